@@ -37,6 +37,8 @@ UDPInterface::UDPInterface(const char* name /*= "UDPInterface"*/) : RNS::Interfa
 	_OUT = true;
 	_bitrate = BITRATE_GUESS;
 	_HW_MTU = 1064;
+	// Datagram size is fixed, so links over UDP can use the full HW MTU
+	_FIXED_MTU = true;
 
 }
 
@@ -212,7 +214,7 @@ UDPInterface::UDPInterface(const char* name /*= "UDPInterface"*/) : RNS::Interfa
 		// Check for incoming packet
 #ifdef ARDUINO
 		udp.parsePacket();
-		size_t len = udp.read(_buffer.writable(Type::Reticulum::MTU), Type::Reticulum::MTU);
+		size_t len = udp.read(_buffer.writable(_HW_MTU), _HW_MTU);
 		if (len > 0) {
 			_buffer.resize(len);
 			on_incoming(_buffer);
@@ -0,0 +1,334 @@
+#include "Buffer.h"
+
+#include "Resource.h"
+#include "Transport.h"
+#include "Log.h"
+#include "Utilities/OS.h"
+
+#include <stdexcept>
+#include <string.h>
+
+using namespace RNS;
+using namespace RNS::Utilities;
+
+namespace {
+
+	// Passes messages on to a reader while it exists, so that the channel
+	// does not keep alive a reader that itself holds the channel
+	class ReaderHandler : public MessageHandler {
+	public:
+		ReaderHandler(const RawChannelReader::Ptr& reader) : _reader(reader) {}
+		virtual bool handle_message(const MessageBase& message) {
+			RawChannelReader::Ptr reader = _reader.lock();
+			return reader ? reader->handle_message(message) : false;
+		}
+	private:
+		std::weak_ptr<RawChannelReader> _reader;
+	};
+
+}
+
+StreamDataMessage::StreamDataMessage(uint16_t stream_id, const Bytes& data, bool eof /*= false*/, bool compressed /*= false*/) :
+	_stream_id(stream_id),
+	_data(data),
+	_eof(eof),
+	_compressed(compressed)
+{
+	if (stream_id > STREAM_ID_MAX) {
+		throw std::invalid_argument("Stream id is too large");
+	}
+}
+
+const Bytes StreamDataMessage::pack() const {
+	uint16_t header_val = (STREAM_ID_MAX & _stream_id) | (_eof ? 0x8000 : 0x0000) | (_compressed ? 0x4000 : 0x0000);
+	Bytes raw(2 + _data.size());
+	raw << (uint8_t)(header_val >> 8) << (uint8_t)header_val;
+	raw << _data;
+	return raw;
+}
+
+void StreamDataMessage::unpack(const Bytes& raw) {
+	if (raw.size() < 2) {
+		throw std::invalid_argument("Stream data message is too short");
+	}
+	uint16_t header_val = (raw.data()[0] << 8) | raw.data()[1];
+	_eof = (header_val & 0x8000) > 0;
+	_compressed = (header_val & 0x4000) > 0;
+	_stream_id = header_val & STREAM_ID_MAX;
+	_data = raw.mid(2);
+	if (_compressed) {
+		// The reference implementation compresses with bz2, which must then
+		// be the codec set for resources
+		if (!Resource::codec()) {
+			throw std::invalid_argument("Compressed stream data is not supported without a codec");
+		}
+		std::unique_ptr<Utilities::Decompressor> decompressor = Resource::codec()->decompressor(MAX_CHUNK_LEN);
+		Bytes data(decompressor->update(_data));
+		data << decompressor->finalize();
+		_data = data;
+	}
+}
+
+
+RawChannelReader::RawChannelReader(uint16_t stream_id, const Channel& channel) :
+	_stream_id(stream_id),
+	_channel(channel)
+{
+	_channel.register_message_type<StreamDataMessage>(true);
+}
+
+RawChannelReader::~RawChannelReader() {
+	if (_handler) {
+		_channel.remove_message_handler(_handler);
+	}
+}
+
+void RawChannelReader::add_ready_callback(Callbacks::ready callback) {
+	for (auto& ready_callback : _ready_callbacks) {
+		if (ready_callback == callback) {
+			return;
+		}
+	}
+	_ready_callbacks.push_back(callback);
+}
+
+void RawChannelReader::remove_ready_callback(Callbacks::ready callback) {
+	_ready_callbacks.remove(callback);
+}
+
+bool RawChannelReader::handle_message(const MessageBase& message) {
+	if (message.msgtype() != StreamDataMessage::MSGTYPE) {
+		return false;
+	}
+	const StreamDataMessage& stream_message = static_cast<const StreamDataMessage&>(message);
+	if (stream_message._stream_id != _stream_id) {
+		return false;
+	}
+	if (stream_message._data.size() > 0) {
+		_chunks.push_back(stream_message._data);
+		_available += stream_message._data.size();
+	}
+	if (stream_message._eof) {
+		_eof = true;
+	}
+	// Iterate a copy, callbacks may remove themselves
+	std::list<Callbacks::ready> ready_callbacks(_ready_callbacks);
+	for (auto& ready_callback : ready_callbacks) {
+		try {
+			ready_callback(_available);
+		}
+		catch (std::exception& e) {
+			ERRORF("Error calling RawChannelReader(%u) callback: %s", _stream_id, e.what());
+		}
+	}
+	return true;
+}
+
+const Bytes RawChannelReader::read_bytes(size_t size /*= SIZE_MAX*/) {
+	if (_available == 0 || size == 0) {
+		return {Bytes::NONE};
+	}
+	Bytes& chunk = _chunks.front();
+	size_t chunk_left = chunk.size() - _offset;
+	// A whole chunk is handed out as is
+	if (_offset == 0 && size >= chunk_left) {
+		Bytes data(chunk);
+		_chunks.pop_front();
+		_available -= data.size();
+		return data;
+	}
+	if (size > _available) {
+		size = _available;
+	}
+	Bytes data(size);
+	readBytes((char*)data.writable(size), size);
+	return data;
+}
+
+void RawChannelReader::close() {
+	if (_handler) {
+		_channel.remove_message_handler(_handler);
+		_handler.reset();
+	}
+	_ready_callbacks.clear();
+}
+
+int RawChannelReader::read() {
+	if (_available == 0) {
+		return -1;
+	}
+	Bytes& chunk = _chunks.front();
+	uint8_t byte = chunk.data()[_offset++];
+	_available -= 1;
+	if (_offset == chunk.size()) {
+		_chunks.pop_front();
+		_offset = 0;
+	}
+	return byte;
+}
+
+int RawChannelReader::peek() {
+	if (_available == 0) {
+		return -1;
+	}
+	return _chunks.front().data()[_offset];
+}
+
+size_t RawChannelReader::readBytes(char* buffer, size_t length) {
+	size_t count = 0;
+	while (count < length && _available > 0) {
+		Bytes& chunk = _chunks.front();
+		size_t chunk_left = chunk.size() - _offset;
+		size_t copy = (length - count < chunk_left) ? length - count : chunk_left;
+		memcpy(buffer + count, chunk.data() + _offset, copy);
+		count += copy;
+		_available -= copy;
+		_offset += copy;
+		if (_offset == chunk.size()) {
+			_chunks.pop_front();
+			_offset = 0;
+		}
+	}
+	return count;
+}
+
+
+RawChannelWriter::RawChannelWriter(uint16_t stream_id, const Channel& channel) :
+	_stream_id(stream_id),
+	_channel(channel)
+{
+	if (stream_id > StreamDataMessage::STREAM_ID_MAX) {
+		throw std::invalid_argument("Stream id is too large");
+	}
+	_max_data_len = _channel.mdu() - (StreamDataMessage::OVERHEAD - Type::Channel::ENVELOPE_HEADER_SIZE);
+	_flush_threshold = _max_data_len;
+}
+
+size_t RawChannelWriter::write(const uint8_t* buffer, size_t size) {
+	if (_eof) {
+		setWriteError();
+		return 0;
+	}
+	size_t count = 0;
+	while (count < size) {
+		if (_pending.size() == _max_data_len && !send_chunk()) {
+			break;
+		}
+		size_t space = _max_data_len - _pending.size();
+		size_t take = (size - count < space) ? size - count : space;
+		_pending.append(buffer + count, take);
+		count += take;
+	}
+	if (_pending.size() >= _flush_threshold) {
+		send_chunk();
+	}
+	if (pending() > 0 && _flush_deadline == 0.0 && _flush_timeout > 0.0) {
+		schedule_flush(OS::time() + _flush_timeout);
+	}
+	return count;
+}
+
+void RawChannelWriter::set_flush_timeout(double timeout) {
+	_flush_timeout = (timeout > 0.0) ? timeout : 0.0;
+	if (_flush_deadline > 0.0) {
+		schedule_flush((_flush_timeout > 0.0) ? OS::time() + _flush_timeout : 0.0);
+	}
+}
+
+int RawChannelWriter::availableForWrite() {
+	if (_eof) {
+		return 0;
+	}
+	if (_pending.size() == _max_data_len) {
+		send_chunk();
+	}
+	return (int)(_max_data_len - _pending.size());
+}
+
+void RawChannelWriter::flush() {
+	while ((_pending.size() > 0 || (_eof && !_eof_sent)) && send_chunk()) {
+	}
+}
+
+/*
+Ends the stream. What is still pending is sent with the end of stream
+marker as soon as the channel allows.
+*/
+void RawChannelWriter::close() {
+	_eof = true;
+	flush();
+	if (pending() > 0 && _flush_deadline == 0.0) {
+		schedule_flush(OS::time() + ((_flush_timeout > 0.0) ? _flush_timeout : Type::Channel::WRITER_FLUSH_TIMEOUT));
+	}
+}
+
+/*
+Runs when the flush deadline passes. Sends what is held, and what the
+channel window has no room for yet is tried again after another timeout
+until the link closes.
+*/
+void RawChannelWriter::__flush_job() {
+	_flush_deadline = 0.0;
+	flush();
+	if (pending() > 0 && _channel.link().status() != Type::Link::CLOSED) {
+		schedule_flush(OS::time() + ((_flush_timeout > 0.0) ? _flush_timeout : Type::Channel::WRITER_FLUSH_TIMEOUT));
+	}
+}
+
+// Sends pending data as one chunk, returns false if the channel is not ready
+bool RawChannelWriter::send_chunk() {
+	if (!_channel.is_ready_to_send()) {
+		return false;
+	}
+	try {
+		StreamDataMessage message(_stream_id, _pending, _eof);
+		_channel.send(message);
+	}
+	catch (ChannelException& e) {
+		if (e.type() != Type::Channel::ME_LINK_NOT_READY) {
+			throw;
+		}
+		return false;
+	}
+	_pending.clear();
+	if (_eof) {
+		_eof_sent = true;
+	}
+	if (_flush_deadline > 0.0) {
+		schedule_flush(0.0);
+	}
+	return true;
+}
+
+// Moves the flush deadline, a deadline of 0 cancels it
+void RawChannelWriter::schedule_flush(double deadline) {
+	if (_flush_deadline > 0.0) {
+		Transport::cancel_deadline(_flush_deadline, _flush_id);
+	}
+	_flush_deadline = deadline;
+	if (deadline > 0.0) {
+		RawChannelWriter::Ptr writer(shared_from_this());
+		_flush_id = Transport::schedule_deadline(deadline, [writer]() { writer->__flush_job(); });
+	}
+}
+
+
+/*static*/ RawChannelReader::Ptr Buffer::create_reader(uint16_t stream_id, const Channel& channel, RawChannelReader::Callbacks::ready ready_callback /*= nullptr*/) {
+	RawChannelReader::Ptr reader(new RawChannelReader(stream_id, channel));
+	reader->_handler = HMessageHandler(new ReaderHandler(reader));
+	const_cast<Channel&>(channel).add_message_handler(reader->_handler);
+	if (ready_callback != nullptr) {
+		reader->add_ready_callback(ready_callback);
+	}
+	return reader;
+}
+
+/*static*/ RawChannelWriter::Ptr Buffer::create_writer(uint16_t stream_id, const Channel& channel) {
+	return RawChannelWriter::Ptr(new RawChannelWriter(stream_id, channel));
+}
+
+/*static*/ ChannelStream::Ptr Buffer::create_bidirectional_buffer(uint16_t receive_stream_id, uint16_t send_stream_id, const Channel& channel, RawChannelReader::Callbacks::ready ready_callback /*= nullptr*/) {
+	RawChannelReader::Ptr reader = create_reader(receive_stream_id, channel, ready_callback);
+	RawChannelWriter::Ptr writer = create_writer(send_stream_id, channel);
+	return ChannelStream::Ptr(new ChannelStream(reader, writer));
+}
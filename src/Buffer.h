@@ -0,0 +1,257 @@
+#pragma once
+
+#include "Channel.h"
+#include "Bytes.h"
+#include "Type.h"
+
+#ifdef ARDUINO
+#include <Stream.h>
+#else
+#include "Utilities/Stream.h"
+#endif
+
+#include <list>
+#include <memory>
+#include <stdint.h>
+
+namespace RNS {
+
+/*
+	Message type used to send a chunk of a stream over a ``Channel``. The
+	two byte header holds the stream id in the low 14 bits, with the top
+	bit set at end of stream and the next bit set for compressed data.
+*/
+	class StreamDataMessage : public MessageBase {
+
+	public:
+		static const uint16_t MSGTYPE = Type::Channel::SMT_STREAM_DATA;
+		// The stream id is limited to 2 bytes - 2 bits
+		static const uint16_t STREAM_ID_MAX = 0x3fff;
+		// 2 for stream data message header, 6 for channel envelope
+		static const uint8_t OVERHEAD = 2 + Type::Channel::ENVELOPE_HEADER_SIZE;
+		// Largest chunk the reference implementation compresses into one message
+		static const uint16_t MAX_CHUNK_LEN = 16 * 1024;
+
+	public:
+		StreamDataMessage() {}
+		StreamDataMessage(uint16_t stream_id, const Bytes& data, bool eof = false, bool compressed = false);
+
+	public:
+		virtual uint16_t msgtype() const { return MSGTYPE; }
+		virtual const Bytes pack() const;
+		virtual void unpack(const Bytes& raw);
+
+	public:
+		uint16_t _stream_id = 0;
+		Bytes _data;
+		bool _eof = false;
+		bool _compressed = false;
+
+	};
+
+/*
+	Receives a stream from a ``Channel``. Received chunks are kept as they
+	arrived and read from in place, read_bytes() hands out whole chunks
+	without copying them where it can.
+
+	Obtained from ``Buffer::create_reader()``, which registers the reader
+	with the channel. The channel holds the reader weakly, and it stays
+	registered until closed, released or the channel shuts down.
+*/
+	class RawChannelReader : public Stream {
+
+	public:
+		class Callbacks {
+		public:
+			// CBA std::function apparently not implemented in NRF52 framework
+			// Called with the number of bytes ready to read as data arrives
+			using ready = void(*)(size_t ready_bytes);
+		};
+
+		using Ptr = std::shared_ptr<RawChannelReader>;
+
+	private:
+		RawChannelReader(uint16_t stream_id, const Channel& channel);
+		friend class Buffer;
+
+	public:
+		virtual ~RawChannelReader();
+
+	public:
+		void add_ready_callback(Callbacks::ready callback);
+		void remove_ready_callback(Callbacks::ready callback);
+		// Returns up to size bytes, or NONE if nothing is ready
+		const Bytes read_bytes(size_t size = SIZE_MAX);
+		// True once the end of the stream was received and all of it read
+		bool eof() const { return _eof && _available == 0; }
+		void close();
+
+		bool handle_message(const MessageBase& message);
+
+		// Print overrides, a reader is not writable
+		using Print::write;
+		virtual size_t write(uint8_t byte) { return 0; }
+
+		// Stream overrides
+		virtual int available() { return (int)_available; }
+		virtual int read();
+		virtual int peek();
+		using Stream::readBytes;
+		// Reads what is ready without waiting for more
+		virtual size_t readBytes(char* buffer, size_t length);
+
+	private:
+		uint16_t _stream_id;
+		Channel _channel;
+		// Registered with the channel on the reader's behalf
+		HMessageHandler _handler;
+		// Received chunks, the first read from _offset on
+		std::list<Bytes> _chunks;
+		size_t _offset = 0;
+		size_t _available = 0;
+		bool _eof = false;
+		std::list<Callbacks::ready> _ready_callbacks;
+
+	};
+
+/*
+	Sends a stream over a ``Channel``. Small writes are gathered into
+	chunks of up to the channel's capacity, and a chunk is sent once it
+	holds at least the flush threshold, once the flush timeout has passed
+	since data was first held, on flush() or on close(). Larger writes are
+	split into chunks.
+
+	Writes are accepted only as far as there is room, so write() returns
+	less than asked for while the channel window is full. flush() and
+	close() send what they can, call flush() again until pending() is 0
+	to complete them. What is left is also sent on the Transport
+	instance's schedule, retried every flush timeout while the link is up.
+
+	Obtained from ``Buffer::create_writer()``.
+*/
+	class RawChannelWriter : public Print, public std::enable_shared_from_this<RawChannelWriter> {
+
+	public:
+		using Ptr = std::shared_ptr<RawChannelWriter>;
+
+	private:
+		RawChannelWriter(uint16_t stream_id, const Channel& channel);
+		friend class Buffer;
+
+	public:
+		virtual ~RawChannelWriter() {}
+
+	public:
+		// Bytes gathered before a chunk is sent, by default a full chunk.
+		// A threshold of 1 sends every write as soon as the channel allows.
+		void set_flush_threshold(size_t threshold) { _flush_threshold = (threshold > 0) ? threshold : 1; }
+		// Seconds written data may be held before it is sent, 0 holds it
+		// until the threshold is reached or flush() is called
+		void set_flush_timeout(double timeout);
+		// Bytes written but not yet sent, including an end of stream not yet sent
+		size_t pending() const { return _pending.size() + ((_eof && !_eof_sent) ? 1 : 0); }
+		void close();
+
+		// Print overrides
+		using Print::write;
+		virtual size_t write(uint8_t byte) { return write(&byte, 1); }
+		virtual size_t write(const uint8_t* buffer, size_t size);
+		virtual int availableForWrite();
+		virtual void flush();
+
+		void __flush_job();
+
+	private:
+		bool send_chunk();
+		void schedule_flush(double deadline);
+
+	private:
+		uint16_t _stream_id;
+		Channel _channel;
+		size_t _max_data_len;
+		size_t _flush_threshold;
+		double _flush_timeout = Type::Channel::WRITER_FLUSH_TIMEOUT;
+		double _flush_deadline = 0.0;
+		uint32_t _flush_id = 0;
+		Bytes _pending;
+		bool _eof = false;
+		bool _eof_sent = false;
+
+	};
+
+/*
+	A reader and a writer on one channel, for a bidirectional byte stream
+	much like a socket.
+*/
+	class ChannelStream : public Stream {
+
+	public:
+		using Ptr = std::shared_ptr<ChannelStream>;
+
+	public:
+		ChannelStream(const RawChannelReader::Ptr& reader, const RawChannelWriter::Ptr& writer) : _reader(reader), _writer(writer) {}
+		virtual ~ChannelStream() {}
+
+	public:
+		const RawChannelReader::Ptr& reader() const { return _reader; }
+		const RawChannelWriter::Ptr& writer() const { return _writer; }
+		void close() { _writer->close(); _reader->close(); }
+
+		// Print overrides
+		using Print::write;
+		virtual size_t write(uint8_t byte) { return _writer->write(byte); }
+		virtual size_t write(const uint8_t* buffer, size_t size) { return _writer->write(buffer, size); }
+		virtual int availableForWrite() { return _writer->availableForWrite(); }
+		virtual void flush() { _writer->flush(); }
+
+		// Stream overrides
+		virtual int available() { return _reader->available(); }
+		virtual int read() { return _reader->read(); }
+		virtual int peek() { return _reader->peek(); }
+		using Stream::readBytes;
+		virtual size_t readBytes(char* buffer, size_t length) { return _reader->readBytes(buffer, length); }
+
+	private:
+		RawChannelReader::Ptr _reader;
+		RawChannelWriter::Ptr _writer;
+
+	};
+
+/*
+	Static functions for creating buffered streams that send and receive
+	over a ``Channel``. Streams are identified by a stream id, which may be
+	used in each direction once on a channel.
+*/
+	class Buffer {
+
+	public:
+		/*
+		Create a reader for a stream on a channel.
+
+		:param stream_id: the local stream id to receive from
+		:param channel: the channel to receive on
+		:param ready_callback: function to call when new data is available
+		*/
+		static RawChannelReader::Ptr create_reader(uint16_t stream_id, const Channel& channel, RawChannelReader::Callbacks::ready ready_callback = nullptr);
+
+		/*
+		Create a writer for a stream on a channel.
+
+		:param stream_id: the remote stream id to send to
+		:param channel: the channel to send on
+		*/
+		static RawChannelWriter::Ptr create_writer(uint16_t stream_id, const Channel& channel);
+
+		/*
+		Create a stream that reads and writes over a channel.
+
+		:param receive_stream_id: the local stream id to receive at
+		:param send_stream_id: the remote stream id to send to
+		:param channel: the channel to send and receive on
+		:param ready_callback: function to call when new data is available
+		*/
+		static ChannelStream::Ptr create_bidirectional_buffer(uint16_t receive_stream_id, uint16_t send_stream_id, const Channel& channel, RawChannelReader::Callbacks::ready ready_callback = nullptr);
+
+	};
+
+}
@@ -6,7 +6,409 @@
 #include "Log.h"
 
 #include <algorithm>
+#include <math.h>
 
 using namespace RNS;
 using namespace RNS::Type::Channel;
 using namespace RNS::Utilities;
+
+/*static*/ bool Envelope::unpack(const Bytes& raw, Envelope& envelope) {
+	if (raw.size() < ENVELOPE_HEADER_SIZE) {
+		return false;
+	}
+	const uint8_t* header = raw.data();
+	uint16_t length = (header[4] << 8) | header[5];
+	if (raw.size() < ENVELOPE_HEADER_SIZE + (size_t)length) {
+		return false;
+	}
+	envelope._msgtype = (header[0] << 8) | header[1];
+	envelope._sequence = (header[2] << 8) | header[3];
+	envelope._data = raw.mid(ENVELOPE_HEADER_SIZE, length);
+	return true;
+}
+
+const Bytes Envelope::pack() const {
+	//p self.raw = struct.pack(">HHH", self.message.MSGTYPE, self.sequence, len(data)) + data
+	Bytes raw(ENVELOPE_HEADER_SIZE + _data.size());
+	raw << (uint8_t)(_msgtype >> 8) << (uint8_t)_msgtype;
+	raw << (uint8_t)(_sequence >> 8) << (uint8_t)_sequence;
+	raw << (uint8_t)(_data.size() >> 8) << (uint8_t)_data.size();
+	raw << _data;
+	return raw;
+}
+
+
+Channel::Channel(const Link& link) : _object(new Object(link)) {
+	assert(_object);
+	// Links too slow for the smallest window send one message at a time
+	if (link.rtt() > RTT_SLOW) {
+		_object->_window = 1;
+		_object->_window_max = 1;
+		_object->_window_min = 1;
+		_object->_window_flexibility = 1;
+	}
+	MEM("Channel object created");
+}
+
+/*
+Register a message class for reception over a ``Channel``.
+
+:param msgtype: The message type, which must be unique on the channel.
+:param factory: A function returning a new instance of the message class.
+:param is_system_type: Whether the type is in the range reserved for system messages.
+*/
+void Channel::register_message_type(uint16_t msgtype, Callbacks::factory factory, bool is_system_type /*= false*/) {
+	assert(_object);
+	if (factory == nullptr) {
+		throw ChannelException(ME_NO_MSG_TYPE, "Message class has no factory");
+	}
+	if (msgtype >= SYSTEM_MSGTYPE_MIN && !is_system_type) {
+		throw ChannelException(ME_INVALID_MSG_TYPE, "Message type is in the range reserved for system messages");
+	}
+	MessageBase::Ptr message = factory();
+	if (!message || message->msgtype() != msgtype) {
+		throw ChannelException(ME_INVALID_MSG_TYPE, "Message class does not create messages of its type");
+	}
+	_object->_message_factories[msgtype] = factory;
+}
+
+/*
+Add a handler for incoming messages. A handler has the following signature:
+
+``bool callback(const MessageBase& message)``
+
+Handlers are called in the order they are added. If a handler returns
+*true*, the message is considered handled and any subsequent handlers are
+skipped.
+
+:param callback: Function to call
+*/
+void Channel::add_message_handler(Callbacks::message callback) {
+	assert(_object);
+	for (auto& message_callback : _object->_message_callbacks) {
+		if (message_callback._callback == callback) {
+			return;
+		}
+	}
+	MessageCallback message_callback;
+	message_callback._callback = callback;
+	_object->_message_callbacks.push_back(message_callback);
+}
+
+void Channel::add_message_handler(const HMessageHandler& handler) {
+	assert(_object);
+	for (auto& message_callback : _object->_message_callbacks) {
+		if (message_callback._handler == handler) {
+			return;
+		}
+	}
+	MessageCallback message_callback;
+	message_callback._handler = handler;
+	_object->_message_callbacks.push_back(message_callback);
+}
+
+void Channel::remove_message_handler(Callbacks::message callback) {
+	assert(_object);
+	_object->_message_callbacks.remove_if([callback](const MessageCallback& message_callback) {
+		return message_callback._callback == callback && !message_callback._handler;
+	});
+}
+
+void Channel::remove_message_handler(const HMessageHandler& handler) {
+	assert(_object);
+	_object->_message_callbacks.remove_if([&handler](const MessageCallback& message_callback) {
+		return message_callback._handler == handler;
+	});
+}
+
+/*
+Check if ``Channel`` is ready to send.
+
+:return: True if ready
+*/
+bool Channel::is_ready_to_send() {
+	assert(_object);
+	if (_object->_link.status() != Type::Link::ACTIVE) {
+		return false;
+	}
+	packets_delivered();
+	return _object->_tx_ring.size() < _object->_window;
+}
+
+/*
+Send a message. If a message send is attempted and ``Channel`` is not
+ready, an exception is thrown.
+
+:param message: an instance of a ``MessageBase`` subclass
+*/
+void Channel::send(const MessageBase& message) {
+	assert(_object);
+	if (!is_ready_to_send()) {
+		throw ChannelException(ME_LINK_NOT_READY, "Link is not ready");
+	}
+	// Checked before the envelope takes a sequence, a gap would stall the receiver
+	Envelope envelope(message.msgtype(), _object->_next_sequence, message.pack());
+	const Bytes raw(envelope.pack());
+	if (raw.size() > _object->_link.get_mdu()) {
+		throw ChannelException(ME_TOO_BIG, "Packed message too big for packet");
+	}
+	_object->_next_sequence = (_object->_next_sequence + 1) % SEQ_MODULUS;
+
+	envelope._packet = Packet(_object->_link, raw, Type::Packet::DATA, Type::Packet::CHANNEL);
+	envelope._packet.send();
+	envelope._tries = 1;
+	envelope._sent_at = OS::time();
+	_object->_tx_ring.push_back(envelope);
+	_object->_tx_ring.back()._timeout = get_packet_timeout_time(1);
+	update_packet_timeouts();
+
+	double deadline = _object->_tx_ring.back()._sent_at + _object->_tx_ring.back()._timeout;
+	if (_object->_watchdog_deadline == 0.0 || deadline < _object->_watchdog_deadline) {
+		schedule_watchdog(deadline);
+	}
+}
+
+/*
+Maximum Data Unit: the number of bytes available
+for a message to consume in a single send. This
+value is adjusted from the ``Link`` MDU to
+accommodate message header information.
+
+:return: number of bytes available
+*/
+uint16_t Channel::mdu() {
+	assert(_object);
+	return _object->_link.get_mdu() - ENVELOPE_HEADER_SIZE;
+}
+
+void Channel::_receive(const Bytes& raw) {
+	assert(_object);
+	Envelope envelope(0, 0, {Bytes::NONE});
+	if (!Envelope::unpack(raw, envelope)) {
+		DEBUGF("Invalid envelope received on %s", toString().c_str());
+		return;
+	}
+
+	// The sender never has more than the maximum window in flight past the
+	// next sequence due, anything else was delivered already or is invalid.
+	// Retransmissions of delivered messages are still proven by the link.
+	uint16_t ahead = (uint16_t)(envelope._sequence - _object->_next_rx_sequence);
+	if (ahead >= WINDOW_MAX) {
+		TRACEF("Invalid packet sequence (%u) received on %s", envelope._sequence, toString().c_str());
+		return;
+	}
+	for (auto& existing : _object->_rx_ring) {
+		if (existing._sequence == envelope._sequence) {
+			TRACEF("Duplicate message with sequence %u received on %s", envelope._sequence, toString().c_str());
+			return;
+		}
+	}
+	_object->_rx_ring.push_back(envelope);
+
+	// Deliver the envelopes that are now in sequence. The ring is searched
+	// again each time since handlers may shut the channel down.
+	while (_object->_rx_ring.size() > 0) {
+		auto iter = std::find_if(_object->_rx_ring.begin(), _object->_rx_ring.end(), [this](const Envelope& next) {
+			return next._sequence == _object->_next_rx_sequence;
+		});
+		if (iter == _object->_rx_ring.end()) {
+			break;
+		}
+		Envelope next(*iter);
+		_object->_rx_ring.erase(iter);
+		_object->_next_rx_sequence = (_object->_next_rx_sequence + 1) % SEQ_MODULUS;
+
+		auto factory = _object->_message_factories.find(next._msgtype);
+		if (factory == _object->_message_factories.end()) {
+			ERRORF("Unable to find constructor for message type 0x%04x on %s, dropping message", next._msgtype, toString().c_str());
+			continue;
+		}
+		MessageBase::Ptr message = (*factory).second();
+		try {
+			message->unpack(next._data);
+		}
+		catch (std::exception& e) {
+			ERRORF("Could not unpack message of type 0x%04x on %s. The contained exception was: %s", next._msgtype, toString().c_str(), e.what());
+			continue;
+		}
+		run_callbacks(*message);
+	}
+}
+
+void Channel::_shutdown() {
+	assert(_object);
+	_object->_message_callbacks.clear();
+	_object->_tx_ring.clear();
+	_object->_rx_ring.clear();
+	schedule_watchdog(0.0);
+}
+
+/*
+Retransmission timers run as a job on the Transport instance's deadline
+schedule, set to when the oldest unproven envelope times out.
+*/
+void Channel::schedule_watchdog(double deadline) {
+	assert(_object);
+	if (_object->_watchdog_deadline > 0.0) {
+		Transport::cancel_deadline(_object->_watchdog_deadline, _object->_watchdog_id);
+	}
+	_object->_watchdog_deadline = deadline;
+	if (deadline > 0.0) {
+		Channel channel(*this);
+		_object->_watchdog_id = Transport::schedule_deadline(deadline, [channel]() mutable { channel.__watchdog_job(); });
+	}
+}
+
+void Channel::__watchdog_job() {
+	assert(_object);
+	// The deadline that ran this job has already been taken off the schedule
+	_object->_watchdog_deadline = 0.0;
+	if (_object->_link.status() == Type::Link::CLOSED) {
+		return;
+	}
+	packets_delivered();
+
+	double now = OS::time();
+	double next_deadline = 0.0;
+	for (auto& envelope : _object->_tx_ring) {
+		if (envelope._sent_at + envelope._timeout <= now) {
+			if (!packet_timed_out(envelope)) {
+				return;
+			}
+		}
+		double deadline = envelope._sent_at + envelope._timeout;
+		if (next_deadline == 0.0 || deadline < next_deadline) {
+			next_deadline = deadline;
+		}
+	}
+	if (next_deadline > 0.0) {
+		schedule_watchdog(next_deadline);
+	}
+}
+
+// Releases the envelopes proven by the other end and widens the window
+void Channel::packets_delivered() {
+	assert(_object);
+	auto iter = _object->_tx_ring.begin();
+	while (iter != _object->_tx_ring.end()) {
+		if (packet_state(*iter) != MSGSTATE_DELIVERED) {
+			++iter;
+			continue;
+		}
+		iter = _object->_tx_ring.erase(iter);
+
+		if (_object->_window < _object->_window_max) {
+			_object->_window += 1;
+		}
+
+		double rtt = _object->_link.rtt();
+		if (rtt != 0.0) {
+			if (rtt > RTT_FAST) {
+				_object->_fast_rate_rounds = 0;
+
+				if (rtt > RTT_MEDIUM) {
+					_object->_medium_rate_rounds = 0;
+				}
+				else {
+					_object->_medium_rate_rounds += 1;
+					if (_object->_window_max < WINDOW_MAX_MEDIUM && _object->_medium_rate_rounds == FAST_RATE_THRESHOLD) {
+						_object->_window_max = WINDOW_MAX_MEDIUM;
+						_object->_window_min = WINDOW_MIN_LIMIT_MEDIUM;
+					}
+				}
+			}
+			else {
+				_object->_fast_rate_rounds += 1;
+				if (_object->_window_max < WINDOW_MAX_FAST && _object->_fast_rate_rounds == FAST_RATE_THRESHOLD) {
+					_object->_window_max = WINDOW_MAX_FAST;
+					_object->_window_min = WINDOW_MIN_LIMIT_FAST;
+				}
+			}
+		}
+	}
+}
+
+/*
+Sends an envelope that was not proven in time again and narrows the window.
+
+:returns: *False* if the envelope has run out of tries and the link was torn down.
+*/
+bool Channel::packet_timed_out(Envelope& envelope) {
+	assert(_object);
+	if (envelope._tries >= _object->_max_tries) {
+		ERRORF("Retry count exceeded on %s, tearing down link.", toString().c_str());
+		Link link(_object->_link);
+		_shutdown();
+		link.teardown();
+		return false;
+	}
+	envelope._tries += 1;
+	if (!envelope._packet.resend()) {
+		ERRORF("Failed to resend packet on %s", toString().c_str());
+	}
+	envelope._sent_at = OS::time();
+	envelope._timeout = get_packet_timeout_time(envelope._tries);
+	update_packet_timeouts();
+
+	if (_object->_window > _object->_window_min) {
+		_object->_window -= 1;
+		if (_object->_window_max > (_object->_window_min + _object->_window_flexibility)) {
+			_object->_window_max -= 1;
+		}
+	}
+	return true;
+}
+
+double Channel::get_packet_timeout_time(uint8_t tries) const {
+	assert(_object);
+	return pow(1.5, tries - 1) * std::max(_object->_link.rtt() * 2.5, 0.025) * (_object->_tx_ring.size() + 1.5);
+}
+
+// Timeouts grow with the number of envelopes in flight, never shrink
+void Channel::update_packet_timeouts() {
+	assert(_object);
+	for (auto& envelope : _object->_tx_ring) {
+		double updated_timeout = get_packet_timeout_time(envelope._tries);
+		if (updated_timeout > envelope._timeout) {
+			envelope._timeout = updated_timeout;
+		}
+	}
+}
+
+Type::Channel::MessageState Channel::packet_state(const Envelope& envelope) const {
+	if (!envelope._packet || !envelope._packet.receipt()) {
+		return MSGSTATE_FAILED;
+	}
+	switch (envelope._packet.receipt().status()) {
+	case Type::PacketReceipt::SENT:
+		return MSGSTATE_SENT;
+	case Type::PacketReceipt::DELIVERED:
+		return MSGSTATE_DELIVERED;
+	default:
+		return MSGSTATE_FAILED;
+	}
+}
+
+void Channel::run_callbacks(const MessageBase& message) {
+	assert(_object);
+	// Iterate a copy, handlers may add or remove handlers
+	std::list<MessageCallback> message_callbacks(_object->_message_callbacks);
+	for (auto& message_callback : message_callbacks) {
+		try {
+			bool handled = message_callback._callback ? message_callback._callback(message) : message_callback._handler->handle_message(message);
+			if (handled) {
+				return;
+			}
+		}
+		catch (std::exception& e) {
+			ERRORF("Error while executing message handler on %s. The contained exception was: %s", toString().c_str(), e.what());
+		}
+	}
+}
+
+std::string Channel::toString() const {
+	if (!_object) {
+		return "";
+	}
+	return "{Channel:" + _object->_link.toString() + "}";
+}
@@ -1,47 +1,203 @@
 #pragma once
 
-#include "Destination.h"
+#include "Link.h"
+#include "Packet.h"
+#include "Bytes.h"
 #include "Type.h"
 
+#include <list>
+#include <map>
 #include <memory>
+#include <stdexcept>
 #include <cassert>
 
 namespace RNS {
 
+/*
+	Base of the messages sent over a ``Channel``. Subclasses declare a
+	unique ``static const uint16_t MSGTYPE`` below 0xf000, return it from
+	msgtype(), and must be default-constructible so that the receiving
+	channel can create them before unpacking.
+*/
+	class MessageBase {
+	public:
+		using Ptr = std::shared_ptr<MessageBase>;
+	public:
+		virtual ~MessageBase() {}
+		virtual uint16_t msgtype() const = 0;
+		// Create and return the binary representation of the message
+		virtual const Bytes pack() const = 0;
+		// Populate message from binary representation
+		virtual void unpack(const Bytes& raw) = 0;
+	};
+
+	// An object receiving messages from a channel, for handlers that need state
+	class MessageHandler {
+	public:
+		virtual ~MessageHandler() {}
+		// Returns true if the message was handled, which ends its processing
+		virtual bool handle_message(const MessageBase& message) = 0;
+	};
+	using HMessageHandler = std::shared_ptr<MessageHandler>;
+
+	class ChannelException : public std::runtime_error {
+	public:
+		ChannelException(Type::Channel::MessageError type, const char* what) : std::runtime_error(what), _type(type) {}
+		Type::Channel::MessageError type() const { return _type; }
+	private:
+		Type::Channel::MessageError _type;
+	};
+
+/*
+	Internal wrapper used to transport messages over a channel and track
+	their state within the channel framework. On the wire an envelope is
+	the message type, sequence and data length as big-endian 16 bit values,
+	followed by the packed message.
+*/
+	class Envelope {
+	public:
+		Envelope(uint16_t msgtype, uint16_t sequence, const Bytes& data) : _msgtype(msgtype), _sequence(sequence), _data(data) {}
+	public:
+		static bool unpack(const Bytes& raw, Envelope& envelope);
+		const Bytes pack() const;
+	public:
+		uint16_t _msgtype = 0;
+		uint16_t _sequence = 0;
+		Bytes _data;
+		// Sending side, the packet carrying the envelope and its retransmission timer
+		Packet _packet = {Type::NONE};
+		uint8_t _tries = 0;
+		double _sent_at = 0.0;
+		double _timeout = 0.0;
+	};
+
+/*
+	Provides reliable delivery of messages over a link.
+
+	``Channel`` differs from ``Request`` and ``Resource`` in some important
+	ways:
+
+	 - **Continuous:** Messages can be sent or received as long as the
+	   ``Link`` is open.
+	 - **Bi-directional:** Messages can be sent in either direction on the
+	   ``Link``, neither end is the client or server.
+	 - **Size-constrained:** Messages must be encoded into a single packet.
+
+	Up to a window of messages are in flight at once, each proven by the
+	other end of the link. The window adapts to the round-trip time of the
+	link, and messages that are not proven in time are sent again. Received
+	messages are delivered to the message handlers in sequence.
+
+	``Channel`` is not instantiated directly, but rather obtained from a
+	``Link`` with ``get_channel()``.
+*/
 	class Channel {
 
+	public:
+		class Callbacks {
+		public:
+			// CBA std::function apparently not implemented in NRF52 framework
+			using factory = MessageBase::Ptr(*)();
+			// Returns true if the message was handled, which ends its processing
+			using message = bool(*)(const MessageBase& message);
+		};
+
 	public:
 		Channel(Type::NoneConstructor none) {
 			MEM("Channel NONE object created");
 		}
-		Channel(const Channel& resource) : _object(resource._object) {
+		Channel(const Channel& channel) : _object(channel._object) {
 			MEM("Channel object copy created");
 		}
+		Channel(const Link& link);
 		virtual ~Channel(){
 			MEM("Channel object destroyed");
 		}
 
-		Channel& operator = (const Channel& resource) {
-			_object = resource._object;
+		Channel& operator = (const Channel& channel) {
+			_object = channel._object;
 			return *this;
 		}
 		operator bool() const {
 			return _object.get() != nullptr;
 		}
-		bool operator < (const Channel& resource) const {
-			return _object.get() < resource._object.get();
-			//return _object->_hash < resource._object->_hash;
+		bool operator < (const Channel& channel) const {
+			return _object.get() < channel._object.get();
 		}
 
 	public:
-		void _shutdown() {}
+		template<class M> static MessageBase::Ptr create_message() { return MessageBase::Ptr(new M()); }
+
+	public:
+		/*
+		Register a message class for reception over a ``Channel``.
+
+		Message classes must extend ``MessageBase``, and are registered
+		by type, e.g. ``channel.register_message_type<MyMessage>()``.
+		*/
+		template<class M> void register_message_type(bool is_system_type = false) {
+			register_message_type(M::MSGTYPE, &create_message<M>, is_system_type);
+		}
+		void register_message_type(uint16_t msgtype, Callbacks::factory factory, bool is_system_type = false);
+		void add_message_handler(Callbacks::message callback);
+		void add_message_handler(const HMessageHandler& handler);
+		void remove_message_handler(Callbacks::message callback);
+		void remove_message_handler(const HMessageHandler& handler);
+		bool is_ready_to_send();
+		void send(const MessageBase& message);
+		uint16_t mdu();
+		void _receive(const Bytes& raw);
+		void _shutdown();
+		void schedule_watchdog(double deadline);
+		void __watchdog_job();
+
+		std::string toString() const;
+
+		// getters
+		uint8_t window() const { assert(_object); return _object->_window; }
+		uint8_t window_max() const { assert(_object); return _object->_window_max; }
+		uint8_t window_min() const { assert(_object); return _object->_window_min; }
+		size_t outstanding() const { assert(_object); return _object->_tx_ring.size(); }
+		const Link& link() const { assert(_object); return _object->_link; }
 
 	private:
+		void packets_delivered();
+		bool packet_timed_out(Envelope& envelope);
+		double get_packet_timeout_time(uint8_t tries) const;
+		void update_packet_timeouts();
+		Type::Channel::MessageState packet_state(const Envelope& envelope) const;
+		void run_callbacks(const MessageBase& message);
+
+	private:
+		class MessageCallback {
+		public:
+			Callbacks::message _callback = nullptr;
+			HMessageHandler _handler;
+		};
+
 		class Object {
 		public:
-			Object() { MEM("Channel::Data object created, this: " + std::to_string((uintptr_t)this)); }
+			Object(const Link& link) : _link(link) { MEM("Channel::Data object created, this: " + std::to_string((uintptr_t)this)); }
 			virtual ~Object() { MEM("Channel::Data object destroyed, this: " + std::to_string((uintptr_t)this)); }
 		private:
+			Link _link;
+			// Sent envelopes not yet proven, in sequence
+			std::list<Envelope> _tx_ring;
+			// Received envelopes waiting for an earlier sequence
+			std::list<Envelope> _rx_ring;
+			std::list<MessageCallback> _message_callbacks;
+			std::map<uint16_t, Callbacks::factory> _message_factories;
+			uint16_t _next_sequence = 0;
+			uint16_t _next_rx_sequence = 0;
+			uint8_t _max_tries = Type::Channel::MAX_TRIES;
+			uint8_t _fast_rate_rounds = 0;
+			uint8_t _medium_rate_rounds = 0;
+			uint8_t _window = Type::Channel::WINDOW;
+			uint8_t _window_max = Type::Channel::WINDOW_MAX_SLOW;
+			uint8_t _window_min = Type::Channel::WINDOW_MIN;
+			uint8_t _window_flexibility = Type::Channel::WINDOW_FLEXIBILITY;
+			double _watchdog_deadline = 0.0;
+			uint32_t _watchdog_id = 0;
 
 		friend class Channel;
 		};
@@ -49,9 +205,4 @@ namespace RNS {
 
 	};
 
-
-	class ChannelAdvertisement {
-
-	};
-
 }
@@ -1,48 +1,34 @@
 #pragma once
 
-#include "CBC.h"
+#include "Provider.h"
 
 #include "../Bytes.h"
 
-#include <AES.h>
-
 namespace RNS { namespace Cryptography {
 
 	class AES_128_CBC {
 
 	public:
 		static inline const Bytes encrypt(const Bytes& plaintext, const Bytes& key, const Bytes& iv) {
-			CBC<AES128> cbc;
-			cbc.setKey(key.data(), key.size());
-			cbc.setIV(iv.data(), iv.size());
 			Bytes ciphertext;
-			cbc.encrypt(ciphertext.writable(plaintext.size()), plaintext.data(), plaintext.size());
+			Provider::aes_cbc_encrypt(ciphertext.writable(plaintext.size()), plaintext.data(), plaintext.size(), key.data(), key.size(), iv.data());
 			return ciphertext;
 		}
 
 		static inline const Bytes decrypt(const Bytes& ciphertext, const Bytes& key, const Bytes& iv) {
-			CBC<AES128> cbc;
-			cbc.setKey(key.data(), key.size());
-			cbc.setIV(iv.data(), iv.size());
 			Bytes plaintext;
-			cbc.decrypt(plaintext.writable(ciphertext.size()), ciphertext.data(), ciphertext.size());
+			Provider::aes_cbc_decrypt(plaintext.writable(ciphertext.size()), ciphertext.data(), ciphertext.size(), key.data(), key.size(), iv.data());
 			return plaintext;
 		}
 
 		// EXPERIMENTAL - overwrites passed buffer
 		static inline void inplace_encrypt(Bytes& plaintext, const Bytes& key, const Bytes& iv) {
-			CBC<AES128> cbc;
-			cbc.setKey(key.data(), key.size());
-			cbc.setIV(iv.data(), iv.size());
-			cbc.encrypt((uint8_t*)plaintext.data(), plaintext.data(), plaintext.size());
+			Provider::aes_cbc_encrypt((uint8_t*)plaintext.data(), plaintext.data(), plaintext.size(), key.data(), key.size(), iv.data());
 		}
 
 		// EXPERIMENTAL - overwrites passed buffer
 		static inline void inplace_decrypt(Bytes& ciphertext, const Bytes& key, const Bytes& iv) {
-			CBC<AES128> cbc;
-			cbc.setKey(key.data(), key.size());
-			cbc.setIV(iv.data(), iv.size());
-			cbc.decrypt((uint8_t*)ciphertext.data(), ciphertext.data(), ciphertext.size());
+			Provider::aes_cbc_decrypt((uint8_t*)ciphertext.data(), ciphertext.data(), ciphertext.size(), key.data(), key.size(), iv.data());
 		}
 
 	};
@@ -51,37 +37,25 @@ namespace RNS { namespace Cryptography {
 
 	public:
 		static inline const Bytes encrypt(const Bytes& plaintext, const Bytes& key, const Bytes& iv) {
-			CBC<AES256> cbc;
-			cbc.setKey(key.data(), key.size());
-			cbc.setIV(iv.data(), iv.size());
 			Bytes ciphertext;
-			cbc.encrypt(ciphertext.writable(plaintext.size()), plaintext.data(), plaintext.size());
+			Provider::aes_cbc_encrypt(ciphertext.writable(plaintext.size()), plaintext.data(), plaintext.size(), key.data(), key.size(), iv.data());
 			return ciphertext;
 		}
 
 		static inline const Bytes decrypt(const Bytes& ciphertext, const Bytes& key, const Bytes& iv) {
-			CBC<AES256> cbc;
-			cbc.setKey(key.data(), key.size());
-			cbc.setIV(iv.data(), iv.size());
 			Bytes plaintext;
-			cbc.decrypt(plaintext.writable(ciphertext.size()), ciphertext.data(), ciphertext.size());
+			Provider::aes_cbc_decrypt(plaintext.writable(ciphertext.size()), ciphertext.data(), ciphertext.size(), key.data(), key.size(), iv.data());
 			return plaintext;
 		}
 
 		// EXPERIMENTAL - overwrites passed buffer
 		static inline void inplace_encrypt(Bytes& plaintext, const Bytes& key, const Bytes& iv) {
-			CBC<AES256> cbc;
-			cbc.setKey(key.data(), key.size());
-			cbc.setIV(iv.data(), iv.size());
-			cbc.encrypt((uint8_t*)plaintext.data(), plaintext.data(), plaintext.size());
+			Provider::aes_cbc_encrypt((uint8_t*)plaintext.data(), plaintext.data(), plaintext.size(), key.data(), key.size(), iv.data());
 		}
 
 		// EXPERIMENTAL - overwrites passed buffer
 		static inline void inplace_decrypt(Bytes& ciphertext, const Bytes& key, const Bytes& iv) {
-			CBC<AES256> cbc;
-			cbc.setKey(key.data(), key.size());
-			cbc.setIV(iv.data(), iv.size());
-			cbc.decrypt((uint8_t*)ciphertext.data(), ciphertext.data(), ciphertext.size());
+			Provider::aes_cbc_decrypt((uint8_t*)ciphertext.data(), ciphertext.data(), ciphertext.size(), key.data(), key.size(), iv.data());
 		}
 
 	};
@@ -24,6 +24,178 @@
 #include <Crypto.h>
 #include <string.h>
 
+#if defined(CRYPTO_CBC_AESNI)
+#include <AES.h>
+#include <cpuid.h>
+#include <emmintrin.h>
+#include <wmmintrin.h>
+
+#define AESNI_TARGET __attribute__((target("aes,sse2")))
+
+// AES-128 key schedule step, see Intel's AES-NI white paper.
+AESNI_TARGET static inline __m128i aesni_expand128(__m128i key, __m128i assist)
+{
+    assist = _mm_shuffle_epi32(assist, 0xff);
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    return _mm_xor_si128(key, assist);
+}
+
+// Second half of an AES-256 key schedule step.
+AESNI_TARGET static inline __m128i aesni_expand256(__m128i key, __m128i assist)
+{
+    assist = _mm_shuffle_epi32(assist, 0xaa);
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    return _mm_xor_si128(key, assist);
+}
+
+// Expands the key into encryption and decryption round keys, returning
+// the number of rounds or zero for an unsupported key length.
+AESNI_TARGET static uint8_t aesni_set_key(uint8_t* encKeys, uint8_t* decKeys, const uint8_t* key, size_t len)
+{
+    __m128i k[15];
+    uint8_t rounds;
+    if (len == 16) {
+        rounds = 10;
+        k[0] = _mm_loadu_si128((const __m128i*)key);
+#define AESNI_EXPAND128(i, rcon) \
+        k[i] = aesni_expand128(k[i - 1], _mm_aeskeygenassist_si128(k[i - 1], rcon))
+        AESNI_EXPAND128(1, 0x01);
+        AESNI_EXPAND128(2, 0x02);
+        AESNI_EXPAND128(3, 0x04);
+        AESNI_EXPAND128(4, 0x08);
+        AESNI_EXPAND128(5, 0x10);
+        AESNI_EXPAND128(6, 0x20);
+        AESNI_EXPAND128(7, 0x40);
+        AESNI_EXPAND128(8, 0x80);
+        AESNI_EXPAND128(9, 0x1b);
+        AESNI_EXPAND128(10, 0x36);
+#undef AESNI_EXPAND128
+    } else if (len == 32) {
+        rounds = 14;
+        k[0] = _mm_loadu_si128((const __m128i*)key);
+        k[1] = _mm_loadu_si128((const __m128i*)(key + 16));
+#define AESNI_EXPAND256(i, rcon) \
+        k[i] = aesni_expand128(k[i - 2], _mm_aeskeygenassist_si128(k[i - 1], rcon)); \
+        k[i + 1] = aesni_expand256(k[i - 1], _mm_aeskeygenassist_si128(k[i], 0x00))
+        AESNI_EXPAND256(2, 0x01);
+        AESNI_EXPAND256(4, 0x02);
+        AESNI_EXPAND256(6, 0x04);
+        AESNI_EXPAND256(8, 0x08);
+        AESNI_EXPAND256(10, 0x10);
+        AESNI_EXPAND256(12, 0x20);
+#undef AESNI_EXPAND256
+        k[14] = aesni_expand128(k[12], _mm_aeskeygenassist_si128(k[13], 0x40));
+    } else {
+        return 0;
+    }
+    // The equivalent inverse cipher runs the rounds backwards with
+    // InvMixColumns applied to the inner round keys.
+    for (uint8_t round = 0; round <= rounds; ++round) {
+        _mm_storeu_si128((__m128i*)(encKeys + round * 16), k[round]);
+        __m128i dk = k[rounds - round];
+        if (round != 0 && round != rounds)
+            dk = _mm_aesimc_si128(dk);
+        _mm_storeu_si128((__m128i*)(decKeys + round * 16), dk);
+    }
+    for (uint8_t round = 0; round <= rounds; ++round)
+        k[round] = _mm_setzero_si128();
+    return rounds;
+}
+
+AESNI_TARGET static void aesni_cbc_encrypt(const uint8_t* encKeys, uint8_t rounds, uint8_t* iv, uint8_t* output, const uint8_t* input, size_t len)
+{
+    __m128i k[15];
+    for (uint8_t round = 0; round <= rounds; ++round)
+        k[round] = _mm_loadu_si128((const __m128i*)(encKeys + round * 16));
+    __m128i state = _mm_loadu_si128((const __m128i*)iv);
+    while (len >= 16) {
+        state = _mm_xor_si128(state, _mm_loadu_si128((const __m128i*)input));
+        state = _mm_xor_si128(state, k[0]);
+        for (uint8_t round = 1; round < rounds; ++round)
+            state = _mm_aesenc_si128(state, k[round]);
+        state = _mm_aesenclast_si128(state, k[rounds]);
+        _mm_storeu_si128((__m128i*)output, state);
+        input += 16;
+        output += 16;
+        len -= 16;
+    }
+    _mm_storeu_si128((__m128i*)iv, state);
+}
+
+// Decrypts eight blocks at a time so that the AESDEC latency of one block
+// is hidden behind the others, each block is then XORed with the previous
+// ciphertext block. All blocks of a group are loaded before any is stored,
+// so output may alias input.
+template <int rounds>
+AESNI_TARGET static void aesni_cbc_decrypt(const uint8_t* decKeys, uint8_t* iv, uint8_t* output, const uint8_t* input, size_t len)
+{
+    __m128i k[15];
+    for (uint8_t round = 0; round <= rounds; ++round)
+        k[round] = _mm_loadu_si128((const __m128i*)(decKeys + round * 16));
+    __m128i prev = _mm_loadu_si128((const __m128i*)iv);
+    while (len >= 8 * 16) {
+        const __m128i* in = (const __m128i*)input;
+        __m128i c0 = _mm_loadu_si128(in);
+        __m128i c1 = _mm_loadu_si128(in + 1);
+        __m128i c2 = _mm_loadu_si128(in + 2);
+        __m128i c3 = _mm_loadu_si128(in + 3);
+        __m128i c4 = _mm_loadu_si128(in + 4);
+        __m128i c5 = _mm_loadu_si128(in + 5);
+        __m128i c6 = _mm_loadu_si128(in + 6);
+        __m128i c7 = _mm_loadu_si128(in + 7);
+        __m128i b0 = _mm_xor_si128(c0, k[0]);
+        __m128i b1 = _mm_xor_si128(c1, k[0]);
+        __m128i b2 = _mm_xor_si128(c2, k[0]);
+        __m128i b3 = _mm_xor_si128(c3, k[0]);
+        __m128i b4 = _mm_xor_si128(c4, k[0]);
+        __m128i b5 = _mm_xor_si128(c5, k[0]);
+        __m128i b6 = _mm_xor_si128(c6, k[0]);
+        __m128i b7 = _mm_xor_si128(c7, k[0]);
+        for (int round = 1; round < rounds; ++round) {
+            __m128i rk = k[round];
+            b0 = _mm_aesdec_si128(b0, rk);
+            b1 = _mm_aesdec_si128(b1, rk);
+            b2 = _mm_aesdec_si128(b2, rk);
+            b3 = _mm_aesdec_si128(b3, rk);
+            b4 = _mm_aesdec_si128(b4, rk);
+            b5 = _mm_aesdec_si128(b5, rk);
+            b6 = _mm_aesdec_si128(b6, rk);
+            b7 = _mm_aesdec_si128(b7, rk);
+        }
+        __m128i* out = (__m128i*)output;
+        _mm_storeu_si128(out, _mm_xor_si128(_mm_aesdeclast_si128(b0, k[rounds]), prev));
+        _mm_storeu_si128(out + 1, _mm_xor_si128(_mm_aesdeclast_si128(b1, k[rounds]), c0));
+        _mm_storeu_si128(out + 2, _mm_xor_si128(_mm_aesdeclast_si128(b2, k[rounds]), c1));
+        _mm_storeu_si128(out + 3, _mm_xor_si128(_mm_aesdeclast_si128(b3, k[rounds]), c2));
+        _mm_storeu_si128(out + 4, _mm_xor_si128(_mm_aesdeclast_si128(b4, k[rounds]), c3));
+        _mm_storeu_si128(out + 5, _mm_xor_si128(_mm_aesdeclast_si128(b5, k[rounds]), c4));
+        _mm_storeu_si128(out + 6, _mm_xor_si128(_mm_aesdeclast_si128(b6, k[rounds]), c5));
+        _mm_storeu_si128(out + 7, _mm_xor_si128(_mm_aesdeclast_si128(b7, k[rounds]), c6));
+        prev = c7;
+        input += 8 * 16;
+        output += 8 * 16;
+        len -= 8 * 16;
+    }
+    while (len >= 16) {
+        __m128i c = _mm_loadu_si128((const __m128i*)input);
+        __m128i b = _mm_xor_si128(c, k[0]);
+        for (uint8_t round = 1; round < rounds; ++round)
+            b = _mm_aesdec_si128(b, k[round]);
+        b = _mm_aesdeclast_si128(b, k[rounds]);
+        _mm_storeu_si128((__m128i*)output, _mm_xor_si128(b, prev));
+        prev = c;
+        input += 16;
+        output += 16;
+        len -= 16;
+    }
+    _mm_storeu_si128((__m128i*)iv, prev);
+}
+#endif
+
 /**
  * \class CBCCommon CBC.h <CBC.h>
  * \brief Concrete base class to assist with implementing CBC for
@@ -42,6 +214,9 @@
 CBCCommon::CBCCommon()
     : blockCipher(0)
     , posn(16)
+#if defined(CRYPTO_CBC_AESNI)
+    , rounds(0)
+#endif
 {
 }
 
@@ -52,8 +227,31 @@ CBCCommon::~CBCCommon()
 {
     clean(iv);
     clean(temp);
+#if defined(CRYPTO_CBC_AESNI)
+    clean(encKeys);
+    clean(decKeys);
+#endif
 }
 
+#if defined(CRYPTO_CBC_AESNI)
+/**
+ * \brief Returns true if the CPU supports the AES-NI instructions.
+ *
+ * Checked once, CBC objects for AES-128 and AES-256 use AES-NI for
+ * encryption and decryption when this returns true.
+ */
+bool CBCCommon::hasAESNI()
+{
+    static const bool supported = []() {
+        unsigned int eax, ebx, ecx, edx;
+        if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+            return false;
+        return (ecx & bit_AES) != 0 && (edx & bit_SSE2) != 0;
+    }();
+    return supported;
+}
+#endif
+
 size_t CBCCommon::keySize() const
 {
     return blockCipher->keySize();
@@ -71,7 +269,17 @@ bool CBCCommon::setKey(const uint8_t* key, size_t len)
         return false;
 
     // Set the key on the underlying block cipher.
-    return blockCipher->setKey(key, len);
+    if (!blockCipher->setKey(key, len))
+        return false;
+
+#if defined(CRYPTO_CBC_AESNI)
+    // Use AES-NI in place of the block cipher when it is AES and the CPU
+    // supports it, the block cipher stays keyed as the fallback.
+    rounds = 0;
+    if (hasAESNI() && dynamic_cast<AESCommon*>(blockCipher) != 0)
+        rounds = aesni_set_key(encKeys, decKeys, key, len);
+#endif
+    return true;
 }
 
 bool CBCCommon::setIV(const uint8_t* iv, size_t len)
@@ -85,6 +293,12 @@ bool CBCCommon::setIV(const uint8_t* iv, size_t len)
 
 void CBCCommon::encrypt(uint8_t* output, const uint8_t* input, size_t len)
 {
+#if defined(CRYPTO_CBC_AESNI)
+    if (rounds) {
+        aesni_cbc_encrypt(encKeys, rounds, iv, output, input, len);
+        return;
+    }
+#endif
     uint8_t posn;
     while (len >= 16) {
         for (posn = 0; posn < 16; ++posn)
@@ -98,6 +312,15 @@ void CBCCommon::encrypt(uint8_t* output, const uint8_t* input, size_t len)
 
 void CBCCommon::decrypt(uint8_t* output, const uint8_t* input, size_t len)
 {
+#if defined(CRYPTO_CBC_AESNI)
+    if (rounds) {
+        if (rounds == 10)
+            aesni_cbc_decrypt<10>(decKeys, iv, output, input, len);
+        else
+            aesni_cbc_decrypt<14>(decKeys, iv, output, input, len);
+        return;
+    }
+#endif
     uint8_t posn;
     while (len >= 16) {
         blockCipher->decryptBlock(temp, input);
@@ -116,6 +339,11 @@ void CBCCommon::clear()
     clean(iv);
     clean(temp);
     posn = 16;
+#if defined(CRYPTO_CBC_AESNI)
+    clean(encKeys);
+    clean(decKeys);
+    rounds = 0;
+#endif
 }
 
 /**
@@ -26,6 +26,14 @@
 #include <Cipher.h>
 #include <BlockCipher.h>
 
+// AES-NI code path for AES-128 and AES-256, selected at runtime on x86-64.
+// To compare it with the per-block fallback, run the aes*_cbc cases of
+// test_crypto_bench under the native environment, once as is and once with
+// -DRNS_CBC_NO_AESNI added to its build_flags.
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__)) && !defined(RNS_CBC_NO_AESNI)
+#define CRYPTO_CBC_AESNI
+#endif
+
 class CBCCommon : public Cipher
 {
 public:
@@ -42,6 +50,10 @@ public:
 
     void clear();
 
+#if defined(CRYPTO_CBC_AESNI)
+    static bool hasAESNI();
+#endif
+
 protected:
     CBCCommon();
     void setBlockCipher(BlockCipher *cipher) { blockCipher = cipher; }
@@ -51,6 +63,12 @@ private:
     uint8_t iv[16];
     uint8_t temp[16];
     uint8_t posn;
+#if defined(CRYPTO_CBC_AESNI)
+    // Round keys for the AES-NI path, rounds is zero when it is not in use
+    uint8_t rounds;
+    uint8_t encKeys[15 * 16];
+    uint8_t decKeys[15 * 16];
+#endif
 };
 
 template <typename T>
@@ -0,0 +1,596 @@
+#include "Curve25519Group.h"
+
+#if defined(RNS_CURVE25519_GROUP)
+
+using namespace RNS::Cryptography::Group;
+
+namespace {
+
+	const uint8_t ed25519_d[32] = {
+		0xa3, 0x78, 0x59, 0x13, 0xca, 0x4d, 0xeb, 0x75, 0xab, 0xd8, 0x41, 0x41, 0x4d, 0x0a, 0x70, 0x00,
+		0x98, 0xe8, 0x79, 0x77, 0x79, 0x40, 0xc7, 0x8c, 0x73, 0xfe, 0x6f, 0x2b, 0xee, 0x6c, 0x03, 0x52
+	};
+	const uint8_t ed25519_base_x[32] = {
+		0x1a, 0xd5, 0x25, 0x8f, 0x60, 0x2d, 0x56, 0xc9, 0xb2, 0xa7, 0x25, 0x95, 0x60, 0xc7, 0x2c, 0x69,
+		0x5c, 0xdc, 0xd6, 0xfd, 0x31, 0xe2, 0xa4, 0xc0, 0xfe, 0x53, 0x6e, 0xcd, 0xd3, 0x36, 0x69, 0x21
+	};
+	const uint8_t ed25519_base_y[32] = {
+		0x58, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+		0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66
+	};
+
+	const uint8_t sqrtm1_bytes[32] = {
+		0xb0, 0xa0, 0x0e, 0x4a, 0x27, 0x1b, 0xee, 0xc4, 0x78, 0xe4, 0x2f, 0xad, 0x06, 0x18, 0x43, 0x2f,
+		0xa7, 0xd7, 0xfb, 0x3d, 0x99, 0x00, 0x4d, 0x2b, 0x0b, 0xdf, 0xc1, 0x4f, 0x80, 0x24, 0x83, 0x2b
+	};
+
+	// Bit offset and width of each limb
+	const uint8_t fe_offset[10] = { 0, 26, 51, 77, 102, 128, 153, 179, 204, 230 };
+	inline int fe_bits(int i) { return (i & 1) ? 25 : 26; }
+
+	// Propagates carries so that every limb fits its width, with the carry
+	// out of the top limb folded back in as 2^255 = 19
+	void fe_carry(fe h, int64_t t[10]) {
+		for (int i = 0; i < 10; i++) {
+			int bits = fe_bits(i);
+			int64_t c = (t[i] + ((int64_t)1 << (bits - 1))) >> bits;
+			t[i] -= c * ((int64_t)1 << bits);
+			if (i < 9) {
+				t[i + 1] += c;
+			}
+			else {
+				t[0] += c * 19;
+			}
+		}
+		int64_t c = (t[0] + ((int64_t)1 << 25)) >> 26;
+		t[0] -= c * ((int64_t)1 << 26);
+		t[1] += c;
+		for (int i = 0; i < 10; i++) {
+			h[i] = (int32_t)t[i];
+		}
+	}
+
+	void fe_sqn(fe h, const fe f, int n) {
+		fe_sq(h, f);
+		for (int i = 1; i < n; i++) {
+			fe_sq(h, h);
+		}
+	}
+
+}
+
+void RNS::Cryptography::Group::fe_add(fe h, const fe f, const fe g) {
+	int64_t t[10];
+	for (int i = 0; i < 10; i++) {
+		t[i] = (int64_t)f[i] + g[i];
+	}
+	fe_carry(h, t);
+}
+
+void RNS::Cryptography::Group::fe_sub(fe h, const fe f, const fe g) {
+	int64_t t[10];
+	for (int i = 0; i < 10; i++) {
+		t[i] = (int64_t)f[i] - g[i];
+	}
+	fe_carry(h, t);
+}
+
+void RNS::Cryptography::Group::fe_neg(fe h, const fe f) {
+	for (int i = 0; i < 10; i++) {
+		h[i] = -f[i];
+	}
+}
+
+void RNS::Cryptography::Group::fe_mul(fe h, const fe f, const fe g) {
+	int32_t f0 = f[0], f1 = f[1], f2 = f[2], f3 = f[3], f4 = f[4], f5 = f[5], f6 = f[6], f7 = f[7], f8 = f[8], f9 = f[9];
+	int32_t g0 = g[0], g1 = g[1], g2 = g[2], g3 = g[3], g4 = g[4], g5 = g[5], g6 = g[6], g7 = g[7], g8 = g[8], g9 = g[9];
+	// Limbs past the top wrap around as 2^255 = 19
+	int32_t g1_19 = 19 * g1, g2_19 = 19 * g2, g3_19 = 19 * g3, g4_19 = 19 * g4, g5_19 = 19 * g5, g6_19 = 19 * g6, g7_19 = 19 * g7, g8_19 = 19 * g8, g9_19 = 19 * g9;
+	// Odd limbs are offset by half a bit, two of them make up a whole one
+	int32_t f1_2 = 2 * f1, f3_2 = 2 * f3, f5_2 = 2 * f5, f7_2 = 2 * f7, f9_2 = 2 * f9;
+	int64_t t[10];
+	t[0] = (int64_t)f0 * g0 + (int64_t)f1_2 * g9_19 + (int64_t)f2 * g8_19 + (int64_t)f3_2 * g7_19 + (int64_t)f4 * g6_19 + (int64_t)f5_2 * g5_19 + (int64_t)f6 * g4_19 + (int64_t)f7_2 * g3_19 + (int64_t)f8 * g2_19 + (int64_t)f9_2 * g1_19;
+	t[1] = (int64_t)f0 * g1 + (int64_t)f1 * g0 + (int64_t)f2 * g9_19 + (int64_t)f3 * g8_19 + (int64_t)f4 * g7_19 + (int64_t)f5 * g6_19 + (int64_t)f6 * g5_19 + (int64_t)f7 * g4_19 + (int64_t)f8 * g3_19 + (int64_t)f9 * g2_19;
+	t[2] = (int64_t)f0 * g2 + (int64_t)f1_2 * g1 + (int64_t)f2 * g0 + (int64_t)f3_2 * g9_19 + (int64_t)f4 * g8_19 + (int64_t)f5_2 * g7_19 + (int64_t)f6 * g6_19 + (int64_t)f7_2 * g5_19 + (int64_t)f8 * g4_19 + (int64_t)f9_2 * g3_19;
+	t[3] = (int64_t)f0 * g3 + (int64_t)f1 * g2 + (int64_t)f2 * g1 + (int64_t)f3 * g0 + (int64_t)f4 * g9_19 + (int64_t)f5 * g8_19 + (int64_t)f6 * g7_19 + (int64_t)f7 * g6_19 + (int64_t)f8 * g5_19 + (int64_t)f9 * g4_19;
+	t[4] = (int64_t)f0 * g4 + (int64_t)f1_2 * g3 + (int64_t)f2 * g2 + (int64_t)f3_2 * g1 + (int64_t)f4 * g0 + (int64_t)f5_2 * g9_19 + (int64_t)f6 * g8_19 + (int64_t)f7_2 * g7_19 + (int64_t)f8 * g6_19 + (int64_t)f9_2 * g5_19;
+	t[5] = (int64_t)f0 * g5 + (int64_t)f1 * g4 + (int64_t)f2 * g3 + (int64_t)f3 * g2 + (int64_t)f4 * g1 + (int64_t)f5 * g0 + (int64_t)f6 * g9_19 + (int64_t)f7 * g8_19 + (int64_t)f8 * g7_19 + (int64_t)f9 * g6_19;
+	t[6] = (int64_t)f0 * g6 + (int64_t)f1_2 * g5 + (int64_t)f2 * g4 + (int64_t)f3_2 * g3 + (int64_t)f4 * g2 + (int64_t)f5_2 * g1 + (int64_t)f6 * g0 + (int64_t)f7_2 * g9_19 + (int64_t)f8 * g8_19 + (int64_t)f9_2 * g7_19;
+	t[7] = (int64_t)f0 * g7 + (int64_t)f1 * g6 + (int64_t)f2 * g5 + (int64_t)f3 * g4 + (int64_t)f4 * g3 + (int64_t)f5 * g2 + (int64_t)f6 * g1 + (int64_t)f7 * g0 + (int64_t)f8 * g9_19 + (int64_t)f9 * g8_19;
+	t[8] = (int64_t)f0 * g8 + (int64_t)f1_2 * g7 + (int64_t)f2 * g6 + (int64_t)f3_2 * g5 + (int64_t)f4 * g4 + (int64_t)f5_2 * g3 + (int64_t)f6 * g2 + (int64_t)f7_2 * g1 + (int64_t)f8 * g0 + (int64_t)f9_2 * g9_19;
+	t[9] = (int64_t)f0 * g9 + (int64_t)f1 * g8 + (int64_t)f2 * g7 + (int64_t)f3 * g6 + (int64_t)f4 * g5 + (int64_t)f5 * g4 + (int64_t)f6 * g3 + (int64_t)f7 * g2 + (int64_t)f8 * g1 + (int64_t)f9 * g0;
+	fe_carry(h, t);
+}
+
+void RNS::Cryptography::Group::fe_sq(fe h, const fe f) {
+	fe_mul(h, f, f);
+}
+
+// h = z^(p-2) = 1/z
+void RNS::Cryptography::Group::fe_invert(fe out, const fe z) {
+	fe t0, t1, t2, t3;
+	fe_sq(t0, z);				// 2
+	fe_sqn(t1, t0, 2);			// 8
+	fe_mul(t1, z, t1);			// 9
+	fe_mul(t0, t0, t1);			// 11
+	fe_sq(t2, t0);				// 22
+	fe_mul(t1, t1, t2);			// 2^5 - 1
+	fe_sqn(t2, t1, 5);
+	fe_mul(t1, t2, t1);			// 2^10 - 1
+	fe_sqn(t2, t1, 10);
+	fe_mul(t2, t2, t1);			// 2^20 - 1
+	fe_sqn(t3, t2, 20);
+	fe_mul(t2, t3, t2);			// 2^40 - 1
+	fe_sqn(t2, t2, 10);
+	fe_mul(t1, t2, t1);			// 2^50 - 1
+	fe_sqn(t2, t1, 50);
+	fe_mul(t2, t2, t1);			// 2^100 - 1
+	fe_sqn(t3, t2, 100);
+	fe_mul(t2, t3, t2);			// 2^200 - 1
+	fe_sqn(t2, t2, 50);
+	fe_mul(t1, t2, t1);			// 2^250 - 1
+	fe_sqn(t1, t1, 5);			// 2^255 - 32
+	fe_mul(out, t1, t0);		// 2^255 - 21
+}
+
+void RNS::Cryptography::Group::fe_frombytes(fe h, const uint8_t s[32]) {
+	int64_t t[10];
+	for (int i = 0; i < 10; i++) {
+		int64_t v = 0;
+		int bits = fe_bits(i);
+		for (int b = 0; b < bits; b++) {
+			int pos = fe_offset[i] + b;
+			// The top bit of the encoding is ignored
+			if (pos < 255 && ((s[pos >> 3] >> (pos & 7)) & 1)) {
+				v |= (int64_t)1 << b;
+			}
+		}
+		t[i] = v;
+	}
+	fe_carry(h, t);
+}
+
+void RNS::Cryptography::Group::fe_tobytes(uint8_t s[32], const fe f) {
+	int32_t h[10];
+	fe_copy(h, f);
+	// q is 1 if h >= p, after which h - q*p is the canonical value
+	int32_t q = (19 * h[9] + ((int32_t)1 << 24)) >> 25;
+	for (int i = 0; i < 10; i++) {
+		q = (h[i] + q) >> fe_bits(i);
+	}
+	h[0] += 19 * q;
+	for (int i = 0; i < 9; i++) {
+		int32_t c = h[i] >> fe_bits(i);
+		h[i + 1] += c;
+		h[i] -= c * ((int32_t)1 << fe_bits(i));
+	}
+	h[9] &= ((int32_t)1 << 25) - 1;
+	memset(s, 0, 32);
+	for (int i = 0; i < 10; i++) {
+		for (int b = 0; b < fe_bits(i); b++) {
+			if ((h[i] >> b) & 1) {
+				int pos = fe_offset[i] + b;
+				s[pos >> 3] |= (uint8_t)(1 << (pos & 7));
+			}
+		}
+	}
+}
+
+void RNS::Cryptography::Group::fe_cmov(fe f, const fe g, uint32_t b) {
+	int32_t mask = -(int32_t)b;
+	for (int i = 0; i < 10; i++) {
+		f[i] ^= (f[i] ^ g[i]) & mask;
+	}
+}
+
+
+namespace {
+
+	// z^((p-5)/8) = z^(2^252 - 3), for square roots
+	void fe_pow22523(fe out, const fe z) {
+		fe t0, t1, t2;
+		fe_sq(t0, z);				// 2
+		fe_sqn(t1, t0, 2);			// 8
+		fe_mul(t1, z, t1);			// 9
+		fe_mul(t0, t0, t1);			// 11
+		fe_sq(t0, t0);				// 22
+		fe_mul(t0, t1, t0);			// 2^5 - 1
+		fe_sqn(t1, t0, 5);
+		fe_mul(t0, t1, t0);			// 2^10 - 1
+		fe_sqn(t1, t0, 10);
+		fe_mul(t1, t1, t0);			// 2^20 - 1
+		fe_sqn(t2, t1, 20);
+		fe_mul(t1, t2, t1);			// 2^40 - 1
+		fe_sqn(t1, t1, 10);
+		fe_mul(t0, t1, t0);			// 2^50 - 1
+		fe_sqn(t1, t0, 50);
+		fe_mul(t1, t1, t0);			// 2^100 - 1
+		fe_sqn(t2, t1, 100);
+		fe_mul(t1, t2, t1);			// 2^200 - 1
+		fe_sqn(t1, t1, 50);
+		fe_mul(t0, t1, t0);			// 2^250 - 1
+		fe_sqn(t0, t0, 2);			// 2^252 - 4
+		fe_mul(out, t0, z);			// 2^252 - 3
+	}
+
+	bool fe_isnegative(const fe f) {
+		uint8_t s[32];
+		fe_tobytes(s, f);
+		return (s[0] & 1) != 0;
+	}
+
+	bool fe_isnonzero(const fe f) {
+		uint8_t s[32];
+		fe_tobytes(s, f);
+		uint8_t bits = 0;
+		for (int i = 0; i < 32; i++) {
+			bits |= s[i];
+		}
+		return bits != 0;
+	}
+
+	// Curve constants, decoded once
+	class Constants {
+	public:
+		Constants() {
+			fe_frombytes(d, ed25519_d);
+			fe_add(d2, d, d);
+			fe_frombytes(sqrtm1, sqrtm1_bytes);
+		}
+		fe d;
+		fe d2;
+		fe sqrtm1;
+	};
+
+	const Constants& constants() {
+		static Constants values;
+		return values;
+	}
+
+	void ge_p3_to_precomp(ge_precomp& r, const ge_p3& p) {
+		fe recip, x, y;
+		fe_invert(recip, p.Z);
+		fe_mul(x, p.X, recip);
+		fe_mul(y, p.Y, recip);
+		fe_add(r.yplusx, y, x);
+		fe_sub(r.yminusx, y, x);
+		fe_mul(r.xy2d, x, y);
+		fe_mul(r.xy2d, r.xy2d, constants().d2);
+	}
+
+	void ge_base(ge_p3& h) {
+		fe_frombytes(h.X, ed25519_base_x);
+		fe_frombytes(h.Y, ed25519_base_y);
+		fe_1(h.Z);
+		fe_mul(h.T, h.X, h.Y);
+	}
+
+	// Fills row with j * p for j in 1..8
+	void ge_multiples(ge_precomp row[8], const ge_p3& p) {
+		ge_p1p1 r;
+		ge_p3_to_precomp(row[0], p);
+		ge_p3 multiple = p;
+		for (int j = 1; j < 8; j++) {
+			ge_madd(r, multiple, row[0]);
+			ge_p1p1_to_p3(multiple, r);
+			ge_p3_to_precomp(row[j], multiple);
+		}
+	}
+
+#if defined(RNS_X25519_FIXED_BASE)
+	// Table of j * 16^(2i) * B, built once on first use
+	class BaseTable {
+	public:
+		BaseTable() {
+			ge_p3 row_base;
+			ge_base(row_base);
+			ge_p1p1 r;
+			for (int i = 0; i < 32; i++) {
+				ge_multiples(_table[i], row_base);
+				// Next row starts at 256 times this one
+				for (int k = 0; k < 8; k++) {
+					ge_p3_dbl(r, row_base);
+					ge_p1p1_to_p3(row_base, r);
+				}
+			}
+		}
+
+		const ge_precomp* row(int pos) const {
+			return _table[pos];
+		}
+
+	private:
+		ge_precomp _table[32][8];
+	};
+
+	const BaseTable& base_table() {
+		static BaseTable table;
+		return table;
+	}
+#else
+	// Without the table only the first row is kept
+	class BaseMultiples {
+	public:
+		BaseMultiples() {
+			ge_p3 base;
+			ge_base(base);
+			ge_multiples(_row, base);
+		}
+
+		const ge_precomp* row() const {
+			return _row;
+		}
+
+	private:
+		ge_precomp _row[8];
+	};
+#endif
+
+	// Selects b * row[0] for b in -8..8 in constant time
+	void select(ge_precomp& t, const ge_precomp row[8], int8_t b) {
+		uint8_t bnegative = (uint8_t)b >> 7;
+		int8_t bmask = (int8_t)(b >> 7);
+		uint8_t babs = (uint8_t)((b ^ bmask) - bmask);
+		ge_precomp_0(t);
+		for (int j = 0; j < 8; j++) {
+			uint32_t equal = ((uint32_t)(babs ^ (j + 1)) - 1) >> 31;
+			fe_cmov(t.yplusx, row[j].yplusx, equal);
+			fe_cmov(t.yminusx, row[j].yminusx, equal);
+			fe_cmov(t.xy2d, row[j].xy2d, equal);
+		}
+		ge_precomp minus_t;
+		fe_copy(minus_t.yplusx, t.yminusx);
+		fe_copy(minus_t.yminusx, t.yplusx);
+		fe_neg(minus_t.xy2d, t.xy2d);
+		fe_cmov(t.yplusx, minus_t.yplusx, bnegative);
+		fe_cmov(t.yminusx, minus_t.yminusx, bnegative);
+		fe_cmov(t.xy2d, minus_t.xy2d, bnegative);
+	}
+
+}
+
+void RNS::Cryptography::Group::ge_p3_0(ge_p3& h) {
+	fe_0(h.X);
+	fe_1(h.Y);
+	fe_1(h.Z);
+	fe_0(h.T);
+}
+
+void RNS::Cryptography::Group::ge_precomp_0(ge_precomp& h) {
+	fe_1(h.yplusx);
+	fe_1(h.yminusx);
+	fe_0(h.xy2d);
+}
+
+void RNS::Cryptography::Group::ge_p1p1_to_p2(ge_p2& r, const ge_p1p1& p) {
+	fe_mul(r.X, p.X, p.T);
+	fe_mul(r.Y, p.Y, p.Z);
+	fe_mul(r.Z, p.Z, p.T);
+}
+
+void RNS::Cryptography::Group::ge_p1p1_to_p3(ge_p3& r, const ge_p1p1& p) {
+	fe_mul(r.X, p.X, p.T);
+	fe_mul(r.Y, p.Y, p.Z);
+	fe_mul(r.Z, p.Z, p.T);
+	fe_mul(r.T, p.X, p.Y);
+}
+
+void RNS::Cryptography::Group::ge_p3_to_cached(ge_cached& r, const ge_p3& p) {
+	fe_add(r.YplusX, p.Y, p.X);
+	fe_sub(r.YminusX, p.Y, p.X);
+	fe_copy(r.Z, p.Z);
+	fe_mul(r.T2d, p.T, constants().d2);
+}
+
+void RNS::Cryptography::Group::ge_p2_dbl(ge_p1p1& r, const ge_p2& p) {
+	fe t0;
+	fe_sq(r.X, p.X);
+	fe_sq(r.Z, p.Y);
+	fe_sq(r.T, p.Z);
+	fe_add(r.T, r.T, r.T);
+	fe_add(r.Y, p.X, p.Y);
+	fe_sq(t0, r.Y);
+	fe_add(r.Y, r.Z, r.X);
+	fe_sub(r.Z, r.Z, r.X);
+	fe_sub(r.X, t0, r.Y);
+	fe_sub(r.T, r.T, r.Z);
+}
+
+void RNS::Cryptography::Group::ge_p3_dbl(ge_p1p1& r, const ge_p3& p) {
+	ge_p2 q;
+	fe_copy(q.X, p.X);
+	fe_copy(q.Y, p.Y);
+	fe_copy(q.Z, p.Z);
+	ge_p2_dbl(r, q);
+}
+
+void RNS::Cryptography::Group::ge_add(ge_p1p1& r, const ge_p3& p, const ge_cached& q) {
+	fe t0;
+	fe_add(r.X, p.Y, p.X);
+	fe_sub(r.Y, p.Y, p.X);
+	fe_mul(r.Z, r.X, q.YplusX);
+	fe_mul(r.Y, r.Y, q.YminusX);
+	fe_mul(r.T, q.T2d, p.T);
+	fe_mul(r.X, p.Z, q.Z);
+	fe_add(t0, r.X, r.X);
+	fe_sub(r.X, r.Z, r.Y);
+	fe_add(r.Y, r.Z, r.Y);
+	fe_add(r.Z, t0, r.T);
+	fe_sub(r.T, t0, r.T);
+}
+
+void RNS::Cryptography::Group::ge_sub(ge_p1p1& r, const ge_p3& p, const ge_cached& q) {
+	fe t0;
+	fe_add(r.X, p.Y, p.X);
+	fe_sub(r.Y, p.Y, p.X);
+	fe_mul(r.Z, r.X, q.YminusX);
+	fe_mul(r.Y, r.Y, q.YplusX);
+	fe_mul(r.T, q.T2d, p.T);
+	fe_mul(r.X, p.Z, q.Z);
+	fe_add(t0, r.X, r.X);
+	fe_sub(r.X, r.Z, r.Y);
+	fe_add(r.Y, r.Z, r.Y);
+	fe_sub(r.Z, t0, r.T);
+	fe_add(r.T, t0, r.T);
+}
+
+void RNS::Cryptography::Group::ge_madd(ge_p1p1& r, const ge_p3& p, const ge_precomp& q) {
+	fe t0;
+	fe_add(r.X, p.Y, p.X);
+	fe_sub(r.Y, p.Y, p.X);
+	fe_mul(r.Z, r.X, q.yplusx);
+	fe_mul(r.Y, r.Y, q.yminusx);
+	fe_mul(r.T, q.xy2d, p.T);
+	fe_add(t0, p.Z, p.Z);
+	fe_sub(r.X, r.Z, r.Y);
+	fe_add(r.Y, r.Z, r.Y);
+	fe_add(r.Z, t0, r.T);
+	fe_sub(r.T, t0, r.T);
+}
+
+void RNS::Cryptography::Group::ge_msub(ge_p1p1& r, const ge_p3& p, const ge_precomp& q) {
+	fe t0;
+	fe_add(r.X, p.Y, p.X);
+	fe_sub(r.Y, p.Y, p.X);
+	fe_mul(r.Z, r.X, q.yminusx);
+	fe_mul(r.Y, r.Y, q.yplusx);
+	fe_mul(r.T, q.xy2d, p.T);
+	fe_add(t0, p.Z, p.Z);
+	fe_sub(r.X, r.Z, r.Y);
+	fe_add(r.Y, r.Z, r.Y);
+	fe_sub(r.Z, t0, r.T);
+	fe_add(r.T, t0, r.T);
+}
+
+bool RNS::Cryptography::Group::ge_frombytes_negate_vartime(ge_p3& h, const uint8_t s[32]) {
+	const Constants& c = constants();
+	fe u, v, v3, vxx, check;
+	fe_frombytes(h.Y, s);
+	fe_1(h.Z);
+	fe_sq(u, h.Y);
+	fe_mul(v, u, c.d);
+	fe_sub(u, u, h.Z);			// u = y^2 - 1
+	fe_add(v, v, h.Z);			// v = d y^2 + 1
+
+	// x = u v^3 (u v^7)^((p-5)/8)
+	fe_sq(v3, v);
+	fe_mul(v3, v3, v);
+	fe_sq(h.X, v3);
+	fe_mul(h.X, h.X, v);
+	fe_mul(h.X, h.X, u);
+	fe_pow22523(h.X, h.X);
+	fe_mul(h.X, h.X, v3);
+	fe_mul(h.X, h.X, u);
+
+	// Either x or x * sqrt(-1) is the root, if there is one
+	fe_sq(vxx, h.X);
+	fe_mul(vxx, vxx, v);
+	fe_sub(check, vxx, u);
+	if (fe_isnonzero(check)) {
+		fe_add(check, vxx, u);
+		if (fe_isnonzero(check)) {
+			return false;
+		}
+		fe_mul(h.X, h.X, c.sqrtm1);
+	}
+
+	// Take the root of the opposite sign to the encoding
+	if (fe_isnegative(h.X) == ((s[31] >> 7) != 0)) {
+		fe_neg(h.X, h.X);
+	}
+	fe_mul(h.T, h.X, h.Y);
+	return true;
+}
+
+void RNS::Cryptography::Group::ge_p3_tobytes(uint8_t s[32], const ge_p3& h) {
+	fe recip, x, y;
+	fe_invert(recip, h.Z);
+	fe_mul(x, h.X, recip);
+	fe_mul(y, h.Y, recip);
+	fe_tobytes(s, y);
+	s[31] ^= (uint8_t)(fe_isnegative(x) << 7);
+}
+
+void RNS::Cryptography::Group::scalar_digits(int8_t e[64], const uint8_t a[32]) {
+	for (int i = 0; i < 32; i++) {
+		e[2 * i + 0] = a[i] & 15;
+		e[2 * i + 1] = (a[i] >> 4) & 15;
+	}
+	int8_t carry = 0;
+	for (int i = 0; i < 63; i++) {
+		e[i] += carry;
+		carry = (int8_t)((e[i] + 8) >> 4);
+		e[i] -= (int8_t)(carry * 16);
+	}
+	e[63] += carry;
+}
+
+const ge_precomp* RNS::Cryptography::Group::base_multiples() {
+#if defined(RNS_X25519_FIXED_BASE)
+	return base_table().row(0);
+#else
+	static BaseMultiples multiples;
+	return multiples.row();
+#endif
+}
+
+void RNS::Cryptography::Group::ge_scalarmult_base(ge_p3& h, const uint8_t a[32]) {
+	int8_t e[64];
+	scalar_digits(e, a);
+
+#if defined(RNS_X25519_FIXED_BASE)
+	const BaseTable& table = base_table();
+	ge_p1p1 r;
+	ge_p2 s;
+	ge_precomp t;
+
+	ge_p3_0(h);
+	for (int i = 1; i < 64; i += 2) {
+		select(t, table.row(i / 2), e[i]);
+		ge_madd(r, h, t);
+		ge_p1p1_to_p3(h, r);
+	}
+
+	ge_p3_dbl(r, h);
+	ge_p1p1_to_p2(s, r);
+	ge_p2_dbl(r, s);
+	ge_p1p1_to_p2(s, r);
+	ge_p2_dbl(r, s);
+	ge_p1p1_to_p2(s, r);
+	ge_p2_dbl(r, s);
+	ge_p1p1_to_p3(h, r);
+
+	for (int i = 0; i < 64; i += 2) {
+		select(t, table.row(i / 2), e[i]);
+		ge_madd(r, h, t);
+		ge_p1p1_to_p3(h, r);
+	}
+#else
+	// Horner's rule over the digits, four doublings each, selecting from the
+	// single row of multiples
+	const ge_precomp* row = base_multiples();
+	ge_p1p1 r;
+	ge_p2 s;
+	ge_precomp t;
+
+	ge_p3_0(h);
+	for (int i = 63; i >= 0; i--) {
+		if (i < 63) {
+			ge_p3_dbl(r, h);
+			ge_p1p1_to_p2(s, r);
+			ge_p2_dbl(r, s);
+			ge_p1p1_to_p2(s, r);
+			ge_p2_dbl(r, s);
+			ge_p1p1_to_p2(s, r);
+			ge_p2_dbl(r, s);
+			ge_p1p1_to_p3(h, r);
+		}
+		select(t, row, e[i]);
+		ge_madd(r, h, t);
+		ge_p1p1_to_p3(h, r);
+	}
+#endif
+	memset(e, 0, sizeof(e));
+}
+
+#endif
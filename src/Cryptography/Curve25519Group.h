@@ -0,0 +1,80 @@
+#pragma once
+
+#include "X25519.h"
+
+#include <string.h>
+#include <stdint.h>
+
+/*
+
+Arithmetic in the field GF(2^255 - 19) and on the twisted Edwards curve of
+Ed25519, after ref10, for the default crypto backend. X25519.cpp builds
+fixed-base public key derivation on it and Ed25519.cpp signing and
+verification.
+
+Field elements use the ref10 representation of ten signed limbs of
+alternately 26 and 25 bits.
+
+*/
+
+#if defined(RNS_CURVE25519_GROUP)
+
+namespace RNS { namespace Cryptography { namespace Group {
+
+	typedef int32_t fe[10];
+
+	// Extended coordinates, x = X/Z, y = Y/Z, x*y = T/Z
+	struct ge_p3 { fe X; fe Y; fe Z; fe T; };
+	// Projective coordinates, x = X/Z, y = Y/Z
+	struct ge_p2 { fe X; fe Y; fe Z; };
+	// Completed coordinates, x = X/Z, y = Y/T
+	struct ge_p1p1 { fe X; fe Y; fe Z; fe T; };
+	// Affine point prepared for mixed addition
+	struct ge_precomp { fe yplusx; fe yminusx; fe xy2d; };
+	// Extended point prepared for addition
+	struct ge_cached { fe YplusX; fe YminusX; fe Z; fe T2d; };
+
+	inline void fe_0(fe h) { memset(h, 0, sizeof(fe)); }
+	inline void fe_1(fe h) { memset(h, 0, sizeof(fe)); h[0] = 1; }
+	inline void fe_copy(fe h, const fe f) { memcpy(h, f, sizeof(fe)); }
+
+	void fe_add(fe h, const fe f, const fe g);
+	void fe_sub(fe h, const fe f, const fe g);
+	void fe_neg(fe h, const fe f);
+	void fe_mul(fe h, const fe f, const fe g);
+	void fe_sq(fe h, const fe f);
+	void fe_invert(fe out, const fe z);
+	void fe_frombytes(fe h, const uint8_t s[32]);
+	void fe_tobytes(uint8_t s[32], const fe f);
+	// Replaces f with g if b is 1, leaves it otherwise, without branching on b
+	void fe_cmov(fe f, const fe g, uint32_t b);
+
+	void ge_p3_0(ge_p3& h);
+	void ge_precomp_0(ge_precomp& h);
+	void ge_p1p1_to_p2(ge_p2& r, const ge_p1p1& p);
+	void ge_p1p1_to_p3(ge_p3& r, const ge_p1p1& p);
+	void ge_p3_to_cached(ge_cached& r, const ge_p3& p);
+	void ge_p2_dbl(ge_p1p1& r, const ge_p2& p);
+	void ge_p3_dbl(ge_p1p1& r, const ge_p3& p);
+	// r = p + q and r = p - q
+	void ge_add(ge_p1p1& r, const ge_p3& p, const ge_cached& q);
+	void ge_sub(ge_p1p1& r, const ge_p3& p, const ge_cached& q);
+	void ge_madd(ge_p1p1& r, const ge_p3& p, const ge_precomp& q);
+	void ge_msub(ge_p1p1& r, const ge_p3& p, const ge_precomp& q);
+	// Decodes a point and negates it, returns false if s encodes no point.
+	// Runs in variable time, for public keys only.
+	bool ge_frombytes_negate_vartime(ge_p3& h, const uint8_t s[32]);
+	// Encodes as y with the sign of x in the top bit
+	void ge_p3_tobytes(uint8_t s[32], const ge_p3& h);
+
+	// Signed radix-16 digits of a scalar below 2^255, each in -8..8
+	void scalar_digits(int8_t e[64], const uint8_t a[32]);
+	// j * B for j in 1..8
+	const ge_precomp* base_multiples();
+	// h = a * B for a scalar a below 2^255, in constant time. Builds without
+	// the fixed-base table double between digits and run slower.
+	void ge_scalarmult_base(ge_p3& h, const uint8_t a[32]);
+
+} } }
+
+#endif
@@ -1,3 +1,256 @@
 #include "Ed25519.h"
 
+#include <string.h>
+
 using namespace RNS::Cryptography;
+
+#if defined(RNS_CURVE25519_GROUP)
+
+using namespace RNS::Cryptography::Group;
+
+/*
+
+Ed25519 signing from an expanded key, with the nonce point R = r * B taken
+from the fixed-base table in Curve25519Group.cpp, and verification from a
+decoded public key.
+
+Scalars are reduced modulo the group order L by shifting in one bit at a
+time and conditionally subtracting L. This is slow next to the radix-2^21
+reduction of ref10, but still small against the point multiplication, and
+it runs in constant time without branching on the secret scalar or nonce.
+
+*/
+
+namespace {
+
+	// Group order L = 2^252 + 27742317777372353535851937790883648493, little-endian words
+	const uint32_t group_order[8] = {
+		0x5cf5d3ed, 0x5812631a, 0xa2f79cd6, 0x14def9de, 0x00000000, 0x00000000, 0x00000000, 0x10000000
+	};
+
+	// True if s is below L, as RFC 8032 requires of the S half of a signature
+	bool sc_is_canonical(const uint8_t s[32]) {
+		for (int i = 31; i >= 0; i--) {
+			uint8_t l = (uint8_t)(group_order[i >> 2] >> (8 * (i & 3)));
+			if (s[i] != l) {
+				return s[i] < l;
+			}
+		}
+		return false;
+	}
+
+	// out = x mod L for a little-endian number of count words
+	void sc_reduce(uint8_t out[32], const uint32_t* x, size_t count) {
+		uint32_t r[8] = {0};
+		for (size_t bit = count * 32; bit-- > 0; ) {
+			// r = 2r + bit, below 2L and so within 254 bits
+			uint32_t carry = (x[bit >> 5] >> (bit & 31)) & 1;
+			for (int i = 0; i < 8; i++) {
+				uint32_t next = r[i] >> 31;
+				r[i] = (r[i] << 1) | carry;
+				carry = next;
+			}
+			// r = r - L unless that borrows
+			uint32_t t[8];
+			uint32_t borrow = 0;
+			for (int i = 0; i < 8; i++) {
+				uint64_t d = (uint64_t)r[i] - group_order[i] - borrow;
+				t[i] = (uint32_t)d;
+				borrow = (uint32_t)(d >> 63);
+			}
+			uint32_t keep = (uint32_t)0 - borrow;
+			for (int i = 0; i < 8; i++) {
+				r[i] = (r[i] & keep) | (t[i] & ~keep);
+			}
+		}
+		for (int i = 0; i < 32; i++) {
+			out[i] = (uint8_t)(r[i >> 2] >> (8 * (i & 3)));
+		}
+		memset(r, 0, sizeof(r));
+	}
+
+	void sc_reduce64(uint8_t out[32], const uint8_t in[64]) {
+		uint32_t x[16];
+		for (int i = 0; i < 16; i++) {
+			x[i] = (uint32_t)in[4 * i] | ((uint32_t)in[4 * i + 1] << 8) | ((uint32_t)in[4 * i + 2] << 16) | ((uint32_t)in[4 * i + 3] << 24);
+		}
+		sc_reduce(out, x, 16);
+		memset(x, 0, sizeof(x));
+	}
+
+	// s = (a * b + c) mod L
+	void sc_muladd(uint8_t s[32], const uint8_t a[32], const uint8_t b[32], const uint8_t c[32]) {
+		uint32_t aw[8], bw[8];
+		uint32_t x[17] = {0};
+		for (int i = 0; i < 8; i++) {
+			aw[i] = (uint32_t)a[4 * i] | ((uint32_t)a[4 * i + 1] << 8) | ((uint32_t)a[4 * i + 2] << 16) | ((uint32_t)a[4 * i + 3] << 24);
+			bw[i] = (uint32_t)b[4 * i] | ((uint32_t)b[4 * i + 1] << 8) | ((uint32_t)b[4 * i + 2] << 16) | ((uint32_t)b[4 * i + 3] << 24);
+			x[i] = (uint32_t)c[4 * i] | ((uint32_t)c[4 * i + 1] << 8) | ((uint32_t)c[4 * i + 2] << 16) | ((uint32_t)c[4 * i + 3] << 24);
+		}
+		for (int i = 0; i < 8; i++) {
+			uint64_t carry = 0;
+			for (int j = 0; j < 8; j++) {
+				uint64_t t = (uint64_t)aw[i] * bw[j] + x[i + j] + carry;
+				x[i + j] = (uint32_t)t;
+				carry = t >> 32;
+			}
+			for (int k = i + 8; carry != 0 && k < 17; k++) {
+				uint64_t t = (uint64_t)x[k] + carry;
+				x[k] = (uint32_t)t;
+				carry = t >> 32;
+			}
+		}
+		sc_reduce(s, x, 17);
+		memset(aw, 0, sizeof(aw));
+		memset(bw, 0, sizeof(bw));
+		memset(x, 0, sizeof(x));
+	}
+
+	// Fills multiples with j * p for j in 1..8
+	void ge_cached_multiples(ge_cached multiples[8], const ge_p3& p) {
+		ge_p1p1 r;
+		ge_p3_to_cached(multiples[0], p);
+		ge_p3 multiple = p;
+		for (int j = 1; j < 8; j++) {
+			ge_add(r, multiple, multiples[0]);
+			ge_p1p1_to_p3(multiple, r);
+			ge_p3_to_cached(multiples[j], multiple);
+		}
+	}
+
+}
+
+bool Ed25519VerifyKey::decode(const uint8_t public_key[32]) {
+	memcpy(_public_key, public_key, 32);
+	ge_p3 point;
+	_valid = ge_frombytes_negate_vartime(point, public_key);
+	if (!_valid) {
+		return false;
+	}
+#if defined(RNS_X25519_FIXED_BASE)
+	ge_cached_multiples(_multiples, point);
+#else
+	_point = point;
+#endif
+	return true;
+}
+
+/*
+Checks that S * B - k * A encodes to R, with k = H(R || A || M). The two
+multiplications share their doublings, and as everything involved is
+public they need not run in constant time.
+*/
+bool Ed25519VerifyKey::verify(const uint8_t signature[64], const uint8_t* message, size_t size) const {
+	if (!_valid || !sc_is_canonical(signature + 32)) {
+		return false;
+	}
+
+	// k = H(R || A || M)
+	Bytes buffer;
+	uint8_t* data = buffer.writable(64 + size);
+	memcpy(data, signature, 32);
+	memcpy(data + 32, _public_key, 32);
+	if (size > 0) {
+		memcpy(data + 64, message, size);
+	}
+	uint8_t hash[64];
+	uint8_t challenge[32];
+	Provider::sha512(hash, data, 64 + size);
+	sc_reduce64(challenge, hash);
+
+#if defined(RNS_X25519_FIXED_BASE)
+	const ge_cached* multiples = _multiples;
+#else
+	ge_cached multiples[8];
+	ge_cached_multiples(multiples, _point);
+#endif
+	const ge_precomp* base = base_multiples();
+	int8_t k[64];
+	int8_t s[64];
+	scalar_digits(k, challenge);
+	scalar_digits(s, signature + 32);
+
+	ge_p3 h;
+	ge_p1p1 r;
+	ge_p2 p;
+	ge_p3_0(h);
+	for (int i = 63; i >= 0; i--) {
+		if (i < 63) {
+			ge_p3_dbl(r, h);
+			ge_p1p1_to_p2(p, r);
+			ge_p2_dbl(r, p);
+			ge_p1p1_to_p2(p, r);
+			ge_p2_dbl(r, p);
+			ge_p1p1_to_p2(p, r);
+			ge_p2_dbl(r, p);
+			ge_p1p1_to_p3(h, r);
+		}
+		// A was negated on decoding
+		if (k[i] > 0) {
+			ge_add(r, h, multiples[k[i] - 1]);
+			ge_p1p1_to_p3(h, r);
+		}
+		else if (k[i] < 0) {
+			ge_sub(r, h, multiples[-k[i] - 1]);
+			ge_p1p1_to_p3(h, r);
+		}
+		if (s[i] > 0) {
+			ge_madd(r, h, base[s[i] - 1]);
+			ge_p1p1_to_p3(h, r);
+		}
+		else if (s[i] < 0) {
+			ge_msub(r, h, base[-s[i] - 1]);
+			ge_p1p1_to_p3(h, r);
+		}
+	}
+
+	uint8_t check[32];
+	ge_p3_tobytes(check, h);
+	return memcmp(check, signature, 32) == 0;
+}
+
+void RNS::Cryptography::ed25519_base(uint8_t point[32], const uint8_t scalar[32]) {
+	ge_p3 h;
+	ge_scalarmult_base(h, scalar);
+	ge_p3_tobytes(point, h);
+}
+
+void RNS::Cryptography::ed25519_expand(uint8_t expanded[64], const uint8_t private_key[32]) {
+	Provider::sha512(expanded, private_key, 32);
+	expanded[0] &= 248;
+	expanded[31] &= 127;
+	expanded[31] |= 64;
+}
+
+void RNS::Cryptography::ed25519_sign_expanded(uint8_t signature[64], const uint8_t expanded[64], const uint8_t public_key[32], const uint8_t* message, size_t size) {
+	// One buffer holds prefix || M for the nonce, then R || A || M for the challenge
+	Bytes buffer;
+	uint8_t* data = buffer.writable(64 + size);
+	memcpy(data + 32, expanded + 32, 32);
+	if (size > 0) {
+		memcpy(data + 64, message, size);
+	}
+
+	uint8_t hash[64];
+	uint8_t nonce[32];
+	Provider::sha512(hash, data + 32, 32 + size);
+	sc_reduce64(nonce, hash);
+
+	// R = r * B
+	ed25519_base(signature, nonce);
+
+	// k = H(R || A || M)
+	memcpy(data, signature, 32);
+	memcpy(data + 32, public_key, 32);
+	uint8_t challenge[32];
+	Provider::sha512(hash, data, 64 + size);
+	sc_reduce64(challenge, hash);
+
+	// S = (r + k * a) mod L
+	sc_muladd(signature + 32, challenge, expanded, nonce);
+
+	memset(hash, 0, sizeof(hash));
+	memset(nonce, 0, sizeof(nonce));
+}
+
+#endif
@@ -1,19 +1,65 @@
 #pragma once
 
+#include "Provider.h"
+#include "Random.h"
+#include "X25519.h"
+#include "Curve25519Group.h"
 #include "Bytes.h"
 
-#include <Ed25519.h>
-
 #include <memory>
+#include <stdexcept>
 
 /*
 
-Note that the library currently in use for Ed25519 does not support generating keys from a seed.
+Keys are loaded into the crypto backend (see Provider.h) once on construction. The OpenSSL
+backend keeps the loaded key object. The default backend expands the seed once into the
+secret scalar and nonce prefix (RFC 8032 5.1.5) and signs from those with its own group
+arithmetic (Curve25519Group.h), taking the nonce point from the fixed-base table of X25519.h
+where that is built.
+
+It also decodes a public key into its curve point once, and verifies from the decoded point.
 
 */
 
 namespace RNS { namespace Cryptography {
 
+#if defined(RNS_CURVE25519_GROUP)
+	// Public key decoded for verification, so that verifying does not
+	// decompress the point again. Builds with the fixed-base table also keep
+	// the multiples of the point that verification adds, 1.3KB a key.
+	class Ed25519VerifyKey {
+
+	public:
+		// Returns false if public_key encodes no point
+		bool decode(const uint8_t public_key[32]);
+		// Checks a signature made by the decoded key, false if it did not decode
+		bool verify(const uint8_t signature[64], const uint8_t* message, size_t size) const;
+
+	private:
+		uint8_t _public_key[32];
+		bool _valid = false;
+#if defined(RNS_X25519_FIXED_BASE)
+		// j * -A for j in 1..8
+		Group::ge_cached _multiples[8];
+#else
+		// -A
+		Group::ge_p3 _point;
+#endif
+
+	};
+#endif
+
+#if defined(RNS_CURVE25519_GROUP)
+	// Multiplies the Ed25519 base point by a scalar below 2^255, writing the
+	// encoded point
+	void ed25519_base(uint8_t point[32], const uint8_t scalar[32]);
+	// Writes the clamped secret scalar to the first 32 bytes of expanded and
+	// the nonce prefix to the last 32
+	void ed25519_expand(uint8_t expanded[64], const uint8_t private_key[32]);
+	// Signs with an expanded key, matching Ed25519 signing from the seed
+	void ed25519_sign_expanded(uint8_t signature[64], const uint8_t expanded[64], const uint8_t public_key[32], const uint8_t* message, size_t size);
+#endif
+
 	class Ed25519PublicKey {
 
 	public:
@@ -22,6 +68,10 @@ namespace RNS { namespace Cryptography {
 	public:
 		Ed25519PublicKey(const Bytes& publicKey) {
 			_publicKey = publicKey;
+			if (_publicKey.size() != 32) {
+				throw std::invalid_argument("Invalid Ed25519 public key length");
+			}
+			_key = Provider::ed25519_public_key(_publicKey.data());
 		}
 		~Ed25519PublicKey() {}
 
@@ -36,11 +86,15 @@ namespace RNS { namespace Cryptography {
 		}
 
 		inline bool verify(const Bytes& signature, const Bytes& message) {
-			return Ed25519::verify(signature.data(), _publicKey.data(), message.data(), message.size());
+			if (signature.size() != 64) {
+				return false;
+			}
+			return Provider::ed25519_verify(*_key, signature.data(), message.data(), message.size());
 		}
 
 	private:
 		Bytes _publicKey;
+		std::shared_ptr<Provider::Ed25519Key> _key;
 
 	};
 
@@ -57,10 +111,15 @@ namespace RNS { namespace Cryptography {
 			}
 			else {
 				// create random private key
-				Ed25519::generatePrivateKey(_privateKey.writable(32));
+				_privateKey = random(32);
+			}
+			if (_privateKey.size() != 32) {
+				throw std::invalid_argument("Invalid Ed25519 private key length");
 			}
 			// derive public key from private key
-			Ed25519::derivePublicKey(_publicKey.writable(32), _privateKey.data());
+			_key = Provider::ed25519_private_key(_privateKey.data(), _publicKey.writable(32));
+			// derived once and shared by every caller of public_key()
+			_public = Ed25519PublicKey::from_public_bytes(_publicKey);
 		}
 		~Ed25519PrivateKey() {}
 
@@ -81,21 +140,23 @@ namespace RNS { namespace Cryptography {
 			return _privateKey;
 		}
 
-		// creates a new instance of public key for this private key
+		// public key for this private key
 		inline Ed25519PublicKey::Ptr public_key() {
-			return Ed25519PublicKey::from_public_bytes(_publicKey);
+			return _public;
 		}
 
 		inline const Bytes sign(const Bytes& message) {
 			//z return _sk.sign(message);
 			Bytes signature;
-			Ed25519::sign(signature.writable(64), _privateKey.data(), _publicKey.data(), message.data(), message.size());
+			Provider::ed25519_sign(*_key, signature.writable(64), message.data(), message.size());
 			return signature;
 		}
 
 	private:
 		Bytes _privateKey;
 		Bytes _publicKey;
+		std::shared_ptr<Provider::Ed25519Key> _key;
+		Ed25519PublicKey::Ptr _public;
 
 	};
 
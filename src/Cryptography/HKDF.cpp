@@ -1,7 +1,6 @@
 #include "HKDF.h"
 
-#include <HKDF.h>
-#include <SHA256.h>
+#include "Provider.h"
 
 using namespace RNS;
 
@@ -15,14 +14,7 @@ const Bytes RNS::Cryptography::hkdf(size_t length, const Bytes& derive_from, con
 		throw std::invalid_argument("Cannot derive key from empty input material");
 	}
 
-	HKDF<SHA256> hkdf;
-	if (salt) {
-		hkdf.setKey(derive_from.data(), derive_from.size(), salt.data(), salt.size());
-	}
-	else {
-		hkdf.setKey(derive_from.data(), derive_from.size());
-	}
 	Bytes derived;
-	hkdf.extract(derived.writable(length), length);
+	Provider::hkdf_sha256(derived.writable(length), length, derive_from.data(), derive_from.size(), salt.data(), salt.size(), context.data(), context.size());
 	return derived;
 }
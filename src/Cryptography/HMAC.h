@@ -1,10 +1,8 @@
 #pragma once
 
+#include "Provider.h"
 #include "../Bytes.h"
 
-#include <Hash.h>
-#include <SHA256.h>
-#include <SHA512.h>
 #include <stdexcept>
 #include <memory>
 #include <cassert>
@@ -37,18 +35,15 @@ namespace RNS { namespace Cryptography {
 
 			switch (digest) {
 			case DIGEST_SHA256:
-				_hash = std::unique_ptr<Hash>(new SHA256());
+				_hash = Provider::hmac_sha256(key.data(), key.size());
 				break;
 			case DIGEST_SHA512:
-				_hash = std::unique_ptr<Hash>(new SHA512());
+				_hash = Provider::hmac_sha512(key.data(), key.size());
 				break;
 			default:
 				throw std::invalid_argument("Unknown ior unsuppored digest");
 			}
 
-			_key = key;
-			_hash->resetHMAC(key.data(), key.size());
-
 			if (msg) {
 				update(msg);
 			}
@@ -64,14 +59,14 @@ namespace RNS { namespace Cryptography {
 
 		/*
 		Return the hash value of this hashing object.
-		This returns the hmac value as bytes.  The object is
-		not altered in any way by this function; you can continue
-		updating the object after calling this function.
+		This returns the hmac value as bytes.  Unlike Python's
+		hmac the object is finalized by this function and must
+		not be updated afterwards.
 		*/
 		Bytes digest() {
 			assert(_hash);
 			Bytes result;
-			_hash->finalizeHMAC(_key.data(), _key.size(), result.writable(_hash->hashSize()), _hash->hashSize());
+			_hash->finalize(result.writable(_hash->size()));
 			return result;
 		}
 
@@ -89,8 +84,7 @@ namespace RNS { namespace Cryptography {
 		}
 
 	private:
-		Bytes _key;
-		std::unique_ptr<Hash> _hash;
+		std::unique_ptr<Provider::Hmac> _hash;
 
 	};
 
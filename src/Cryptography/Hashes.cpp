@@ -1,36 +1,45 @@
 #include "Hashes.h"
 
+#include "Provider.h"
 #include "../Bytes.h"
 
-#include <SHA256.h>
-#include <SHA512.h>
-
 using namespace RNS;
 
 /*
 The SHA primitives are abstracted here to allow platform-
-aware hardware acceleration in the future. Currently only
-uses Python's internal SHA-256 implementation. All SHA-256
+aware hardware acceleration. The implementation is that of
+the build's crypto backend, see Provider.h. All SHA-256
 calls in RNS end up here.
 */
 
 const Bytes RNS::Cryptography::sha256(const Bytes& data) {
 	//TRACE("Cryptography::sha256: data: " + data.toHex() );
-	SHA256 digest;
-	digest.reset();
-	digest.update(data.data(), data.size());
 	Bytes hash;
-	digest.finalize(hash.writable(32), 32);
+	Provider::sha256(hash.writable(32), data.data(), data.size());
 	//TRACE("Cryptography::sha256: hash: " + hash.toHex() );
 	return hash;
 }
 
 const Bytes RNS::Cryptography::sha512(const Bytes& data) {
-	SHA512 digest;
-	digest.reset();
-	digest.update(data.data(), data.size());
 	Bytes hash;
-	digest.finalize(hash.writable(64), 64);
+	Provider::sha512(hash.writable(64), data.data(), data.size());
 	//TRACE("Cryptography::sha512: hash: " + hash.toHex() );
 	return hash;
 }
+
+const std::vector<Bytes> RNS::Cryptography::sha256_batch(const std::vector<Bytes>& data) {
+	std::vector<const uint8_t*> pointers(data.size());
+	std::vector<size_t> sizes(data.size());
+	for (size_t i = 0; i < data.size(); i++) {
+		pointers[i] = data[i].data();
+		sizes[i] = data[i].size();
+	}
+	std::vector<uint8_t> digests(data.size() * 32);
+	Provider::sha256_batch((uint8_t (*)[32])digests.data(), pointers.data(), sizes.data(), data.size());
+	std::vector<Bytes> hashes;
+	hashes.reserve(data.size());
+	for (size_t i = 0; i < data.size(); i++) {
+		hashes.push_back(Bytes(digests.data() + i * 32, 32));
+	}
+	return hashes;
+}
@@ -2,11 +2,33 @@
 
 #include "../Bytes.h"
 
+#include <vector>
+#include <stddef.h>
 #include <stdint.h>
 
+// SHA-NI and AVX2 SHA-256 for x86-64, selected at runtime by the default
+// crypto backend
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__)) && !defined(RNS_SHA256_NO_X86)
+	#define RNS_SHA256_X86
+#endif
+
 namespace RNS { namespace Cryptography {
 
 	const Bytes sha256(const Bytes& data);
 	const Bytes sha512(const Bytes& data);
 
+	// Hashes a batch of independent messages, such as received packets,
+	// several at a time where the platform allows
+	const std::vector<Bytes> sha256_batch(const std::vector<Bytes>& data);
+
+#if defined(RNS_SHA256_X86)
+	bool sha256_shani_supported();
+	bool sha256_avx2_supported();
+	// Runs the compression function over whole 64 byte blocks
+	void sha256_shani_blocks(uint32_t state[8], const uint8_t* data, size_t blocks);
+	void sha256_shani(uint8_t hash[32], const uint8_t* data, size_t size);
+	// Hashes up to eight messages at once, one per 32-bit lane
+	void sha256_avx2(uint8_t (*hashes)[32], const uint8_t* const* data, const size_t* sizes, size_t count);
+#endif
+
 } }
@@ -0,0 +1,308 @@
+#include "Hashes.h"
+
+#if defined(RNS_SHA256_X86)
+
+#include <cpuid.h>
+#include <immintrin.h>
+#include <string.h>
+
+using namespace RNS::Cryptography;
+
+/*
+
+SHA-256 code paths for x86-64, compiled with per-function target attributes
+so the rest of the build does not need -msha or -mavx2. Callers check
+sha256_shani_supported() and sha256_avx2_supported() first.
+
+The SHA-NI path follows the message schedule of Intel's SHA extensions
+reference code. The AVX2 path runs eight independent messages side by side,
+one per 32-bit lane, which is what a batch of packet hashes looks like.
+
+*/
+
+#define SHANI_TARGET __attribute__((target("sha,sse4.1,ssse3")))
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+namespace {
+
+	alignas(32) const uint32_t K[64] = {
+		0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+		0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+		0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+		0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+		0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+		0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+		0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+		0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+	};
+
+	const uint32_t H0[8] = {
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+	};
+
+	struct CpuFeatures {
+		bool shani = false;
+		bool avx2 = false;
+		CpuFeatures() {
+			unsigned int eax, ebx, ecx, edx;
+			if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+				return;
+			}
+			bool ssse3 = (ecx & bit_SSSE3) != 0;
+			bool sse41 = (ecx & bit_SSE4_1) != 0;
+			// AVX state must be enabled by the OS as well as supported by the CPU
+			bool ymm = false;
+			if ((ecx & bit_OSXSAVE) && (ecx & bit_AVX)) {
+				unsigned int xcr0_lo, xcr0_hi;
+				__asm__("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+				ymm = (xcr0_lo & 0x6) == 0x6;
+			}
+			if (__get_cpuid_max(0, nullptr) < 7) {
+				return;
+			}
+			__cpuid_count(7, 0, eax, ebx, ecx, edx);
+			shani = ssse3 && sse41 && (ebx & bit_SHA) != 0;
+			avx2 = ymm && (ebx & bit_AVX2) != 0;
+		}
+	};
+
+	const CpuFeatures& cpu_features() {
+		static const CpuFeatures features;
+		return features;
+	}
+
+	// Writes the padded final one or two blocks of a message to tail and
+	// returns how many there are
+	size_t pad_tail(uint8_t tail[128], const uint8_t* data, size_t size) {
+		size_t remainder = size % 64;
+		size_t blocks = (remainder + 9 <= 64) ? 1 : 2;
+		memset(tail, 0, blocks * 64);
+		memcpy(tail, data + (size - remainder), remainder);
+		tail[remainder] = 0x80;
+		uint64_t bits = (uint64_t)size * 8;
+		for (int i = 0; i < 8; i++) {
+			tail[blocks * 64 - 1 - i] = (uint8_t)(bits >> (8 * i));
+		}
+		return blocks;
+	}
+
+	void store_be(uint8_t hash[32], const uint32_t state[8]) {
+		for (int i = 0; i < 8; i++) {
+			hash[4 * i] = (uint8_t)(state[i] >> 24);
+			hash[4 * i + 1] = (uint8_t)(state[i] >> 16);
+			hash[4 * i + 2] = (uint8_t)(state[i] >> 8);
+			hash[4 * i + 3] = (uint8_t)state[i];
+		}
+	}
+
+	AVX2_TARGET inline __m256i rotr(__m256i x, int n) {
+		return _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n));
+	}
+
+	AVX2_TARGET inline void transpose(__m256i r[8]) {
+		__m256i t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+		__m256i t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+		__m256i t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+		__m256i t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+		__m256i t4 = _mm256_unpacklo_epi32(r[4], r[5]);
+		__m256i t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+		__m256i t6 = _mm256_unpacklo_epi32(r[6], r[7]);
+		__m256i t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+		__m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+		__m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+		__m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+		__m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+		__m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+		__m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+		__m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+		__m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+		r[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+		r[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+		r[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+		r[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+		r[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+		r[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+		r[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+		r[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+	}
+
+}
+
+bool RNS::Cryptography::sha256_shani_supported() {
+	return cpu_features().shani;
+}
+
+bool RNS::Cryptography::sha256_avx2_supported() {
+	return cpu_features().avx2;
+}
+
+SHANI_TARGET void RNS::Cryptography::sha256_shani_blocks(uint32_t state[8], const uint8_t* data, size_t blocks) {
+	const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+	// state0 holds ABEF and state1 CDGH as the SHA256RNDS2 instruction expects
+	__m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)state), 0xB1);
+	__m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)(state + 4)), 0x1B);
+	__m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+	state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+	while (blocks > 0) {
+		__m128i abef = state0;
+		__m128i cdgh = state1;
+		__m128i msg;
+		__m128i m0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)data), mask);
+		__m128i m1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 16)), mask);
+		__m128i m2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 32)), mask);
+		__m128i m3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 48)), mask);
+
+// Four rounds on the message words in m, for rounds 4g to 4g+3
+#define SHANI_ROUNDS(m, g) \
+		msg = _mm_add_epi32(m, _mm_load_si128((const __m128i*)(K + 4 * (g)))); \
+		state1 = _mm_sha256rnds2_epu32(state1, state0, msg); \
+		msg = _mm_shuffle_epi32(msg, 0x0E); \
+		state0 = _mm_sha256rnds2_epu32(state0, state1, msg)
+// Completes the schedule of next from the current and previous words
+#define SHANI_MSG2(next, m, prev) \
+		next = _mm_sha256msg2_epu32(_mm_add_epi32(next, _mm_alignr_epi8(m, prev, 4)), m)
+#define SHANI_MSG1(prev, m) \
+		prev = _mm_sha256msg1_epu32(prev, m)
+
+		SHANI_ROUNDS(m0, 0);
+		SHANI_ROUNDS(m1, 1);  SHANI_MSG1(m0, m1);
+		SHANI_ROUNDS(m2, 2);  SHANI_MSG1(m1, m2);
+		SHANI_ROUNDS(m3, 3);  SHANI_MSG2(m0, m3, m2); SHANI_MSG1(m2, m3);
+		SHANI_ROUNDS(m0, 4);  SHANI_MSG2(m1, m0, m3); SHANI_MSG1(m3, m0);
+		SHANI_ROUNDS(m1, 5);  SHANI_MSG2(m2, m1, m0); SHANI_MSG1(m0, m1);
+		SHANI_ROUNDS(m2, 6);  SHANI_MSG2(m3, m2, m1); SHANI_MSG1(m1, m2);
+		SHANI_ROUNDS(m3, 7);  SHANI_MSG2(m0, m3, m2); SHANI_MSG1(m2, m3);
+		SHANI_ROUNDS(m0, 8);  SHANI_MSG2(m1, m0, m3); SHANI_MSG1(m3, m0);
+		SHANI_ROUNDS(m1, 9);  SHANI_MSG2(m2, m1, m0); SHANI_MSG1(m0, m1);
+		SHANI_ROUNDS(m2, 10); SHANI_MSG2(m3, m2, m1); SHANI_MSG1(m1, m2);
+		SHANI_ROUNDS(m3, 11); SHANI_MSG2(m0, m3, m2); SHANI_MSG1(m2, m3);
+		SHANI_ROUNDS(m0, 12); SHANI_MSG2(m1, m0, m3); SHANI_MSG1(m3, m0);
+		SHANI_ROUNDS(m1, 13); SHANI_MSG2(m2, m1, m0);
+		SHANI_ROUNDS(m2, 14); SHANI_MSG2(m3, m2, m1);
+		SHANI_ROUNDS(m3, 15);
+
+#undef SHANI_ROUNDS
+#undef SHANI_MSG2
+#undef SHANI_MSG1
+
+		state0 = _mm_add_epi32(state0, abef);
+		state1 = _mm_add_epi32(state1, cdgh);
+		data += 64;
+		blocks--;
+	}
+
+	tmp = _mm_shuffle_epi32(state0, 0x1B);
+	state1 = _mm_shuffle_epi32(state1, 0xB1);
+	_mm_storeu_si128((__m128i*)state, _mm_blend_epi16(tmp, state1, 0xF0));
+	_mm_storeu_si128((__m128i*)(state + 4), _mm_alignr_epi8(state1, tmp, 8));
+}
+
+void RNS::Cryptography::sha256_shani(uint8_t hash[32], const uint8_t* data, size_t size) {
+	uint32_t state[8];
+	memcpy(state, H0, sizeof(state));
+	sha256_shani_blocks(state, data, size / 64);
+	uint8_t tail[128];
+	size_t tail_blocks = pad_tail(tail, data, size);
+	sha256_shani_blocks(state, tail, tail_blocks);
+	store_be(hash, state);
+}
+
+AVX2_TARGET void RNS::Cryptography::sha256_avx2(uint8_t (*hashes)[32], const uint8_t* const* data, const size_t* sizes, size_t count) {
+	static const uint8_t zero_block[64] = {0};
+	const __m256i bswap = _mm256_set_epi8(
+		12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3,
+		12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+
+	// Lanes beyond count stay idle
+	uint8_t tails[8][128];
+	size_t full_blocks[8] = {0};
+	size_t total_blocks[8] = {0};
+	size_t max_blocks = 0;
+	for (size_t lane = 0; lane < count; lane++) {
+		full_blocks[lane] = sizes[lane] / 64;
+		total_blocks[lane] = full_blocks[lane] + pad_tail(tails[lane], data[lane], sizes[lane]);
+		if (total_blocks[lane] > max_blocks) {
+			max_blocks = total_blocks[lane];
+		}
+	}
+
+	__m256i state[8];
+	for (int i = 0; i < 8; i++) {
+		state[i] = _mm256_set1_epi32((int)H0[i]);
+	}
+
+	for (size_t block = 0; block < max_blocks; block++) {
+		// Lanes that have finished keep their state, the others take the new one
+		int active[8];
+		const uint8_t* ptr[8];
+		for (int lane = 0; lane < 8; lane++) {
+			active[lane] = (block < total_blocks[lane]) ? -1 : 0;
+			if (block < full_blocks[lane]) {
+				ptr[lane] = data[lane] + block * 64;
+			}
+			else if (block < total_blocks[lane]) {
+				ptr[lane] = tails[lane] + (block - full_blocks[lane]) * 64;
+			}
+			else {
+				ptr[lane] = zero_block;
+			}
+		}
+		__m256i mask = _mm256_setr_epi32(active[0], active[1], active[2], active[3], active[4], active[5], active[6], active[7]);
+
+		__m256i w[16];
+		for (int half = 0; half < 2; half++) {
+			__m256i* r = w + half * 8;
+			for (int lane = 0; lane < 8; lane++) {
+				r[lane] = _mm256_loadu_si256((const __m256i*)(ptr[lane] + half * 32));
+			}
+			transpose(r);
+			for (int i = 0; i < 8; i++) {
+				r[i] = _mm256_shuffle_epi8(r[i], bswap);
+			}
+		}
+
+		__m256i a = state[0], b = state[1], c = state[2], d = state[3];
+		__m256i e = state[4], f = state[5], g = state[6], h = state[7];
+		for (int t = 0; t < 64; t++) {
+			if (t >= 16) {
+				__m256i w15 = w[(t - 15) & 15];
+				__m256i w2 = w[(t - 2) & 15];
+				__m256i s0 = _mm256_xor_si256(_mm256_xor_si256(rotr(w15, 7), rotr(w15, 18)), _mm256_srli_epi32(w15, 3));
+				__m256i s1 = _mm256_xor_si256(_mm256_xor_si256(rotr(w2, 17), rotr(w2, 19)), _mm256_srli_epi32(w2, 10));
+				w[t & 15] = _mm256_add_epi32(_mm256_add_epi32(w[t & 15], s0), _mm256_add_epi32(w[(t - 7) & 15], s1));
+			}
+			__m256i S1 = _mm256_xor_si256(_mm256_xor_si256(rotr(e, 6), rotr(e, 11)), rotr(e, 25));
+			__m256i ch = _mm256_xor_si256(g, _mm256_and_si256(e, _mm256_xor_si256(f, g)));
+			__m256i t1 = _mm256_add_epi32(_mm256_add_epi32(h, S1), _mm256_add_epi32(ch, _mm256_add_epi32(_mm256_set1_epi32((int)K[t]), w[t & 15])));
+			__m256i S0 = _mm256_xor_si256(_mm256_xor_si256(rotr(a, 2), rotr(a, 13)), rotr(a, 22));
+			__m256i maj = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));
+			h = g;
+			g = f;
+			f = e;
+			e = _mm256_add_epi32(d, t1);
+			d = c;
+			c = b;
+			b = a;
+			a = _mm256_add_epi32(t1, _mm256_add_epi32(S0, maj));
+		}
+
+		state[0] = _mm256_blendv_epi8(state[0], _mm256_add_epi32(state[0], a), mask);
+		state[1] = _mm256_blendv_epi8(state[1], _mm256_add_epi32(state[1], b), mask);
+		state[2] = _mm256_blendv_epi8(state[2], _mm256_add_epi32(state[2], c), mask);
+		state[3] = _mm256_blendv_epi8(state[3], _mm256_add_epi32(state[3], d), mask);
+		state[4] = _mm256_blendv_epi8(state[4], _mm256_add_epi32(state[4], e), mask);
+		state[5] = _mm256_blendv_epi8(state[5], _mm256_add_epi32(state[5], f), mask);
+		state[6] = _mm256_blendv_epi8(state[6], _mm256_add_epi32(state[6], g), mask);
+		state[7] = _mm256_blendv_epi8(state[7], _mm256_add_epi32(state[7], h), mask);
+	}
+
+	// Back to one row of eight words per lane
+	transpose(state);
+	for (size_t lane = 0; lane < count; lane++) {
+		_mm256_storeu_si256((__m256i*)hashes[lane], _mm256_shuffle_epi8(state[lane], bswap));
+	}
+}
+
+#endif
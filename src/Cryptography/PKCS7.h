@@ -25,6 +25,24 @@ namespace RNS { namespace Cryptography {
 			return unpadded;
 		}
 
+		// pads len bytes at the start of buffer, which must have room for
+		// another bs bytes, and returns the padded length
+		static inline size_t pad(uint8_t* buffer, size_t len, size_t bs = BLOCKSIZE) {
+			size_t padlen = bs - (len % bs);
+			memset(buffer + len, 0, padlen);
+			buffer[len + padlen - 1] = (uint8_t)padlen;
+			return len + padlen;
+		}
+
+		// returns the length of len bytes of padded data in buffer once unpadded
+		static inline size_t unpad(const uint8_t* buffer, size_t len, size_t bs = BLOCKSIZE) {
+			size_t padlen = (len > 0) ? (size_t)buffer[len-1] : 0;
+			if (padlen > bs || padlen > len) {
+				throw std::runtime_error("Cannot unpad, invalid padding length of " + std::to_string(padlen) + " bytes");
+			}
+			return len - padlen;
+		}
+
 		// updates passed buffer
 		static inline void inplace_pad(Bytes& data, size_t bs = BLOCKSIZE) {
 			size_t len = data.size();
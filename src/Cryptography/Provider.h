@@ -0,0 +1,97 @@
+#pragma once
+
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+
+Backend for the cryptographic primitives in this directory, selected at
+build time. Hashes, HKDF, HMAC, AES and the Ed25519 and X25519 key classes
+all call through here rather than into a crypto library directly.
+
+The default backend uses the Crypto library and runs on every supported
+platform. Defining RNS_CRYPTO_OPENSSL selects a backend on OpenSSL's
+libcrypto for native builds, which picks AES-NI, SHA extensions and
+vectorised code paths at runtime where the CPU supports them.
+
+Random numbers are not part of the backend, see Random.h.
+
+*/
+
+namespace RNS { namespace Cryptography { namespace Provider {
+
+	// Name of the backend in use
+	const char* name();
+
+	void sha256(uint8_t hash[32], const uint8_t* data, size_t size);
+	void sha512(uint8_t hash[64], const uint8_t* data, size_t size);
+	// SHA-256 of count independent messages
+	void sha256_batch(uint8_t (*hashes)[32], const uint8_t* const* data, const size_t* sizes, size_t count);
+
+	// Incremental SHA-256, for data hashed as it streams past
+	class Sha256 {
+	public:
+		virtual ~Sha256() {}
+		virtual void update(const uint8_t* data, size_t size) = 0;
+		// Writes the hash of all data fed so far, after which the object
+		// must not be updated again
+		virtual void finalize(uint8_t hash[32]) = 0;
+		// Independent copy of the state, to finish a common prefix more than one way
+		virtual std::unique_ptr<Sha256> clone() const = 0;
+	};
+	std::unique_ptr<Sha256> sha256_stream();
+
+	// Incremental HMAC over SHA-256 or SHA-512. The hash states after the
+	// inner and outer key pads are computed once per key.
+	class Hmac {
+	public:
+		virtual ~Hmac() {}
+		virtual void update(const uint8_t* data, size_t size) = 0;
+		// Writes the MAC of all data fed so far, after which the object must
+		// be reset before it is updated again
+		virtual void finalize(uint8_t* mac) = 0;
+		// Starts a new MAC under the same key
+		virtual void reset() = 0;
+		virtual size_t size() const = 0;
+		// Independent copy under the same key, including any data fed so far
+		virtual std::unique_ptr<Hmac> clone() const = 0;
+	};
+	std::unique_ptr<Hmac> hmac_sha256(const uint8_t* key, size_t key_size);
+	std::unique_ptr<Hmac> hmac_sha512(const uint8_t* key, size_t key_size);
+
+	// HKDF (RFC 5869) over SHA-256, an empty salt is treated as a zero filled one
+	void hkdf_sha256(uint8_t* derived, size_t length, const uint8_t* key, size_t key_size, const uint8_t* salt, size_t salt_size, const uint8_t* info, size_t info_size);
+
+	// AES-128 or AES-256 (by key_size of 16 or 32) in CBC mode without padding,
+	// size must be a multiple of 16 and output may alias input
+	void aes_cbc_encrypt(uint8_t* output, const uint8_t* input, size_t size, const uint8_t* key, size_t key_size, const uint8_t iv[16]);
+	void aes_cbc_decrypt(uint8_t* output, const uint8_t* input, size_t size, const uint8_t* key, size_t key_size, const uint8_t iv[16]);
+
+	// AES-CBC as above with the key schedule run once, for encrypting or
+	// decrypting many messages under the same key
+	class AesCbc {
+	public:
+		virtual ~AesCbc() {}
+		virtual void encrypt(uint8_t* output, const uint8_t* input, size_t size, const uint8_t iv[16]) = 0;
+		virtual void decrypt(uint8_t* output, const uint8_t* input, size_t size, const uint8_t iv[16]) = 0;
+	};
+	std::unique_ptr<AesCbc> aes_cbc(const uint8_t* key, size_t key_size);
+
+	// Ed25519 key in whatever form the backend signs or verifies with, decoded
+	// once when the key is loaded
+	class Ed25519Key {
+	public:
+		virtual ~Ed25519Key() {}
+	};
+	// Loads a private key from its 32 byte seed and writes the matching public key
+	std::shared_ptr<Ed25519Key> ed25519_private_key(const uint8_t private_key[32], uint8_t public_key[32]);
+	std::shared_ptr<Ed25519Key> ed25519_public_key(const uint8_t public_key[32]);
+	void ed25519_sign(const Ed25519Key& private_key, uint8_t signature[64], const uint8_t* message, size_t size);
+	bool ed25519_verify(const Ed25519Key& public_key, const uint8_t signature[64], const uint8_t* message, size_t size);
+
+	void x25519_public_key(uint8_t public_key[32], const uint8_t private_key[32]);
+	// Returns false if the backend rejects the peer key
+	bool x25519_exchange(uint8_t shared_key[32], const uint8_t private_key[32], const uint8_t peer_public_key[32]);
+
+} } }
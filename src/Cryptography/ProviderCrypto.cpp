@@ -0,0 +1,446 @@
+#include "Provider.h"
+
+#if !defined(RNS_CRYPTO_OPENSSL)
+
+#include "CBC.h"
+#include "Hashes.h"
+#include "X25519.h"
+#include "Ed25519.h"
+
+#include <Crypto.h>
+#include <SHA256.h>
+#include <SHA512.h>
+#include <HKDF.h>
+#include <AES.h>
+#include <Curve25519.h>
+
+#include <stdexcept>
+#include <string.h>
+
+using namespace RNS::Cryptography;
+
+/*
+Default backend on the Crypto library, available on every platform.
+*/
+
+namespace {
+
+	// HMAC keeping copies of the hash state after the inner and outer pads
+	template <typename T>
+	class CryptoHmac : public Provider::Hmac {
+	public:
+		CryptoHmac(const uint8_t* key, size_t key_size) {
+			uint8_t block[128];
+			size_t block_size = _inner.blockSize();
+			memset(block, 0, block_size);
+			if (key_size > block_size) {
+				_inner.reset();
+				_inner.update(key, key_size);
+				_inner.finalize(block, _inner.hashSize());
+			}
+			else {
+				memcpy(block, key, key_size);
+			}
+			for (size_t i = 0; i < block_size; i++) {
+				block[i] ^= 0x36;
+			}
+			_inner.reset();
+			_inner.update(block, block_size);
+			for (size_t i = 0; i < block_size; i++) {
+				block[i] ^= (0x36 ^ 0x5c);
+			}
+			_outer.reset();
+			_outer.update(block, block_size);
+			clean(block, sizeof(block));
+			_hash = _inner;
+		}
+		virtual ~CryptoHmac() {
+			_inner.clear();
+			_outer.clear();
+			_hash.clear();
+		}
+		virtual void update(const uint8_t* data, size_t size) {
+			_hash.update(data, size);
+		}
+		virtual void finalize(uint8_t* mac) {
+			uint8_t digest[64];
+			size_t size = _hash.hashSize();
+			_hash.finalize(digest, size);
+			_hash = _outer;
+			_hash.update(digest, size);
+			_hash.finalize(mac, size);
+			clean(digest, sizeof(digest));
+		}
+		virtual void reset() {
+			_hash = _inner;
+		}
+		virtual size_t size() const {
+			return _hash.hashSize();
+		}
+		virtual std::unique_ptr<Provider::Hmac> clone() const {
+			return std::unique_ptr<Provider::Hmac>(new CryptoHmac(*this));
+		}
+	private:
+		T _inner;
+		T _outer;
+		T _hash;
+	};
+
+	class CryptoSha256 : public Provider::Sha256 {
+	public:
+		virtual ~CryptoSha256() {
+			_hash.clear();
+		}
+		virtual void update(const uint8_t* data, size_t size) {
+			_hash.update(data, size);
+		}
+		virtual void finalize(uint8_t hash[32]) {
+			_hash.finalize(hash, 32);
+		}
+		virtual std::unique_ptr<Provider::Sha256> clone() const {
+			return std::unique_ptr<Provider::Sha256>(new CryptoSha256(*this));
+		}
+	private:
+		SHA256 _hash;
+	};
+
+#if defined(RNS_SHA256_X86)
+	// Streaming SHA-256 over sha256_shani_blocks()
+	struct ShaNiSha256 {
+		uint32_t state[8];
+		uint8_t buffer[64];
+		size_t buffered;
+		uint64_t length;
+
+		void reset() {
+			static const uint32_t H0[8] = {
+				0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+			};
+			memcpy(state, H0, sizeof(state));
+			buffered = 0;
+			length = 0;
+		}
+		void update(const uint8_t* data, size_t size) {
+			length += size;
+			if (buffered > 0) {
+				size_t count = (size < 64 - buffered) ? size : 64 - buffered;
+				memcpy(buffer + buffered, data, count);
+				buffered += count;
+				data += count;
+				size -= count;
+				if (buffered < 64) {
+					return;
+				}
+				sha256_shani_blocks(state, buffer, 1);
+				buffered = 0;
+			}
+			if (size >= 64) {
+				sha256_shani_blocks(state, data, size / 64);
+				data += size - (size % 64);
+				size %= 64;
+			}
+			if (size > 0) {
+				memcpy(buffer, data, size);
+				buffered = size;
+			}
+		}
+		void finalize(uint8_t hash[32]) {
+			uint8_t tail[128];
+			size_t blocks = (buffered + 9 <= 64) ? 1 : 2;
+			memset(tail, 0, sizeof(tail));
+			memcpy(tail, buffer, buffered);
+			tail[buffered] = 0x80;
+			uint64_t bits = length * 8;
+			for (int i = 0; i < 8; i++) {
+				tail[blocks * 64 - 1 - i] = (uint8_t)(bits >> (8 * i));
+			}
+			sha256_shani_blocks(state, tail, blocks);
+			for (int i = 0; i < 8; i++) {
+				hash[4 * i] = (uint8_t)(state[i] >> 24);
+				hash[4 * i + 1] = (uint8_t)(state[i] >> 16);
+				hash[4 * i + 2] = (uint8_t)(state[i] >> 8);
+				hash[4 * i + 3] = (uint8_t)state[i];
+			}
+		}
+	};
+
+	class ShaNiHmac : public Provider::Hmac {
+	public:
+		ShaNiHmac(const uint8_t* key, size_t key_size) {
+			uint8_t block[64];
+			memset(block, 0, sizeof(block));
+			if (key_size > sizeof(block)) {
+				sha256_shani(block, key, key_size);
+			}
+			else {
+				memcpy(block, key, key_size);
+			}
+			for (size_t i = 0; i < sizeof(block); i++) {
+				block[i] ^= 0x36;
+			}
+			_hash.reset();
+			_hash.update(block, sizeof(block));
+			memcpy(_inner, _hash.state, sizeof(_inner));
+			for (size_t i = 0; i < sizeof(block); i++) {
+				block[i] ^= (0x36 ^ 0x5c);
+			}
+			_hash.reset();
+			_hash.update(block, sizeof(block));
+			memcpy(_outer, _hash.state, sizeof(_outer));
+			clean(block, sizeof(block));
+			reset();
+		}
+		virtual ~ShaNiHmac() {
+			clean(_inner, sizeof(_inner));
+			clean(_outer, sizeof(_outer));
+			clean(&_hash, sizeof(_hash));
+		}
+		virtual void update(const uint8_t* data, size_t size) {
+			_hash.update(data, size);
+		}
+		virtual void finalize(uint8_t* mac) {
+			uint8_t digest[32];
+			_hash.finalize(digest);
+			restart(_outer);
+			_hash.update(digest, sizeof(digest));
+			_hash.finalize(mac);
+		}
+		virtual void reset() {
+			restart(_inner);
+		}
+		virtual size_t size() const {
+			return 32;
+		}
+		virtual std::unique_ptr<Provider::Hmac> clone() const {
+			return std::unique_ptr<Provider::Hmac>(new ShaNiHmac(*this));
+		}
+	private:
+		// Continues from the state after one 64 byte pad block
+		void restart(const uint32_t state[8]) {
+			memcpy(_hash.state, state, sizeof(_hash.state));
+			_hash.buffered = 0;
+			_hash.length = 64;
+		}
+		uint32_t _inner[8];
+		uint32_t _outer[8];
+		ShaNiSha256 _hash;
+	};
+
+	class ShaNiSha256Stream : public Provider::Sha256 {
+	public:
+		ShaNiSha256Stream() {
+			_hash.reset();
+		}
+		virtual ~ShaNiSha256Stream() {
+			clean(&_hash, sizeof(_hash));
+		}
+		virtual void update(const uint8_t* data, size_t size) {
+			_hash.update(data, size);
+		}
+		virtual void finalize(uint8_t hash[32]) {
+			_hash.finalize(hash);
+		}
+		virtual std::unique_ptr<Provider::Sha256> clone() const {
+			return std::unique_ptr<Provider::Sha256>(new ShaNiSha256Stream(*this));
+		}
+	private:
+		ShaNiSha256 _hash;
+	};
+#endif
+
+	template <typename T>
+	class CryptoAesCbc : public Provider::AesCbc {
+	public:
+		CryptoAesCbc(const uint8_t* key, size_t key_size) {
+			_cbc.setKey(key, key_size);
+		}
+		virtual ~CryptoAesCbc() {
+			_cbc.clear();
+		}
+		virtual void encrypt(uint8_t* output, const uint8_t* input, size_t size, const uint8_t iv[16]) {
+			_cbc.setIV(iv, 16);
+			_cbc.encrypt(output, input, size);
+		}
+		virtual void decrypt(uint8_t* output, const uint8_t* input, size_t size, const uint8_t iv[16]) {
+			_cbc.setIV(iv, 16);
+			_cbc.decrypt(output, input, size);
+		}
+	private:
+		CBC<T> _cbc;
+	};
+
+	class CryptoEd25519Key : public Provider::Ed25519Key {
+	public:
+		virtual ~CryptoEd25519Key() {
+			clean(_private_key);
+			clean(_expanded);
+		}
+		uint8_t _private_key[32];
+		uint8_t _public_key[32];
+		// Secret scalar and nonce prefix, expanded once from _private_key
+		uint8_t _expanded[64];
+		// Curve point of _public_key, decoded once for public keys
+		Ed25519VerifyKey _verify_key;
+	};
+
+	template <typename T>
+	void cbc_encrypt(uint8_t* output, const uint8_t* input, size_t size, const uint8_t* key, size_t key_size, const uint8_t iv[16]) {
+		CBC<T> cbc;
+		cbc.setKey(key, key_size);
+		cbc.setIV(iv, 16);
+		cbc.encrypt(output, input, size);
+	}
+
+	template <typename T>
+	void cbc_decrypt(uint8_t* output, const uint8_t* input, size_t size, const uint8_t* key, size_t key_size, const uint8_t iv[16]) {
+		CBC<T> cbc;
+		cbc.setKey(key, key_size);
+		cbc.setIV(iv, 16);
+		cbc.decrypt(output, input, size);
+	}
+
+}
+
+const char* Provider::name() {
+	return "Crypto";
+}
+
+void Provider::sha256(uint8_t hash[32], const uint8_t* data, size_t size) {
+#if defined(RNS_SHA256_X86)
+	if (sha256_shani_supported()) {
+		sha256_shani(hash, data, size);
+		return;
+	}
+#endif
+	SHA256 digest;
+	digest.update(data, size);
+	digest.finalize(hash, 32);
+}
+
+void Provider::sha256_batch(uint8_t (*hashes)[32], const uint8_t* const* data, const size_t* sizes, size_t count) {
+#if defined(RNS_SHA256_X86)
+	if (sha256_avx2_supported() && !sha256_shani_supported()) {
+		while (count > 0) {
+			size_t lanes = count < 8 ? count : 8;
+			sha256_avx2(hashes, data, sizes, lanes);
+			hashes += lanes;
+			data += lanes;
+			sizes += lanes;
+			count -= lanes;
+		}
+		return;
+	}
+#endif
+	for (size_t i = 0; i < count; i++) {
+		sha256(hashes[i], data[i], sizes[i]);
+	}
+}
+
+std::unique_ptr<Provider::Sha256> Provider::sha256_stream() {
+#if defined(RNS_SHA256_X86)
+	if (sha256_shani_supported()) {
+		return std::unique_ptr<Sha256>(new ShaNiSha256Stream());
+	}
+#endif
+	return std::unique_ptr<Sha256>(new CryptoSha256());
+}
+
+void Provider::sha512(uint8_t hash[64], const uint8_t* data, size_t size) {
+	SHA512 digest;
+	digest.update(data, size);
+	digest.finalize(hash, 64);
+}
+
+std::unique_ptr<Provider::Hmac> Provider::hmac_sha256(const uint8_t* key, size_t key_size) {
+#if defined(RNS_SHA256_X86)
+	if (sha256_shani_supported()) {
+		return std::unique_ptr<Hmac>(new ShaNiHmac(key, key_size));
+	}
+#endif
+	return std::unique_ptr<Hmac>(new CryptoHmac<SHA256>(key, key_size));
+}
+
+std::unique_ptr<Provider::Hmac> Provider::hmac_sha512(const uint8_t* key, size_t key_size) {
+	return std::unique_ptr<Hmac>(new CryptoHmac<SHA512>(key, key_size));
+}
+
+void Provider::hkdf_sha256(uint8_t* derived, size_t length, const uint8_t* key, size_t key_size, const uint8_t* salt, size_t salt_size, const uint8_t* info, size_t info_size) {
+	HKDF<SHA256> hkdf;
+	hkdf.setKey(key, key_size, salt, salt_size);
+	hkdf.extract(derived, length, info, info_size);
+}
+
+void Provider::aes_cbc_encrypt(uint8_t* output, const uint8_t* input, size_t size, const uint8_t* key, size_t key_size, const uint8_t iv[16]) {
+	if (key_size == 16) {
+		cbc_encrypt<AES128>(output, input, size, key, key_size, iv);
+	}
+	else if (key_size == 32) {
+		cbc_encrypt<AES256>(output, input, size, key, key_size, iv);
+	}
+	else {
+		throw std::invalid_argument("Invalid AES key size");
+	}
+}
+
+void Provider::aes_cbc_decrypt(uint8_t* output, const uint8_t* input, size_t size, const uint8_t* key, size_t key_size, const uint8_t iv[16]) {
+	if (key_size == 16) {
+		cbc_decrypt<AES128>(output, input, size, key, key_size, iv);
+	}
+	else if (key_size == 32) {
+		cbc_decrypt<AES256>(output, input, size, key, key_size, iv);
+	}
+	else {
+		throw std::invalid_argument("Invalid AES key size");
+	}
+}
+
+std::unique_ptr<Provider::AesCbc> Provider::aes_cbc(const uint8_t* key, size_t key_size) {
+	if (key_size == 16) {
+		return std::unique_ptr<AesCbc>(new CryptoAesCbc<AES128>(key, key_size));
+	}
+	else if (key_size == 32) {
+		return std::unique_ptr<AesCbc>(new CryptoAesCbc<AES256>(key, key_size));
+	}
+	throw std::invalid_argument("Invalid AES key size");
+}
+
+std::shared_ptr<Provider::Ed25519Key> Provider::ed25519_private_key(const uint8_t private_key[32], uint8_t public_key[32]) {
+	std::shared_ptr<CryptoEd25519Key> key(new CryptoEd25519Key());
+	memcpy(key->_private_key, private_key, 32);
+	ed25519_expand(key->_expanded, private_key);
+	ed25519_base(key->_public_key, key->_expanded);
+	memcpy(public_key, key->_public_key, 32);
+	return key;
+}
+
+std::shared_ptr<Provider::Ed25519Key> Provider::ed25519_public_key(const uint8_t public_key[32]) {
+	std::shared_ptr<CryptoEd25519Key> key(new CryptoEd25519Key());
+	memset(key->_private_key, 0, 32);
+	memcpy(key->_public_key, public_key, 32);
+	key->_verify_key.decode(public_key);
+	return key;
+}
+
+void Provider::ed25519_sign(const Ed25519Key& private_key, uint8_t signature[64], const uint8_t* message, size_t size) {
+	const CryptoEd25519Key& key = static_cast<const CryptoEd25519Key&>(private_key);
+	ed25519_sign_expanded(signature, key._expanded, key._public_key, message, size);
+}
+
+bool Provider::ed25519_verify(const Ed25519Key& public_key, const uint8_t signature[64], const uint8_t* message, size_t size) {
+	const CryptoEd25519Key& key = static_cast<const CryptoEd25519Key&>(public_key);
+	return key._verify_key.verify(signature, message, size);
+}
+
+void Provider::x25519_public_key(uint8_t public_key[32], const uint8_t private_key[32]) {
+#if defined(RNS_X25519_FIXED_BASE)
+	x25519_base(public_key, private_key);
+#else
+	Curve25519::eval(public_key, private_key, 0);
+#endif
+}
+
+bool Provider::x25519_exchange(uint8_t shared_key[32], const uint8_t private_key[32], const uint8_t peer_public_key[32]) {
+	return Curve25519::eval(shared_key, private_key, peer_public_key);
+}
+
+#endif
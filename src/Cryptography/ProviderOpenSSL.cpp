@@ -0,0 +1,308 @@
+#include "Provider.h"
+
+#if defined(RNS_CRYPTO_OPENSSL)
+
+// HMAC_CTX is deprecated in OpenSSL 3 but is the interface shared with 1.1.1
+#define OPENSSL_API_COMPAT 10101
+
+#include <openssl/evp.h>
+#include <openssl/kdf.h>
+#include <openssl/hmac.h>
+#include <openssl/crypto.h>
+
+#include <stdexcept>
+#include <string.h>
+
+using namespace RNS::Cryptography;
+
+/*
+Backend on OpenSSL's libcrypto (1.1.1 or later) for native builds.
+libcrypto dispatches to AES-NI, SHA extensions and AVX2 code at runtime.
+*/
+
+namespace {
+
+	class OpenSSLHmac : public Provider::Hmac {
+	public:
+		OpenSSLHmac(const EVP_MD* md, const uint8_t* key, size_t key_size) : _ctx(HMAC_CTX_new()), _size(EVP_MD_size(md)) {
+			if (_ctx == nullptr || !HMAC_Init_ex(_ctx, key, (int)key_size, md, nullptr)) {
+				HMAC_CTX_free(_ctx);
+				throw std::runtime_error("Failed to initialise HMAC");
+			}
+		}
+		virtual ~OpenSSLHmac() {
+			HMAC_CTX_free(_ctx);
+		}
+		virtual void update(const uint8_t* data, size_t size) {
+			HMAC_Update(_ctx, data, size);
+		}
+		virtual void finalize(uint8_t* mac) {
+			unsigned int length = 0;
+			HMAC_Final(_ctx, mac, &length);
+		}
+		virtual void reset() {
+			// a null key reuses the pads computed at initialisation
+			HMAC_Init_ex(_ctx, nullptr, 0, nullptr, nullptr);
+		}
+		virtual size_t size() const {
+			return _size;
+		}
+		virtual std::unique_ptr<Provider::Hmac> clone() const {
+			return std::unique_ptr<Provider::Hmac>(new OpenSSLHmac(*this));
+		}
+	private:
+		OpenSSLHmac(const OpenSSLHmac& hmac) : _ctx(HMAC_CTX_new()), _size(hmac._size) {
+			if (_ctx == nullptr || !HMAC_CTX_copy(_ctx, hmac._ctx)) {
+				HMAC_CTX_free(_ctx);
+				throw std::runtime_error("Failed to copy HMAC");
+			}
+		}
+		HMAC_CTX* _ctx;
+		size_t _size;
+	};
+
+	class OpenSSLSha256 : public Provider::Sha256 {
+	public:
+		OpenSSLSha256() : _ctx(EVP_MD_CTX_new()) {
+			if (_ctx == nullptr || !EVP_DigestInit_ex(_ctx, EVP_sha256(), nullptr)) {
+				EVP_MD_CTX_free(_ctx);
+				throw std::runtime_error("Failed to initialise SHA-256");
+			}
+		}
+		virtual ~OpenSSLSha256() {
+			EVP_MD_CTX_free(_ctx);
+		}
+		virtual void update(const uint8_t* data, size_t size) {
+			EVP_DigestUpdate(_ctx, data, size);
+		}
+		virtual void finalize(uint8_t hash[32]) {
+			unsigned int length = 0;
+			EVP_DigestFinal_ex(_ctx, hash, &length);
+		}
+		virtual std::unique_ptr<Provider::Sha256> clone() const {
+			return std::unique_ptr<Provider::Sha256>(new OpenSSLSha256(*this));
+		}
+	private:
+		OpenSSLSha256(const OpenSSLSha256& hash) : _ctx(EVP_MD_CTX_new()) {
+			if (_ctx == nullptr || !EVP_MD_CTX_copy_ex(_ctx, hash._ctx)) {
+				EVP_MD_CTX_free(_ctx);
+				throw std::runtime_error("Failed to copy SHA-256 state");
+			}
+		}
+		EVP_MD_CTX* _ctx;
+	};
+
+	class OpenSSLEd25519Key : public Provider::Ed25519Key {
+	public:
+		OpenSSLEd25519Key(EVP_PKEY* pkey) : _pkey(pkey) {}
+		virtual ~OpenSSLEd25519Key() {
+			EVP_PKEY_free(_pkey);
+		}
+		EVP_PKEY* _pkey;
+	};
+
+	const EVP_CIPHER* aes_cbc_cipher(size_t key_size) {
+		if (key_size == 16) {
+			return EVP_aes_128_cbc();
+		}
+		else if (key_size == 32) {
+			return EVP_aes_256_cbc();
+		}
+		throw std::invalid_argument("Invalid AES key size");
+	}
+
+	void aes_cbc_run(uint8_t* output, const uint8_t* input, size_t size, const uint8_t* key, size_t key_size, const uint8_t iv[16], int encrypt) {
+		const EVP_CIPHER* cipher = aes_cbc_cipher(key_size);
+		EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+		int length = 0;
+		bool success = ctx != nullptr
+			&& EVP_CipherInit_ex(ctx, cipher, nullptr, key, iv, encrypt)
+			&& EVP_CIPHER_CTX_set_padding(ctx, 0)
+			&& EVP_CipherUpdate(ctx, output, &length, input, (int)size);
+		EVP_CIPHER_CTX_free(ctx);
+		if (!success) {
+			throw std::runtime_error("AES-CBC operation failed");
+		}
+	}
+
+	class OpenSSLAesCbc : public Provider::AesCbc {
+	public:
+		OpenSSLAesCbc(const uint8_t* key, size_t key_size) : _encrypt(EVP_CIPHER_CTX_new()), _decrypt(EVP_CIPHER_CTX_new()) {
+			const EVP_CIPHER* cipher = aes_cbc_cipher(key_size);
+			bool success = _encrypt != nullptr && _decrypt != nullptr
+				&& EVP_CipherInit_ex(_encrypt, cipher, nullptr, key, nullptr, 1)
+				&& EVP_CIPHER_CTX_set_padding(_encrypt, 0)
+				&& EVP_CipherInit_ex(_decrypt, cipher, nullptr, key, nullptr, 0)
+				&& EVP_CIPHER_CTX_set_padding(_decrypt, 0);
+			if (!success) {
+				EVP_CIPHER_CTX_free(_encrypt);
+				EVP_CIPHER_CTX_free(_decrypt);
+				throw std::runtime_error("Failed to initialise AES-CBC");
+			}
+		}
+		virtual ~OpenSSLAesCbc() {
+			EVP_CIPHER_CTX_free(_encrypt);
+			EVP_CIPHER_CTX_free(_decrypt);
+		}
+		virtual void encrypt(uint8_t* output, const uint8_t* input, size_t size, const uint8_t iv[16]) {
+			run(_encrypt, output, input, size, iv);
+		}
+		virtual void decrypt(uint8_t* output, const uint8_t* input, size_t size, const uint8_t iv[16]) {
+			run(_decrypt, output, input, size, iv);
+		}
+	private:
+		// Only the IV is set per message, the expanded key is kept
+		void run(EVP_CIPHER_CTX* ctx, uint8_t* output, const uint8_t* input, size_t size, const uint8_t iv[16]) {
+			int length = 0;
+			if (!EVP_CipherInit_ex(ctx, nullptr, nullptr, nullptr, iv, -1) || !EVP_CipherUpdate(ctx, output, &length, input, (int)size)) {
+				throw std::runtime_error("AES-CBC operation failed");
+			}
+		}
+		EVP_CIPHER_CTX* _encrypt;
+		EVP_CIPHER_CTX* _decrypt;
+	};
+
+	EVP_PKEY* x25519_key(const uint8_t private_key[32]) {
+		EVP_PKEY* pkey = EVP_PKEY_new_raw_private_key(EVP_PKEY_X25519, nullptr, private_key, 32);
+		if (pkey == nullptr) {
+			throw std::runtime_error("Failed to load X25519 private key");
+		}
+		return pkey;
+	}
+
+}
+
+const char* Provider::name() {
+	return "OpenSSL";
+}
+
+void Provider::sha256(uint8_t hash[32], const uint8_t* data, size_t size) {
+	EVP_Digest(data, size, hash, nullptr, EVP_sha256(), nullptr);
+}
+
+void Provider::sha256_batch(uint8_t (*hashes)[32], const uint8_t* const* data, const size_t* sizes, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		EVP_Digest(data[i], sizes[i], hashes[i], nullptr, EVP_sha256(), nullptr);
+	}
+}
+
+std::unique_ptr<Provider::Sha256> Provider::sha256_stream() {
+	return std::unique_ptr<Sha256>(new OpenSSLSha256());
+}
+
+void Provider::sha512(uint8_t hash[64], const uint8_t* data, size_t size) {
+	EVP_Digest(data, size, hash, nullptr, EVP_sha512(), nullptr);
+}
+
+std::unique_ptr<Provider::Hmac> Provider::hmac_sha256(const uint8_t* key, size_t key_size) {
+	return std::unique_ptr<Hmac>(new OpenSSLHmac(EVP_sha256(), key, key_size));
+}
+
+std::unique_ptr<Provider::Hmac> Provider::hmac_sha512(const uint8_t* key, size_t key_size) {
+	return std::unique_ptr<Hmac>(new OpenSSLHmac(EVP_sha512(), key, key_size));
+}
+
+void Provider::hkdf_sha256(uint8_t* derived, size_t length, const uint8_t* key, size_t key_size, const uint8_t* salt, size_t salt_size, const uint8_t* info, size_t info_size) {
+	// RFC 5869 salt defaults to a string of zeros of the hash length
+	static const uint8_t zero_salt[32] = {0};
+	if (salt == nullptr || salt_size == 0) {
+		salt = zero_salt;
+		salt_size = sizeof(zero_salt);
+	}
+	EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, nullptr);
+	size_t derived_length = length;
+	bool success = ctx != nullptr
+		&& EVP_PKEY_derive_init(ctx) > 0
+		&& EVP_PKEY_CTX_set_hkdf_md(ctx, EVP_sha256()) > 0
+		&& EVP_PKEY_CTX_set1_hkdf_salt(ctx, salt, (int)salt_size) > 0
+		&& EVP_PKEY_CTX_set1_hkdf_key(ctx, key, (int)key_size) > 0
+		&& (info_size == 0 || EVP_PKEY_CTX_add1_hkdf_info(ctx, info, (int)info_size) > 0)
+		&& EVP_PKEY_derive(ctx, derived, &derived_length) > 0;
+	EVP_PKEY_CTX_free(ctx);
+	if (!success) {
+		throw std::runtime_error("HKDF derivation failed");
+	}
+}
+
+void Provider::aes_cbc_encrypt(uint8_t* output, const uint8_t* input, size_t size, const uint8_t* key, size_t key_size, const uint8_t iv[16]) {
+	aes_cbc_run(output, input, size, key, key_size, iv, 1);
+}
+
+void Provider::aes_cbc_decrypt(uint8_t* output, const uint8_t* input, size_t size, const uint8_t* key, size_t key_size, const uint8_t iv[16]) {
+	aes_cbc_run(output, input, size, key, key_size, iv, 0);
+}
+
+std::unique_ptr<Provider::AesCbc> Provider::aes_cbc(const uint8_t* key, size_t key_size) {
+	return std::unique_ptr<AesCbc>(new OpenSSLAesCbc(key, key_size));
+}
+
+std::shared_ptr<Provider::Ed25519Key> Provider::ed25519_private_key(const uint8_t private_key[32], uint8_t public_key[32]) {
+	EVP_PKEY* pkey = EVP_PKEY_new_raw_private_key(EVP_PKEY_ED25519, nullptr, private_key, 32);
+	if (pkey == nullptr) {
+		throw std::runtime_error("Failed to load Ed25519 private key");
+	}
+	std::shared_ptr<OpenSSLEd25519Key> key(new OpenSSLEd25519Key(pkey));
+	size_t length = 32;
+	if (!EVP_PKEY_get_raw_public_key(pkey, public_key, &length)) {
+		throw std::runtime_error("Failed to derive Ed25519 public key");
+	}
+	return key;
+}
+
+std::shared_ptr<Provider::Ed25519Key> Provider::ed25519_public_key(const uint8_t public_key[32]) {
+	EVP_PKEY* pkey = EVP_PKEY_new_raw_public_key(EVP_PKEY_ED25519, nullptr, public_key, 32);
+	if (pkey == nullptr) {
+		throw std::runtime_error("Failed to load Ed25519 public key");
+	}
+	return std::shared_ptr<Ed25519Key>(new OpenSSLEd25519Key(pkey));
+}
+
+void Provider::ed25519_sign(const Ed25519Key& private_key, uint8_t signature[64], const uint8_t* message, size_t size) {
+	const OpenSSLEd25519Key& key = static_cast<const OpenSSLEd25519Key&>(private_key);
+	EVP_MD_CTX* ctx = EVP_MD_CTX_new();
+	size_t length = 64;
+	bool success = ctx != nullptr
+		&& EVP_DigestSignInit(ctx, nullptr, nullptr, nullptr, key._pkey) > 0
+		&& EVP_DigestSign(ctx, signature, &length, message, size) > 0;
+	EVP_MD_CTX_free(ctx);
+	if (!success) {
+		throw std::runtime_error("Ed25519 signing failed");
+	}
+}
+
+bool Provider::ed25519_verify(const Ed25519Key& public_key, const uint8_t signature[64], const uint8_t* message, size_t size) {
+	const OpenSSLEd25519Key& key = static_cast<const OpenSSLEd25519Key&>(public_key);
+	EVP_MD_CTX* ctx = EVP_MD_CTX_new();
+	bool valid = ctx != nullptr
+		&& EVP_DigestVerifyInit(ctx, nullptr, nullptr, nullptr, key._pkey) > 0
+		&& EVP_DigestVerify(ctx, signature, 64, message, size) == 1;
+	EVP_MD_CTX_free(ctx);
+	return valid;
+}
+
+void Provider::x25519_public_key(uint8_t public_key[32], const uint8_t private_key[32]) {
+	EVP_PKEY* pkey = x25519_key(private_key);
+	size_t length = 32;
+	bool success = EVP_PKEY_get_raw_public_key(pkey, public_key, &length) > 0;
+	EVP_PKEY_free(pkey);
+	if (!success) {
+		throw std::runtime_error("Failed to derive X25519 public key");
+	}
+}
+
+bool Provider::x25519_exchange(uint8_t shared_key[32], const uint8_t private_key[32], const uint8_t peer_public_key[32]) {
+	EVP_PKEY* pkey = x25519_key(private_key);
+	EVP_PKEY* peer = EVP_PKEY_new_raw_public_key(EVP_PKEY_X25519, nullptr, peer_public_key, 32);
+	EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new(pkey, nullptr);
+	size_t length = 32;
+	bool success = peer != nullptr && ctx != nullptr
+		&& EVP_PKEY_derive_init(ctx) > 0
+		&& EVP_PKEY_derive_set_peer(ctx, peer) > 0
+		&& EVP_PKEY_derive(ctx, shared_key, &length) > 0;
+	EVP_PKEY_CTX_free(ctx);
+	EVP_PKEY_free(peer);
+	EVP_PKEY_free(pkey);
+	return success;
+}
+
+#endif
@@ -0,0 +1,93 @@
+#include "Random.h"
+
+#include <Crypto.h>
+#include <RNG.h>
+
+#include <string.h>
+
+#if defined(NATIVE)
+#include <mutex>
+#include <pthread.h>
+#endif
+
+using namespace RNS;
+
+// Bytes drawn from RNG per refill. Each RNG request ends by rekeying its
+// generator, so larger refills spread that cost over more packets.
+#ifndef RNS_RANDOM_POOL_SIZE
+#if defined(NATIVE)
+#define RNS_RANDOM_POOL_SIZE 1024
+#else
+#define RNS_RANDOM_POOL_SIZE 256
+#endif
+#endif
+
+namespace {
+
+	struct RandomPool {
+		uint8_t buffer[RNS_RANDOM_POOL_SIZE];
+		// unused bytes, taken from the end of the buffer
+		size_t available = 0;
+		~RandomPool() {
+			clean(buffer, sizeof(buffer));
+		}
+	};
+
+#if defined(NATIVE)
+	// RNG itself is shared by all threads
+	std::mutex rng_mutex;
+	thread_local RandomPool pool;
+
+	// A forked child must not hand out the same bytes as its parent. Only the
+	// forking thread lives on in the child, so its pool is the one to drop.
+	// RNG is held across the fork so that the child gets it unlocked.
+	void fork_prepare() {
+		rng_mutex.lock();
+	}
+	void fork_parent() {
+		rng_mutex.unlock();
+	}
+	void fork_child() {
+		rng_mutex.unlock();
+		clean(pool.buffer, sizeof(pool.buffer));
+		pool.available = 0;
+	}
+	struct ForkHandlers {
+		ForkHandlers() {
+			pthread_atfork(fork_prepare, fork_parent, fork_child);
+		}
+	} fork_handlers;
+#else
+	// Not locked, random_bytes() must be called from one task only
+	RandomPool pool;
+#endif
+
+	void rng_rand(uint8_t* output, size_t length) {
+#if defined(NATIVE)
+		std::lock_guard<std::mutex> lock(rng_mutex);
+#endif
+		RNG.rand(output, length);
+	}
+
+}
+
+void RNS::Cryptography::random_bytes(uint8_t* output, size_t length) {
+	// Requests of a size comparable to the pool gain nothing from it
+	if (length >= RNS_RANDOM_POOL_SIZE / 2) {
+		rng_rand(output, length);
+		return;
+	}
+	while (length > 0) {
+		if (pool.available == 0) {
+			rng_rand(pool.buffer, sizeof(pool.buffer));
+			pool.available = sizeof(pool.buffer);
+		}
+		size_t count = (length < pool.available) ? length : pool.available;
+		uint8_t* bytes = pool.buffer + sizeof(pool.buffer) - pool.available;
+		memcpy(output, bytes, count);
+		clean(bytes, count);
+		pool.available -= count;
+		output += count;
+		length -= count;
+	}
+}
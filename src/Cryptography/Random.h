@@ -7,21 +7,29 @@
 
 namespace RNS { namespace Cryptography {
 
+	// Fills output with random bytes taken from a buffered pool, refilled from
+	// RNG in large chunks. Native builds keep one pool per thread, and drop
+	// the pool in a forked child. Other builds keep one pool without locking,
+	// so must call this from a single task. Bytes are wiped from the pool as
+	// they are handed out, so output already returned cannot be recovered
+	// from the pool afterwards.
+	void random_bytes(uint8_t* output, size_t length);
+
     // return vector specified length of random bytes
 	inline const Bytes random(size_t length) {
         Bytes rand;
-        RNG.rand(rand.writable(length), length);
+        random_bytes(rand.writable(length), length);
         return rand;
     }
 
     // return 32 bit random unigned int
     inline uint32_t randomnum() {
-        Bytes rand;
-        RNG.rand(rand.writable(4), 4);
-        uint32_t randnum = uint32_t((unsigned char)(rand.data()[0]) << 24 |
-                                    (unsigned char)(rand.data()[0]) << 16 |
-                                    (unsigned char)(rand.data()[0]) << 8 |
-                                    (unsigned char)(rand.data()[0]));
+        uint8_t rand[4];
+        random_bytes(rand, 4);
+        uint32_t randnum = uint32_t((uint32_t)rand[0] << 24 |
+                                    (uint32_t)rand[1] << 16 |
+                                    (uint32_t)rand[2] << 8 |
+                                    (uint32_t)rand[3]);
         return randnum;
     }
 
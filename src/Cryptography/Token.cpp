@@ -1,11 +1,15 @@
 #include "Token.h"
 
-#include "HMAC.h"
+#include "Provider.h"
 #include "PKCS7.h"
-#include "AES.h"
+#include "Random.h"
 #include "../Log.h"
 
+#include <Crypto.h>
+
+#include <memory>
 #include <stdexcept>
+#include <string.h>
 #include <time.h>
 
 using namespace RNS;
@@ -22,16 +26,16 @@ Token::Token(const Bytes& key, token_mode mode /*= AES*/) {
 		if (key.size() == 32) {
 			_mode = MODE_AES_128_CBC;
 			//p self._signing_key = key[:16]
-			_signing_key = key.left(16);
+			_hmac = Provider::hmac_sha256(key.data(), 16);
 			//p self._encryption_key = key[16:]
-			_encryption_key = key.mid(16);
+			_cipher = Provider::aes_cbc(key.data() + 16, 16);
 		}
 		else if (key.size() == 64) {
 			_mode = MODE_AES_256_CBC;
 			//p self._signing_key = key[:32]
-			_signing_key = key.left(32);
+			_hmac = Provider::hmac_sha256(key.data(), 32);
 			//p self._encryption_key = key[32:]
-			_encryption_key = key.mid(32);
+			_cipher = Provider::aes_cbc(key.data() + 32, 32);
 		}
 		else {
 			throw std::invalid_argument("Token key must be 128 or 256 bits, not " + std::to_string(key.size()*8));
@@ -49,111 +53,279 @@ Token::~Token() {
 }
 
 bool Token::verify_hmac(const Bytes& token) {
+	return verify_hmac(token.data(), token.size());
+}
+
+bool Token::verify_hmac(const uint8_t* token, size_t size) {
 
-	if (token.size() <= 32) {
-		throw std::invalid_argument("Cannot verify HMAC on token of only " + std::to_string(token.size()) + " bytes");
+	if (size <= 32) {
+		throw std::invalid_argument("Cannot verify HMAC on token of only " + std::to_string(size) + " bytes");
 	}
 
 	//received_hmac = token[-32:]
-	Bytes received_hmac = token.right(32);
-	DEBUG("Token::verify_hmac: received_hmac: " + received_hmac.toHex());
+	const uint8_t* received_hmac = token + size - 32;
 	//expected_hmac = HMAC.new(self._signing_key, token[:-32]).digest()
-	Bytes expected_hmac = HMAC::generate(_signing_key, token.left(token.size()-32))->digest();
-	DEBUG("Token::verify_hmac: expected_hmac: " + expected_hmac.toHex());
+	uint8_t expected_hmac[32];
+	_hmac->reset();
+	_hmac->update(token, size - 32);
+	_hmac->finalize(expected_hmac);
 
-	return (received_hmac == expected_hmac);
+	// compare in constant time
+	uint8_t diff = 0;
+	for (uint8_t i = 0; i < 32; i++) {
+		diff |= received_hmac[i] ^ expected_hmac[i];
+	}
+	return (diff == 0);
 }
 
 const Bytes Token::encrypt(const Bytes& data) {
+	Bytes token;
+	encrypt(token.writable(token_size(data.size())), data.data(), data.size());
+	DEBUG("Token::encrypt: token length: " + std::to_string(token.size()));
+	return token;
+}
 
-	DEBUG("Token::encrypt: plaintext length: " + std::to_string(data.size()));
-	Bytes iv = random(16);
+size_t Token::encrypt(uint8_t* token, const uint8_t* data, size_t size) {
+
+	DEBUG("Token::encrypt: plaintext length: " + std::to_string(size));
+	uint8_t* iv = token;
+	random_bytes(iv, 16);
 	//double current_time = OS::time();
-	TRACE("Token::encrypt: iv:         " + iv.toHex());
-
-	TRACE("Token::encrypt: plaintext:  " + data.toHex());
-	Bytes ciphertext;
-	if (_mode == MODE_AES_128_CBC) {
-		ciphertext = AES_128_CBC::encrypt(
-			PKCS7::pad(data),
-			_encryption_key,
-			iv
-		);
-	}
-	else if (_mode == MODE_AES_256_CBC) {
-		ciphertext = AES_256_CBC::encrypt(
-			PKCS7::pad(data),
-			_encryption_key,
-			iv
-		);
-	}
-	else {
-		throw new std::invalid_argument("Invalid token mode "+std::to_string(_mode));
-	}
-	DEBUG("Token::encrypt: padded ciphertext length: " + std::to_string(ciphertext.size()));
-	TRACE("Token::encrypt: ciphertext: " + ciphertext.toHex());
 
-	Bytes signed_parts = iv + ciphertext;
+	uint8_t* ciphertext = token + 16;
+	if (size > 0) {
+		memcpy(ciphertext, data, size);
+	}
+	size_t ciphertext_size = PKCS7::pad(ciphertext, size);
+	_cipher->encrypt(ciphertext, ciphertext, ciphertext_size, iv);
+	DEBUG("Token::encrypt: padded ciphertext length: " + std::to_string(ciphertext_size));
 
 	//return signed_parts + HMAC::generate(_signing_key, signed_parts)->digest();
-	Bytes sig(HMAC::generate(_signing_key, signed_parts)->digest());
-	TRACE("Token::encrypt: sig:        " + sig.toHex());
-	Bytes token(signed_parts + sig);
-	DEBUG("Token::encrypt: token length: " + std::to_string(token.size()));
-	return token;
+	size_t signed_size = 16 + ciphertext_size;
+	_hmac->reset();
+	_hmac->update(token, signed_size);
+	_hmac->finalize(token + signed_size);
+	return signed_size + 32;
 }
 
-
 const Bytes Token::decrypt(const Bytes& token) {
+	Bytes plaintext;
+	// token size is checked before anything is written
+	size_t size = decrypt(plaintext.writable(token.size() > 48 ? token.size() - 48 : 0), token.data(), token.size());
+	plaintext.resize(size);
+	return plaintext;
+}
 
-	DEBUG("Token::decrypt: token length: " + std::to_string(token.size()));
-	if (token.size() < 48) {
-		throw std::invalid_argument("Cannot decrypt token of only " + std::to_string(token.size()) + " bytes");
+size_t Token::decrypt(uint8_t* plaintext, const uint8_t* token, size_t size) {
+
+	DEBUG("Token::decrypt: token length: " + std::to_string(size));
+	if (size < 48) {
+		throw std::invalid_argument("Cannot decrypt token of only " + std::to_string(size) + " bytes");
 	}
 
-	if (!verify_hmac(token)) {
+	if (!verify_hmac(token, size)) {
 		throw std::invalid_argument("Token token HMAC was invalid");
 	}
 
 	//iv = token[:16]
-	Bytes iv = token.left(16);
-	TRACE("Token::decrypt: iv:         " + iv.toHex());
+	const uint8_t* iv = token;
 
 	//ciphertext = token[16:-32]
-	Bytes ciphertext = token.mid(16, token.size()-48);
-	TRACE("Token::decrypt: ciphertext: " + ciphertext.toHex());
+	const uint8_t* ciphertext = token + 16;
+	size_t ciphertext_size = size - 48;
 
 	try {
-		Bytes plaintext;
-		if (_mode == MODE_AES_128_CBC) {
-			plaintext = PKCS7::unpad(
-				AES_128_CBC::decrypt(
-					ciphertext,
-					_encryption_key,
-					iv
-				)
-			);
-		}
-		else if (_mode == MODE_AES_256_CBC) {
-			plaintext = PKCS7::unpad(
-				AES_256_CBC::decrypt(
-					ciphertext,
-					_encryption_key,
-					iv
-				)
-			);
+		if (ciphertext_size == 0 || ciphertext_size % 16 != 0) {
+			throw std::invalid_argument("Invalid ciphertext length of " + std::to_string(ciphertext_size) + " bytes");
 		}
-		else {
-			throw new std::invalid_argument("Invalid token mode "+std::to_string(_mode));
-		}
-		DEBUG("Token::encrypt: unpadded plaintext length: " + std::to_string(plaintext.size()));
-		TRACE("Token::decrypt: plaintext:  " + plaintext.toHex());
-
-		DEBUG("Token::decrypt: plaintext length: " + std::to_string(plaintext.size()));
-		return plaintext;
+		_cipher->decrypt(plaintext, ciphertext, ciphertext_size, iv);
+		size_t plaintext_size = PKCS7::unpad(plaintext, ciphertext_size);
+		DEBUG("Token::decrypt: plaintext length: " + std::to_string(plaintext_size));
+		return plaintext_size;
 	}
 	catch (std::exception& e) {
 		WARNING("Could not decrypt Token token");
 		throw std::runtime_error("Could not decrypt Token token");
 	}
-}
\ No newline at end of file
+}
+
+
+TokenEncryptor::TokenEncryptor(const Token::Ptr& token) : _token(token) {
+	if (!_token) {
+		throw std::invalid_argument("TokenEncryptor requires a token");
+	}
+	// MAC state of its own, the token keeps serving whole messages meanwhile
+	_hmac = _token->_hmac->clone();
+	_hmac->reset();
+	MEM("TokenEncryptor object created");
+}
+
+TokenEncryptor::~TokenEncryptor() {
+	clean(_chain, sizeof(_chain));
+	clean(_buffer, sizeof(_buffer));
+	MEM("TokenEncryptor object destroyed");
+}
+
+const Bytes TokenEncryptor::update(const Bytes& data) {
+	const uint8_t* input = data.data();
+	size_t size = data.size();
+	Bytes output;
+	uint8_t* token = output.writable(16 + _buffered + size);
+	size_t written = 0;
+	if (!_started) {
+		written += start(token);
+	}
+
+	// Complete the buffered block first
+	if (_buffered > 0) {
+		size_t count = (size < 16 - _buffered) ? size : 16 - _buffered;
+		memcpy(_buffer + _buffered, input, count);
+		_buffered += count;
+		input += count;
+		size -= count;
+		if (_buffered == 16) {
+			encrypt_blocks(token + written, _buffer, 16);
+			written += 16;
+			_buffered = 0;
+		}
+	}
+	// Padding is always added by finalize(), so whole blocks go out at once
+	size_t whole = size - (size % 16);
+	if (whole > 0) {
+		encrypt_blocks(token + written, input, whole);
+		written += whole;
+		input += whole;
+		size -= whole;
+	}
+	if (size > 0) {
+		memcpy(_buffer + _buffered, input, size);
+		_buffered += size;
+	}
+
+	output.resize(written);
+	return output;
+}
+
+const Bytes TokenEncryptor::finalize() {
+	Bytes output;
+	uint8_t* token = output.writable(16 + 16 + 32);
+	size_t written = 0;
+	if (!_started) {
+		written += start(token);
+	}
+	size_t padded_size = PKCS7::pad(_buffer, _buffered);
+	encrypt_blocks(token + written, _buffer, padded_size);
+	written += padded_size;
+	_buffered = 0;
+	_hmac->finalize(token + written);
+	written += 32;
+	output.resize(written);
+	return output;
+}
+
+size_t TokenEncryptor::start(uint8_t* output) {
+	random_bytes(_chain, 16);
+	memcpy(output, _chain, 16);
+	_hmac->update(_chain, 16);
+	_started = true;
+	return 16;
+}
+
+void TokenEncryptor::encrypt_blocks(uint8_t* output, const uint8_t* input, size_t size) {
+	_token->_cipher->encrypt(output, input, size, _chain);
+	_hmac->update(output, size);
+	memcpy(_chain, output + size - 16, 16);
+}
+
+
+TokenDecryptor::TokenDecryptor(const Token::Ptr& token) : _token(token) {
+	if (!_token) {
+		throw std::invalid_argument("TokenDecryptor requires a token");
+	}
+	_hmac = _token->_hmac->clone();
+	_hmac->reset();
+	MEM("TokenDecryptor object created");
+}
+
+TokenDecryptor::TokenDecryptor(const Token::Ptr& token, const Bytes& chain) : _token(token) {
+	if (!_token) {
+		throw std::invalid_argument("TokenDecryptor requires a token");
+	}
+	if (chain.size() != 16) {
+		throw std::invalid_argument("TokenDecryptor chain must be one block");
+	}
+	memcpy(_chain, chain.data(), 16);
+	_started = true;
+	MEM("TokenDecryptor object created");
+}
+
+TokenDecryptor::~TokenDecryptor() {
+	clean(_chain, sizeof(_chain));
+	MEM("TokenDecryptor object destroyed");
+}
+
+const Bytes TokenDecryptor::update(const Bytes& token) {
+	_pending << token;
+	Bytes output;
+	size_t consumed = 0;
+	if (!_started) {
+		if (_pending.size() < 16) {
+			return output;
+		}
+		//iv = token[:16]
+		memcpy(_chain, _pending.data(), 16);
+		_hmac->update(_chain, 16);
+		consumed = 16;
+		_started = true;
+	}
+
+	// The last 48 bytes could be the final block and the HMAC
+	size_t available = _pending.size() - consumed;
+	if (available > 48) {
+		size_t size = ((available - 48) / 16) * 16;
+		if (size > 0) {
+			const uint8_t* ciphertext = _pending.data() + consumed;
+			if (_hmac) {
+				_hmac->update(ciphertext, size);
+			}
+			_token->_cipher->decrypt(output.writable(size), ciphertext, size, _chain);
+			memcpy(_chain, ciphertext + size - 16, 16);
+			consumed += size;
+		}
+	}
+
+	if (consumed > 0) {
+		_pending = _pending.mid(consumed);
+	}
+	return output;
+}
+
+const Bytes TokenDecryptor::finalize() {
+	if (!_started || _pending.size() != 48) {
+		throw std::invalid_argument("Invalid token length");
+	}
+	const uint8_t* ciphertext = _pending.data();
+	if (_hmac) {
+		const uint8_t* received_hmac = ciphertext + 16;
+		uint8_t expected_hmac[32];
+		_hmac->update(ciphertext, 16);
+		_hmac->finalize(expected_hmac);
+
+		// compare in constant time
+		uint8_t diff = 0;
+		for (uint8_t i = 0; i < 32; i++) {
+			diff |= received_hmac[i] ^ expected_hmac[i];
+		}
+		if (diff != 0) {
+			throw std::invalid_argument("Token token HMAC was invalid");
+		}
+	}
+
+	uint8_t plaintext[16];
+	_token->_cipher->decrypt(plaintext, ciphertext, 16, _chain);
+	size_t size = PKCS7::unpad(plaintext, 16);
+	Bytes output(plaintext, size);
+	clean(plaintext, sizeof(plaintext));
+	_pending = {Bytes::NONE};
+	return output;
+}
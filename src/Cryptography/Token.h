@@ -1,9 +1,11 @@
 #pragma once
 
+#include "Provider.h"
 #include "Random.h"
 #include "../Bytes.h"
 #include "../Type.h"
 
+#include <memory>
 #include <stdint.h>
 
 namespace RNS { namespace Cryptography {
@@ -16,6 +18,12 @@ namespace RNS { namespace Cryptography {
     eight byte TIMESTAMP field at the start of each token. These fields are
     not relevant to Reticulum. They are therefore stripped from this
     implementation, since they incur overhead and leak initiator metadata.
+
+    A token keeps its cipher and HMAC state between calls, so it is not safe
+    to use from more than one thread at a time. This holds for the encryptors
+    and decryptors built on it too, which share that state. Callers that
+    share a token across threads, such as the users of one Link, must
+    serialize their calls.
     */
 	class Token {
 
@@ -33,15 +41,107 @@ namespace RNS { namespace Cryptography {
 		Token(const Bytes& key, RNS::Type::Cryptography::Token::token_mode mode = RNS::Type::Cryptography::Token::MODE_AES);
 		~Token();
 
+	public:
+		// Size of the token produced for plaintext of the given size
+		static inline size_t token_size(size_t plaintext_size) {
+			return 16 + (plaintext_size / 16 + 1) * 16 + 32;
+		}
+
 	public:
 		bool verify_hmac(const Bytes& token);
 		const Bytes encrypt(const Bytes& data);
 		const Bytes decrypt(const Bytes& token);
 
+		// Writes the token for size bytes of data to token, which must hold
+		// token_size(size) bytes and must not overlap data. Padding, encryption
+		// and HMAC all run in the token buffer. Returns the token size.
+		size_t encrypt(uint8_t* token, const uint8_t* data, size_t size);
+		// Verifies and decrypts a token into plaintext, which must hold
+		// size - 48 bytes and must not overlap token. Returns the plaintext
+		// size, or throws if the token is invalid.
+		size_t decrypt(uint8_t* plaintext, const uint8_t* token, size_t size);
+
+	private:
+		bool verify_hmac(const uint8_t* token, size_t size);
+
 	private:
 		RNS::Type::Cryptography::Token::token_mode _mode = RNS::Type::Cryptography::Token::MODE_AES_256_CBC;
-		Bytes _signing_key;
-		Bytes _encryption_key;
+		// Keyed once for the lifetime of the token so that each message
+		// costs only the block processing
+		std::unique_ptr<Provider::AesCbc> _cipher;
+		std::unique_ptr<Provider::Hmac> _hmac;
+
+	friend class TokenEncryptor;
+	friend class TokenDecryptor;
+	};
+
+	/*
+	Builds one token from plaintext supplied in pieces, so that data too large
+	to hold in memory can be encrypted as it is read. The output of all calls
+	taken together is a token that Token::decrypt() accepts.
+	*/
+	class TokenEncryptor {
+
+	public:
+		using Ptr = std::shared_ptr<TokenEncryptor>;
+
+	public:
+		TokenEncryptor(const Token::Ptr& token);
+		~TokenEncryptor();
+
+	public:
+		// Returns the token bytes that follow from data, starting with the IV
+		const Bytes update(const Bytes& data);
+		// Returns the rest of the token, the final padded block and the HMAC
+		const Bytes finalize();
+
+	private:
+		size_t start(uint8_t* output);
+		void encrypt_blocks(uint8_t* output, const uint8_t* input, size_t size);
+
+	private:
+		Token::Ptr _token;
+		std::unique_ptr<Provider::Hmac> _hmac;
+		bool _started = false;
+		// IV for the next block, the previous ciphertext block once started
+		uint8_t _chain[16];
+		// Plaintext short of a whole block, with room for padding
+		uint8_t _buffer[32];
+		size_t _buffered = 0;
+	};
+
+	/*
+	Decrypts one token supplied in pieces. Plaintext is returned as soon as
+	whole blocks are available, while the final block and the HMAC are held
+	back for finalize(). Plaintext returned by update() is therefore not
+	authenticated until finalize() has returned without throwing.
+	*/
+	class TokenDecryptor {
+
+	public:
+		using Ptr = std::shared_ptr<TokenDecryptor>;
+
+	public:
+		TokenDecryptor(const Token::Ptr& token);
+		// Resumes decryption part way through a token, after the ciphertext
+		// block chain. The HMAC covers the whole token and is not verified.
+		TokenDecryptor(const Token::Ptr& token, const Bytes& chain);
+		~TokenDecryptor();
+
+	public:
+		// Returns the plaintext that can be decrypted so far
+		const Bytes update(const Bytes& token);
+		// Verifies the HMAC unless resumed and returns the last of the
+		// plaintext, throws if the token is invalid
+		const Bytes finalize();
+
+	private:
+		Token::Ptr _token;
+		std::unique_ptr<Provider::Hmac> _hmac;
+		bool _started = false;
+		uint8_t _chain[16];
+		// Token bytes not yet decrypted, at least the final block and HMAC
+		Bytes _pending;
 	};
 
 } }
@@ -1,3 +1,46 @@
 #include "X25519.h"
+#include "Curve25519Group.h"
+
+#include <string.h>
 
 using namespace RNS::Cryptography;
+
+#if defined(RNS_X25519_FIXED_BASE)
+
+using namespace RNS::Cryptography::Group;
+
+/*
+
+Fixed-base scalar multiplication for X25519 public key derivation.
+
+The scalar is multiplied with the Ed25519 base point on the birationally
+equivalent twisted Edwards curve, using a table of the multiples
+j * 16^(2i) * B for j in 1..8 and i in 0..31 (the radix-16 comb of ref10),
+and the result is mapped back to the Montgomery u-coordinate with
+u = (1 + y) / (1 - y). The Edwards base point maps to u = 9, so this gives
+the same result as the Montgomery ladder in Curve25519::eval(result, s, 0)
+with a fraction of the field multiplications. The table and the group
+arithmetic are in Curve25519Group.cpp. Table lookups scan every entry of a
+row so the memory access pattern does not depend on the secret scalar.
+
+*/
+
+void RNS::Cryptography::x25519_base(uint8_t public_key[32], const uint8_t private_key[32]) {
+	// The top bit of the scalar is ignored, as Curve25519::eval() does
+	uint8_t a[32];
+	memcpy(a, private_key, 32);
+	a[31] &= 0x7f;
+	ge_p3 h;
+	ge_scalarmult_base(h, a);
+	memset(a, 0, 32);
+
+	// Montgomery u = (1 + y) / (1 - y) = (Z + Y) / (Z - Y)
+	fe numerator, denominator, u;
+	fe_add(numerator, h.Z, h.Y);
+	fe_sub(denominator, h.Z, h.Y);
+	fe_invert(denominator, denominator);
+	fe_mul(u, numerator, denominator);
+	fe_tobytes(public_key, u);
+}
+
+#endif
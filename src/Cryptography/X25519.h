@@ -1,16 +1,34 @@
 #pragma once
 
+#include "Provider.h"
+#include "Random.h"
 #include "Bytes.h"
 #include "Log.h"
 
-#include <Curve25519.h>
-
 #include <memory>
 #include <stdexcept>
 #include <stdint.h>
 
+// The default crypto backend carries its own Curve25519 group arithmetic,
+// see Curve25519Group.h
+#if !defined(RNS_CRYPTO_OPENSSL)
+	#define RNS_CURVE25519_GROUP
+#endif
+
+// Fixed-base public key derivation keeps a 30KB table of base point
+// multiples, built on first use, so it is left out of Arduino builds.
+#if defined(RNS_CURVE25519_GROUP) && !defined(ARDUINO) && !defined(RNS_X25519_NO_FIXED_BASE)
+	#define RNS_X25519_FIXED_BASE
+#endif
+
 namespace RNS { namespace Cryptography {
 
+#if defined(RNS_X25519_FIXED_BASE)
+	// Derives the public key for a private key from a precomputed table,
+	// giving the same result as Curve25519::eval(public_key, private_key, 0)
+	void x25519_base(uint8_t public_key[32], const uint8_t private_key[32]);
+#endif
+
 	class X25519PublicKey {
 
 	public:
@@ -75,17 +93,26 @@ namespace RNS { namespace Cryptography {
 			if (privateKey) {
 				// use specified private key
 				_privateKey = privateKey;
-				// similar to derive public key from private key
-				// second param "f" is secret
-				//eval(uint8_t result[32], const uint8_t s[32], const uint8_t x[32])
 				// derive public key from private key
-				Curve25519::eval(_publicKey.writable(32), _privateKey.data(), 0);
+				Provider::x25519_public_key(_publicKey.writable(32), _privateKey.data());
 			}
 			else {
-				// create random private key and derive public key
-				// second param "f" is secret
-				//dh1(uint8_t k[32], uint8_t f[32])
-				Curve25519::dh1(_publicKey.writable(32), _privateKey.writable(32));
+				// create random private key and derive public key,
+				// clamped as in Curve25519::dh1(). The base point has prime
+				// order so only the identity (all zero key) can be weak
+				uint8_t* f = _privateKey.writable(32);
+				uint8_t* k = _publicKey.writable(32);
+				uint8_t weak;
+				do {
+					random_bytes(f, 32);
+					f[0] &= 0xF8;
+					f[31] = (f[31] & 0x7F) | 0x40;
+					Provider::x25519_public_key(k, f);
+					weak = 0;
+					for (uint8_t i = 0; i < 32; i++) {
+						weak |= k[i];
+					}
+				} while (weak == 0);
 			}
 		}
 		~X25519PrivateKey() {}
@@ -174,7 +201,7 @@ namespace RNS { namespace Cryptography {
 			DEBUG("X25519PublicKey::exchange: peer public key:  " + peer_public_key.toHex());
 			DEBUG("X25519PublicKey::exchange: pre private key:  " + _privateKey.toHex());
 			Bytes sharedKey;
-			if (!Curve25519::eval(sharedKey.writable(32), _privateKey.data(), peer_public_key.data())) {
+			if (peer_public_key.size() != 32 || !Provider::x25519_exchange(sharedKey.writable(32), _privateKey.data(), peer_public_key.data())) {
 				throw std::runtime_error("Peer key is invalid");
 			}
 			DEBUG("X25519PublicKey::exchange: shared key:       " + sharedKey.toHex());
@@ -186,8 +213,8 @@ namespace RNS { namespace Cryptography {
 			DEBUG("X25519PublicKey::exchange: public key:       " + _publicKey.toHex());
 			DEBUG("X25519PublicKey::exchange: peer public key:  " + peer_public_key.toHex());
 			DEBUG("X25519PublicKey::exchange: pre private key:  " + _privateKey.toHex());
-			Bytes sharedKey(peer_public_key);
-			bool success = Curve25519::dh2(sharedKey.writable(32), _privateKey.writable(32));
+			Bytes sharedKey;
+			bool success = peer_public_key.size() == 32 && Provider::x25519_exchange(sharedKey.writable(32), _privateKey.data(), peer_public_key.data());
 			DEBUG("X25519PublicKey::exchange: shared key:       " + sharedKey.toHex());
 			DEBUG("X25519PublicKey::exchange: post private key: " + _privateKey.toHex());
 			return success;
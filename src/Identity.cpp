@@ -2,6 +2,7 @@
 
 #include "Reticulum.h"
 #include "Transport.h"
+#include "TransportInstance.h"
 #include "Packet.h"
 #include "Log.h"
 #include "Utilities/OS.h"
@@ -19,13 +20,6 @@ using namespace RNS::Type::Identity;
 using namespace RNS::Cryptography;
 using namespace RNS::Utilities;
 
-/*static*/ std::map<Bytes, Identity::IdentityEntry> Identity::_known_destinations;
-/*static*/ bool Identity::_saving_known_destinations = false;
-// CBA
-// CBA ACCUMULATES
-/*static*/ //uint16_t Identity::_known_destinations_maxsize = 100;
-/*static*/ uint16_t Identity::_known_destinations_maxsize = 100;
-
 Identity::Identity(bool create_keys /*= true*/) : _object(new Object()) {
 	if (create_keys) {
 		createKeys();
@@ -131,6 +125,32 @@ void Identity::load_public_key(const Bytes& pub_bytes) {
 	}
 }
 
+/*
+Load the public key of a known destination, decoding it only on first use
+and sharing the decoded keys and hash with the entry afterwards.
+*/
+void Identity::load_public_key(IdentityEntry& entry) {
+	assert(_object);
+	if (!entry._pub || !entry._sig_pub) {
+		load_public_key(entry._public_key);
+		cache_public_key(entry);
+		return;
+	}
+	_object->_pub_bytes     = entry._public_key.left(Type::Identity::KEYSIZE/8/2);
+	_object->_sig_pub_bytes = entry._public_key.mid(Type::Identity::KEYSIZE/8/2);
+	_object->_pub           = entry._pub;
+	_object->_sig_pub       = entry._sig_pub;
+	_object->_hash          = entry._hash;
+	_object->_hexhash       = entry._hash.toHex();
+}
+
+void Identity::cache_public_key(IdentityEntry& entry) const {
+	assert(_object);
+	entry._pub     = _object->_pub;
+	entry._sig_pub = _object->_sig_pub;
+	entry._hash    = _object->_hash;
+}
+
 bool Identity::load(const char* path) {
 	TRACE("Reading identity key from storage...");
 #if defined(RNS_USE_FS)
@@ -196,7 +216,7 @@ Can be used to load previously created and saved identities into Reticulum.
 	else {
 		//p _known_destinations[destination_hash] = {OS::time(), packet_hash, public_key, app_data};
 		// CBA ACCUMULATES
-		_known_destinations.insert({destination_hash, {OS::time(), packet_hash, public_key, app_data}});
+		Transport::instance()._known_destinations.insert({destination_hash, {OS::time(), packet_hash, public_key, app_data}});
 	}
 }
 
@@ -208,12 +228,13 @@ Recall identity for a destination hash.
 */
 /*static*/ Identity Identity::recall(const Bytes& destination_hash) {
 	TRACE("Identity::recall...");
-	auto iter = _known_destinations.find(destination_hash);
-	if (iter != _known_destinations.end()) {
+	TransportInstance& node = Transport::instance();
+	auto iter = node._known_destinations.find(destination_hash);
+	if (iter != node._known_destinations.end()) {
 		TRACE("Identity::recall: Found identity entry for destination " + destination_hash.toHex());
-		const IdentityEntry& identity_data = (*iter).second;
+		IdentityEntry& identity_data = (*iter).second;
 		Identity identity(false);
-		identity.load_public_key(identity_data._public_key);
+		identity.load_public_key(identity_data);
 		identity.app_data(identity_data._app_data);
 		return identity;
 	}
@@ -240,8 +261,9 @@ Recall last heard app_data for a destination hash.
 */
 /*static*/ Bytes Identity::recall_app_data(const Bytes& destination_hash) {
 	TRACE("Identity::recall_app_data...");
-	auto iter = _known_destinations.find(destination_hash);
-	if (iter != _known_destinations.end()) {
+	TransportInstance& node = Transport::instance();
+	auto iter = node._known_destinations.find(destination_hash);
+	if (iter != node._known_destinations.end()) {
 		TRACE("Identity::recall_app_data: Found identity entry for destination " + destination_hash.toHex());
 		const IdentityEntry& identity_data = (*iter).second;
 		return identity_data._app_data;
@@ -259,13 +281,14 @@ Recall last heard app_data for a destination hash.
 	// simply overwrite on exit now that every local client
 	// disconnect triggers a data persist.
 
+	TransportInstance& node = Transport::instance();
 	bool success = false;
 	try {
-		if (_saving_known_destinations) {
+		if (node._saving_known_destinations) {
 			double wait_interval = 0.2;
 			double wait_timeout = 5;
 			double wait_start = OS::time();
-			while (_saving_known_destinations) {
+			while (node._saving_known_destinations) {
 				OS::sleep(wait_interval);
 				if (OS::time() > (wait_start + wait_timeout)) {
 					ERROR("Could not save known destinations to storage, waiting for previous save operation timed out.");
@@ -274,7 +297,7 @@ Recall last heard app_data for a destination hash.
 			}
 		}
 
-		_saving_known_destinations = true;
+		node._saving_known_destinations = true;
 		double save_start = OS::time();
 
 		std::map<Bytes, IdentityEntry> storage_known_destinations;
@@ -290,11 +313,11 @@ Recall last heard app_data for a destination hash.
 */
 
 		for (auto& [destination_hash, identity_entry] : storage_known_destinations) {
-			if (_known_destinations.find(destination_hash) == _known_destinations.end()) {
+			if (node._known_destinations.find(destination_hash) == node._known_destinations.end()) {
 				//_known_destinations[destination_hash] = storage_known_destinations[destination_hash];
 				//_known_destinations[destination_hash] = identity_entry;
 				// CBA ACCUMULATES
-				_known_destinations.insert({destination_hash, identity_entry});
+				node._known_destinations.insert({destination_hash, identity_entry});
 			}
 		}
 
@@ -323,7 +346,7 @@ Recall last heard app_data for a destination hash.
 		ERRORF("Error while saving known destinations to disk, the contained exception was: %s", e.what());
 	}
 
-	_saving_known_destinations = false;
+	node._saving_known_destinations = false;
 
 	return success;
 }
@@ -353,12 +376,14 @@ Recall last heard app_data for a destination hash.
 
 /*static*/ void Identity::cull_known_destinations() {
 	TRACE("Transport::cull_path_table()");
-	if (_known_destinations.size() > _known_destinations_maxsize) {
+	TransportInstance& node = Transport::instance();
+	if (node._known_destinations.size() > node._known_destinations_maxsize) {
 		// prune by age
-		uint16_t count = 0;
+		uint32_t count = 0;
 		std::vector<std::pair<Bytes, IdentityEntry>> sorted_pairs;
+		sorted_pairs.reserve(node._known_destinations.size());
 		// Copy key/value pairs from map into vector
-		std::for_each(_known_destinations.begin(), _known_destinations.end(), [&](const std::pair<const Bytes, IdentityEntry>& ref) {
+		std::for_each(node._known_destinations.begin(), node._known_destinations.end(), [&](const std::pair<const Bytes, IdentityEntry>& ref) {
 			sorted_pairs.push_back(ref);
 		});
 		// Sort vector using specified comparator
@@ -369,11 +394,11 @@ Recall last heard app_data for a destination hash.
 		for (auto& [destination_hash, identity_entry] : sorted_pairs) {
 			TRACE("Transport::cull_path_table: Removing destination " + destination_hash.toHex() + " from known destinations");
 			// Remove destination from known destinations
-			if (_known_destinations.erase(destination_hash) < 1) {
+			if (node._known_destinations.erase(destination_hash) < 1) {
 				WARNING("Failed to remove destination " + destination_hash.toHex() + " from known destinations");
 			}
 			++count;
-			if (_known_destinations.size() <= _known_destinations_maxsize) {
+			if (node._known_destinations.size() <= node._known_destinations_maxsize) {
 				break;
 			}
 		}
@@ -409,8 +434,16 @@ Recall last heard app_data for a destination hash.
 				app_data.clear();
 			}
 
+			// Reuse the decoded keys of a known destination announcing the same key
+			TransportInstance& node = Transport::instance();
+			auto iter = node._known_destinations.find(destination_hash);
 			Identity announced_identity(false);
-			announced_identity.load_public_key(public_key);
+			if (iter != node._known_destinations.end() && (*iter).second._public_key == public_key) {
+				announced_identity.load_public_key((*iter).second);
+			}
+			else {
+				announced_identity.load_public_key(public_key);
+			}
 
 			if (announced_identity.pub() && announced_identity.validate(signature, signed_data)) {
 				Bytes hash_material = name_hash << announced_identity.hash();
@@ -421,8 +454,7 @@ Recall last heard app_data for a destination hash.
 				if (packet.destination_hash() == expected_hash) {
 					// Check if we already have a public key for this destination
 					// and make sure the public key is not different.
-					auto iter = _known_destinations.find(packet.destination_hash());
-					if (iter != _known_destinations.end()) {
+					if (iter != node._known_destinations.end()) {
 						IdentityEntry& identity_entry = (*iter).second;
 						if (public_key != identity_entry._public_key) {
 							// In reality, this should never occur, but in the odd case
@@ -434,6 +466,10 @@ Recall last heard app_data for a destination hash.
 					}
 
 					remember(packet.get_hash(), packet.destination_hash(), public_key, app_data);
+					iter = node._known_destinations.find(destination_hash);
+					if (iter != node._known_destinations.end() && !(*iter).second._sig_pub) {
+						announced_identity.cache_public_key((*iter).second);
+					}
 					//p del announced_identity
 
 					std::string signal_str;
@@ -523,10 +559,14 @@ const Bytes Identity::encrypt(const Bytes& plaintext) const {
 	Cryptography::Token token(derived_key);
 	TRACE("Identity::encrypt: Token encrypting data of length " + std::to_string(plaintext.size()));
 	TRACE("Identity::encrypt: plaintext:  " + plaintext.toHex());
-	Bytes ciphertext = token.encrypt(plaintext);
+	// ephemeral public key followed by the token, written in place
+	Bytes ciphertext;
+	uint8_t* buffer = ciphertext.writable(ephemeral_pub_bytes.size() + Cryptography::Token::token_size(plaintext.size()));
+	memcpy(buffer, ephemeral_pub_bytes.data(), ephemeral_pub_bytes.size());
+	token.encrypt(buffer + ephemeral_pub_bytes.size(), plaintext.data(), plaintext.size());
 	TRACE("Identity::encrypt: ciphertext: " + ciphertext.toHex());
 
-	return ephemeral_pub_bytes + ciphertext;
+	return ciphertext;
 }
 
 
@@ -570,15 +610,20 @@ const Bytes Identity::decrypt(const Bytes& ciphertext_token) const {
 
 		Cryptography::Token token(derived_key);
 		//ciphertext = ciphertext_token[Identity.KEYSIZE//8//2:]
-		Bytes ciphertext(ciphertext_token.mid(Type::Identity::KEYSIZE/8/2));
-		TRACE("Identity::decrypt: Token decrypting data of length " + std::to_string(ciphertext.size()));
-		TRACE("Identity::decrypt: ciphertext: " + ciphertext.toHex());
-		plaintext = token.decrypt(ciphertext);
+		const uint8_t* ciphertext = ciphertext_token.data() + Type::Identity::KEYSIZE/8/2;
+		size_t ciphertext_size = ciphertext_token.size() - Type::Identity::KEYSIZE/8/2;
+		TRACE("Identity::decrypt: Token decrypting data of length " + std::to_string(ciphertext_size));
+		if (ciphertext_size < Type::Cryptography::Token::TOKEN_OVERHEAD) {
+			throw std::invalid_argument("Cannot decrypt token of only " + std::to_string(ciphertext_size) + " bytes");
+		}
+		size_t plaintext_size = token.decrypt(plaintext.writable(ciphertext_size - Type::Cryptography::Token::TOKEN_OVERHEAD), ciphertext, ciphertext_size);
+		plaintext.resize(plaintext_size);
 		TRACE("Identity::decrypt: plaintext:  " + plaintext.toHex());
 		//TRACE("Identity::decrypt: Token decrypted data of length " + std::to_string(plaintext.size()));
 	}
 	catch (std::exception& e) {
 		DEBUG("Decryption by " + toString() + " failed: " + e.what());
+		plaintext = {Bytes::NONE};
 	}
 		
 	return plaintext;
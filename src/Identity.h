@@ -20,7 +20,8 @@ namespace RNS {
 
 	class Identity {
 
-	private:
+	public:
+		// A known destination, held per node by TransportInstance
 		class IdentityEntry {
 		public:
 			IdentityEntry(double timestamp, const Bytes& packet_hash, const Bytes& public_key, const Bytes& app_data) :
@@ -35,14 +36,12 @@ namespace RNS {
 			Bytes _packet_hash;
 			Bytes _public_key;
 			Bytes _app_data;
+			// Decoded keys and hash of _public_key, filled on first recall
+			Cryptography::X25519PublicKey::Ptr _pub;
+			Cryptography::Ed25519PublicKey::Ptr _sig_pub;
+			Bytes _hash;
 		};
 
-	public:
-		static std::map<Bytes, IdentityEntry> _known_destinations;
-		static bool _saving_known_destinations;
-		// CBA
-		static uint16_t _known_destinations_maxsize;
-
 	public:
 		Identity(bool create_keys = true);
 		Identity(Type::NoneConstructor none) {
@@ -167,6 +166,10 @@ namespace RNS {
 
 		inline std::string toString() const { if (!_object) return ""; return "{Identity:" + _object->_hash.toHex() + "}"; }
 
+	private:
+		void load_public_key(IdentityEntry& entry);
+		void cache_public_key(IdentityEntry& entry) const;
+
 	private:
 		class Object {
 		public:
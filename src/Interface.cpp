@@ -2,9 +2,13 @@
 
 #include "Identity.h"
 #include "Transport.h"
+#include "Utilities/OS.h"
+
+#include <algorithm>
 
 using namespace RNS;
 using namespace RNS::Type::Interface;
+using namespace RNS::Utilities;
 
 /*static*/ uint8_t Interface::DISCOVER_PATHS_FOR = MODE_ACCESS_POINT | MODE_GATEWAY;
 
@@ -37,51 +41,82 @@ void Interface::handle_incoming(const Bytes& data) {
 	_impl->handle_incoming(data);
 }
 
-void Interface::process_announce_queue() {
-/*
-	if not hasattr(self, "announce_cap"):
-		self.announce_cap = RNS.Reticulum.ANNOUNCE_CAP
-
-	if hasattr(self, "announce_queue"):
-		try:
-			now = time.time()
-			stale = []
-			for a in self.announce_queue:
-				if now > a["time"]+RNS.Reticulum.QUEUED_ANNOUNCE_LIFE:
-					stale.append(a)
-
-			for s in stale:
-				if s in self.announce_queue:
-					self.announce_queue.remove(s)
-
-			if len(self.announce_queue) > 0:
-				min_hops = min(entry["hops"] for entry in self.announce_queue)
-				entries = list(filter(lambda e: e["hops"] == min_hops, self.announce_queue))
-				entries.sort(key=lambda e: e["time"])
-				selected = entries[0]
-
-				double now = OS::time();
-				uint32_t wait_time = 0;
-				if (_impl->_bitrate > 0 && _impl->_announce_cap > 0) {
-					uint32_t tx_time = (len(selected["raw"])*8) / _impl->_bitrate;
-					wait_time = (tx_time / _impl->_announce_cap);
-				}
-				_impl->_announce_allowed_at = now + wait_time;
-
-				self.on_outgoing(selected["raw"])
+void Interface::add_announce(const AnnounceEntry& entry) {
+	assert(_impl);
+	std::vector<AnnounceEntry>& queue = _impl->_announce_queue;
+	// Only keep the most recent emission of each destination in the queue
+	for (auto& queued : queue) {
+		if (queued._destination == entry._destination) {
+			if (entry._emitted > queued._emitted) {
+				queued = entry;
+				// Key of an interior entry changed so restore heap order
+				std::make_heap(queue.begin(), queue.end(), AnnounceEntry::Later());
+			}
+			return;
+		}
+	}
+	if (queue.size() >= Type::Reticulum::MAX_QUEUED_ANNOUNCES) {
+		// Reclaim any stale entries buried in the heap before giving up
+		double now = OS::time();
+		queue.erase(std::remove_if(queue.begin(), queue.end(), [now](const AnnounceEntry& queued) {
+			return now > queued._time + Type::Reticulum::QUEUED_ANNOUNCE_LIFE;
+		}), queue.end());
+		std::make_heap(queue.begin(), queue.end(), AnnounceEntry::Later());
+		if (queue.size() >= Type::Reticulum::MAX_QUEUED_ANNOUNCES) {
+			return;
+		}
+	}
+	queue.push_back(entry);
+	std::push_heap(queue.begin(), queue.end(), AnnounceEntry::Later());
+}
 
-				if selected in self.announce_queue:
-					self.announce_queue.remove(selected)
+size_t Interface::drop_announce_queue() {
+	assert(_impl);
+	size_t dropped = _impl->_announce_queue.size();
+	_impl->_announce_queue.clear();
+	return dropped;
+}
 
-				if len(self.announce_queue) > 0:
-					timer = threading.Timer(wait_time, self.process_announce_queue)
-					timer.start()
+double Interface::announce_wait_time(size_t length) const {
+	assert(_impl);
+	if (_impl->_bitrate > 0 && _impl->_announce_cap > 0) {
+		double tx_time = (double)(length * 8) / (double)_impl->_bitrate;
+		return tx_time / _impl->_announce_cap;
+	}
+	return 0.0;
+}
 
-		except Exception as e:
-			self.announce_queue = []
-			RNS.log("Error while processing announce queue on "+str(self)+". The contained exception was: "+str(e), RNS.LOG_ERROR)
-			RNS.log("The announce queue for this interface has been cleared.", RNS.LOG_ERROR)
-*/
+// CBA No timers here, so Transport::jobs calls this once announce_allowed_at
+// has passed and each call transmits at most one queued announce.
+void Interface::process_announce_queue() {
+	assert(_impl);
+	std::vector<AnnounceEntry>& queue = _impl->_announce_queue;
+	try {
+		double now = OS::time();
+		while (queue.size() > 0) {
+			std::pop_heap(queue.begin(), queue.end(), AnnounceEntry::Later());
+			AnnounceEntry selected(std::move(queue.back()));
+			queue.pop_back();
+
+			// Stale entries are expired as they reach the front of the heap
+			if (now > selected._time + Type::Reticulum::QUEUED_ANNOUNCE_LIFE) {
+				continue;
+			}
+
+			_impl->_announce_allowed_at = now + announce_wait_time(selected._raw.size());
+			Transport::transmit(*this, selected._raw);
+
+			if (queue.size() > 0) {
+				TRACE("Announce queue on " + toString() + " has " + std::to_string(queue.size()) + " entries, next in " + std::to_string(_impl->_announce_allowed_at - now) + " s");
+			}
+			break;
+		}
+	}
+	catch (std::exception& e) {
+		queue.clear();
+		ERROR("Error while processing announce queue on " + toString() + ". The contained exception was: " + e.what());
+		ERROR("The announce queue for this interface has been cleared.");
+	}
 }
 
 /*
@@ -7,7 +7,7 @@
 
 #include <ArduinoJson.h>
 
-#include <list>
+#include <vector>
 #include <memory>
 #include <cassert>
 #include <stdint.h>
@@ -26,6 +26,17 @@ namespace RNS {
 			_hops(hops),
 			_emitted(emitted),
 			_raw(raw) {}
+	public:
+		// Heap ordering for the interface announce queue, placing the
+		// entry with the fewest hops (oldest first on ties) at the front
+		struct Later {
+			inline bool operator () (const AnnounceEntry& lhs, const AnnounceEntry& rhs) const {
+				if (lhs._hops != rhs._hops) {
+					return lhs._hops > rhs._hops;
+				}
+				return lhs._time > rhs._time;
+			}
+		};
 	public:
 		Bytes _destination;
 		double _time = 0;
@@ -78,8 +89,9 @@ namespace RNS {
 		bool _AUTOCONFIGURE_MTU = false;
 		bool _FIXED_MTU = false;
 		double _announce_allowed_at = 0;
-		float _announce_cap = 0.0;
-		std::list<AnnounceEntry> _announce_queue;
+		float _announce_cap = Type::Reticulum::ANNOUNCE_CAP/100.0;
+		// CBA Binary heap ordered by AnnounceEntry::Later
+		std::vector<AnnounceEntry> _announce_queue;
 		bool _is_connected_to_shared_instance = false;
 		bool _is_local_shared_instance = false;
 		//Bytes _hash;
@@ -158,7 +170,10 @@ namespace RNS {
 		void process_announce_queue();
 
 		// CBA ACCUMULATES
-		inline void add_announce(AnnounceEntry& entry) { assert(_impl); _impl->_announce_queue.push_back(entry); }
+		void add_announce(const AnnounceEntry& entry);
+		size_t drop_announce_queue();
+		// Seconds of airtime budget consumed by sending length bytes under the announce cap
+		double announce_wait_time(size_t length) const;
 
 	protected:
 		inline void send_outgoing(const Bytes& data) { assert(_impl); _impl->send_outgoing(data); }
@@ -177,6 +192,7 @@ namespace RNS {
 		inline void bitrate(uint32_t bitrate) { assert(_impl); _impl->_bitrate = bitrate; }
 		inline void online(bool online) { assert(_impl); _impl->_online = online; }
 		inline void announce_allowed_at(double announce_allowed_at) { assert(_impl); _impl->_announce_allowed_at = announce_allowed_at; }
+		inline void announce_cap(float announce_cap) { assert(_impl); _impl->_announce_cap = announce_cap; }
 	public:
 		// getters
 		inline bool IN() const { assert(_impl); return _impl->_IN; }
@@ -194,7 +210,7 @@ namespace RNS {
 		inline bool FIXED_MTU() const { assert(_impl); return _impl->_FIXED_MTU; }
 		inline double announce_allowed_at() const { assert(_impl); return _impl->_announce_allowed_at; }
 		inline float announce_cap() const { assert(_impl); return _impl->_announce_cap; }
-		inline std::list<AnnounceEntry>& announce_queue() const { assert(_impl); return _impl->_announce_queue; }
+		inline const std::vector<AnnounceEntry>& announce_queue() const { assert(_impl); return _impl->_announce_queue; }
 		inline bool is_connected_to_shared_instance() const { assert(_impl); return _impl->_is_connected_to_shared_instance; }
 		inline bool is_local_shared_instance() const { assert(_impl); return _impl->_is_local_shared_instance; }
 		inline HInterface parent_interface() const { assert(_impl); return _impl->_parent_interface; }
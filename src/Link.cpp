@@ -12,13 +12,16 @@
 #include "Cryptography/Token.h"
 #include "Cryptography/Random.h"
 #include "Utilities/OS.h"
+#include "Utilities/Packed.h"
 
 #define MSGPACK_DEBUGLOG_ENABLE 0
 #include <MsgPack.h>
 
 #include <math.h>
+#include <string.h>
 
 #include <algorithm>
+#include <stdexcept>
 
 using namespace RNS;
 using namespace RNS::Type::Link;
@@ -37,6 +40,7 @@ Link::Link(const Destination& destination /*= {Type::NONE}*/, Callbacks::establi
 
 	_object->_owner = owner;
 	_object->_mode = mode;
+	update_mdu();
 
 	if (destination && destination.type() != Type::Destination::SINGLE) {
 		throw std::logic_error("Links can only be established to the \"single\" destination type");
@@ -176,10 +180,26 @@ Link::Link(const Destination& destination /*= {Type::NONE}*/, Callbacks::establi
 }
 
 /*static*/ Link Link::validate_request( const Destination& owner, const Bytes& data, const Packet& packet) {
-	if (data.size() == ECPUBSIZE) {
+	if (data.size() == ECPUBSIZE || data.size() == ECPUBSIZE+LINK_MTU_SIZE) {
 		try {
-			Link link({Type::NONE}, nullptr, nullptr, owner, data.left(ECPUBSIZE/2), data.mid(ECPUBSIZE/2, ECPUBSIZE/2));
+			Link link({Type::NONE}, nullptr, nullptr, owner, data.left(ECPUBSIZE/2), data.mid(ECPUBSIZE/2, ECPUBSIZE/2), mode_from_lr_packet(packet));
 			link.set_link_id(packet);
+			if (data.size() == ECPUBSIZE+LINK_MTU_SIZE) {
+				// Path minimum signalled by the initiator and transport nodes
+				// on the way, clamped to what the receiving interface carries
+				uint16_t path_mtu = mtu_from_lr_packet(packet);
+				uint16_t nh_mtu = RNS::Type::Reticulum::MTU;
+				const Interface& interface = packet.receiving_interface();
+				if (interface && (interface.AUTOCONFIGURE_MTU() || interface.FIXED_MTU()) && interface.HW_MTU() > 0) {
+					nh_mtu = interface.HW_MTU();
+				}
+				if (path_mtu == 0 || path_mtu > nh_mtu) {
+					path_mtu = nh_mtu;
+				}
+				DEBUGF("Link request includes MTU signalling, link MTU is %d", path_mtu);
+				link.mtu(path_mtu);
+			}
+			link.update_mdu();
 			link.destination(packet.destination());
 			link.establishment_timeout(ESTABLISHMENT_TIMEOUT_PER_HOP * std::max((uint8_t)1, packet.hops()) + KEEPALIVE);
 			link.establishment_cost(link.establishment_cost() + packet.raw().size());
@@ -207,6 +227,89 @@ Link::Link(const Destination& destination /*= {Type::NONE}*/, Callbacks::establi
 	}
 }
 
+// Requests and responses are the msgpack arrays [requested_at, path_hash,
+// data] and [request_id, response] as packed by umsgpack in the reference
+// implementation, empty values being sent as None. They are appended to the
+// buffer that becomes the plaintext of the packet or resource, which is
+// reserved up front so that packing does not reallocate.
+
+/*static*/ void Link::pack_request(Bytes& plaintext, double requested_at, const Bytes& path_hash, const Bytes& data) {
+	plaintext.reserve(plaintext.size() + 1 + 9 + Packed::bin_size(path_hash.size()) + Packed::bin_size(data.size()));
+	plaintext.append((uint8_t)0x93);
+	Packed::pack_double(plaintext, requested_at);
+	Packed::pack_optional_bin(plaintext, path_hash);
+	Packed::pack_optional_bin(plaintext, data);
+}
+
+/*static*/ void Link::unpack_request(const Bytes& packed, ResourceRequest& request) {
+	PackedReader reader(packed);
+	if (reader.read_array_size() != 3) {
+		throw std::invalid_argument("Invalid request");
+	}
+	request._requested_at = reader.read_number();
+	request._path_hash = reader.read_bin(true);
+	request._request_data = reader.read_bin(true);
+	if (!reader.at_end()) {
+		throw std::invalid_argument("Invalid request");
+	}
+}
+
+/*static*/ void Link::pack_response(Bytes& plaintext, const Bytes& request_id, const Bytes& response) {
+	plaintext.reserve(plaintext.size() + 1 + Packed::bin_size(request_id.size()) + Packed::bin_size(response.size()));
+	plaintext.append((uint8_t)0x92);
+	Packed::pack_optional_bin(plaintext, request_id);
+	Packed::pack_optional_bin(plaintext, response);
+}
+
+// Returns the packed size of the response data
+/*static*/ size_t Link::unpack_response(const Bytes& packed, Bytes& request_id, Bytes& response_data) {
+	PackedReader reader(packed);
+	if (reader.read_array_size() != 2) {
+		throw std::invalid_argument("Invalid response");
+	}
+	request_id = reader.read_bin(true);
+	size_t response_at = reader.position();
+	response_data = reader.read_bin(true);
+	if (!reader.at_end()) {
+		throw std::invalid_argument("Invalid response");
+	}
+	return packed.size() - response_at;
+}
+
+/*static*/ void Link::append_coalesced(Bytes& payload, const Bytes& message) {
+	if (message.size() > 0x7fff) {
+		throw std::invalid_argument("Message is too large to coalesce");
+	}
+	if (message.size() < 0x80) {
+		payload << (uint8_t)message.size();
+	}
+	else {
+		payload << (uint8_t)(0x80 | (message.size() >> 8)) << (uint8_t)message.size();
+	}
+	payload << message;
+}
+
+// Returns false if the payload does not split into whole messages
+/*static*/ bool Link::split_coalesced(const Bytes& payload, std::vector<Bytes>& messages) {
+	messages.clear();
+	size_t offset = 0;
+	while (offset < payload.size()) {
+		size_t length = payload.data()[offset++];
+		if (length & 0x80) {
+			if (offset == payload.size()) {
+				return false;
+			}
+			length = ((length & 0x7f) << 8) | payload.data()[offset++];
+		}
+		if (length > payload.size() - offset) {
+			return false;
+		}
+		messages.push_back(payload.mid(offset, length));
+		offset += length;
+	}
+	return true;
+}
+
 void Link::load_peer(const Bytes& peer_pub_bytes, const Bytes& peer_sig_pub_bytes) {
 	assert(_object);
 	_object->_peer_pub_bytes = peer_pub_bytes;
@@ -256,10 +359,12 @@ void Link::handshake() {
 void Link::prove() {
 	assert(_object);
 	DEBUGF("Link %s requesting proof", link_id().toHex().c_str());
-	Bytes signed_data =_object->_link_id + _object->_pub_bytes + _object->_sig_pub_bytes;
+	// Confirms the link MTU to the initiator
+	Bytes signalling_bytes = Link::signalling_bytes(_object->_mtu, _object->_mode);
+	Bytes signed_data =_object->_link_id + _object->_pub_bytes + _object->_sig_pub_bytes + signalling_bytes;
 	const Bytes signature(_object->_owner.identity().sign(signed_data));
 
-	Bytes proof_data = signature + _object->_pub_bytes;
+	Bytes proof_data = signature + _object->_pub_bytes + signalling_bytes;
 	// CBA LINK
 	// CBA TODO: Determine which approach is better, passing liunk to packet or passing _link_destination
 	Packet proof(*this, proof_data, Type::Packet::PROOF, Type::Packet::LRPROOF);
@@ -317,7 +422,7 @@ void Link::validate_proof(const Packet& packet) {
 				handshake();
 
 				_object->_establishment_cost += packet.raw().size();
-				Bytes signed_data = _object->_link_id + _object->_peer_pub_bytes + _object->_peer_sig_pub_bytes;
+				Bytes signed_data = _object->_link_id + _object->_peer_pub_bytes + _object->_peer_sig_pub_bytes + signalling_bytes;
 				const Bytes signature(packet_data.left(Type::Identity::SIGLENGTH/8));
 				
 				TRACEF("Link %s validating identity", link_id().toHex().c_str());
@@ -361,6 +466,10 @@ TRACEF("***** RTT test packet plaintext: %s", plaintext.toHex().c_str());
 					rtt_packet.send();
 					had_outbound();
 
+					if (_object->_coalesce_latency > 0.0) {
+						signal_coalescing();
+					}
+
 					if (_object->_callbacks._established != nullptr) {
 						VERBOSEF("Link %s is established", link_id().toHex().c_str());
 						//p thread = threading.Thread(target=_object->_callbacks.link_established, args=(self,))
@@ -425,9 +534,8 @@ const RNS::RequestReceipt Link::request(const Bytes& path, const Bytes& data /*=
 
 	//p unpacked_request = [OS::time(), request_path_hash, data]
 	//p packed_request = umsgpack.packb(unpacked_request)
-    MsgPack::Packer packer;
-	packer.to_array(OS::time(), request_path_hash, data);
-	Bytes packed_request(packer.data(), packer.size());
+	Bytes packed_request(MDU);
+	pack_request(packed_request, OS::time(), request_path_hash, data);
 
 	if (timeout == 0.0) {
 		timeout = _object->_rtt * _object->_traffic_timeout_factor + Type::Resource::RESPONSE_MAX_GRACE_TIME * 1.125;
@@ -500,6 +608,10 @@ void Link::rtt_packet(const Packet& packet) {
 				_object->_establishment_rate = _object->_establishment_cost / _object->_rtt;
 			}
 
+			if (_object->_coalesce_latency > 0.0) {
+				signal_coalescing();
+			}
+
 			try {
 				if (_object->_owner.callbacks()._link_established != nullptr) {
 					_object->_owner.callbacks()._link_established(*this);
@@ -561,6 +673,18 @@ float Link::get_expected_rate() {
 	return 0.0;
 }
 
+// :returns: The window the last incoming resource on this link concluded with, or 0.
+uint8_t Link::get_last_resource_window() const {
+	assert(_object);
+	return _object->_last_resource_window;
+}
+
+// :returns: The expected in-flight rate the last incoming resource on this link concluded with, or 0.
+double Link::get_last_resource_eifr() const {
+	assert(_object);
+	return _object->_last_resource_eifr;
+}
+
 /*
 :returns: The mode of an established link.
 */
@@ -647,6 +771,7 @@ be used if a new link to the same destination is established.
 void Link::teardown() {
 	assert(_object);
 	if (_object->_status != Type::Link::PENDING && _object->_status != Type::Link::CLOSED) {
+		flush_coalesced();
 		Packet teardown_packet(*this, _object->_link_id, Type::Packet::DATA, Type::Packet::LINKCLOSE);
 		teardown_packet.send();
 		had_outbound();
@@ -682,14 +807,26 @@ void Link::teardown_packet(const Packet& packet) {
 
 void Link::link_closed() {
 	assert(_object);
-	for (auto& resource : _object->_incoming_resources) {
+	schedule_watchdog(0.0);
+	// Messages still queued can no longer be sent
+	schedule_flush(0.0);
+	_object->_coalesce_queue.clear();
+	_object->_coalesce_count = 0;
+	// cancel() unregisters the resource, so iterate copies
+	std::set<Resource> incoming_resources(_object->_incoming_resources);
+	for (auto& resource : incoming_resources) {
 		const_cast<Resource&>(resource).cancel();
 	}
-	for (auto& resource : _object->_outgoing_resources) {
+	std::set<Resource> outgoing_resources(_object->_outgoing_resources);
+	for (auto& resource : outgoing_resources) {
 		const_cast<Resource&>(resource).cancel();
 	}
+	// Split resources can no longer be completed
+	_object->_incoming_segments.clear();
 	if (_object->_channel) {
 		_object->_channel._shutdown();
+		// The channel refers back to the link
+		_object->_channel = {Type::NONE};
 	}
 
 	_object->_prv.reset();
@@ -716,86 +853,111 @@ void Link::link_closed() {
 	}
 }
 
-// CBA TODO Implement watchdog
+/*
+Supervises the link from request until close. Rather than a thread per link
+as in the Python implementation, each link keeps one deadline on the
+Transport instance's deadline schedule, and __watchdog_job() runs when it
+is due to act on the link state and set the next deadline.
+*/
 void Link::start_watchdog() {
+	assert(_object);
 	//z thread = threading.Thread(target=_object->___watchdog_job)
 	//z thread.daemon = True
 	//z thread.start()
+	schedule_watchdog(OS::time());
 }
 
-/*p TODO
+// Moves the watchdog to a new deadline, a deadline of 0 stops it
+void Link::schedule_watchdog(double deadline) {
+	assert(_object);
+	if (_object->_watchdog_deadline > 0.0) {
+		Transport::cancel_deadline(_object->_watchdog_deadline, _object->_watchdog_id);
+	}
+	_object->_watchdog_deadline = deadline;
+	if (deadline > 0.0) {
+		Link link(*this);
+		_object->_watchdog_id = Transport::schedule_deadline(deadline, [link]() mutable { link.__watchdog_job(); });
+	}
+}
 
 void Link::__watchdog_job() {
 	assert(_object);
-	while not _object->_status == Type::Link::CLOSED:
-		while (_object->_watchdog_lock):
-			rtt_wait = 0.025
-			if hasattr(self, "rtt") and _object->_rtt:
-				rtt_wait = _object->_rtt
-
-			sleep(max(rtt_wait, 0.025))
-
-		if not _object->_status == Type::Link::CLOSED:
-			# Link was initiated, but no response
-			# from destination yet
-			if _object->_status == PENDING:
-				next_check = _object->_request_time + _object->_establishment_timeout
-				sleep_time = next_check - OS::time()
-				if OS::time() >= _object->_request_time + _object->_establishment_timeout:
-					RNS.log("Link establishment timed out", RNS.LOG_VERBOSE)
-					_object->_status = Type::Link::CLOSED
-					_object->_teardown_reason = TIMEOUT
-					link_closed()
-					sleep_time = 0.001
-
-			elif _object->_status == Type::Link::HANDSHAKE:
-				next_check = _object->_request_time + _object->_establishment_timeout
-				sleep_time = next_check - OS::time()
-				if OS::time() >= _object->_request_time + _object->_establishment_timeout:
-					_object->_status = Type::Link::CLOSED
-					_object->_teardown_reason = TIMEOUT
-					link_closed()
-					sleep_time = 0.001
-
-					if _object->_initiator:
-						RNS.log("Timeout waiting for link request proof", RNS.LOG_DEBUG)
-					else:
-						RNS.log("Timeout waiting for RTT packet from link initiator", RNS.LOG_DEBUG)
-
-			elif _object->_status == Type::Link::ACTIVE:
-				activated_at = _object->_activated_at if _object->_activated_at != None else 0
-				last_inbound = max(max(_object->_last_inbound, _object->_last_proof), activated_at)
-
-				if OS::time() >= last_inbound + _object->_keepalive:
-					if _object->_initiator:
-						send_keepalive()
-
-					if OS::time() >= last_inbound + _object->_stale_time:
-						sleep_time = _object->_rtt * _object->_keepalive_timeout_factor + STALE_GRACE
-						_object->_status = STALE
-					else:
-						sleep_time = _object->_keepalive
-				
-				else:
-					sleep_time = (last_inbound + _object->_keepalive) - OS::time()
-
-			elif _object->_status == STALE:
-				sleep_time = 0.001
-				_object->_status = Type::Link::CLOSED
-				_object->_teardown_reason = TIMEOUT
-				link_closed()
+	// The deadline that ran this job has already been taken off the schedule
+	_object->_watchdog_deadline = 0.0;
+	if (_object->_status == Type::Link::CLOSED) {
+		return;
+	}
+
+	double now = OS::time();
+	double sleep_time = 0.0;
+	// Link was initiated, but no response
+	// from destination yet
+	if (_object->_status == Type::Link::PENDING) {
+		double next_check = _object->_request_time + _object->_establishment_timeout;
+		sleep_time = next_check - now;
+		if (now >= next_check) {
+			VERBOSE("Link establishment timed out");
+			_object->_status = Type::Link::CLOSED;
+			_object->_teardown_reason = Type::Link::TIMEOUT;
+			link_closed();
+			return;
+		}
+	}
+	else if (_object->_status == Type::Link::HANDSHAKE) {
+		double next_check = _object->_request_time + _object->_establishment_timeout;
+		sleep_time = next_check - now;
+		if (now >= next_check) {
+			_object->_status = Type::Link::CLOSED;
+			_object->_teardown_reason = Type::Link::TIMEOUT;
+			link_closed();
+			if (_object->_initiator) {
+				DEBUG("Timeout waiting for link request proof");
+			}
+			else {
+				DEBUG("Timeout waiting for RTT packet from link initiator");
+			}
+			return;
+		}
+	}
+	else if (_object->_status == Type::Link::ACTIVE) {
+		//p activated_at = _object->_activated_at if _object->_activated_at != None else 0
+		double last_inbound = std::max(std::max(_object->_last_inbound, _object->_last_proof), _object->_activated_at);
 
+		if (now >= last_inbound + _object->_keepalive) {
+			if (_object->_initiator) {
+				send_keepalive();
+			}
 
-			if sleep_time == 0:
-				RNS.log("Warning! Link watchdog sleep time of 0!", RNS.LOG_ERROR)
-			if sleep_time == None or sleep_time < 0:
-				RNS.log("Timing error! Tearing down link "+str(self)+" now.", RNS.LOG_ERROR)
-				teardown()
-				sleep_time = 0.1
+			if (now >= last_inbound + _object->_stale_time) {
+				sleep_time = _object->_rtt * _object->_keepalive_timeout_factor + Type::Link::STALE_GRACE;
+				_object->_status = Type::Link::STALE;
+			}
+			else {
+				sleep_time = _object->_keepalive;
+			}
+		}
+		else {
+			sleep_time = (last_inbound + _object->_keepalive) - now;
+		}
+	}
+	else if (_object->_status == Type::Link::STALE) {
+		_object->_status = Type::Link::CLOSED;
+		_object->_teardown_reason = Type::Link::TIMEOUT;
+		link_closed();
+		return;
+	}
 
-			sleep(sleep_time)
+	if (sleep_time == 0) {
+		ERROR("Warning! Link watchdog sleep time of 0!");
+	}
+	if (sleep_time < 0) {
+		ERROR("Timing error! Tearing down link " + toString() + " now.");
+		teardown();
+		return;
+	}
 
-*/
+	schedule_watchdog(now + sleep_time);
+}
 
 void Link::send_keepalive() {
 	assert(_object);
@@ -842,9 +1004,8 @@ void Link::handle_request(const Bytes& request_id, const ResourceRequest& resour
 
 				if (response) {
 					//p packed_response = umsgpack.packb([request_id, response])
-					MsgPack::Packer packer;
-					packer.to_array(request_id, response);
-					Bytes packed_response(packer.data(), packer.size());
+					Bytes packed_response(MDU);
+					pack_response(packed_response, request_id, response);
 
 					if (packed_response.size() <= MDU) {
 						//p RNS.Packet(self, packed_response, Type::Packet::DATA, context = Type::Packet::RESPONSE).send()
@@ -852,7 +1013,7 @@ void Link::handle_request(const Bytes& request_id, const ResourceRequest& resour
 						response_packet.send();
 					}
 					else {
-						// CBA TODO Determine why unused Resource is created here
+						// The resource advertises itself and is held by the link until it concludes
 						Resource response_resource = RNS::Resource(packed_response, *this, request_id, true);
 					}
 				}
@@ -906,17 +1067,8 @@ void Link::request_resource_concluded(const Resource& resource) {
 		//p packed_request = resource.data().read()
 		Bytes packed_request = resource.data();
 		//p unpacked_request = umsgpack.unpackb(packed_request)
-		MsgPack::Unpacker unpacker;
-		unpacker.feed(packed_request.data(), packed_request.size());
-		// CBA TODO OPTIMIZE MSGPACK
-		double requested_at;
-		MsgPack::bin_t<uint8_t> path_hash;
-		MsgPack::bin_t<uint8_t> request_data;
-		unpacker.from_array(requested_at, path_hash, request_data);
 		ResourceRequest resource_request;
-		resource_request._requested_at = requested_at;
-		resource_request._path_hash = path_hash;
-		resource_request._request_data = request_data;
+		unpack_request(packed_request, resource_request);
         //p request_id        = RNS.Identity.truncated_hash(packed_request)
 		Bytes request_id(Identity::truncated_hash(resource.data()));
 		//p request_data = unpacked_request
@@ -937,11 +1089,9 @@ void Link::response_resource_concluded(const Resource& resource) {
 		//p unpacked_response = umsgpack.unpackb(packed_response)
 		//p request_id        = unpacked_response[0]
 		//p response_data     = unpacked_response[1]
-		MsgPack::Unpacker unpacker;
-		unpacker.feed(packed_response.data(), packed_response.size());
-		MsgPack::bin_t<uint8_t> request_id;
-		MsgPack::bin_t<uint8_t> response_data;
-		unpacker.from_array(request_id, response_data);
+		Bytes request_id;
+		Bytes response_data;
+		unpack_response(packed_response, request_id, response_data);
 
 		handle_response(request_id, response_data, resource.total_size(), resource.size());
 	}
@@ -956,18 +1106,125 @@ void Link::response_resource_concluded(const Resource& resource) {
 }
 
 
-/*z
-"""
+/*
 Get the ``Channel`` for this link.
 
 :return: ``Channel`` object
-"""
-void Link::get_channel() {
+*/
+Channel Link::get_channel() {
 	assert(_object);
-	if _object->_channel is None:
-		_object->_channel = Channel(LinkChannelOutlet(self))
-	return _object->_channel
+	if (!_object->_channel) {
+		_object->_channel = Channel(*this);
+	}
+	return _object->_channel;
+}
+
+/*
+Sets the link to coalesce the small messages sent with ``send_coalesced()``.
+Messages queued within the latency budget are sent together in one packet
+of up to the link MDU, and handed to the packet callback one by one on the
+other end. A budget of 0 turns coalescing off and sends what is queued.
+
+Coalesced packets use a packet context the reference implementation does
+not know. Turning coalescing on signals support to the other end, and
+messages are sent in a packet each until it signals back, which a
+reference peer never does.
+
+:param latency_budget: The time in seconds a message may wait for others.
 */
+void Link::set_coalescing(double latency_budget) {
+	assert(_object);
+	_object->_coalesce_latency = (latency_budget > 0.0) ? latency_budget : 0.0;
+	if (_object->_coalesce_latency == 0.0) {
+		flush_coalesced();
+	}
+	else {
+		signal_coalescing();
+	}
+}
+
+/*
+Sends data over the link, queued for up to the latency budget while
+coalescing is on and the other end takes coalesced packets. The queue is
+sent once the next message would not fit
+in it, when its deadline passes, or on ``flush_coalesced()``. No receipts
+are returned for queued messages.
+
+:param data: The data to send, up to the link MDU.
+*/
+void Link::send_coalesced(const Bytes& data) {
+	assert(_object);
+	size_t record_size = data.size() + ((data.size() < 0x80) ? 1 : 2);
+	size_t mdu = get_mdu();
+	if (_object->_coalesce_queue.size() + record_size > mdu) {
+		flush_coalesced();
+	}
+	if (_object->_coalesce_latency == 0.0 || !_object->_peer_coalesces || record_size > mdu) {
+		Packet packet(*this, data);
+		packet.send();
+		return;
+	}
+	append_coalesced(_object->_coalesce_queue, data);
+	_object->_coalesce_count += 1;
+	// Sent right away once there is no room left for even an empty message
+	if (_object->_coalesce_queue.size() + 1 >= mdu) {
+		flush_coalesced();
+	}
+	else if (_object->_coalesce_deadline == 0.0) {
+		schedule_flush(OS::time() + _object->_coalesce_latency);
+	}
+}
+
+// Sends the messages queued by send_coalesced() now
+void Link::flush_coalesced() {
+	assert(_object);
+	if (_object->_coalesce_count == 0) {
+		return;
+	}
+	schedule_flush(0.0);
+	Bytes payload(_object->_coalesce_queue);
+	uint16_t count = _object->_coalesce_count;
+	_object->_coalesce_queue.clear();
+	_object->_coalesce_count = 0;
+	if (count == 1) {
+		// A lone message goes out as an ordinary packet
+		Packet packet(*this, payload.mid((payload.data()[0] & 0x80) ? 2 : 1));
+		packet.send();
+	}
+	else {
+		TRACEF("Sending %u coalesced messages on %s", count, toString().c_str());
+		Packet packet(*this, payload, Type::Packet::DATA, Type::Packet::COALESCED);
+		packet.send();
+	}
+}
+
+// Moves the coalescing queue deadline, a deadline of 0 cancels it
+void Link::schedule_flush(double deadline) {
+	assert(_object);
+	if (_object->_coalesce_deadline > 0.0) {
+		Transport::cancel_deadline(_object->_coalesce_deadline, _object->_coalesce_id);
+	}
+	_object->_coalesce_deadline = deadline;
+	if (deadline > 0.0) {
+		Link link(*this);
+		_object->_coalesce_id = Transport::schedule_deadline(deadline, [link]() mutable { link.flush_coalesced(); });
+	}
+}
+
+// Tells the other end that this end takes coalesced packets, once the link
+// is active, with a coalesced packet holding a single empty message, which
+// is never sent otherwise as lone messages go out as ordinary packets
+void Link::signal_coalescing() {
+	assert(_object);
+	if (_object->_coalesce_signalled || _object->_status != Type::Link::ACTIVE) {
+		return;
+	}
+	_object->_coalesce_signalled = true;
+	Bytes signal;
+	append_coalesced(signal, Bytes());
+	Packet packet(*this, signal, Type::Packet::DATA, Type::Packet::COALESCED);
+	packet.send();
+}
 
 /*
 void Link::receive(const Packet& packet) {
@@ -995,18 +1252,46 @@ void Link::receive(const Packet& packet) {
 				bool should_query = false;
 				switch (packet.context()) {
 				case Type::Packet::CONTEXT_NONE:
+				case Type::Packet::COALESCED:
 				{
 					const Bytes plaintext = decrypt(packet.data());
+					// Coalesced packets are split into their messages, and proven once
+					std::vector<Bytes> messages;
+					if (plaintext && packet.context() == Type::Packet::COALESCED && !split_coalesced(plaintext, messages)) {
+						DEBUG("Dropping malformed coalesced packet on " + toString());
+						break;
+					}
+					if (plaintext && packet.context() == Type::Packet::COALESCED) {
+						// Only sent by peers that take coalesced packets as well
+						_object->_peer_coalesces = true;
+						if (messages.size() == 1 && messages[0].size() == 0) {
+							DEBUG("Link " + toString() + " peer takes coalesced packets");
+							signal_coalescing();
+							break;
+						}
+					}
 					if (plaintext) {
 						if (_object->_callbacks._packet) {
 							//z thread = threading.Thread(target=_object->_callbacks.packet, args=(plaintext, packet))
 							//z thread.daemon = True
 							//z thread.start()
-							try {
-								_object->_callbacks._packet(plaintext, packet);
+							if (packet.context() == Type::Packet::COALESCED) {
+								for (auto& message : messages) {
+									try {
+										_object->_callbacks._packet(message, packet);
+									}
+									catch (std::exception& e) {
+										ERRORF("Error while executing packet callback from %s. The contained exception was: %s", toString().c_str(), e.what());
+									}
+								}
 							}
-							catch (std::exception& e) {
-								ERRORF("Error while executing packet callback from %s. The contained exception was: %s", toString().c_str(), e.what());
+							else {
+								try {
+									_object->_callbacks._packet(plaintext, packet);
+								}
+								catch (std::exception& e) {
+									ERRORF("Error while executing packet callback from %s. The contained exception was: %s", toString().c_str(), e.what());
+								}
 							}
 						}
 						
@@ -1063,17 +1348,8 @@ void Link::receive(const Packet& packet) {
 						const Bytes packed_request = decrypt(packet.data());
 						if (packed_request) {
                             //p unpacked_request = umsgpack.unpackb(packed_request)
-							MsgPack::Unpacker unpacker;
-							unpacker.feed(packed_request.data(), packed_request.size());
-							// CBA TODO OPTIMIZE MSGPACK
-							double requested_at;
-							MsgPack::bin_t<uint8_t> path_hash;
-							MsgPack::bin_t<uint8_t> request_data;
-							unpacker.from_array(requested_at, path_hash, request_data);
 							ResourceRequest resource_request;
-							resource_request._requested_at = requested_at;
-							resource_request._path_hash = path_hash;
-							resource_request._request_data = request_data;
+							unpack_request(packed_request, resource_request);
 							handle_request(request_id, resource_request);
 						}
 					}
@@ -1091,15 +1367,11 @@ void Link::receive(const Packet& packet) {
 							//p request_id = unpacked_response[0]
 							//p response_data = unpacked_response[1]
                             //p transfer_size = len(umsgpack.packb(response_data))-2
-							MsgPack::Unpacker unpacker;
-							unpacker.feed(packed_response.data(), packed_response.size());
-							MsgPack::bin_t<uint8_t> request_id;
-							MsgPack::bin_t<uint8_t> response_data;
-							unpacker.from_array(request_id, response_data);
-							MsgPack::Packer packer;
-							packer.serialize(response_data);
-							size_t transfer_size = packer.size() - 2;
-							handle_response(Bytes(request_id.data(), request_id.size()), Bytes(response_data.data(), response_data.size()), transfer_size, transfer_size);
+							Bytes request_id;
+							Bytes response_data;
+							size_t packed_size = unpack_response(packed_response, request_id, response_data);
+							size_t transfer_size = (packed_size > 2) ? packed_size - 2 : 0;
+							handle_response(request_id, response_data, transfer_size, transfer_size);
 						}
 					}
 					catch (std::exception& e) {
@@ -1118,98 +1390,122 @@ void Link::receive(const Packet& packet) {
 					teardown_packet(packet);
 					break;
 				}
-/*z
 				case Type::Packet::RESOURCE_ADV:
 				{
 					//p packet.plaintext = decrypt(packet.data)
 					const Bytes plaintext = decrypt(packet.data());
 					if (plaintext) {
 						const_cast<Packet&>(packet).plaintext(plaintext);
-						if (ResourceAdvertisement::is_request(packet)) {
-							Resource::accept(packet, callback=_object->_request_resource_concluded);
-						}
-						else if (ResourceAdvertisement::is_response(packet)) {
-							Bytes request_id = ResourceAdvertisement::read_request_id(packet)
-							for (auto& pending_request : _object->_pending_requests) {
-								if (pending_request.request_id == request_id) {
-									const Bytes response_resource = Resource::accept(packet, callback=_object->_response_resource_concluded, progress_callback=pending_request.response_resource_progress, request_id = request_id);
-									if (response_resource) {
-										//p if pending_request.response_size == None:
-										if (pending_request.response_size == 0) {
-											pending_request.response_size = ResourceAdvertisement::read_size(packet);
-										}
-										//p if pending_request.response_transfer_size == None:
-										if (pending_request.response_transfer_size == 0) {
-											pending_request.response_transfer_size = 0;
+						try {
+							if (ResourceAdvertisement::is_request(packet)) {
+								Resource::accept(packet);
+							}
+							else if (ResourceAdvertisement::is_response(packet)) {
+								const Bytes request_id = ResourceAdvertisement::read_request_id(packet);
+								// Iterate a copy, a failed accept may conclude the request
+								std::set<RequestReceipt> pending_requests(_object->_pending_requests);
+								for (auto& pending_request : pending_requests) {
+									if (pending_request.request_id() == request_id) {
+										RequestReceipt request_receipt(pending_request);
+										const Resource response_resource = Resource::accept(packet, nullptr, nullptr, request_id);
+										if (response_resource) {
+											//p if pending_request.response_size == None:
+											if (request_receipt.response_size() == 0) {
+												request_receipt.response_size(ResourceAdvertisement::read_size(packet));
+											}
+											request_receipt.response_transfer_size(request_receipt.response_transfer_size() + ResourceAdvertisement::read_transfer_size(packet));
+											//p if pending_request.started_at == None:
+											if (request_receipt.started_at() == 0.0) {
+												request_receipt.started_at(OS::time());
+											}
+											request_receipt.response_resource_progress(response_resource);
 										}
-										pending_request.response_transfer_size += ResourceAdvertisement::read_transfer_size(packet);
-										//p if pending_request.started_at == None:
-										if (pending_request.started_at == 0.0) {
-											pending_request.started_at = OS::time();
+									}
+								}
+							}
+							else if (_object->_resource_strategy == ACCEPT_NONE) {
+								//p pass
+							}
+							else if (_object->_resource_strategy == ACCEPT_APP) {
+								if (_object->_callbacks._resource) {
+									try {
+										ResourceAdvertisement resource_advertisement = ResourceAdvertisement::unpack(packet.plaintext());
+										resource_advertisement.link(*this);
+										if (_object->_callbacks._resource(resource_advertisement)) {
+											Resource::accept(packet, _object->_callbacks._resource_concluded);
 										}
-										pending_request.response_resource_progress(response_resource);
+									}
+									catch (std::exception& e) {
+										ERRORF("Error while executing resource accept callback from %s. The contained exception was: %s", toString().c_str(), e.what());
 									}
 								}
 							}
+							else if (_object->_resource_strategy == ACCEPT_ALL) {
+								Resource::accept(packet, _object->_callbacks._resource_concluded);
+							}
 						}
-						else if (_object->_resource_strategy == ACCEPT_NONE) {
-							//p pass
+						catch (std::exception& e) {
+							DEBUGF("Dropping invalid resource advertisement on %s. The contained exception was: %s", toString().c_str(), e.what());
 						}
-						else if (_object->_resource_strategy == ACCEPT_APP) {
-							if (_object->_callbacks.resource) {
-								try {
-									resource_advertisement = RNS.ResourceAdvertisement.unpack(packet.plaintext());
-									resource_advertisement.link = *this;
-									if (_object->_callbacks.resource(resource_advertisement)) {
-										Resource::accept(packet, _object->_callbacks.resource_concluded);
-									}
-								}
-								catch (std::exception& e) {
-									ERRORF("Error while executing resource accept callback from %s. The contained exception was: %s", toString().c_str(), e.what());
-								}
-						elif _object->_resource_strategy == ACCEPT_ALL:
-							RNS.Resource.accept(packet, _object->_callbacks.resource_concluded)
+					}
 					break;
 				}
 				case Type::Packet::RESOURCE_REQ:
 				{
 					const Bytes plaintext = decrypt(packet.data());
 					if (plaintext) {
-						if ord(plaintext[:1]) == RNS.Resource.HASHMAP_IS_EXHAUSTED:
-							resource_hash = plaintext[1+RNS.Resource.MAPHASH_LEN:Type::Identity::HASHLENGTH//8+1+RNS.Resource.MAPHASH_LEN]
-						else:
-							resource_hash = plaintext[1:Type::Identity::HASHLENGTH//8+1]
+						Bytes resource_hash;
+						if (plaintext[0] == Type::Resource::HASHMAP_IS_EXHAUSTED) {
+							resource_hash = plaintext.mid(1+Type::Resource::MAPHASH_LEN, Type::Identity::HASHLENGTH/8);
+						}
+						else {
+							resource_hash = plaintext.mid(1, Type::Identity::HASHLENGTH/8);
+						}
 
-						for resource in _object->_outgoing_resources:
-							if resource.hash == resource_hash:
+						// Iterate a copy, a request may conclude or cancel the resource
+						std::set<Resource> outgoing_resources(_object->_outgoing_resources);
+						for (auto& resource : outgoing_resources) {
+							if (resource.hash() == resource_hash) {
 								// We need to check that this request has not been
 								// received before in order to avoid sequencing errors.
-								if not packet.packet_hash in resource.req_hashlist:
-									resource.req_hashlist.append(packet.packet_hash)
-									resource.request(plaintext)
+								const Bytes packet_hash = const_cast<Packet&>(packet).get_hash();
+								if (resource.req_hashlist().count(packet_hash) == 0) {
+									resource.req_hashlist().insert(packet_hash);
+									const_cast<Resource&>(resource).request(plaintext);
+								}
+							}
+						}
+					}
 					break;
 				}
 				case Type::Packet::RESOURCE_HMU:
 				{
 					const Bytes plaintext = decrypt(packet.data());
 					if (plaintext) {
-						resource_hash = plaintext[:Type::Identity::HASHLENGTH//8]
-						for resource in _object->_incoming_resources:
-							if resource_hash == resource.hash:
-								resource.hashmap_update_packet(plaintext)
+						const Bytes resource_hash = plaintext.left(Type::Identity::HASHLENGTH/8);
+						std::set<Resource> incoming_resources(_object->_incoming_resources);
+						for (auto& resource : incoming_resources) {
+							if (resource_hash == resource.hash()) {
+								const_cast<Resource&>(resource).hashmap_update_packet(plaintext);
+							}
+						}
+					}
 					break;
 				}
 				case Type::Packet::RESOURCE_ICL:
 				{
 					const Bytes plaintext = decrypt(packet.data());
 					if (plaintext) {
-						resource_hash = plaintext[:Type::Identity::HASHLENGTH//8]
-						for resource in _object->_incoming_resources:
-							if resource_hash == resource.hash:
-								resource.cancel()
+						const Bytes resource_hash = plaintext.left(Type::Identity::HASHLENGTH/8);
+						std::set<Resource> incoming_resources(_object->_incoming_resources);
+						for (auto& resource : incoming_resources) {
+							if (resource_hash == resource.hash()) {
+								const_cast<Resource&>(resource).cancel();
+							}
+						}
+					}
 					break;
 				}
-*/
 				case Type::Packet::KEEPALIVE:
 				{
 					if (!_object->_initiator && packet.data() == "\xFF") {
@@ -1226,36 +1522,37 @@ void Link::receive(const Packet& packet) {
 				// of hash -> sequence map
 				case Type::Packet::RESOURCE:
 				{
-					for (auto& resource : _object->_incoming_resources) {
-						//z resource.receive_part(packet);
+					std::set<Resource> incoming_resources(_object->_incoming_resources);
+					for (auto& resource : incoming_resources) {
+						const_cast<Resource&>(resource).receive_part(packet);
 					}
 					break;
 				}
-/*z
 				case Type::Packet::CHANNEL:
 				{
-					//z if (!_object->_channel) {
-					if (true) {
-						DEBUG(f"Channel data received without open channel")
+					if (!_object->_channel) {
+						DEBUGF("Channel data received without open channel on %s", toString().c_str());
 					}
 					else {
-						//z packet.prove();
-						//z plaintext = decrypt(packet.data());
-						//z if (plaintext) {
-						//z 	_object->_channel._receive(plaintext);
-						//z }
+						// Proven before the channel sees it, so that a retransmission
+						// of a message already delivered is proven again
+						const_cast<Packet&>(packet).prove();
+						const Bytes plaintext = decrypt(packet.data());
+						if (plaintext) {
+							_object->_channel._receive(plaintext);
+						}
 					}
 					break;
 				}
-*/
 				}
 			}
 			else if (packet.packet_type() == Type::Packet::PROOF) {
 				if (packet.context() == Type::Packet::RESOURCE_PRF) {
 					Bytes resource_hash = packet.data().left(Type::Identity::HASHLENGTH/8);
-					for (const auto& resource : _object->_outgoing_resources) {
+					std::set<Resource> outgoing_resources(_object->_outgoing_resources);
+					for (const auto& resource : outgoing_resources) {
 						if (resource_hash == resource.hash()) {
-							//z resource.validate_proof(packet.data());
+							const_cast<Resource&>(resource).validate_proof(packet.data());
 						}
 					}
 				}
@@ -1302,6 +1599,30 @@ const Bytes Link::decrypt(const Bytes& ciphertext) {
 	}
 }
 
+std::shared_ptr<Cryptography::TokenEncryptor> Link::encryptor() {
+	assert(_object);
+	if (!_object->_token) {
+		_object->_token.reset(new Token(_object->_derived_key));
+	}
+	return std::shared_ptr<Cryptography::TokenEncryptor>(new Cryptography::TokenEncryptor(_object->_token));
+}
+
+std::shared_ptr<Cryptography::TokenDecryptor> Link::decryptor() {
+	assert(_object);
+	if (!_object->_token) {
+		_object->_token.reset(new Token(_object->_derived_key));
+	}
+	return std::shared_ptr<Cryptography::TokenDecryptor>(new Cryptography::TokenDecryptor(_object->_token));
+}
+
+std::shared_ptr<Cryptography::TokenDecryptor> Link::decryptor(const Bytes& chain) {
+	assert(_object);
+	if (!_object->_token) {
+		_object->_token.reset(new Token(_object->_derived_key));
+	}
+	return std::shared_ptr<Cryptography::TokenDecryptor>(new Cryptography::TokenDecryptor(_object->_token, chain));
+}
+
 const Bytes Link::sign(const Bytes& message) {
 	assert(_object);
 	return _object->_sig_prv->sign(message);
@@ -1357,6 +1678,8 @@ void Link::set_resource_concluded_callback(Callbacks::resource_concluded callbac
 void Link::resource_concluded(const Resource& resource) {
 	assert(_object);
 	if (_object->_incoming_resources.count(resource) > 0) {
+		_object->_last_resource_window = resource.window();
+		_object->_last_resource_eifr = resource.eifr();
 		_object->_incoming_resources.erase(resource);
 	}
 	if (_object->_outgoing_resources.count(resource) > 0) {
@@ -1400,6 +1723,24 @@ bool Link::has_incoming_resource(const Resource& resource) {
 	return false;
 }
 
+void Link::hold_incoming_segment(const Resource& resource) {
+	assert(_object);
+	_object->_incoming_segments.erase(resource.original_hash());
+	_object->_incoming_segments.insert({resource.original_hash(), resource});
+}
+
+// :returns: The segment held for a split resource, or *None* if there is none.
+Resource Link::take_incoming_segment(const Bytes& original_hash) {
+	assert(_object);
+	auto iter = _object->_incoming_segments.find(original_hash);
+	if (iter == _object->_incoming_segments.end()) {
+		return {Type::NONE};
+	}
+	Resource resource(iter->second);
+	_object->_incoming_segments.erase(iter);
+	return resource;
+}
+
 void Link::cancel_outgoing_resource(const Resource& resource) {
 	assert(_object);
 	if (_object->_outgoing_resources.count(resource) > 0) {
@@ -1422,7 +1763,7 @@ void Link::cancel_incoming_resource(const Resource& resource) {
 
 bool Link::ready_for_new_resource() {
 	assert(_object);
-	return (_object->_outgoing_resources.size() > 0);
+	return (_object->_outgoing_resources.size() == 0);
 }
 
 std::string Link::toString() const {
@@ -1512,6 +1853,11 @@ bool Link::initiator() const {
 	return _object->_initiator;
 }
 
+const Link::Callbacks& Link::callbacks() const {
+	assert(_object);
+	return _object->_callbacks;
+}
+
 // setters
 
 void Link::destination(const Destination& destination) {
@@ -1524,6 +1870,11 @@ void Link::attached_interface(const Interface& interface) {
 	_object->_attached_interface = interface;
 }
 
+void Link::mtu(uint16_t mtu) {
+	assert(_object);
+	_object->_mtu = mtu;
+}
+
 void Link::establishment_timeout(double timeout) {
 	assert(_object);
 	_object->_establishment_timeout = timeout;
@@ -1564,6 +1915,11 @@ void Link::status(Type::Link::status status) {
 	_object->_status = status;
 }
 
+void Link::expected_rate(float rate) {
+	assert(_object);
+	_object->_expected_rate = rate;
+}
+
 
 //RequestReceipt::RequestReceipt(const Link& link, const PacketReceipt& packet_receipt /*= {Type::NONE}*/, const Resource& resource /*= {Type::NONE}*/, RequestReceipt::Callbacks::response response_callback /*= nullptr*/, RequestReceipt::Callbacks::failed failed_callback /*= nullptr*/, RequestReceipt::Callbacks::progress progress_callback /*= nullptr*/, double timeout /*= 0.0*/, int request_size /*= 0*/) :
 RequestReceipt::RequestReceipt(const Link& link, const PacketReceipt& packet_receipt, const Resource& resource, RequestReceipt::Callbacks::response response_callback /*= nullptr*/, RequestReceipt::Callbacks::failed failed_callback /*= nullptr*/, RequestReceipt::Callbacks::progress progress_callback /*= nullptr*/, double timeout /*= 0.0*/, int request_size /*= 0*/) :
@@ -1579,9 +1935,8 @@ RequestReceipt::RequestReceipt(const Link& link, const PacketReceipt& packet_rec
 	}
 	else if (_object->_resource) {
 		_object->_hash = resource.request_id();
-		// CBA TODO Need to find cross-platform way of passing class method as callback
-		//z const_cast<Resource&>(resource).set_concluded_callback(request_resource_concluded);
-		//z const_cast<Resource&>(resource).set_concluded_callback(std::bind(&RequestReceipt::request_resource_concluded, this, std::placeholders::_1));
+		// The resource finds this receipt among the link's pending requests
+		// and calls request_resource_concluded() when it concludes
 	}
 	_object->_link = link;
 	_object->_request_id = _object->_hash;
@@ -1788,11 +2143,21 @@ const Bytes& RequestReceipt::request_id() const {
 	return _object->_request_id;
 }
 
+size_t RequestReceipt::response_size() const {
+	assert(_object);
+	return _object->_response_size;
+}
+
 size_t RequestReceipt::response_transfer_size() const {
 	assert(_object);
 	return _object->_response_transfer_size;
 }
 
+double RequestReceipt::started_at() const {
+	assert(_object);
+	return _object->_started_at;
+}
+
 // setters
 
 void RequestReceipt::response_size(size_t size) {
@@ -1804,3 +2169,8 @@ void RequestReceipt::response_transfer_size(size_t size) {
 	assert(_object);
 	_object->_response_transfer_size = size;
 }
+
+void RequestReceipt::started_at(double time) {
+	assert(_object);
+	_object->_started_at = time;
+}
@@ -3,11 +3,17 @@
 #include "Destination.h"
 #include "Type.h"
 
+#include <vector>
 #include <memory>
 #include <cassert>
 
 namespace RNS {
 
+	namespace Cryptography {
+		class TokenEncryptor;
+		class TokenDecryptor;
+	}
+
 	class ResourceRequest;
 	class ResourceResponse;
 	class RequestReceipt;
@@ -20,6 +26,7 @@ namespace RNS {
 	class Destination;
 	class ResourceAdvertisement;
 	class PacketReceipt;
+	class Channel;
 
 	class ResourceRequest {
 	public:
@@ -87,11 +94,14 @@ namespace RNS {
 		// getters
 		const Bytes& hash() const;
 		const Bytes& request_id() const;
+		size_t response_size() const;
 		size_t response_transfer_size() const;
+		double started_at() const;
 
 		// setters
 		void response_size(size_t size);
 		void response_transfer_size(size_t size);
+		void started_at(double time);
 
 	private:
 		std::shared_ptr<RequestReceiptData> _object;
@@ -116,7 +126,7 @@ namespace RNS {
 			using closed = void(*)(Link& link);
 			using packet = void(*)(const Bytes& plaintext, const Packet& packet);
 			using remote_identified = void(*)(const Link& link, const Identity& remote_identity);
-			using resource = void(*)(const ResourceAdvertisement& resource_advertisement);
+			using resource = bool(*)(const ResourceAdvertisement& resource_advertisement);
 			using resource_started = void(*)(const Resource& resource);
 			using resource_concluded = void(*)(const Resource& resource);
 		public:
@@ -168,6 +178,16 @@ namespace RNS {
 		static RNS::Type::Link::link_mode mode_from_lp_packet(const Packet& packet);
 		static Bytes link_id_from_lr_packet(const Packet& packet);
 		static Link validate_request( const Destination& owner, const Bytes& data, const Packet& packet);
+		// Requests and responses as packed by the reference implementation,
+		// unpacking throws std::invalid_argument on malformed input
+		static void pack_request(Bytes& plaintext, double requested_at, const Bytes& path_hash, const Bytes& data);
+		static void unpack_request(const Bytes& packed, ResourceRequest& request);
+		static void pack_response(Bytes& plaintext, const Bytes& request_id, const Bytes& response);
+		static size_t unpack_response(const Bytes& packed, Bytes& request_id, Bytes& response_data);
+		// Framing of coalesced packets, each message prefixed by its length
+		// in one byte below 0x80, else in two bytes with the top bit set
+		static void append_coalesced(Bytes& payload, const Bytes& message);
+		static bool split_coalesced(const Bytes& payload, std::vector<Bytes>& messages);
 
 	public:
 		void load_peer(const Bytes& peer_pub_bytes, const Bytes& peer_sig_pub_bytes);
@@ -184,6 +204,8 @@ namespace RNS {
 		uint16_t get_mtu();
 		uint16_t get_mdu();
 		float get_expected_rate();
+		uint8_t get_last_resource_window() const;
+		double get_last_resource_eifr() const;
 		RNS::Type::Link::link_mode get_mode();
 		const Bytes& get_salt();
 		const Bytes get_context();
@@ -198,16 +220,26 @@ namespace RNS {
 		void teardown_packet(const Packet& packet);
 		void link_closed();
 		void start_watchdog();
-	void __watchdog_job();
+		void schedule_watchdog(double deadline);
+		void __watchdog_job();
 		void send_keepalive();
 		void handle_request(const Bytes& request_id, const ResourceRequest& unpacked_request);
 		void handle_response(const Bytes& request_id, const Bytes& response_data, size_t response_size, size_t response_transfer_size);
 		void request_resource_concluded(const Resource& resource);
 		void response_resource_concluded(const Resource& resource);
-		//z const Channel& get_channel();
+		Channel get_channel();
+		void set_coalescing(double latency_budget);
+		void send_coalesced(const Bytes& data);
+		void flush_coalesced();
+		void schedule_flush(double deadline);
+		void signal_coalescing();
 		void receive(const Packet& packet);
 		const Bytes encrypt(const Bytes& plaintext);
 		const Bytes decrypt(const Bytes& ciphertext);
+		// Encrypt or decrypt one token in pieces, for resources streamed from and to storage
+		std::shared_ptr<Cryptography::TokenEncryptor> encryptor();
+		std::shared_ptr<Cryptography::TokenDecryptor> decryptor();
+		std::shared_ptr<Cryptography::TokenDecryptor> decryptor(const Bytes& chain);
 		const Bytes sign(const Bytes& message);
 		bool validate(const Bytes& signature, const Bytes& message);
 		void set_link_established_callback(Callbacks::established callback);
@@ -222,6 +254,9 @@ namespace RNS {
 		void register_outgoing_resource(const Resource& resource);
 		void register_incoming_resource(const Resource& resource);
 		bool has_incoming_resource(const Resource& resource);
+		// Segments of a split resource are held until the next one is accepted
+		void hold_incoming_segment(const Resource& resource);
+		Resource take_incoming_segment(const Bytes& original_hash);
 		void cancel_outgoing_resource(const Resource& resource);
 		void cancel_incoming_resource(const Resource& resource);
 		bool ready_for_new_resource();
@@ -247,10 +282,12 @@ namespace RNS {
 		std::set<RequestReceipt>& pending_requests() const;
 		Type::Link::teardown_reason teardown_reason() const;
 		bool initiator() const;
+		const Callbacks& callbacks() const;
 
 		// setters
 		void destination(const Destination& destination);
 		void attached_interface(const Interface& interface);
+		void mtu(uint16_t mtu);
 		void establishment_timeout(double timeout);
 		void establishment_cost(uint16_t cost);
 		void request_time(double time);
@@ -259,6 +296,7 @@ namespace RNS {
 		void increment_tx();
 		void increment_txbytes(uint16_t bytes);
 		void status(Type::Link::status status);
+		void expected_rate(float rate);
 
 	protected:
 		std::shared_ptr<LinkData> _object;
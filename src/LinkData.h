@@ -12,6 +12,7 @@
 #include "Type.h"
 #include "Cryptography/Token.h"
 
+#include <map>
 #include <set>
 
 namespace RNS {
@@ -58,6 +59,9 @@ namespace RNS {
 		uint16_t _keepalive = Type::Link::KEEPALIVE;
 		uint16_t _stale_time = Type::Link::STALE_TIME;
 		bool _watchdog_lock = false;
+		// Time the watchdog is scheduled to run, 0 while not scheduled
+		double _watchdog_deadline = 0.0;
+		uint32_t _watchdog_id = 0;
 		double _activated_at = 0.0;
 		// CBA LINK
 		//Type::Destination::types _type = Type::Destination::LINK;
@@ -67,12 +71,27 @@ namespace RNS {
 		Interface _attached_interface = {Type::NONE};
 		Identity __remote_identity = {Type::NONE};
 		Channel _channel = {Type::NONE};
+		// Messages queued by send_coalesced() as length-prefixed records, and
+		// the latency budget they may wait for, 0 while coalescing is off
+		Bytes _coalesce_queue;
+		uint16_t _coalesce_count = 0;
+		double _coalesce_latency = 0.0;
+		// Time the queue is flushed at the latest, 0 while it is empty
+		double _coalesce_deadline = 0.0;
+		uint32_t _coalesce_id = 0;
+		// Whether each end has signalled that it takes coalesced packets, as
+		// messages are only coalesced once the other end has
+		bool _coalesce_signalled = false;
+		bool _peer_coalesces = false;
 		double _establishment_timeout = 0.0;
 		Bytes _request_data;
 		Packet _packet = {Type::NONE};
 		double _request_time = 0.0;
 		float _establishment_rate = 0.0;
         float _expected_rate = 0.0;
+		// Window and rate the last incoming resource ended with, the next one starts from them
+		uint8_t _last_resource_window = 0;
+		double _last_resource_eifr = 0.0;
 		Type::Link::teardown_reason _teardown_reason = Type::Link::TEARDOWN_NONE;
 
 		Cryptography::Token::Ptr _token;
@@ -100,6 +119,8 @@ namespace RNS {
 
 		std::set<Resource> _incoming_resources;
 		std::set<Resource> _outgoing_resources;
+		// Last completed segment of each split resource still being received, by original hash
+		std::map<Bytes, Resource> _incoming_segments;
 		std::set<RNS::RequestReceipt> _pending_requests;
 
 	friend class Link;
@@ -122,7 +143,7 @@ namespace RNS {
 		size_t _response_size = 0;
 		Type::RequestReceipt::status _status = Type::RequestReceipt::SENT;
 		double _sent_at = 0.0;
-		int _progress = 0;
+		float _progress = 0.0;
 		double _concluded_at = 0.0;
 		double _response_concluded_at = 0.0;
 		double _timeout = 0.0;
@@ -739,6 +739,9 @@ std::string Packet::dumpString() const {
 	case CHANNEL:
 		dump += "CHANNEL\n";
 		break;
+	case COALESCED:
+		dump += "COALESCED\n";
+		break;
 	case KEEPALIVE:
 		encrypted = false;
 		dump += "KEEPALIVE\n";
@@ -838,8 +841,7 @@ bool PacketReceipt::validate_link_proof(const Bytes& proof, const Link& link, co
 		Bytes proof_hash = proof.left(Type::Identity::HASHLENGTH/8);
 		Bytes signature = proof.mid(Type::Identity::HASHLENGTH/8, Type::Identity::SIGLENGTH/8);
 		if (proof_hash == _object->_hash) {
-			//z if (link.validate(signature, _object->_hash)) {
-			if (false) {
+			if (const_cast<Link&>(link).validate(signature, _object->_hash)) {
 				_object->_status = DELIVERED;
 				_object->_proved = true;
 				_object->_concluded_at = OS::time();
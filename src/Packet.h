@@ -248,7 +248,7 @@ namespace RNS {
 		// CBA LINK
 		inline const Link& destination_link() const { assert(_object); return _object->_destination_link; }
 		//CBA Following method is only used by Resource to access decrypted resource advertisement form Link. Consider a better way.
-		inline const Bytes& plaintext() { assert(_object); return _object->_plaintext; }
+		inline const Bytes& plaintext() const { assert(_object); return _object->_plaintext; }
 
 		// setters
 		inline void destination(const Destination& destination) { assert(_object); _object->_destination = destination; }
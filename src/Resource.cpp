@@ -3,78 +3,2337 @@
 #include "ResourceData.h"
 #include "Reticulum.h"
 #include "Transport.h"
+#include "Identity.h"
 #include "Packet.h"
 #include "Log.h"
+#include "Cryptography/Token.h"
+#include "Cryptography/Provider.h"
+#include "Utilities/OS.h"
+#include "Utilities/Packed.h"
+
+#include <MsgPack.h>
 
 #include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+#include <string.h>
+
+using namespace RNS;
+using namespace RNS::Utilities;
+
+/*static*/ Codec::Ptr Resource::_codec;
+
+namespace {
+
+	// Parts travel unencrypted in a single packet each, so a part fills the
+	// link MTU less headers
+	uint16_t link_sdu(const Link& link) {
+		//p self.sdu = link.mtu - RNS.Reticulum.HEADER_MAXSIZE - RNS.Reticulum.IFAC_MIN_SIZE
+		return link.mtu() - Type::Reticulum::HEADER_MAXSIZE - Type::Reticulum::IFAC_MIN_SIZE;
+	}
+
+	// Metadata travels ahead of the data in the first segment, prefixed
+	// with its size in three bytes
+	const Bytes metadata_prefix(size_t size) {
+		//p self.metadata = struct.pack(">I", metadata_size)[1:] + packed_metadata
+		Bytes prefix(3);
+		prefix.append((uint8_t)(size >> 16));
+		prefix.append((uint8_t)(size >> 8));
+		prefix.append((uint8_t)size);
+		return prefix;
+	}
+
+	size_t metadata_size(const uint8_t* prefix) {
+		return (prefix[0] << 16) | (prefix[1] << 8) | prefix[2];
+	}
+
+	// Reads up to size bytes, NONE at the end of the stream. Reads stop at
+	// what the stream has available, as a blocking read would wait out the
+	// stream timeout at its end.
+	const Bytes read_stream(FileStream& stream, size_t size) {
+		Bytes data;
+		if (size == 0) {
+			return data;
+		}
+		uint8_t* buffer = data.writable(size);
+		size_t length = 0;
+		while (length < size) {
+			int available = stream.available();
+			if (available <= 0) {
+				break;
+			}
+			size_t chunk = size - length;
+			if ((size_t)available < chunk) {
+				chunk = available;
+			}
+			size_t read = stream.readBytes(buffer + length, chunk);
+			if (read == 0) {
+				break;
+			}
+			length += read;
+		}
+		if (length == 0) {
+			return {Bytes::NONE};
+		}
+		data.resize(length);
+		return data;
+	}
+
+	size_t write_stream(FileStream& stream, const Bytes& data) {
+		if (data.size() > 0 && stream.write(data.data(), data.size()) != data.size()) {
+			throw std::runtime_error("Could not write to resource stream");
+		}
+		return data.size();
+	}
+
+	// Path for a new file in the resources cache, named for the time created
+	// for clean_cache() to expire
+	const std::string cache_file_path(const char* suffix) {
+		char path[Type::Reticulum::FILEPATH_MAXSIZE];
+		snprintf(path, Type::Reticulum::FILEPATH_MAXSIZE, "%s/resources", Reticulum::_cachepath);
+		if (!OS::directory_exists(path)) {
+			OS::create_directory(path);
+		}
+		snprintf(path, Type::Reticulum::FILEPATH_MAXSIZE, "%s/resources/%08lx%s%s", Reticulum::_cachepath, (unsigned long)(uint32_t)OS::time(), Identity::get_random_hash().left(4).toHex().c_str(), suffix);
+		return path;
+	}
+
+	// One encrypted stream written to a spool file in the cache, starting
+	// with a random prefix unless it is a stream encrypted again
+	class SpoolWriter {
+	public:
+		SpoolWriter(Link& link, bool prefix = true) : _encryptor(link.encryptor()), _path(cache_file_path(".spool")) {
+			_file = OS::open_file(_path.c_str(), FileStream::MODE_WRITE);
+			if (!_file) {
+				throw std::runtime_error("Could not create resource spool file");
+			}
+			if (prefix) {
+				write(Identity::get_random_hash().left(Type::Resource::RANDOM_HASH_SIZE));
+			}
+		}
+		~SpoolWriter() {
+			if (_file) {
+				_file.close();
+			}
+		}
+
+		void write(const Bytes& plaintext) {
+			_size += write_stream(_file, _encryptor->update(plaintext));
+		}
+		void finalize() {
+			_size += write_stream(_file, _encryptor->finalize());
+			_file.flush();
+			_file.close();
+			_file.clear();
+		}
+		void discard() {
+			if (_file) {
+				_file.close();
+				_file.clear();
+			}
+			OS::remove_file(_path.c_str());
+		}
+
+		const std::string& path() const { return _path; }
+		size_t size() const { return _size; }
+
+	private:
+		std::shared_ptr<Cryptography::TokenEncryptor> _encryptor;
+		std::string _path;
+		FileStream _file = {Type::NONE};
+		size_t _size = 0;
+	};
+
+	// Transfer state of an incoming resource as kept in the cache. What was
+	// received is kept decrypted in the sink spool, no key is kept.
+	struct ResourceState {
+		double updated = 0.0;
+		uint32_t size = 0;
+		uint32_t total_size = 0;
+		uint32_t parts = 0;
+		uint8_t flags = 0;
+		Bytes random_hash;
+		uint32_t part_size = 0;
+		std::string spool_path;
+	};
+
+	void state_path(char* path, const Bytes& hash) {
+		snprintf(path, Type::Reticulum::FILEPATH_MAXSIZE, "%s/resources/%s", Reticulum::_cachepath, hash.toHex().c_str());
+	}
+
+	bool unpack_state(const Bytes& packed, ResourceState& state) {
+		MsgPack::Unpacker unpacker;
+		unpacker.feed(packed.data(), packed.size());
+		MsgPack::bin_t<uint8_t> random_hash;
+		MsgPack::bin_t<uint8_t> spool_path;
+		if (!unpacker.from_array(state.updated, state.size, state.total_size, state.parts, state.flags, random_hash, state.part_size, spool_path)) {
+			return false;
+		}
+		state.random_hash = Bytes(random_hash);
+		state.spool_path = Bytes(spool_path).toString();
+		return true;
+	}
+
+}
+
+//Resource::Resource(const Link& link /*= {Type::NONE}*/) :
+//	_object(new ResourceData(link))
+//{
+//	assert(_object);
+//	MEM("Resource object created");
+//}
+
+// Incoming resource, set up by accept()
+Resource::Resource(const Link& link) :
+	_object(new ResourceData(link))
+{
+	assert(_object);
+	MEM("Resource object created");
+}
+
+Resource::Resource(const Bytes& data, const Link& link, const Bytes& request_id, bool is_response, double timeout) :
+	Resource(data, link, true, true, nullptr, nullptr, timeout, 1, {Type::NONE}, request_id, is_response)
+{
+}
+
+Resource::Resource(const Bytes& data, const Link& link, bool advertise /*= true*/, bool auto_compress /*= true*/, Callbacks::concluded callback /*= nullptr*/, Callbacks::progress progress_callback /*= nullptr*/, double timeout /*= 0.0*/, int segment_index /*= 1*/, const Bytes& original_hash /*= {Type::NONE}*/, const Bytes& request_id /*= {Type::NONE}*/, bool is_response /*= false*/, const Bytes& metadata /*= {Bytes::NONE}*/) :
+	_object(new ResourceData(link))
+{
+	assert(_object);
+	MEM("Resource object created");
+
+	setup(callback, progress_callback, timeout, segment_index, request_id, is_response);
+	_object->_auto_compress = auto_compress;
+	set_metadata(metadata);
+	_object->_input = data;
+	prepare_data(original_hash);
+
+	if (advertise) {
+		this->advertise();
+	}
+}
+
+Resource::Resource(const FileStream& source, const Link& link, bool advertise /*= true*/, bool auto_compress /*= true*/, Callbacks::concluded callback /*= nullptr*/, Callbacks::progress progress_callback /*= nullptr*/, double timeout /*= 0.0*/, int segment_index /*= 1*/, const Bytes& original_hash /*= {Type::NONE}*/, const Bytes& request_id /*= {Type::NONE}*/, bool is_response /*= false*/, const Bytes& metadata /*= {Bytes::NONE}*/) :
+	_object(new ResourceData(link))
+{
+	assert(_object);
+	MEM("Resource object created");
+
+	setup(callback, progress_callback, timeout, segment_index, request_id, is_response);
+	_object->_auto_compress = auto_compress;
+	set_metadata(metadata);
+	_object->_source = source;
+	prepare_stream(original_hash);
+
+	if (advertise) {
+		this->advertise();
+	}
+}
+
+// Transfer parameters common to outgoing resources
+void Resource::setup(Callbacks::concluded callback, Callbacks::progress progress_callback, double timeout, int segment_index, const Bytes& request_id, bool is_response) {
+	assert(_object);
+	_object->_status = Type::Resource::NONE;
+	_object->_timeout_factor = _object->_link.traffic_timeout_factor();
+	_object->_request_id = request_id;
+	_object->_is_request = (request_id && !is_response);
+	_object->_is_response = (request_id && is_response);
+	_object->_sdu = link_sdu(_object->_link);
+
+	if (timeout != 0.0) {
+		_object->_timeout = timeout;
+	}
+	else {
+		_object->_timeout = _object->_link.rtt() * _object->_link.traffic_timeout_factor();
+	}
+
+	_object->_initiator = true;
+	_object->_callbacks._concluded = callback;
+	_object->_callbacks._progress = progress_callback;
+	_object->_segment_index = segment_index;
+	_object->_total_segments = 1;
+	_object->_compressed = false;
+}
+
+void Resource::set_metadata(const Bytes& metadata) {
+	assert(_object);
+	if (!metadata) {
+		return;
+	}
+	if (metadata.size() > Type::Resource::METADATA_MAX_SIZE) {
+		throw std::invalid_argument("Resource metadata size exceeded");
+	}
+	_object->_metadata = metadata;
+	_object->_metadata_size = 3 + metadata.size();
+	_object->_has_metadata = true;
+}
+
+/*
+Sets the number of segments from the total size, and gives the range of the
+input the current segment covers. The first segment leaves room for the
+metadata.
+*/
+void Resource::segment(size_t& offset, size_t& length) {
+	assert(_object);
+	//p self.total_segments = ((self.total_size-1)//Resource.MAX_EFFICIENT_SIZE)+1
+	_object->_total_segments = (_object->_total_size > 0) ? (int)((_object->_total_size - 1) / Type::Resource::MAX_EFFICIENT_SIZE) + 1 : 1;
+	_object->_split = (_object->_total_segments > 1);
+	if (_object->_segment_index < 1 || _object->_segment_index > _object->_total_segments) {
+		throw std::invalid_argument("Invalid resource segment index");
+	}
+	size_t first_length = Type::Resource::MAX_EFFICIENT_SIZE - _object->_metadata_size;
+	if (_object->_segment_index == 1) {
+		offset = 0;
+		length = first_length;
+	}
+	else {
+		offset = first_length + (size_t)(_object->_segment_index - 2) * Type::Resource::MAX_EFFICIENT_SIZE;
+		length = Type::Resource::MAX_EFFICIENT_SIZE;
+	}
+}
+
+// Compresses, encrypts and maps the current segment of data held in memory
+void Resource::prepare_data(const Bytes& original_hash) {
+	assert(_object);
+	_object->_total_size = _object->_input.size() + _object->_metadata_size;
+	size_t offset;
+	size_t length;
+	segment(offset, length);
+	Bytes data(_object->_split ? _object->_input.mid(offset, length) : _object->_input);
+	if (_object->_segment_index == 1 && _object->_has_metadata) {
+		data = metadata_prefix(_object->_metadata.size()) + _object->_metadata + data;
+	}
+	// Only later segments are cut from the input
+	if (_object->_segment_index == _object->_total_segments) {
+		_object->_input.clear();
+	}
+	_object->_uncompressed_size = data.size();
+
+	// Compressed only if that makes it smaller
+	Bytes payload(data);
+	if (_object->_auto_compress && _codec && data.size() <= Type::Resource::AUTO_COMPRESS_MAX_SIZE) {
+		std::unique_ptr<Compressor> compressor(_codec->compressor());
+		Bytes compressed(compressor->update(data));
+		compressed << compressor->finalize();
+		if (compressed.size() < data.size()) {
+			TRACEF("Compression saved %u bytes, sending compressed", (unsigned)(data.size() - compressed.size()));
+			payload = compressed;
+			_object->_compressed = true;
+		}
+		else {
+			TRACE("Compression did not decrease size, sending uncompressed");
+		}
+	}
+	_object->_compressed_size = payload.size();
+
+	// Resources handle encryption directly to
+	// make optimal use of packet MTU on an entire
+	// encrypted stream. The Resource instance will
+	// use it's underlying link directly to encrypt.
+	Bytes stream(Type::Resource::RANDOM_HASH_SIZE + payload.size());
+	stream << Identity::get_random_hash().left(Type::Resource::RANDOM_HASH_SIZE);
+	stream << payload;
+	_object->_data = _object->_link.encrypt(stream);
+	_object->_stream_decryptor = _object->_link.decryptor();
+	_object->_encrypted = true;
+	_object->_size = _object->_data.size();
+
+	map_hashes(original_hash, nullptr, data);
+}
+
+// Spools the current segment of the source to the cache and maps it
+void Resource::prepare_stream(const Bytes& original_hash) {
+	assert(_object);
+	try {
+		_object->_total_size = _object->_source.size() + _object->_metadata_size;
+		size_t offset;
+		size_t length;
+		segment(offset, length);
+		// Segments are read in sequence, each from where the one before stopped
+		Bytes prefix;
+		if (_object->_segment_index == 1 && _object->_has_metadata) {
+			prefix = metadata_prefix(_object->_metadata.size()) + _object->_metadata;
+		}
+		std::unique_ptr<Cryptography::Provider::Sha256> data_hash(spool(_object->_source, length, prefix));
+		if (_object->_segment_index == _object->_total_segments) {
+			// A resource of one segment is as large as what was read
+			if (!_object->_split) {
+				_object->_total_size = _object->_uncompressed_size;
+			}
+			_object->_source.clear();
+		}
+		_object->_stream_decryptor = _object->_link.decryptor();
+		_object->_encrypted = true;
+
+		map_hashes(original_hash, data_hash.get(), {Bytes::NONE});
+
+		_object->_spool = OS::open_file(_object->_spool_path.c_str(), FileStream::MODE_READ);
+		if (!_object->_spool) {
+			throw std::runtime_error("Could not open resource spool file");
+		}
+	}
+	catch (std::exception& e) {
+		close_streams();
+		throw;
+	}
+}
+
+// Prepares the segment after this one, advertised once this one is proven
+Resource Resource::next_segment() {
+	assert(_object);
+	Resource next(_object->_link);
+	next.setup(_object->_callbacks._concluded, _object->_callbacks._progress, 0.0, _object->_segment_index + 1, _object->_request_id, _object->_is_response);
+	next._object->_auto_compress = _object->_auto_compress;
+	next._object->_metadata_size = _object->_metadata_size;
+	if (_object->_source) {
+		next._object->_source = _object->_source;
+		next.prepare_stream(_object->_original_hash);
+	}
+	else {
+		next._object->_input = _object->_input;
+		next.prepare_data(_object->_original_hash);
+	}
+	return next;
+}
+
+/*
+Picks the random hash and builds the part hashmap of the encrypted stream,
+picking again until no map hash collides within the collision guard. The
+resource hash and proof cover the plaintext, given either as data or as the
+hash state after all of it for a spooled resource.
+*/
+void Resource::map_hashes(const Bytes& original_hash, const Cryptography::Provider::Sha256* data_hash, const Bytes& data) {
+	assert(_object);
+	_object->_sent_parts = 0;
+	uint32_t hashmap_entries = (_object->_size + _object->_sdu - 1) / _object->_sdu;
+	_object->_total_parts = hashmap_entries;
+	_object->_parts_sent.assign(hashmap_entries, false);
+
+	bool hashmap_ok = false;
+	while (!hashmap_ok) {
+		_object->_random_hash = Identity::get_random_hash().left(Type::Resource::RANDOM_HASH_SIZE);
+		if (data_hash != nullptr) {
+			uint8_t hash[Type::Identity::HASHLENGTH/8];
+			std::unique_ptr<Cryptography::Provider::Sha256> resource_hash(data_hash->clone());
+			resource_hash->update(_object->_random_hash.data(), _object->_random_hash.size());
+			resource_hash->finalize(hash);
+			_object->_hash.assign(hash, sizeof(hash));
+			std::unique_ptr<Cryptography::Provider::Sha256> proof_hash(data_hash->clone());
+			proof_hash->update(_object->_hash.data(), _object->_hash.size());
+			proof_hash->finalize(hash);
+			_object->_expected_proof.assign(hash, sizeof(hash));
+		}
+		else {
+			_object->_hash = Identity::full_hash(data + _object->_random_hash);
+			_object->_expected_proof = Identity::full_hash(data + _object->_hash);
+		}
+
+		if (!original_hash) {
+			_object->_original_hash = _object->_hash;
+		}
+		else {
+			_object->_original_hash = original_hash;
+		}
+
+		hashmap_ok = map_parts();
+	}
+}
+
+/*
+Builds the part hashmap of the encrypted stream under the current random
+hash. A spooled resource reads its spool through and writes the map hashes
+to a file beside it, to be read back as parts are requested.
+
+:returns: *False* if a map hash collides within the collision guard.
+*/
+bool Resource::map_parts() {
+	assert(_object);
+	bool hashmap_ok = true;
+	_object->_hashmap = Bytes((_object->_spool_path.empty() ? _object->_total_parts : 2 * Type::Resource::ResourceAdvertisement::COLLISION_GUARD_SIZE) * Type::Resource::MAPHASH_LEN);
+	_object->_hashmap_base = 0;
+	if (_object->_spool_path.empty()) {
+		for (uint32_t i = 0; i < _object->_total_parts && hashmap_ok; i++) {
+			hashmap_ok = map_part(i, _object->_data.mid(i * _object->_sdu, _object->_sdu));
+		}
+		return hashmap_ok;
+	}
+
+	if (_object->_hashmap_path.empty()) {
+		_object->_hashmap_path = cache_file_path(".map");
+	}
+	FileStream spool = OS::open_file(_object->_spool_path.c_str(), FileStream::MODE_READ);
+	if (!spool) {
+		throw std::runtime_error("Could not open resource spool file");
+	}
+	if (_object->_hashmap_file) {
+		_object->_hashmap_file.close();
+	}
+	_object->_hashmap_file = OS::open_file(_object->_hashmap_path.c_str(), FileStream::MODE_WRITE);
+	if (!_object->_hashmap_file) {
+		spool.close();
+		throw std::runtime_error("Could not create resource hashmap file");
+	}
+	try {
+		for (uint32_t i = 0; i < _object->_total_parts && hashmap_ok; i++) {
+			const Bytes part(read_stream(spool, _object->_sdu));
+			if (!part) {
+				throw std::runtime_error("Resource spool file is truncated");
+			}
+			hashmap_ok = map_part(i, part);
+		}
+		_object->_hashmap_file.flush();
+	}
+	catch (std::exception& e) {
+		spool.close();
+		_object->_hashmap_file.close();
+		_object->_hashmap_file.clear();
+		throw;
+	}
+	spool.close();
+	_object->_hashmap_file.close();
+	_object->_hashmap_file.clear();
+
+	// Read back from the file as parts are requested
+	_object->_hashmap.clear();
+	_object->_hashmap_base = 0;
+	_object->_hashmap_read = 0;
+	return hashmap_ok;
+}
+
+// Enters the map hash of the next part, false if it collides with a recent one
+bool Resource::map_part(uint32_t index, const Bytes& part) {
+	assert(_object);
+	const Bytes map_hash(get_map_hash(part));
+	// Map hashes need only be unique within the span a receiver searches
+	const uint32_t guard_size = Type::Resource::ResourceAdvertisement::COLLISION_GUARD_SIZE;
+	uint32_t guard_start = (index > guard_size) ? index - guard_size : 0;
+	for (uint32_t j = std::max(guard_start, _object->_hashmap_base); j < index; j++) {
+		if (memcmp(hashmap_entry(j), map_hash.data(), Type::Resource::MAPHASH_LEN) == 0) {
+			DEBUG("Found hash collision in resource map, remapping...");
+			return false;
+		}
+	}
+	_object->_hashmap << map_hash;
+	if (_object->_hashmap_file) {
+		write_stream(_object->_hashmap_file, map_hash);
+		// Only the span checked for collisions is held
+		if (index + 1 - _object->_hashmap_base > 2 * guard_size) {
+			uint32_t base = index + 1 - guard_size;
+			_object->_hashmap = _object->_hashmap.mid((base - _object->_hashmap_base) * Type::Resource::MAPHASH_LEN);
+			_object->_hashmap_base = base;
+		}
+	}
+	return true;
+}
+
+// Map hash of a part held in memory
+const uint8_t* Resource::hashmap_entry(uint32_t index) const {
+	assert(_object);
+	assert(index >= _object->_hashmap_base && (index - _object->_hashmap_base) * Type::Resource::MAPHASH_LEN < _object->_hashmap.size());
+	return _object->_hashmap.data() + (index - _object->_hashmap_base) * Type::Resource::MAPHASH_LEN;
+}
+
+/*
+Reads the map hashes of parts start to end from the hashmap file of a spooled
+resource, and drops those held before start. The file is read forward only,
+going back reads it from the start again.
+*/
+void Resource::load_hashmap(uint32_t start, uint32_t end) {
+	assert(_object);
+	if (_object->_hashmap_path.empty()) {
+		return;
+	}
+	if (end > _object->_total_parts) {
+		end = _object->_total_parts;
+	}
+	if (start > end) {
+		start = end;
+	}
+	if (!_object->_hashmap_file || start < _object->_hashmap_base) {
+		if (_object->_hashmap_file) {
+			_object->_hashmap_file.close();
+		}
+		_object->_hashmap_file = OS::open_file(_object->_hashmap_path.c_str(), FileStream::MODE_READ);
+		if (!_object->_hashmap_file) {
+			throw std::runtime_error("Could not open resource hashmap file");
+		}
+		_object->_hashmap.clear();
+		_object->_hashmap_base = 0;
+		_object->_hashmap_read = 0;
+	}
+
+	if (start >= _object->_hashmap_read) {
+		while (_object->_hashmap_read < start) {
+			size_t skip = std::min<size_t>((start - _object->_hashmap_read) * Type::Resource::MAPHASH_LEN, Type::Resource::SPOOL_CHUNK_SIZE);
+			const Bytes skipped(read_stream(_object->_hashmap_file, skip));
+			if (skipped.size() != skip) {
+				throw std::runtime_error("Resource hashmap file is truncated");
+			}
+			_object->_hashmap_read += skip / Type::Resource::MAPHASH_LEN;
+		}
+		_object->_hashmap.clear();
+		_object->_hashmap_base = start;
+	}
+	else if (start > _object->_hashmap_base) {
+		_object->_hashmap = _object->_hashmap.mid((start - _object->_hashmap_base) * Type::Resource::MAPHASH_LEN);
+		_object->_hashmap_base = start;
+	}
+
+	if (_object->_hashmap_read < end) {
+		size_t size = (end - _object->_hashmap_read) * Type::Resource::MAPHASH_LEN;
+		const Bytes map_hashes(read_stream(_object->_hashmap_file, size));
+		if (map_hashes.size() != size) {
+			throw std::runtime_error("Resource hashmap file is truncated");
+		}
+		_object->_hashmap << map_hashes;
+		_object->_hashmap_read = end;
+	}
+}
+
+/*
+Encrypts prefix and up to length bytes read from source into a spool file in
+the cache, hashing the plaintext on the way. With auto_compress the
+compressed data is spooled alongside, and kept instead if it turns out
+smaller.
+
+:returns: The hash state after all of the data.
+*/
+std::unique_ptr<Cryptography::Provider::Sha256> Resource::spool(FileStream& source, size_t length, const Bytes& prefix) {
+	assert(_object);
+	SpoolWriter spool(_object->_link);
+	_object->_spool_path = spool.path();
+
+	bool auto_compress = _object->_auto_compress;
+	std::unique_ptr<SpoolWriter> compressed_spool;
+	std::unique_ptr<Compressor> compressor;
+	if (auto_compress && _codec) {
+		compressed_spool.reset(new SpoolWriter(_object->_link));
+		compressor = _codec->compressor();
+	}
+
+	std::unique_ptr<Cryptography::Provider::Sha256> data_hash(Cryptography::Provider::sha256_stream());
+	size_t total_size = 0;
+	size_t compressed_size = 0;
+	try {
+		Bytes chunk(prefix);
+		size_t read = 0;
+		while (chunk || read < length) {
+			if (!chunk) {
+				chunk = read_stream(source, std::min<size_t>(Type::Resource::SPOOL_CHUNK_SIZE, length - read));
+				if (!chunk) {
+					break;
+				}
+				read += chunk.size();
+			}
+			total_size += chunk.size();
+			data_hash->update(chunk.data(), chunk.size());
+			spool.write(chunk);
+
+			if (compressed_spool) {
+				const Bytes compressed(compressor->update(chunk));
+				compressed_size += compressed.size();
+				compressed_spool->write(compressed);
+				// Data that has not compressed over the first few chunks is
+				// taken to be incompressible, saving the second spool
+				if (total_size > Type::Resource::AUTO_COMPRESS_MAX_SIZE || (total_size >= 4 * Type::Resource::SPOOL_CHUNK_SIZE && compressed_size >= total_size)) {
+					compressed_spool->discard();
+					compressed_spool.reset();
+				}
+			}
+			chunk.clear();
+		}
+		spool.finalize();
+
+		if (compressed_spool) {
+			const Bytes compressed(compressor->finalize());
+			compressed_size += compressed.size();
+			compressed_spool->write(compressed);
+			compressed_spool->finalize();
+		}
+	}
+	catch (std::exception& e) {
+		if (compressed_spool) {
+			compressed_spool->discard();
+		}
+		throw;
+	}
+
+	_object->_uncompressed_size = total_size;
+	if (compressed_spool && compressed_size < total_size) {
+		TRACEF("Compression saved %u bytes, sending compressed", (unsigned)(total_size - compressed_size));
+		spool.discard();
+		_object->_spool_path = compressed_spool->path();
+		_object->_size = compressed_spool->size();
+		_object->_compressed_size = compressed_size;
+		_object->_compressed = true;
+	}
+	else {
+		if (compressed_spool) {
+			compressed_spool->discard();
+		}
+		if (auto_compress && _codec) {
+			TRACE("Compression did not decrease size, sending uncompressed");
+		}
+		_object->_size = spool.size();
+		_object->_compressed_size = total_size;
+	}
+	return data_hash;
+}
+
+/*
+Accepts a resource advertisement received on a link and starts requesting
+its parts.
+
+:returns: The incoming resource, or *None* if the advertisement was invalid or the resource is already being transferred.
+*/
+/*static*/ Resource Resource::accept(const Packet& advertisement_packet, Callbacks::concluded callback /*= nullptr*/, Callbacks::progress progress_callback /*= nullptr*/, const Bytes& request_id /*= {Bytes::NONE}*/) {
+	try {
+		RNS::ResourceAdvertisement adv = RNS::ResourceAdvertisement::unpack(advertisement_packet.plaintext());
+		if (adv.compressed() && !_codec) {
+			throw std::invalid_argument("Compressed resources are not supported without a codec");
+		}
+		if (adv.segment_index() < 1 || adv.segment_index() > adv.total_segments()) {
+			throw std::invalid_argument("Invalid segment in resource advertisement");
+		}
+		// Every part carries at least one byte of the transfer
+		if (adv.parts() == 0 || adv.parts() > adv.transfer_size()) {
+			throw std::invalid_argument("Invalid part count in resource advertisement");
+		}
+
+		Link link(advertisement_packet.link());
+		Resource resource(link);
+		resource._object->_status = Type::Resource::TRANSFERRING;
+		resource._object->_size = adv.transfer_size();
+		resource._object->_total_size = adv.data_size();
+		resource._object->_uncompressed_size = adv.data_size();
+		resource._object->_hash = adv.hash();
+		resource._object->_original_hash = adv.original_hash();
+		resource._object->_random_hash = adv.random_hash();
+		resource._object->_encrypted = adv.encrypted();
+		resource._object->_compressed = adv.compressed();
+		resource._object->_has_metadata = adv.has_metadata();
+		resource._object->_is_request = adv.is_request();
+		resource._object->_is_response = adv.is_response();
+		resource._object->_request_id = request_id;
+		resource._object->_initiator = false;
+		resource._object->_callbacks._concluded = callback;
+		resource._object->_callbacks._progress = progress_callback;
+		resource._object->_timeout_factor = link.traffic_timeout_factor();
+		resource._object->_timeout = link.rtt() * link.traffic_timeout_factor();
+		resource._object->_sdu = link_sdu(link);
+		// The part count is advertised, so parts of any size the sender chose are accepted
+		resource._object->_total_parts = adv.parts();
+		resource._object->_received_count = 0;
+		resource._object->_outstanding_parts = 0;
+		resource._object->_parts.clear();
+		resource._object->_window = Type::Resource::WINDOW;
+		resource._object->_window_max = Type::Resource::WINDOW_MAX_SLOW;
+		resource._object->_window_min = Type::Resource::WINDOW_MIN;
+		resource._object->_window_flexibility = Type::Resource::WINDOW_FLEXIBILITY;
+		resource._object->_last_activity = OS::time();
+		resource._object->_started_transferring = resource._object->_last_activity;
+		resource._object->_segment_index = adv.segment_index();
+		resource._object->_total_segments = adv.total_segments();
+		resource._object->_split = adv.split();
+		resource._object->_hashmap_height = 0;
+		resource._object->_waiting_for_hmu = false;
+		resource._object->_consecutive_completed_height = -1;
+
+		// Start from where the last transfer on this link left off
+		uint8_t previous_window = link.get_last_resource_window();
+		double previous_eifr = link.get_last_resource_eifr();
+		if (previous_window > 0) {
+			resource._object->_window = previous_window;
+		}
+		if (previous_eifr > 0.0) {
+			resource._object->_previous_eifr = previous_eifr;
+		}
+
+		if (!link.has_incoming_resource(resource)) {
+			if (adv.segment_index() > 1) {
+				// Later segments add to what the ones before received
+				Resource previous(link.take_incoming_segment(adv.original_hash()));
+				if (!previous) {
+					throw std::invalid_argument("Resource segment does not follow an earlier one");
+				}
+				resource._object->_data = previous._object->_data;
+				resource._object->_metadata = previous._object->_metadata;
+				if (previous._object->_sink) {
+					resource.set_data_sink(previous._object->_sink);
+				}
+			}
+			link.register_incoming_resource(resource);
+			DEBUGF("Accepting resource advertisement for %s. Transfer size is %u in %u parts.", resource._object->_hash.toHex().c_str(), (unsigned)resource._object->_size, (unsigned)resource._object->_total_parts);
+
+#if defined(RNS_USE_FS)
+			// Transfers to a sink taking more than one round of requests keep
+			// their state in the cache, and pick up from it if interrupted
+			// before once the sink is set
+			if (OS::get_filesystem() && adv.parts() > Type::Resource::WINDOW) {
+				try {
+					char resources_path[Type::Reticulum::FILEPATH_MAXSIZE];
+					snprintf(resources_path, Type::Reticulum::FILEPATH_MAXSIZE, "%s/resources", Reticulum::_cachepath);
+					if (!OS::directory_exists(resources_path)) {
+						OS::create_directory(resources_path);
+					}
+					resource.load_state();
+					resource._object->_persist = true;
+				}
+				catch (std::exception& e) {
+					ERRORF("Could not set up resource transfer state, the contained exception was: %s", e.what());
+				}
+			}
+#endif
+
+			if (link.callbacks()._resource_started != nullptr) {
+				try {
+					link.callbacks()._resource_started(resource);
+				}
+				catch (std::exception& e) {
+					ERRORF("Error while executing resource started callback from %s. The contained exception was: %s", resource.toString().c_str(), e.what());
+				}
+			}
+			resource.hashmap_update(0, adv.hashmap());
+			resource.watchdog_job();
+			return resource;
+		}
+		else {
+			DEBUGF("Ignoring resource advertisement for %s, resource already transferring", resource._object->_hash.toHex().c_str());
+			return {Type::NONE};
+		}
+	}
+	catch (std::exception& e) {
+		DEBUGF("Could not decode resource advertisement, dropping resource. The contained exception was: %s", e.what());
+		return {Type::NONE};
+	}
+}
+
+void Resource::hashmap_update_packet(const Bytes& plaintext) {
+	assert(_object);
+	if (_object->_status != Type::Resource::FAILED) {
+		_object->_last_activity = OS::time();
+		_object->_retries_left = _object->_max_retries;
+
+		//p update = umsgpack.unpackb(plaintext[RNS.Identity.HASHLENGTH//8:])
+		if (plaintext.size() <= Type::Identity::HASHLENGTH/8) {
+			return;
+		}
+		MsgPack::Unpacker unpacker;
+		unpacker.feed(plaintext.data() + Type::Identity::HASHLENGTH/8, plaintext.size() - Type::Identity::HASHLENGTH/8);
+		uint32_t segment = 0;
+		MsgPack::bin_t<uint8_t> hashmap;
+		if (unpacker.from_array(segment, hashmap)) {
+			hashmap_update(segment, Bytes(hashmap));
+		}
+	}
+}
+
+void Resource::hashmap_update(uint32_t segment, const Bytes& hashmap) {
+	assert(_object);
+	if (_object->_status != Type::Resource::FAILED) {
+		_object->_status = Type::Resource::TRANSFERRING;
+		uint32_t seg_len = Type::Resource::ResourceAdvertisement::HASHMAP_MAX_LEN;
+		uint32_t hashes = hashmap.size() / Type::Resource::MAPHASH_LEN;
+		for (uint32_t i = 0; i < hashes; i++) {
+			uint32_t index = i + segment * seg_len;
+			if (index >= _object->_total_parts) {
+				break;
+			}
+			// Segments arrive in order, ones already received are skipped
+			if (index == _object->_hashmap_height) {
+				_object->_hashmap.append(hashmap.data() + i * Type::Resource::MAPHASH_LEN, Type::Resource::MAPHASH_LEN);
+				_object->_hashmap_height = index + 1;
+			}
+		}
+
+		// Map hashes of parts received in sequence are no longer searched.
+		// The last one received is kept for requesting the next segment,
+		// which a resumed transfer does until it reaches its first part.
+		int32_t base = std::min(_object->_consecutive_completed_height, (int32_t)_object->_hashmap_height - 1);
+		if (base > (int32_t)_object->_hashmap_base) {
+			_object->_hashmap = _object->_hashmap.mid((base - _object->_hashmap_base) * Type::Resource::MAPHASH_LEN);
+			_object->_hashmap_base = base;
+		}
+
+		if (_object->_persist) {
+			save_state();
+		}
+
+		_object->_waiting_for_hmu = false;
+		request_next();
+	}
+}
+
+const Bytes Resource::get_map_hash(const Bytes& data) const {
+	assert(_object);
+	return Identity::full_hash(data + _object->_random_hash).left(Type::Resource::MAPHASH_LEN);
+}
+
+/*
+Advertise the resource. If the other end of the link accepts
+the resource advertisement it will begin transferring.
+*/
+void Resource::advertise() {
+	assert(_object);
+	//p thread = threading.Thread(target=self.__advertise_job, daemon=True)
+	//p thread.start()
+	__advertise_job();
+}
+
+void Resource::__advertise_job() {
+	assert(_object);
+	// Links carry one outgoing resource at a time, the watchdog retries a
+	// queued resource until the current one concludes
+	if (!_object->_link.ready_for_new_resource()) {
+		_object->_status = Type::Resource::QUEUED;
+		schedule_watchdog(OS::time() + 0.25);
+		return;
+	}
+
+	try {
+		// The advertisement carries the first segment of the hashmap
+		load_hashmap(0, Type::Resource::ResourceAdvertisement::HASHMAP_MAX_LEN);
+		Packet advertisement_packet(_object->_link, RNS::ResourceAdvertisement(*this).pack(), Type::Packet::DATA, Type::Packet::RESOURCE_ADV);
+		advertisement_packet.send();
+		_object->_last_activity = OS::time();
+		_object->_started_transferring = _object->_last_activity;
+		_object->_adv_sent = _object->_last_activity;
+		_object->_rtt = 0.0;
+		_object->_status = Type::Resource::ADVERTISED;
+		_object->_retries_left = _object->_max_adv_retries;
+		_object->_link.register_outgoing_resource(*this);
+		TRACEF("Sent resource advertisement for %s", _object->_hash.toHex().c_str());
+	}
+	catch (std::exception& e) {
+		ERRORF("Could not advertise resource, the contained exception was: %s", e.what());
+		cancel();
+		return;
+	}
+
+	watchdog_job();
+}
+
+// Expected in-flight rate in bits per second
+void Resource::update_eifr() {
+	assert(_object);
+	double rtt = (_object->_rtt != 0.0) ? _object->_rtt : _object->_link.rtt();
+
+	double expected_inflight_rate = 0.0;
+	if (_object->_req_data_rtt_rate != 0.0) {
+		expected_inflight_rate = _object->_req_data_rtt_rate * 8;
+	}
+	else if (_object->_previous_eifr != 0.0) {
+		expected_inflight_rate = _object->_previous_eifr;
+	}
+	else if (rtt > 0.0) {
+		expected_inflight_rate = _object->_link.establishment_cost() * 8 / rtt;
+	}
+	// Nothing measured yet, assume the slowest links
+	if (expected_inflight_rate <= 0.0) {
+		expected_inflight_rate = Type::Resource::RATE_VERY_SLOW * 8;
+	}
+
+	_object->_eifr = expected_inflight_rate;
+	_object->_link.expected_rate(expected_inflight_rate);
+}
+
+/*
+Supervises the transfer. As with links, a resource keeps one deadline on the
+Transport instance's deadline schedule instead of a thread, and each run of
+__watchdog_job() acts on the transfer state and sets the next deadline.
+*/
+void Resource::watchdog_job() {
+	assert(_object);
+	//p thread = threading.Thread(target=self.__watchdog_job, daemon=True)
+	//p thread.start()
+	schedule_watchdog(OS::time());
+}
+
+// Moves the watchdog to a new deadline, a deadline of 0 stops it
+void Resource::schedule_watchdog(double deadline) {
+	assert(_object);
+	if (_object->_watchdog_deadline > 0.0) {
+		Transport::cancel_deadline(_object->_watchdog_deadline, _object->_watchdog_id);
+	}
+	_object->_watchdog_deadline = deadline;
+	if (deadline > 0.0) {
+		Resource resource(*this);
+		_object->_watchdog_id = Transport::schedule_deadline(deadline, [resource]() mutable { resource.__watchdog_job(); });
+	}
+}
+
+void Resource::__watchdog_job() {
+	assert(_object);
+	// The deadline that ran this job has already been taken off the schedule
+	_object->_watchdog_deadline = 0.0;
+	if (_object->_status >= Type::Resource::ASSEMBLING) {
+		return;
+	}
+	if (_object->_status == Type::Resource::QUEUED) {
+		__advertise_job();
+		return;
+	}
+
+	bool timing = true;
+	double sleep_time = 0.0;
+	if (_object->_status == Type::Resource::ADVERTISED) {
+		sleep_time = (_object->_adv_sent + _object->_timeout + Type::Resource::PROCESSING_GRACE) - OS::time();
+		if (sleep_time < 0) {
+			if (_object->_retries_left <= 0) {
+				DEBUG("Resource transfer timeout after sending advertisement");
+				cancel();
+				sleep_time = 0.001;
+			}
+			else {
+				try {
+					DEBUG("No part requests received, retrying resource advertisement...");
+					_object->_retries_left -= 1;
+					load_hashmap(0, Type::Resource::ResourceAdvertisement::HASHMAP_MAX_LEN);
+					Packet advertisement_packet(_object->_link, RNS::ResourceAdvertisement(*this).pack(), Type::Packet::DATA, Type::Packet::RESOURCE_ADV);
+					advertisement_packet.send();
+					_object->_last_activity = OS::time();
+					_object->_adv_sent = _object->_last_activity;
+					sleep_time = 0.001;
+				}
+				catch (std::exception& e) {
+					VERBOSEF("Could not resend advertisement packet, cancelling resource. The contained exception was: %s", e.what());
+					cancel();
+					sleep_time = 0.001;
+				}
+			}
+		}
+	}
+	else if (_object->_status == Type::Resource::TRANSFERRING) {
+		if (!_object->_initiator) {
+			uint8_t retries_used = _object->_max_retries - _object->_retries_left;
+			double extra_wait = retries_used * Type::Resource::PER_RETRY_DELAY;
+
+			update_eifr();
+			double expected_tof_remaining = (_object->_outstanding_parts * _object->_sdu * 8) / _object->_eifr;
+
+			if (_object->_req_resp_rtt_rate != 0.0) {
+				sleep_time = _object->_last_activity + _object->_part_timeout_factor * expected_tof_remaining + Type::Resource::RETRY_GRACE_TIME + extra_wait - OS::time();
+			}
+			else {
+				sleep_time = _object->_last_activity + _object->_part_timeout_factor * ((3 * _object->_sdu) / _object->_eifr) + Type::Resource::RETRY_GRACE_TIME + extra_wait - OS::time();
+			}
+
+			if (sleep_time < 0) {
+				if (_object->_retries_left > 0) {
+					DEBUGF("Timed out waiting for %u part%s, requesting retry", (unsigned)_object->_outstanding_parts, (_object->_outstanding_parts == 1) ? "" : "s");
+					// Shrink the window on loss
+					if (_object->_window > _object->_window_min) {
+						_object->_window -= 1;
+						if (_object->_window_max > _object->_window_min) {
+							_object->_window_max -= 1;
+							if ((_object->_window_max - _object->_window) > (_object->_window_flexibility - 1)) {
+								_object->_window_max -= 1;
+							}
+						}
+					}
+
+					sleep_time = 0.001;
+					_object->_retries_left -= 1;
+					_object->_waiting_for_hmu = false;
+					request_next();
+				}
+				else {
+					cancel();
+					sleep_time = 0.001;
+				}
+			}
+		}
+		else {
+			double max_extra_wait = 0.0;
+			for (uint8_t r = 0; r < Type::Resource::MAX_RETRIES; r++) {
+				max_extra_wait += (r + 1) * Type::Resource::PER_RETRY_DELAY;
+			}
+			double max_wait = _object->_rtt * _object->_timeout_factor * _object->_max_retries + _object->_sender_grace_time + max_extra_wait;
+			sleep_time = _object->_last_activity + max_wait - OS::time();
+			if (sleep_time < 0) {
+				DEBUG("Resource timed out waiting for part requests");
+				cancel();
+				sleep_time = 0.001;
+			}
+		}
+	}
+	else if (_object->_status == Type::Resource::AWAITING_PROOF) {
+		// Decrease timeout factor since proof packets are
+		// significantly smaller than full req/resp roundtrip
+		_object->_timeout_factor = Type::Resource::PROOF_TIMEOUT_FACTOR;
+
+		sleep_time = _object->_last_part_sent + (_object->_rtt * _object->_timeout_factor + _object->_sender_grace_time) - OS::time();
+		if (sleep_time < 0) {
+			if (_object->_retries_left <= 0) {
+				DEBUG("Resource timed out waiting for proof");
+				cancel();
+				sleep_time = 0.001;
+			}
+			else {
+				DEBUG("All parts sent, but no resource proof received, querying network cache...");
+				_object->_retries_left -= 1;
+				Packet expected_proof_packet(_object->_link, _object->_hash + _object->_expected_proof, Type::Packet::PROOF, Type::Packet::RESOURCE_PRF);
+				expected_proof_packet.pack();
+				Transport::cache_request(expected_proof_packet.get_hash(), _object->_link);
+				_object->_last_part_sent = OS::time();
+				sleep_time = 0.001;
+			}
+		}
+	}
+	else {
+		timing = false;
+	}
+
+	if (!timing || sleep_time < 0) {
+		ERROR("Timing error, cancelling resource transfer.");
+		cancel();
+	}
+
+	if (_object->_status < Type::Resource::ASSEMBLING) {
+		if (sleep_time > Type::Resource::WATCHDOG_MAX_SLEEP) {
+			sleep_time = Type::Resource::WATCHDOG_MAX_SLEEP;
+		}
+		schedule_watchdog(OS::time() + sleep_time);
+	}
+}
+
+/*
+Assembles the received parts, checks the result against the resource hash
+and proves it to the sender if valid.
+*/
+void Resource::assemble() {
+	assert(_object);
+	if (_object->_status != Type::Resource::FAILED) {
+		_object->_status = Type::Resource::ASSEMBLING;
+		if (_object->_sink) {
+			assemble_sink();
+			concluded();
+			return;
+		}
+
+		try {
+			size_t stream_size = 0;
+			for (auto& entry : _object->_parts) {
+				stream_size += entry.second.size();
+			}
+			Bytes stream(stream_size);
+			for (auto& entry : _object->_parts) {
+				stream << entry.second;
+			}
+			// Parts are no longer needed once joined
+			_object->_parts.clear();
+
+			Bytes data;
+			if (_object->_encrypted) {
+				data = _object->_link.decrypt(stream);
+			}
+			else {
+				data = stream;
+			}
+
+			// Strip off random hash
+			Bytes segment_data(data.mid(Type::Resource::RANDOM_HASH_SIZE));
+
+			if (_object->_compressed) {
+				if (!_codec) {
+					throw std::invalid_argument("No codec to decompress resource");
+				}
+				_object->_compressed_size = segment_data.size();
+				std::unique_ptr<Decompressor> decompressor(_codec->decompressor(_object->_total_size));
+				Bytes decompressed(decompressor->update(segment_data));
+				decompressed << decompressor->finalize();
+				segment_data = decompressed;
+			}
+
+			const Bytes calculated_hash(Identity::full_hash(segment_data + _object->_random_hash));
+			if (calculated_hash == _object->_hash) {
+				_object->_expected_proof = Identity::full_hash(segment_data + _object->_hash);
+				if (_object->_has_metadata) {
+					if (segment_data.size() < 3 || segment_data.size() < 3 + metadata_size(segment_data.data())) {
+						throw std::invalid_argument("Resource metadata is truncated");
+					}
+					size_t size = metadata_size(segment_data.data());
+					_object->_metadata = segment_data.mid(3, size);
+					segment_data = segment_data.mid(3 + size);
+				}
+				// Segments of a split resource are joined as they arrive
+				if (_object->_data) {
+					_object->_data << segment_data;
+				}
+				else {
+					_object->_data = segment_data;
+				}
+				_object->_status = Type::Resource::COMPLETE;
+				prove();
+			}
+			else {
+				_object->_status = Type::Resource::CORRUPT;
+			}
+		}
+		catch (std::exception& e) {
+			ERRORF("Error while assembling received resource. The contained exception was: %s", e.what());
+			_object->_status = Type::Resource::CORRUPT;
+		}
+
+		concluded();
+	}
+}
+
+/*
+Finishes spooling a resource received to a sink and checks its hash, then
+writes the data out to the sink. The sink is left untouched if the data does
+not match.
+*/
+void Resource::assemble_sink() {
+	assert(_object);
+	try {
+		write_parts();
+		if (_object->_decryptor) {
+			write_data(_object->_decryptor->finalize());
+		}
+		_object->_sink_spool.flush();
+		_object->_sink_spool.close();
+		_object->_sink_spool.clear();
+
+		std::unique_ptr<Cryptography::Provider::Sha256> data_hash(Cryptography::Provider::sha256_stream());
+		unspool(data_hash.get());
+		uint8_t hash[Type::Identity::HASHLENGTH/8];
+		std::unique_ptr<Cryptography::Provider::Sha256> resource_hash(data_hash->clone());
+		resource_hash->update(_object->_random_hash.data(), _object->_random_hash.size());
+		resource_hash->finalize(hash);
+		if (_object->_hash == Bytes(hash, sizeof(hash)) && !_object->_metadata_pending) {
+			// The proof is hashed over the data as well, which is no longer in memory
+			data_hash->update(_object->_hash.data(), _object->_hash.size());
+			data_hash->finalize(hash);
+			_object->_expected_proof.assign(hash, sizeof(hash));
+			unspool(nullptr);
+			_object->_sink.flush();
+			_object->_status = Type::Resource::COMPLETE;
+			prove();
+		}
+		else {
+			_object->_status = Type::Resource::CORRUPT;
+		}
+	}
+	catch (std::exception& e) {
+		ERRORF("Error while writing received resource. The contained exception was: %s", e.what());
+		_object->_status = Type::Resource::CORRUPT;
+	}
+}
+
+void Resource::prove() {
+	assert(_object);
+	if (_object->_status != Type::Resource::FAILED) {
+		try {
+			const Bytes proof(_object->_expected_proof ? _object->_expected_proof : Identity::full_hash(_object->_data + _object->_hash));
+			const Bytes proof_data(_object->_hash + proof);
+			Packet proof_packet(_object->_link, proof_data, Type::Packet::PROOF, Type::Packet::RESOURCE_PRF);
+			proof_packet.send();
+			Transport::cache_packet(proof_packet, true);
+		}
+		catch (std::exception& e) {
+			DEBUG("Could not send proof packet, cancelling resource");
+			DEBUGF("The contained exception was: %s", e.what());
+			cancel();
+		}
+	}
+}
+
+void Resource::validate_proof(const Bytes& proof_data) {
+	assert(_object);
+	if (_object->_status != Type::Resource::FAILED) {
+		if (proof_data.size() == Type::Identity::HASHLENGTH/8*2) {
+			if (proof_data.mid(Type::Identity::HASHLENGTH/8) == _object->_expected_proof) {
+				_object->_status = Type::Resource::COMPLETE;
+				schedule_watchdog(0.0);
+				concluded();
+			}
+		}
+	}
+}
+
+void Resource::receive_part(const Packet& packet) {
+	assert(_object);
+	//p with self.receive_lock:
+	_object->_last_activity = OS::time();
+	_object->_retries_left = _object->_max_retries;
+
+	// First part in response to a request measures the round trip
+	if (_object->_req_resp == 0.0) {
+		_object->_req_resp = _object->_last_activity;
+		double rtt = _object->_req_resp - _object->_req_sent;
+
+		_object->_part_timeout_factor = Type::Resource::PART_TIMEOUT_FACTOR_AFTER_RTT;
+		if (_object->_rtt == 0.0) {
+			_object->_rtt = _object->_link.rtt();
+			watchdog_job();
+		}
+		else if (rtt < _object->_rtt) {
+			_object->_rtt = std::max(_object->_rtt - _object->_rtt * 0.05, rtt);
+		}
+		else if (rtt > _object->_rtt) {
+			_object->_rtt = std::min(_object->_rtt + _object->_rtt * 0.05, rtt);
+		}
+
+		if (rtt > 0) {
+			size_t req_resp_cost = packet.raw().size() + _object->_req_sent_bytes;
+			_object->_req_resp_rtt_rate = req_resp_cost / rtt;
+
+			if (_object->_req_resp_rtt_rate > Type::Resource::RATE_FAST && _object->_fast_rate_rounds < Type::Resource::FAST_RATE_THRESHOLD) {
+				_object->_fast_rate_rounds += 1;
+
+				if (_object->_fast_rate_rounds == Type::Resource::FAST_RATE_THRESHOLD) {
+					_object->_window_max = Type::Resource::WINDOW_MAX_FAST;
+				}
+			}
+		}
+	}
+
+	if (_object->_status != Type::Resource::FAILED) {
+		_object->_status = Type::Resource::TRANSFERRING;
+		const Bytes& part_data = packet.data();
+		const Bytes part_hash(get_map_hash(part_data));
+
+		// Only the current window past the last consecutive part is searched
+		uint32_t consecutive_index = (_object->_consecutive_completed_height >= 0) ? _object->_consecutive_completed_height : 0;
+		uint32_t search_end = consecutive_index + _object->_window;
+		if (search_end > _object->_hashmap_height) {
+			search_end = _object->_hashmap_height;
+		}
+		for (uint32_t i = consecutive_index; i < search_end; i++) {
+			if (memcmp(hashmap_entry(i), part_hash.data(), Type::Resource::MAPHASH_LEN) == 0) {
+				if (_object->_parts.count(i) == 0 && i >= _object->_written_parts) {
+
+					// Insert data into parts list
+					_object->_parts[i] = part_data;
+					_object->_rtt_rxd_bytes += part_data.size();
+					// All parts but the last are of one size, which a resumed
+					// transfer finds its first part by
+					if (_object->_persist && _object->_part_size == 0 && i + 1 < _object->_total_parts) {
+						_object->_part_size = part_data.size();
+						save_state();
+					}
+					_object->_received_count += 1;
+					if (_object->_outstanding_parts > 0) {
+						_object->_outstanding_parts -= 1;
+					}
+
+					// Update consecutive completed pointer
+					if ((int32_t)i == _object->_consecutive_completed_height + 1) {
+						_object->_consecutive_completed_height = i;
+					}
+
+					uint32_t cp = _object->_consecutive_completed_height + 1;
+					while (cp < _object->_total_parts && _object->_parts.count(cp) > 0) {
+						_object->_consecutive_completed_height = cp;
+						cp += 1;
+					}
+
+					progress();
+				}
+			}
+		}
+
+		// Parts received in sequence go straight to the sink
+		if (_object->_sink && _object->_received_count < _object->_total_parts) {
+			try {
+				write_parts();
+				// What a round brought in is on storage before the next is requested
+				if (_object->_persist && _object->_outstanding_parts == 0) {
+					_object->_sink_spool.flush();
+				}
+			}
+			catch (std::exception& e) {
+				ERRORF("Error while writing received resource, cancelling transfer. The contained exception was: %s", e.what());
+				cancel();
+				return;
+			}
+		}
+
+		if (_object->_received_count == _object->_total_parts && !_object->_assembly_lock) {
+			_object->_assembly_lock = true;
+			assemble();
+		}
+		else if (_object->_outstanding_parts == 0) {
+			// Grow the window after each fully delivered round
+			if (_object->_window < _object->_window_max) {
+				_object->_window += 1;
+				if ((_object->_window - _object->_window_min) > (_object->_window_flexibility - 1)) {
+					_object->_window_min += 1;
+				}
+			}
+
+			if (_object->_req_sent != 0.0) {
+				double rtt = OS::time() - _object->_req_sent;
+				size_t req_transferred = _object->_rtt_rxd_bytes - _object->_rtt_rxd_bytes_at_part_req;
+
+				if (rtt != 0.0) {
+					_object->_req_data_rtt_rate = req_transferred / rtt;
+					update_eifr();
+					_object->_rtt_rxd_bytes_at_part_req = _object->_rtt_rxd_bytes;
+
+					if (_object->_req_data_rtt_rate > Type::Resource::RATE_FAST && _object->_fast_rate_rounds < Type::Resource::FAST_RATE_THRESHOLD) {
+						_object->_fast_rate_rounds += 1;
+
+						if (_object->_fast_rate_rounds == Type::Resource::FAST_RATE_THRESHOLD) {
+							_object->_window_max = Type::Resource::WINDOW_MAX_FAST;
+						}
+					}
+
+					if (_object->_fast_rate_rounds == 0 && _object->_req_data_rtt_rate < Type::Resource::RATE_VERY_SLOW && _object->_very_slow_rate_rounds < Type::Resource::VERY_SLOW_RATE_THRESHOLD) {
+						_object->_very_slow_rate_rounds += 1;
+
+						if (_object->_very_slow_rate_rounds == Type::Resource::VERY_SLOW_RATE_THRESHOLD) {
+							_object->_window_max = Type::Resource::WINDOW_MAX_VERY_SLOW;
+						}
+					}
+				}
+			}
+
+			request_next();
+		}
+	}
+}
+
+// Called on incoming resource to send a request for more data
+void Resource::request_next() {
+	assert(_object);
+	if (_object->_status != Type::Resource::FAILED) {
+		if (!_object->_waiting_for_hmu) {
+			_object->_outstanding_parts = 0;
+			uint8_t hashmap_exhausted = Type::Resource::HASHMAP_IS_NOT_EXHAUSTED;
+			Bytes requested_hashes(_object->_window * Type::Resource::MAPHASH_LEN);
+
+			uint32_t i = 0;
+			uint32_t pn = _object->_consecutive_completed_height + 1;
+			uint32_t search_end = pn + _object->_window;
+			if (search_end > _object->_total_parts) {
+				search_end = _object->_total_parts;
+			}
+
+			while (pn < search_end) {
+				if (_object->_parts.count(pn) == 0) {
+					if (pn < _object->_hashmap_height) {
+						requested_hashes.append(hashmap_entry(pn), Type::Resource::MAPHASH_LEN);
+						_object->_outstanding_parts += 1;
+						i += 1;
+					}
+					else {
+						hashmap_exhausted = Type::Resource::HASHMAP_IS_EXHAUSTED;
+					}
+				}
+
+				pn += 1;
+				if (i >= _object->_window || hashmap_exhausted == Type::Resource::HASHMAP_IS_EXHAUSTED) {
+					break;
+				}
+			}
+
+			Bytes request_data;
+			request_data.append(hashmap_exhausted);
+			if (hashmap_exhausted == Type::Resource::HASHMAP_IS_EXHAUSTED && _object->_hashmap_height > 0) {
+				request_data.append(hashmap_entry(_object->_hashmap_height - 1), Type::Resource::MAPHASH_LEN);
+				_object->_waiting_for_hmu = true;
+			}
+			request_data << _object->_hash;
+			request_data << requested_hashes;
+
+			try {
+				Packet request_packet(_object->_link, request_data, Type::Packet::DATA, Type::Packet::RESOURCE_REQ);
+				request_packet.send();
+				_object->_last_activity = OS::time();
+				_object->_req_sent = _object->_last_activity;
+				_object->_req_sent_bytes = request_packet.raw().size();
+				_object->_req_resp = 0.0;
+			}
+			catch (std::exception& e) {
+				DEBUG("Could not send resource request packet, cancelling resource");
+				DEBUGF("The contained exception was: %s", e.what());
+				cancel();
+			}
+		}
+	}
+}
+
+// Called on outgoing resource to make it send more data
+void Resource::request(const Bytes& request_data) {
+	assert(_object);
+	if (_object->_status != Type::Resource::FAILED) {
+		double rtt = OS::time() - _object->_adv_sent;
+		if (_object->_rtt == 0.0) {
+			_object->_rtt = rtt;
+		}
+
+		if (_object->_status != Type::Resource::TRANSFERRING) {
+			_object->_status = Type::Resource::TRANSFERRING;
+			watchdog_job();
+		}
+
+		_object->_retries_left = _object->_max_retries;
+
+		if (request_data.size() < 1) {
+			return;
+		}
+		bool wants_more_hashmap = (request_data[0] == Type::Resource::HASHMAP_IS_EXHAUSTED);
+		size_t pad = wants_more_hashmap ? 1 + Type::Resource::MAPHASH_LEN : 1;
+		size_t hashes_offset = pad + Type::Identity::HASHLENGTH/8;
+		size_t requested_count = (request_data.size() > hashes_offset) ? (request_data.size() - hashes_offset) / Type::Resource::MAPHASH_LEN : 0;
+		const uint8_t* requested_hashes = request_data.data() + hashes_offset;
+
+		// Define the search scope
+		uint32_t search_start = _object->_receiver_min_consecutive_height;
+		uint32_t search_end = search_start + Type::Resource::ResourceAdvertisement::COLLISION_GUARD_SIZE;
+		if (search_end > _object->_total_parts) {
+			search_end = _object->_total_parts;
+		}
+		try {
+			load_hashmap(search_start, search_end);
+		}
+		catch (std::exception& e) {
+			ERRORF("Could not read resource hashmap, cancelling transfer. The contained exception was: %s", e.what());
+			cancel();
+			return;
+		}
+
+		// A receiver resuming an interrupted transfer asks for parts, or for
+		// the hashmap, past the search scope. The scope then moves to where
+		// the first requested hash is found further on in the hashmap.
+		const uint8_t* anchor_hash = (requested_count > 0) ? requested_hashes : (wants_more_hashmap ? request_data.data() + 1 : nullptr);
+		if (anchor_hash != nullptr) {
+			bool in_scope = false;
+			for (uint32_t index = search_start; index < search_end && !in_scope; index++) {
+				in_scope = (memcmp(hashmap_entry(index), anchor_hash, Type::Resource::MAPHASH_LEN) == 0);
+			}
+			try {
+				// A spooled hashmap is searched one scope at a time
+				for (uint32_t scope_start = search_end; scope_start < _object->_total_parts && !in_scope; scope_start += Type::Resource::ResourceAdvertisement::COLLISION_GUARD_SIZE) {
+					load_hashmap(scope_start, scope_start + Type::Resource::ResourceAdvertisement::COLLISION_GUARD_SIZE);
+					uint32_t scope_end = std::min<uint32_t>(scope_start + Type::Resource::ResourceAdvertisement::COLLISION_GUARD_SIZE, _object->_total_parts);
+					for (uint32_t index = scope_start; index < scope_end && !in_scope; index++) {
+						if (memcmp(hashmap_entry(index), anchor_hash, Type::Resource::MAPHASH_LEN) == 0) {
+							in_scope = true;
+							_object->_receiver_min_consecutive_height = index;
+							search_start = index;
+							search_end = search_start + Type::Resource::ResourceAdvertisement::COLLISION_GUARD_SIZE;
+							if (search_end > _object->_total_parts) {
+								search_end = _object->_total_parts;
+							}
+						}
+					}
+				}
+				load_hashmap(search_start, search_end);
+			}
+			catch (std::exception& e) {
+				ERRORF("Could not read resource hashmap, cancelling transfer. The contained exception was: %s", e.what());
+				cancel();
+				return;
+			}
+		}
+
+		std::vector<uint32_t> requested_indexes;
+		for (uint32_t index = search_start; index < search_end; index++) {
+			const uint8_t* map_hash = hashmap_entry(index);
+			for (size_t i = 0; i < requested_count; i++) {
+				if (memcmp(requested_hashes + i * Type::Resource::MAPHASH_LEN, map_hash, Type::Resource::MAPHASH_LEN) == 0) {
+					requested_indexes.push_back(index);
+					break;
+				}
+			}
+		}
+
+		// The receiver requests from its first missing part on, so parts
+		// below the first one requested have arrived and can be released
+		if (_object->_spool && !requested_indexes.empty()) {
+			_object->_parts.erase(_object->_parts.begin(), _object->_parts.lower_bound(requested_indexes.front()));
+		}
+
+		for (uint32_t index : requested_indexes) {
+			try {
+				const Bytes part_data(get_part(index));
+				if (!part_data) {
+					// Already released, a late duplicate of an earlier request
+					continue;
+				}
+				Packet part(_object->_link, part_data, Type::Packet::DATA, Type::Packet::RESOURCE);
+				part.send();
+				if (!_object->_parts_sent[index]) {
+					_object->_parts_sent[index] = true;
+					_object->_sent_parts += 1;
+				}
+
+				_object->_last_activity = OS::time();
+				_object->_last_part_sent = _object->_last_activity;
+			}
+			catch (std::exception& e) {
+				DEBUG("Resource could not send parts, cancelling transfer!");
+				DEBUGF("The contained exception was: %s", e.what());
+				cancel();
+			}
+		}
+
+		if (wants_more_hashmap) {
+			const uint8_t* last_map_hash = request_data.data() + 1;
+
+			uint32_t part_index = _object->_receiver_min_consecutive_height;
+			for (uint32_t index = search_start; index < search_end; index++) {
+				part_index += 1;
+				if (memcmp(hashmap_entry(index), last_map_hash, Type::Resource::MAPHASH_LEN) == 0) {
+					break;
+				}
+			}
+
+			//p self.receiver_min_consecutive_height = max(part_index-1-Resource.WINDOW_MAX, 0)
+			_object->_receiver_min_consecutive_height = (part_index > 1 + Type::Resource::WINDOW_MAX) ? part_index - 1 - Type::Resource::WINDOW_MAX : 0;
+
+			if (part_index % Type::Resource::ResourceAdvertisement::HASHMAP_MAX_LEN != 0) {
+				ERROR("Resource sequencing error, cancelling transfer!");
+				cancel();
+				return;
+			}
+			uint32_t segment = part_index / Type::Resource::ResourceAdvertisement::HASHMAP_MAX_LEN;
+
+			uint32_t hashmap_start = segment * Type::Resource::ResourceAdvertisement::HASHMAP_MAX_LEN;
+			uint32_t hashmap_end = (segment + 1) * Type::Resource::ResourceAdvertisement::HASHMAP_MAX_LEN;
+			if (hashmap_end > _object->_total_parts) {
+				hashmap_end = _object->_total_parts;
+			}
+			Bytes hashmap;
+			if (hashmap_end > hashmap_start) {
+				try {
+					load_hashmap(hashmap_start, hashmap_end);
+				}
+				catch (std::exception& e) {
+					ERRORF("Could not read resource hashmap, cancelling transfer. The contained exception was: %s", e.what());
+					cancel();
+					return;
+				}
+				hashmap.assign(hashmap_entry(hashmap_start), (hashmap_end - hashmap_start) * Type::Resource::MAPHASH_LEN);
+			}
+
+			//p hmu = self.hash+umsgpack.packb([segment, hashmap])
+			MsgPack::Packer packer;
+			packer.to_array(segment, hashmap);
+			Bytes hmu(_object->_hash);
+			hmu.append(packer.data(), packer.size());
+
+			try {
+				Packet hmu_packet(_object->_link, hmu, Type::Packet::DATA, Type::Packet::RESOURCE_HMU);
+				hmu_packet.send();
+				_object->_last_activity = OS::time();
+			}
+			catch (std::exception& e) {
+				DEBUG("Could not send resource HMU packet, cancelling resource");
+				DEBUGF("The contained exception was: %s", e.what());
+				cancel();
+			}
+		}
+
+		if (_object->_sent_parts == _object->_total_parts) {
+			_object->_status = Type::Resource::AWAITING_PROOF;
+			_object->_retries_left = 3;
+		}
+
+		progress();
+	}
+}
+
+/*
+Cancels transferring the resource.
+*/
+void Resource::cancel() {
+	assert(_object);
+	if (_object->_status < Type::Resource::COMPLETE) {
+		_object->_status = Type::Resource::FAILED;
+		schedule_watchdog(0.0);
+		if (_object->_initiator) {
+			if (_object->_link.status() == Type::Link::ACTIVE) {
+				try {
+					Packet cancel_packet(_object->_link, _object->_hash, Type::Packet::DATA, Type::Packet::RESOURCE_ICL);
+					cancel_packet.send();
+				}
+				catch (std::exception& e) {
+					ERRORF("Could not send resource cancel packet, the contained exception was: %s", e.what());
+				}
+			}
+			_object->_link.cancel_outgoing_resource(*this);
+		}
+		else {
+			_object->_link.cancel_incoming_resource(*this);
+		}
+
+		concluded();
+	}
+}
+
+/*
+Advertises an outgoing resource again on another link to the same
+destination, after the link it was sent on has closed. The stream is
+encrypted again for the new link under the same random hash, so a receiver
+that kept the state of the transfer recognises it and requests only the
+parts it is still missing. This takes the same resource object, the state
+of the sending side is not kept past it.
+*/
+void Resource::resume(const Link& link) {
+	assert(_object);
+	if (!_object->_initiator) {
+		throw std::logic_error("Only outgoing resources can be resumed");
+	}
+	if (_object->_status != Type::Resource::FAILED) {
+		throw std::logic_error("Only interrupted resources can be resumed");
+	}
+	if (!_object->_data && _object->_spool_path.empty()) {
+		throw std::logic_error("Resource data is no longer available");
+	}
+	// Parts were cut for the link the transfer started on
+	if (link_sdu(link) < _object->_sdu) {
+		throw std::invalid_argument("Link MTU is too small for the resource parts");
+	}
+
+	Link new_link(link);
+	reencrypt(new_link);
+	if (!_object->_spool_path.empty()) {
+		_object->_parts.clear();
+		_object->_spooled_parts = 0;
+		_object->_spool = OS::open_file(_object->_spool_path.c_str(), FileStream::MODE_READ);
+		if (!_object->_spool) {
+			throw std::runtime_error("Could not open resource spool file");
+		}
+	}
+
+	_object->_link = link;
+	_object->_status = Type::Resource::NONE;
+	_object->_timeout_factor = link.traffic_timeout_factor();
+	_object->_timeout = link.rtt() * link.traffic_timeout_factor();
+	_object->_sent_parts = 0;
+	_object->_parts_sent.assign(_object->_total_parts, false);
+	_object->_receiver_min_consecutive_height = 0;
+	_object->_rtt = 0.0;
+	_object->_retries_left = _object->_max_retries;
+	advertise();
+}
+
+/*
+Encrypts the stream again for link, keeping its random prefix and the random
+hash. The parts are mapped anew, and should a map hash collide the stream is
+encrypted once more, as the random hash cannot change.
+*/
+void Resource::reencrypt(Link& link) {
+	assert(_object);
+	Cryptography::TokenDecryptor::Ptr decryptor(_object->_stream_decryptor);
+	bool hashmap_ok = false;
+	while (!hashmap_ok) {
+		if (_object->_spool_path.empty()) {
+			Bytes stream(decryptor->update(_object->_data));
+			stream << decryptor->finalize();
+			_object->_data = link.encrypt(stream);
+		}
+		else {
+			FileStream spool = OS::open_file(_object->_spool_path.c_str(), FileStream::MODE_READ);
+			if (!spool) {
+				throw std::runtime_error("Could not open resource spool file");
+			}
+			SpoolWriter respool(link, false);
+			try {
+				Bytes chunk;
+				while ((chunk = read_stream(spool, Type::Resource::SPOOL_CHUNK_SIZE))) {
+					respool.write(decryptor->update(chunk));
+				}
+				respool.write(decryptor->finalize());
+				respool.finalize();
+			}
+			catch (std::exception& e) {
+				spool.close();
+				respool.discard();
+				throw;
+			}
+			spool.close();
+			OS::remove_file(_object->_spool_path.c_str());
+			_object->_spool_path = respool.path();
+		}
+		decryptor = link.decryptor();
+		hashmap_ok = map_parts();
+	}
+	_object->_stream_decryptor = link.decryptor();
+}
 
-using namespace RNS;
-using namespace RNS::Type::Resource;
-using namespace RNS::Utilities;
+/*
+:returns: The current progress of the resource transfer as a *float* between 0.0 and 1.0.
+*/
+float Resource::get_progress() const {
+	assert(_object);
+	if (_object->_status == Type::Resource::COMPLETE && _object->_segment_index == _object->_total_segments) {
+		return 1.0;
+	}
+	if (_object->_total_parts == 0) {
+		return 0.0;
+	}
+	uint32_t processed_parts;
+	if (_object->_initiator) {
+		processed_parts = _object->_sent_parts;
+	}
+	else {
+		processed_parts = _object->_received_count;
+	}
+	float progress;
+	if (_object->_split) {
+		// Segments before this one count as complete, and this one as full
+		// sized, so the progress of a split resource does not jump back
+		float max_parts_per_segment = ceil((float)Type::Resource::MAX_EFFICIENT_SIZE / (float)_object->_sdu);
+		float previously_processed_parts = (_object->_segment_index - 1) * max_parts_per_segment;
+		float current_segment_factor = 1.0;
+		if (_object->_total_parts < max_parts_per_segment) {
+			current_segment_factor = max_parts_per_segment / _object->_total_parts;
+		}
+		progress = (previously_processed_parts + processed_parts * current_segment_factor) / (max_parts_per_segment * _object->_total_segments);
+	}
+	else {
+		progress = (float)processed_parts / (float)_object->_total_parts;
+	}
+	return (progress > 1.0) ? 1.0 : progress;
+}
 
-//Resource::Resource(const Link& link /*= {Type::NONE}*/) :
-//	_object(new ResourceData(link))
-//{
-//	assert(_object);
-//	MEM("Resource object created");
-//}
+// :returns: The number of bytes needed to transfer the resource.
+size_t Resource::get_transfer_size() const {
+	assert(_object);
+	return _object->_size;
+}
 
-Resource::Resource(const Bytes& data, const Link& link, const Bytes& request_id, bool is_response, double timeout) :
-	_object(new ResourceData(link))
-{
+// :returns: The total data size of the resource.
+size_t Resource::get_data_size() const {
 	assert(_object);
-	MEM("Resource object created");
+	return _object->_total_size;
 }
 
-Resource::Resource(const Bytes& data, const Link& link, bool advertise /*= true*/, bool auto_compress /*= true*/, Callbacks::concluded callback /*= nullptr*/, Callbacks::progress progress_callback /*= nullptr*/, double timeout /*= 0.0*/, int segment_index /*= 1*/, const Bytes& original_hash /*= {Type::NONE}*/, const Bytes& request_id /*= {Type::NONE}*/, bool is_response /*= false*/) :
-	_object(new ResourceData(link))
-{
+// :returns: The number of parts the resource will be transferred in.
+uint32_t Resource::get_parts() const {
 	assert(_object);
-	MEM("Resource object created");
+	return _object->_total_parts;
 }
 
+// :returns: The number of segments the resource is divided into.
+int Resource::get_segments() const {
+	assert(_object);
+	return _object->_total_segments;
+}
 
-void Resource::validate_proof(const Bytes& proof_data) {
+// :returns: The hash of the resource.
+const Bytes& Resource::get_hash() const {
+	assert(_object);
+	return _object->_hash;
 }
 
-void Resource::cancel() {
+// :returns: Whether the resource is compressed.
+bool Resource::is_compressed() const {
+	assert(_object);
+	return _object->_compressed;
+}
+
+// :returns: The compressed size of the data as a fraction of its size, 1.0 if not compressed.
+float Resource::get_compression_ratio() const {
+	assert(_object);
+	if (!_object->_compressed || _object->_uncompressed_size == 0 || _object->_compressed_size == 0) {
+		return 1.0;
+	}
+	return (float)_object->_compressed_size / (float)_object->_uncompressed_size;
+}
+
+void Resource::set_concluded_callback(Callbacks::concluded callback) {
+	assert(_object);
+	_object->_callbacks._concluded = callback;
+}
+
+void Resource::set_progress_callback(Callbacks::progress callback) {
+	assert(_object);
+	_object->_callbacks._progress = callback;
+}
+
+void Resource::set_data_sink(const FileStream& sink) {
+	assert(_object);
+	if (_object->_sink_spool) {
+		_object->_sink_spool.close();
+		_object->_sink_spool.clear();
+	}
+	if (!_object->_sink_spool_path.empty()) {
+		OS::remove_file(_object->_sink_spool_path.c_str());
+		_object->_sink_spool_path.clear();
+	}
+	if (!_object->_resume_path.empty()) {
+		resume_spool();
+	}
+	else {
+		_object->_sink_spool_path = cache_file_path(".sink");
+		_object->_sink_spool = OS::open_file(_object->_sink_spool_path.c_str(), FileStream::MODE_WRITE);
+		if (!_object->_sink_spool) {
+			throw std::runtime_error("Could not create resource sink spool file");
+		}
+	}
+	_object->_sink = sink;
+	if (_object->_encrypted && !_object->_resumed) {
+		_object->_decryptor = _object->_link.decryptor();
+	}
+	// Metadata is read off the start of the stream rather than written to the sink
+	if (_object->_has_metadata) {
+		_object->_metadata.clear();
+		_object->_metadata_pending = true;
+	}
+}
+
+// Part of the encrypted stream, NONE if a spooled resource has released it
+const Bytes Resource::get_part(uint32_t index) {
+	assert(_object);
+	if (!_object->_spool) {
+		// Parts are cut from the encrypted stream as they are sent
+		return _object->_data.mid(index * _object->_sdu, _object->_sdu);
+	}
+	// The spool is read in sequence, parts read ahead of the one asked for
+	// are held until requested
+	while (_object->_spooled_parts <= index) {
+		const Bytes part(read_stream(_object->_spool, _object->_sdu));
+		if (!part) {
+			throw std::runtime_error("Resource spool file is truncated");
+		}
+		_object->_parts[_object->_spooled_parts] = part;
+		_object->_spooled_parts += 1;
+	}
+	auto iter = _object->_parts.find(index);
+	if (iter == _object->_parts.end()) {
+		return {Bytes::NONE};
+	}
+	return iter->second;
+}
+
+// Decrypts and writes the parts received in sequence so far to the sink
+void Resource::write_parts() {
+	assert(_object);
+	auto iter = _object->_parts.begin();
+	while (iter != _object->_parts.end() && iter->first == _object->_written_parts) {
+		const Bytes stream(_object->_resumed ? resume_stream(iter->second) : iter->second);
+		if (_object->_decryptor) {
+			write_data(_object->_decryptor->update(stream));
+		}
+		else if (!_object->_resumed) {
+			write_data(stream);
+		}
+		iter = _object->_parts.erase(iter);
+		_object->_written_parts += 1;
+	}
+}
+
+void Resource::write_data(const Bytes& plaintext) {
+	assert(_object);
+	size_t offset = 0;
+	// Strip off random hash
+	if (_object->_prefix_left > 0) {
+		offset = (plaintext.size() < _object->_prefix_left) ? plaintext.size() : _object->_prefix_left;
+		_object->_prefix_left -= offset;
+	}
+	// Decrypted again on resuming, the spool holds it already
+	if (_object->_resume_overlap > 0) {
+		size_t overlap = std::min(_object->_resume_overlap, plaintext.size() - offset);
+		_object->_resume_overlap -= overlap;
+		offset += overlap;
+	}
+	if (offset == plaintext.size()) {
+		return;
+	}
+	const Bytes data((offset > 0) ? plaintext.mid(offset) : plaintext);
+	if (_object->_compressed) {
+		_object->_compressed_size += data.size();
+	}
+	write_stream(_object->_sink_spool, data);
 }
 
 /*
-:returns: The current progress of the resource transfer as a *float* between 0.0 and 1.0.
+Reads the spooled stream back, decompressing it if need be. The first pass
+hashes the data and reads the metadata off its start, the second, with no
+hash given, writes the data after the metadata to the sink.
 */
-float Resource::get_progress() const {
+void Resource::unspool(Cryptography::Provider::Sha256* data_hash) {
+	assert(_object);
+	FileStream spool = OS::open_file(_object->_sink_spool_path.c_str(), FileStream::MODE_READ);
+	if (!spool) {
+		throw std::runtime_error("Could not open resource sink spool file");
+	}
+	std::unique_ptr<Decompressor> decompressor;
+	if (_object->_compressed) {
+		if (!_codec) {
+			spool.close();
+			throw std::invalid_argument("No codec to decompress resource");
+		}
+		decompressor = _codec->decompressor(_object->_total_size);
+	}
+	size_t skip = (data_hash == nullptr && _object->_has_metadata) ? 3 + _object->_metadata.size() : 0;
+	try {
+		bool spooled = true;
+		while (spooled) {
+			const Bytes chunk(read_stream(spool, Type::Resource::SPOOL_CHUNK_SIZE));
+			spooled = chunk;
+			Bytes data(chunk);
+			if (decompressor) {
+				data = spooled ? decompressor->update(chunk) : decompressor->finalize();
+			}
+			if (data.size() == 0) {
+				continue;
+			}
+			if (data_hash != nullptr) {
+				data_hash->update(data.data(), data.size());
+				if (_object->_metadata_pending) {
+					read_metadata(data);
+				}
+			}
+			else {
+				size_t offset = std::min(skip, data.size());
+				skip -= offset;
+				if (offset < data.size() && _object->_sink.write(data.data() + offset, data.size() - offset) != data.size() - offset) {
+					throw std::runtime_error("Could not write resource data to sink");
+				}
+			}
+		}
+	}
+	catch (std::exception& e) {
+		spool.close();
+		throw;
+	}
+	spool.close();
+}
+
+// Takes the metadata off the start of the stream, returns the number of bytes taken
+size_t Resource::read_metadata(const Bytes& data) {
+	assert(_object);
+	size_t offset = 0;
+	while (_object->_metadata_pending && offset < data.size()) {
+		// The size in three bytes, then the metadata
+		size_t wanted = 3;
+		if (_object->_metadata.size() >= 3) {
+			wanted += metadata_size(_object->_metadata.data());
+		}
+		size_t take = std::min(wanted - _object->_metadata.size(), data.size() - offset);
+		_object->_metadata.append(data.data() + offset, take);
+		offset += take;
+		if (_object->_metadata.size() >= 3 && _object->_metadata.size() == 3 + metadata_size(_object->_metadata.data())) {
+			_object->_metadata = _object->_metadata.mid(3);
+			_object->_metadata_pending = false;
+		}
+	}
+	return offset;
+}
+
 /*
+Loads the state kept from an earlier, interrupted transfer of this resource.
+The transfer resumes from the sink spool it names once the sink is set.
+State that does not match the advertisement is discarded.
+
+:returns: *True* if the transfer can resume from the kept state.
+*/
+bool Resource::load_state() {
 	assert(_object);
-	if (_object->_initiator) {
-		_object->_processed_parts = (_object->_segment_index-1)*math.ceil(Type::Resource::MAX_EFFICIENT_SIZE/Type::Resource::SDU);
-		_object->_processed_parts += _object->sent_parts;
-		_object->_progress_total_parts = float(_object->grand_total_parts);
+	char path[Type::Reticulum::FILEPATH_MAXSIZE];
+	state_path(path, _object->_hash);
+	if (!OS::file_exists(path)) {
+		return false;
 	}
-	else {
-		_object->_processed_parts = (_object->_segment_index-1)*math.ceil(Type::Resource::MAX_EFFICIENT_SIZE/Type::Resource::SDU);
-		_object->_processed_parts += _object->_received_count;
-		if (_object->split) {
-			_object->progress_total_parts = float(math.ceil(_object->total_size/Type::Resource::SDU));
+	Bytes packed;
+	ResourceState state;
+	bool valid = (OS::read_file(path, packed) > 0 && unpack_state(packed, state));
+	_object->_resume_path = state.spool_path;
+	if (valid) {
+		valid = (state.size == _object->_size && state.total_size == _object->_total_size && state.parts == _object->_total_parts && state.flags == flags() && state.random_hash == _object->_random_hash);
+	}
+	// Parts are cut to the advertised count, and the spool must hold less
+	// than the stream short of its final block and HMAC
+	if (valid) {
+		valid = (state.part_size > 0 && (size_t)state.part_size * (state.parts - 1) < state.size && (size_t)state.part_size * state.parts >= state.size);
+	}
+	if (valid) {
+		FileStream spool = OS::open_file(state.spool_path.c_str(), FileStream::MODE_READ);
+		valid = (bool)spool;
+		if (spool) {
+			valid = (spool.size() + Type::Resource::RANDOM_HASH_SIZE + 64 <= _object->_size);
+			spool.close();
 		}
-		else {
-			_object->progress_total_parts = float(_object->total_parts);
+	}
+	if (!valid) {
+		DEBUGF("Discarding mismatched transfer state for resource %s", _object->_hash.toHex().c_str());
+		discard_state();
+		return false;
+	}
+	_object->_part_size = state.part_size;
+	return true;
+}
+
+// Writes the advertised parameters, the part size and the sink spool path to the cache
+void Resource::save_state() {
+	assert(_object);
+	// Only a transfer to a sink has a spool to resume from
+	if (!_object->_sink) {
+		return;
+	}
+	try {
+		MsgPack::Packer packer;
+		packer.to_array(OS::time(), (uint32_t)_object->_size, (uint32_t)_object->_total_size, _object->_total_parts, flags(), _object->_random_hash, _object->_part_size, Bytes(_object->_sink_spool_path));
+		char path[Type::Reticulum::FILEPATH_MAXSIZE];
+		state_path(path, _object->_hash);
+		if (OS::write_file(path, Bytes(packer.data(), packer.size())) == 0) {
+			throw std::runtime_error("Could not write resource transfer state");
 		}
 	}
+	catch (std::exception& e) {
+		ERRORF("Could not save resource transfer state, the contained exception was: %s", e.what());
+		_object->_persist = false;
+		discard_state();
+	}
+}
+
+// Removes the kept state, and the spool kept with it if not resumed into
+void Resource::discard_state() {
+	assert(_object);
+	char path[Type::Reticulum::FILEPATH_MAXSIZE];
+	state_path(path, _object->_hash);
+	OS::remove_file(path);
+	if (!_object->_resume_path.empty()) {
+		OS::remove_file(_object->_resume_path.c_str());
+		_object->_resume_path.clear();
+	}
+}
+
+/*
+Carries on spooling where an interrupted transfer stopped. Decryption picks
+up after the last whole block in the spool, keyed to the new link, from the
+part holding the ciphertext block before it. The parts before that part are
+not requested again.
+*/
+void Resource::resume_spool() {
+	assert(_object);
+	_object->_sink_spool_path = _object->_resume_path;
+	_object->_resume_path.clear();
+	_object->_sink_spool = OS::open_file(_object->_sink_spool_path.c_str(), FileStream::MODE_APPEND);
+	if (!_object->_sink_spool) {
+		throw std::runtime_error("Could not open resource sink spool file");
+	}
+	size_t spooled = _object->_sink_spool.size();
+	// The spool holds the decrypted stream less its random prefix
+	size_t decrypted = spooled + Type::Resource::RANDOM_HASH_SIZE;
+	size_t resume_offset = (decrypted / 16) * 16;
+	uint32_t first_part = resume_offset / _object->_part_size;
+	_object->_resume_skip = resume_offset - (size_t)first_part * _object->_part_size;
+	_object->_resume_chain.clear();
+	_object->_resume_overlap = decrypted - resume_offset;
+	_object->_prefix_left = 0;
+	_object->_resumed = true;
+	if (_object->_compressed) {
+		_object->_compressed_size = spooled;
+	}
+	_object->_received_count = first_part;
+	_object->_written_parts = first_part;
+	_object->_consecutive_completed_height = (int32_t)first_part - 1;
+	DEBUGF("Resuming resource %s from part %u", _object->_hash.toHex().c_str(), (unsigned)first_part);
+	// Parts requested from the start before the sink was set are passed over
+	if (_object->_hashmap_height > 0) {
+		request_next();
+	}
+}
+
+/*
+Passes over the stream before the block decryption resumes after, and sets
+up the decryptor from that block.
 
-	return (float)_object->processed_parts / (float)_object->progress_total_parts;
+:returns: The rest of the stream.
 */
-	return 0.0;
+const Bytes Resource::resume_stream(const Bytes& stream) {
+	assert(_object);
+	size_t offset = std::min(_object->_resume_skip, stream.size());
+	_object->_resume_skip -= offset;
+	if (_object->_resume_skip > 0) {
+		return {Bytes::NONE};
+	}
+	if (_object->_encrypted) {
+		size_t take = std::min(16 - _object->_resume_chain.size(), stream.size() - offset);
+		_object->_resume_chain.append(stream.data() + offset, take);
+		offset += take;
+		if (_object->_resume_chain.size() < 16) {
+			return {Bytes::NONE};
+		}
+		_object->_decryptor = _object->_link.decryptor(_object->_resume_chain);
+		_object->_resume_chain.clear();
+	}
+	_object->_resumed = false;
+	return stream.mid(offset);
 }
 
-void Resource::set_concluded_callback(Callbacks::concluded callback) {
+// Releases the spool and sink once the transfer has concluded. A transfer
+// cut short by its link closing keeps what it needs to resume.
+void Resource::close_streams() {
 	assert(_object);
-	_object->_callbacks._concluded = callback;
+	bool interrupted = (_object->_status == Type::Resource::FAILED && _object->_link.status() == Type::Link::CLOSED);
+	// The sink of a split resource carries on with the next segment
+	bool segment_completed = (_object->_status == Type::Resource::COMPLETE && _object->_segment_index < _object->_total_segments);
+	if (!interrupted) {
+		_object->_input.clear();
+		_object->_source.clear();
+	}
+	if (_object->_spool) {
+		_object->_spool.close();
+		_object->_spool.clear();
+		_object->_parts.clear();
+	}
+	if (!_object->_spool_path.empty() && !interrupted) {
+		OS::remove_file(_object->_spool_path.c_str());
+		_object->_spool_path.clear();
+	}
+	if (_object->_persist && !(interrupted && _object->_sink)) {
+		_object->_persist = false;
+		discard_state();
+	}
+	if (_object->_hashmap_file) {
+		_object->_hashmap_file.close();
+		_object->_hashmap_file.clear();
+	}
+	if (!_object->_hashmap_path.empty() && !interrupted) {
+		OS::remove_file(_object->_hashmap_path.c_str());
+		_object->_hashmap_path.clear();
+	}
+	if (_object->_sink) {
+		if (!segment_completed) {
+			_object->_sink.close();
+			_object->_sink.clear();
+		}
+		_object->_decryptor.reset();
+		_object->_parts.clear();
+	}
+	if (_object->_sink_spool) {
+		_object->_sink_spool.close();
+		_object->_sink_spool.clear();
+	}
+	if (!_object->_sink_spool_path.empty()) {
+		// Named in the transfer state to resume from
+		if (!_object->_persist) {
+			OS::remove_file(_object->_sink_spool_path.c_str());
+		}
+		_object->_sink_spool_path.clear();
+	}
 }
 
-void Resource::set_progress_callback(Callbacks::progress callback) {
+// Reports the conclusion to the link, to the request or response the
+// resource carries, and finally to the application callback
+void Resource::concluded() {
 	assert(_object);
-	_object->_callbacks._progress = callback;
+	// Only the last segment of a split resource concludes the transfer
+	bool segment_completed = (_object->_status == Type::Resource::COMPLETE && _object->_segment_index < _object->_total_segments);
+	Resource next = {Type::NONE};
+	if (segment_completed && _object->_initiator) {
+		try {
+			next = next_segment();
+		}
+		catch (std::exception& e) {
+			ERRORF("Could not prepare the next resource segment, the contained exception was: %s", e.what());
+			_object->_status = Type::Resource::FAILED;
+			segment_completed = false;
+		}
+	}
+	close_streams();
+	_object->_link.resource_concluded(*this);
+
+	if (segment_completed) {
+		if (_object->_initiator) {
+			next.advertise();
+		}
+		else {
+			_object->_link.hold_incoming_segment(*this);
+		}
+		return;
+	}
+
+	if (_object->_initiator) {
+		if (_object->_is_request) {
+			std::set<RequestReceipt> pending_requests(_object->_link.pending_requests());
+			for (auto& pending_request : pending_requests) {
+				if (pending_request.request_id() == _object->_request_id) {
+					const_cast<RequestReceipt&>(pending_request).request_resource_concluded(*this);
+				}
+			}
+		}
+	}
+	else if (_object->_is_request) {
+		_object->_link.request_resource_concluded(*this);
+	}
+	else if (_object->_is_response && _object->_request_id) {
+		_object->_link.response_resource_concluded(*this);
+	}
+
+	if (_object->_callbacks._concluded != nullptr) {
+		try {
+			_object->_callbacks._concluded(*this);
+		}
+		catch (std::exception& e) {
+			ERRORF("Error while executing resource concluded callback from %s. The contained exception was: %s", toString().c_str(), e.what());
+		}
+	}
+}
+
+void Resource::progress() {
+	assert(_object);
+	if (!_object->_initiator && _object->_is_response && _object->_request_id) {
+		std::set<RequestReceipt> pending_requests(_object->_link.pending_requests());
+		for (auto& pending_request : pending_requests) {
+			if (pending_request.request_id() == _object->_request_id) {
+				const_cast<RequestReceipt&>(pending_request).response_resource_progress(*this);
+			}
+		}
+	}
+
+	if (_object->_callbacks._progress != nullptr) {
+		try {
+			_object->_callbacks._progress(*this);
+		}
+		catch (std::exception& e) {
+			ERRORF("Error while executing resource progress callback from %s. The contained exception was: %s", toString().c_str(), e.what());
+		}
+	}
+}
+
+
+/*static*/ void Resource::clean_cache() {
+	char resources_path[Type::Reticulum::FILEPATH_MAXSIZE];
+	snprintf(resources_path, Type::Reticulum::FILEPATH_MAXSIZE, "%s/resources", Reticulum::_cachepath);
+	if (!OS::directory_exists(resources_path)) {
+		return;
+	}
+	double now = OS::time();
+	for (auto& filename : OS::list_directory(resources_path)) {
+		try {
+			char filepath[Type::Reticulum::FILEPATH_MAXSIZE];
+			snprintf(filepath, Type::Reticulum::FILEPATH_MAXSIZE, "%s/%s", resources_path, filename.c_str());
+			double timestamp;
+			if (filename.length() == (Type::Identity::HASHLENGTH/8)*2) {
+				// Transfer state, stamped when last saved
+				Bytes packed;
+				ResourceState state;
+				if (OS::read_file(filepath, packed) == 0 || !unpack_state(packed, state)) {
+					timestamp = 0.0;
+				}
+				else {
+					timestamp = state.updated;
+				}
+			}
+			else if (filename.find('.') == 16) {
+				// Spools and hashmaps, named for the time they were created
+				timestamp = (double)strtoul(filename.substr(0, 8).c_str(), nullptr, 16);
+			}
+			else {
+				continue;
+			}
+			// Times from before a clock reset count as old as well
+			double age = now - timestamp;
+			if (age > Type::Reticulum::RESOURCE_CACHE || age < -(double)Type::Reticulum::RESOURCE_CACHE) {
+				TRACEF("Removing expired resource cache file %s", filename.c_str());
+				OS::remove_file(filepath);
+			}
+		}
+		catch (std::exception& e) {
+			ERRORF("Error while cleaning resources cache, the contained exception was: %s", e.what());
+		}
+	}
 }
 
 
@@ -83,16 +2342,35 @@ std::string Resource::toString() const {
 		return "";
 	}
     //return "<"+RNS.hexrep(self.hash,delimit=False)+"/"+RNS.hexrep(self.link.link_id,delimit=False)+">"
-	//return "{Resource:" + _object->_hash.toHex() + "}";
-	return "{Resource: unknown}";
+	return "{Resource:" + _object->_hash.toHex() + "}";
 }
 
 // getters
+const Link& Resource::link() const {
+	assert(_object);
+	return _object->_link;
+}
+
 const Bytes& Resource::hash() const {
 	assert(_object);
 	return _object->_hash;
 }
 
+const Bytes& Resource::original_hash() const {
+	assert(_object);
+	return _object->_original_hash;
+}
+
+const Bytes& Resource::random_hash() const {
+	assert(_object);
+	return _object->_random_hash;
+}
+
+const Bytes& Resource::hashmap() const {
+	assert(_object);
+	return _object->_hashmap;
+}
+
 const Bytes& Resource::request_id() const {
 	assert(_object);
 	return _object->_request_id;
@@ -103,6 +2381,11 @@ const Bytes& Resource::data() const {
 	return _object->_data;
 }
 
+const Bytes& Resource::metadata() const {
+	assert(_object);
+	return _object->_metadata;
+}
+
 const Type::Resource::status Resource::status() const {
 	assert(_object);
 	return _object->_status;
@@ -118,5 +2401,199 @@ const size_t Resource::total_size() const {
 	return _object->_total_size;
 }
 
+//p self.f = 0x00 | self.x << 5 | self.p << 4 | self.u << 3 | self.s << 2 | self.c << 1 | self.e
+uint8_t Resource::flags() const {
+	assert(_object);
+	return (_object->_has_metadata << 5) | (_object->_is_response << 4) | (_object->_is_request << 3) | (_object->_split << 2) | (_object->_compressed << 1) | (uint8_t)_object->_encrypted;
+}
+
+bool Resource::initiator() const {
+	assert(_object);
+	return _object->_initiator;
+}
+
+bool Resource::is_request() const {
+	assert(_object);
+	return _object->_is_request;
+}
+
+bool Resource::is_response() const {
+	assert(_object);
+	return _object->_is_response;
+}
+
+int Resource::segment_index() const {
+	assert(_object);
+	return _object->_segment_index;
+}
+
+bool Resource::has_metadata() const {
+	assert(_object);
+	return _object->_has_metadata;
+}
+
+uint8_t Resource::window() const {
+	assert(_object);
+	return _object->_window;
+}
+
+double Resource::eifr() const {
+	assert(_object);
+	return _object->_eifr;
+}
+
+std::set<Bytes>& Resource::req_hashlist() const {
+	assert(_object);
+	return _object->_req_hashlist;
+}
+
 // setters
 
+
+ResourceAdvertisement::ResourceAdvertisement(const Resource& resource) :
+	_link(resource.link()),
+	_transfer_size(resource.size()),
+	_data_size(resource.total_size()),
+	_parts(resource.get_parts()),
+	_hash(resource.hash()),
+	_random_hash(resource.random_hash()),
+	_original_hash(resource.original_hash()),
+	_hashmap(resource.hashmap()),
+	_request_id(resource.request_id()),
+	_flags(resource.flags()),
+	_segment_index(resource.segment_index()),
+	_total_segments(resource.get_segments())
+{
+	_encrypted = (_flags & 0x01) == 0x01;
+	_compressed = ((_flags >> 1) & 0x01) == 0x01;
+	_split = ((_flags >> 2) & 0x01) == 0x01;
+	_is_request = ((_flags >> 3) & 0x01) == 0x01;
+	_is_response = ((_flags >> 4) & 0x01) == 0x01;
+	_has_metadata = ((_flags >> 5) & 0x01) == 0x01;
+}
+
+/*static*/ bool ResourceAdvertisement::is_request(const Packet& advertisement_packet) {
+	ResourceAdvertisement adv = unpack(advertisement_packet.plaintext());
+	return (adv._request_id && adv._is_request);
+}
+
+/*static*/ bool ResourceAdvertisement::is_response(const Packet& advertisement_packet) {
+	ResourceAdvertisement adv = unpack(advertisement_packet.plaintext());
+	return (adv._request_id && adv._is_response);
+}
+
+/*static*/ const Bytes ResourceAdvertisement::read_request_id(const Packet& advertisement_packet) {
+	return unpack(advertisement_packet.plaintext())._request_id;
+}
+
+/*static*/ size_t ResourceAdvertisement::read_transfer_size(const Packet& advertisement_packet) {
+	return unpack(advertisement_packet.plaintext())._transfer_size;
+}
+
+/*static*/ size_t ResourceAdvertisement::read_size(const Packet& advertisement_packet) {
+	return unpack(advertisement_packet.plaintext())._data_size;
+}
+
+// Packs the advertisement with the given segment of the hashmap, as the
+// msgpack map keyed by single letters that umsgpack packs in the reference
+// implementation, its request id being nil for plain resources
+const Bytes ResourceAdvertisement::pack(uint32_t segment /*= 0*/) const {
+	uint32_t hashmap_start = segment * Type::Resource::ResourceAdvertisement::HASHMAP_MAX_LEN;
+	uint32_t hashmap_end = (segment + 1) * Type::Resource::ResourceAdvertisement::HASHMAP_MAX_LEN;
+	if (hashmap_end > _parts) {
+		hashmap_end = _parts;
+	}
+	Bytes hashmap;
+	if (hashmap_end > hashmap_start) {
+		hashmap = _hashmap.mid(hashmap_start * Type::Resource::MAPHASH_LEN, (hashmap_end - hashmap_start) * Type::Resource::MAPHASH_LEN);
+	}
+
+	Bytes packed(Type::Resource::ResourceAdvertisement::OVERHEAD + hashmap.size());
+	// fixmap of 11 entries
+	packed.append((uint8_t)(0x80 | 11));
+	Packed::pack_key(packed, 't');	// Transfer size
+	Packed::pack_uint(packed, _transfer_size);
+	Packed::pack_key(packed, 'd');	// Data size
+	Packed::pack_uint(packed, _data_size);
+	Packed::pack_key(packed, 'n');	// Number of parts
+	Packed::pack_uint(packed, _parts);
+	Packed::pack_key(packed, 'h');	// Resource hash
+	Packed::pack_bin(packed, _hash);
+	Packed::pack_key(packed, 'r');	// Resource random hash
+	Packed::pack_bin(packed, _random_hash);
+	Packed::pack_key(packed, 'o');	// Original hash
+	Packed::pack_bin(packed, _original_hash);
+	Packed::pack_key(packed, 'i');	// Segment index
+	Packed::pack_uint(packed, _segment_index);
+	Packed::pack_key(packed, 'l');	// Total segments
+	Packed::pack_uint(packed, _total_segments);
+	Packed::pack_key(packed, 'q');	// Request ID
+	Packed::pack_optional_bin(packed, _request_id);
+	Packed::pack_key(packed, 'f');	// Resource flags
+	Packed::pack_uint(packed, _flags);
+	Packed::pack_key(packed, 'm');	// Resource hashmap
+	Packed::pack_bin(packed, hashmap);
+	return packed;
+}
+
+/*static*/ ResourceAdvertisement ResourceAdvertisement::unpack(const Bytes& data) {
+	PackedReader reader(data);
+	ResourceAdvertisement adv;
+	size_t entries = reader.read_map_size();
+	for (size_t entry = 0; entry < entries; entry++) {
+		const Bytes key(reader.read_bin());
+		if (key.size() != 1) {
+			reader.skip();
+			continue;
+		}
+		switch (key[0]) {
+		case 't':
+			adv._transfer_size = reader.read_uint();
+			break;
+		case 'd':
+			adv._data_size = reader.read_uint();
+			break;
+		case 'n':
+			adv._parts = reader.read_uint();
+			break;
+		case 'h':
+			adv._hash = reader.read_bin();
+			break;
+		case 'r':
+			adv._random_hash = reader.read_bin();
+			break;
+		case 'o':
+			adv._original_hash = reader.read_bin();
+			break;
+		case 'm':
+			adv._hashmap = reader.read_bin();
+			break;
+		case 'q':
+			adv._request_id = reader.read_bin(true);
+			break;
+		case 'i':
+			adv._segment_index = reader.read_uint();
+			break;
+		case 'l':
+			adv._total_segments = reader.read_uint();
+			break;
+		case 'f':
+			adv._flags = reader.read_uint();
+			break;
+		default:
+			reader.skip();
+		}
+	}
+
+	if (adv._hash.size() != Type::Identity::HASHLENGTH/8 || adv._random_hash.size() != Type::Resource::RANDOM_HASH_SIZE) {
+		throw std::invalid_argument("Invalid hashes in resource advertisement");
+	}
+
+	adv._encrypted = (adv._flags & 0x01) == 0x01;
+	adv._compressed = ((adv._flags >> 1) & 0x01) == 0x01;
+	adv._split = ((adv._flags >> 2) & 0x01) == 0x01;
+	adv._is_request = ((adv._flags >> 3) & 0x01) == 0x01;
+	adv._is_response = ((adv._flags >> 4) & 0x01) == 0x01;
+	adv._has_metadata = ((adv._flags >> 5) & 0x01) == 0x01;
+	return adv;
+}
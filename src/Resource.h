@@ -1,19 +1,44 @@
 #pragma once
 
+#include "Link.h"
 #include "Destination.h"
+#include "FileStream.h"
 #include "Type.h"
+#include "Utilities/Compression.h"
 
+#include <set>
 #include <memory>
 #include <cassert>
 
 namespace RNS {
 
+	namespace Cryptography { namespace Provider {
+		class Sha256;
+	} }
+
 	class ResourceData;
+	class ResourceAdvertisement;
 	class Packet;
 	class Destination;
 	class Link;
 	class Resource;
 
+/*
+	The Resource class allows transferring arbitrary amounts
+	of data over a link. It will automatically handle sequencing,
+	compression, coordination and checksumming.
+
+	:param data: The data to be transferred.
+	:param link: The :ref:`RNS.Link<api-link>` instance on which to transfer the data.
+	:param advertise: Optional. Whether to automatically advertise the resource. Can be *True* or *False*.
+	:param auto_compress: Optional. Whether to auto-compress the resource. Can be *True* or *False*.
+	:param callback: An optional *callable* with the signature *callback(resource)*. Will be called when the resource transfer concludes.
+	:param progress_callback: An optional *callable* with the signature *callback(resource)*. Will be called whenever the resource transfer progress is updated.
+	:param metadata: Optional packed msgpack data sent along with the resource, available to the receiver as *metadata()*.
+
+	Data above MAX_EFFICIENT_SIZE is sent in sequential segments, each a
+	resource of its own. The callback is called once the last segment concludes.
+*/
 	class Resource {
 
 	public:
@@ -38,7 +63,11 @@ namespace RNS {
 		}
 		//Resource(const Link& link = {Type::NONE});
 		Resource(const Bytes& data, const Link& link, const Bytes& request_id, bool is_response, double timeout);
-		Resource(const Bytes& data, const Link& link, bool advertise = true, bool auto_compress = true, Callbacks::concluded callback = nullptr, Callbacks::progress progress_callback = nullptr, double timeout = 0.0, int segment_index = 1, const Bytes& original_hash = {Type::NONE}, const Bytes& request_id = {Type::NONE}, bool is_response = false);
+		Resource(const Bytes& data, const Link& link, bool advertise = true, bool auto_compress = true, Callbacks::concluded callback = nullptr, Callbacks::progress progress_callback = nullptr, double timeout = 0.0, int segment_index = 1, const Bytes& original_hash = {Type::NONE}, const Bytes& request_id = {Type::NONE}, bool is_response = false, const Bytes& metadata = {Bytes::NONE});
+		// Sends the data read from source. The data is encrypted into a spool
+		// file in the cache and read back part by part, so memory use follows
+		// the transfer window rather than the size of the data.
+		Resource(const FileStream& source, const Link& link, bool advertise = true, bool auto_compress = true, Callbacks::concluded callback = nullptr, Callbacks::progress progress_callback = nullptr, double timeout = 0.0, int segment_index = 1, const Bytes& original_hash = {Type::NONE}, const Bytes& request_id = {Type::NONE}, bool is_response = false, const Bytes& metadata = {Bytes::NONE});
 		virtual ~Resource(){
 			MEM("Resource object destroyed");
 		}
@@ -55,56 +84,188 @@ namespace RNS {
 			//return _object->_hash < resource._object->_hash;
 		}
 
+	private:
+		Resource(const Link& link);
+
 	public:
-	    //p static def accept(advertisement_packet, callback=None, progress_callback = None, request_id = None):
+		// Codec used when a resource is sent with auto_compress and to receive
+		// compressed resources, none by default. Peers must use the same codec,
+		// the reference implementation uses bz2.
+		static void set_codec(const Utilities::Codec::Ptr& codec) { _codec = codec; }
+		static const Utilities::Codec::Ptr& codec() { return _codec; }
+		// Removes expired transfer state and spool files from the cache
+		static void clean_cache();
+		static Resource accept(const Packet& advertisement_packet, Callbacks::concluded callback = nullptr, Callbacks::progress progress_callback = nullptr, const Bytes& request_id = {Bytes::NONE});
 
 	public:
-//p def hashmap_update_packet(self, plaintext):
-//p def hashmap_update(self, segment, hashmap):
-//p def get_map_hash(self, data):
-//p def advertise(self):
-//p def __advertise_job(self):
-//p def watchdog_job(self):
-//p def __watchdog_job(self):
-//p def assemble(self):
-//p def prove(self):
+		void hashmap_update_packet(const Bytes& plaintext);
+		void hashmap_update(uint32_t segment, const Bytes& hashmap);
+		const Bytes get_map_hash(const Bytes& data) const;
+		void advertise();
+		void __advertise_job();
+		void update_eifr();
+		void watchdog_job();
+		void schedule_watchdog(double deadline);
+		void __watchdog_job();
+		void assemble();
+		void prove();
 		void validate_proof(const Bytes& proof_data);
-//p def receive_part(self, packet):
-//p def request_next(self):
-//p def request(self, request_data):
+		void receive_part(const Packet& packet);
+		void request_next();
+		void request(const Bytes& request_data);
 		void cancel();
-//p def set_callback(self, callback):
-//p def progress_callback(self, callback):
+		void resume(const Link& link);
 		float get_progress() const;
-//p def get_transfer_size(self):
-//p def get_data_size(self):
-//p def get_parts(self):
-//p def get_segments(self):
-//p def get_hash(self):
-//p def is_compressed(self):
+		size_t get_transfer_size() const;
+		size_t get_data_size() const;
+		uint32_t get_parts() const;
+		int get_segments() const;
+		const Bytes& get_hash() const;
+		bool is_compressed() const;
+		float get_compression_ratio() const;
 		void set_concluded_callback(Callbacks::concluded callback);
 		void set_progress_callback(Callbacks::progress callback);
+		// Writes received data to sink instead of assembling it in memory. The
+		// data is decrypted into a spool file in the cache as parts arrive in
+		// sequence, and written to the sink once its hash has been checked.
+		// Must be set before parts arrive, such as from the link's resource
+		// started callback. The sink is closed when the transfer concludes, and
+		// is written to only if it completed. The spool of a transfer cut short
+		// by its link closing is kept, and a later transfer of the same resource
+		// with a sink set carries on from it.
+		void set_data_sink(const FileStream& sink);
 
 		std::string toString() const;
 
 		// getters
+		const Link& link() const;
 		const Bytes& hash() const;
+		const Bytes& original_hash() const;
+		const Bytes& random_hash() const;
+		const Bytes& hashmap() const;
 		const Bytes& request_id() const;
 		const Bytes& data() const;
+		const Bytes& metadata() const;
 		const Type::Resource::status status() const;
 		const size_t size() const;
 		const size_t total_size() const;
+		uint8_t flags() const;
+		bool initiator() const;
+		bool is_request() const;
+		bool is_response() const;
+		int segment_index() const;
+		bool has_metadata() const;
+		uint8_t window() const;
+		double eifr() const;
+		std::set<Bytes>& req_hashlist() const;
 
 		// setters
 
+	private:
+		void setup(Callbacks::concluded callback, Callbacks::progress progress_callback, double timeout, int segment_index, const Bytes& request_id, bool is_response);
+		void set_metadata(const Bytes& metadata);
+		void prepare_data(const Bytes& original_hash);
+		void prepare_stream(const Bytes& original_hash);
+		void segment(size_t& offset, size_t& length);
+		Resource next_segment();
+		void map_hashes(const Bytes& original_hash, const Cryptography::Provider::Sha256* data_hash, const Bytes& data);
+		bool map_parts();
+		void reencrypt(Link& link);
+		bool map_part(uint32_t index, const Bytes& part);
+		const uint8_t* hashmap_entry(uint32_t index) const;
+		void load_hashmap(uint32_t start, uint32_t end);
+		std::unique_ptr<Cryptography::Provider::Sha256> spool(FileStream& source, size_t length, const Bytes& prefix);
+		const Bytes get_part(uint32_t index);
+		void assemble_sink();
+		void write_parts();
+		void write_data(const Bytes& plaintext);
+		void unspool(Cryptography::Provider::Sha256* data_hash);
+		size_t read_metadata(const Bytes& data);
+		bool load_state();
+		void save_state();
+		void discard_state();
+		void resume_spool();
+		const Bytes resume_stream(const Bytes& stream);
+		void close_streams();
+		void concluded();
+		void progress();
+
+	private:
+		static Utilities::Codec::Ptr _codec;
+
 	protected:
 		std::shared_ptr<ResourceData> _object;
 
 	};
 
 
+/*
+	Describes a resource to the receiving side of a link. The advertisement
+	carries sizes, hashes, flags and the first segment of the part hashmap,
+	packed as a msgpack map as in the reference implementation.
+*/
 	class ResourceAdvertisement {
 
+	public:
+		ResourceAdvertisement() {}
+		ResourceAdvertisement(const Resource& resource);
+
+	public:
+		static bool is_request(const Packet& advertisement_packet);
+		static bool is_response(const Packet& advertisement_packet);
+		static const Bytes read_request_id(const Packet& advertisement_packet);
+		static size_t read_transfer_size(const Packet& advertisement_packet);
+		static size_t read_size(const Packet& advertisement_packet);
+		static ResourceAdvertisement unpack(const Bytes& data);
+
+	public:
+		const Bytes pack(uint32_t segment = 0) const;
+
+		// getters
+		const Link& link() const { return _link; }
+		size_t transfer_size() const { return _transfer_size; }
+		size_t data_size() const { return _data_size; }
+		uint32_t parts() const { return _parts; }
+		const Bytes& hash() const { return _hash; }
+		const Bytes& random_hash() const { return _random_hash; }
+		const Bytes& original_hash() const { return _original_hash; }
+		const Bytes& hashmap() const { return _hashmap; }
+		const Bytes& request_id() const { return _request_id; }
+		uint8_t flags() const { return _flags; }
+		int segment_index() const { return _segment_index; }
+		int total_segments() const { return _total_segments; }
+		bool encrypted() const { return _encrypted; }
+		bool compressed() const { return _compressed; }
+		bool split() const { return _split; }
+		bool has_metadata() const { return _has_metadata; }
+		bool is_request() const { return _is_request; }
+		bool is_response() const { return _is_response; }
+
+		// setters
+		void link(const Link& link) { _link = link; }
+
+	private:
+		Link _link = {Type::NONE};
+		size_t _transfer_size = 0;
+		size_t _data_size = 0;
+		uint32_t _parts = 0;
+		Bytes _hash;
+		Bytes _random_hash;
+		Bytes _original_hash;
+		// The hashmap from the first part on when built from a resource, one
+		// segment of it when unpacked
+		Bytes _hashmap;
+		Bytes _request_id;
+		uint8_t _flags = 0;
+		int _segment_index = 1;
+		int _total_segments = 1;
+		bool _encrypted = false;
+		bool _compressed = false;
+		bool _split = false;
+		bool _has_metadata = false;
+		bool _is_request = false;
+		bool _is_response = false;
+
 	};
 
 }
@@ -5,24 +5,180 @@
 #include "Interface.h"
 #include "Packet.h"
 #include "Destination.h"
+#include "FileStream.h"
 #include "Bytes.h"
 #include "Type.h"
 #include "Cryptography/Fernet.h"
+#include "Cryptography/Token.h"
+#include "Cryptography/Provider.h"
+#include "Utilities/OS.h"
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
 
 namespace RNS {
 
 	class ResourceData {
 	public:
 		ResourceData(const Link& link) : _link(link) {}
-		virtual ~ResourceData() {}
+		virtual ~ResourceData() {
+			// A spool kept for resuming goes with the last reference to the resource
+			if (_spool) {
+				_spool.close();
+			}
+			if (_hashmap_file) {
+				_hashmap_file.close();
+			}
+			if (!_hashmap_path.empty()) {
+				Utilities::OS::remove_file(_hashmap_path.c_str());
+			}
+			if (_sink_spool) {
+				_sink_spool.close();
+			}
+			if (!_sink_spool_path.empty()) {
+				Utilities::OS::remove_file(_sink_spool_path.c_str());
+			}
+			if (!_spool_path.empty()) {
+				Utilities::OS::remove_file(_spool_path.c_str());
+			}
+		}
 	private:
 		Link _link;
 		Bytes _hash;
+		Bytes _original_hash;
+		Bytes _random_hash;
+		Bytes _expected_proof;
 		Bytes _request_id;
+		// Encrypted stream on the sending side, assembled data once received
 		Bytes _data;
+		// MAPHASH_LEN bytes per part, from part _hashmap_base on. A spooled
+		// resource keeps its hashmap in a file beside the spool and holds
+		// only the span being searched, a receiver drops the map hashes of
+		// parts it has received in sequence.
+		Bytes _hashmap;
+		uint32_t _hashmap_base = 0;
+		std::string _hashmap_path;
+		FileStream _hashmap_file = {Type::NONE};
+		// Next part whose map hash is read from the file
+		uint32_t _hashmap_read = 0;
+		// Parts held in memory by index. Received parts until they are
+		// assembled or written to the sink, on the sending side of a spooled
+		// resource the parts read back from the spool and not yet released.
+		std::map<uint32_t, Bytes> _parts;
+		std::vector<bool> _parts_sent;
+
+		// Sending side of a split resource, the input that later segments
+		// are cut from, or the source they are read from in sequence
+		Bytes _input;
+		FileStream _source = {Type::NONE};
+		bool _auto_compress = true;
+
+		// Packed metadata, sent ahead of the data in the first segment with
+		// its size in three bytes, and received without them
+		Bytes _metadata;
+		// Size of the metadata as sent, later segments are cut after it
+		size_t _metadata_size = 0;
+		bool _has_metadata = false;
+		// Metadata still to be read off the start of a stream to a sink
+		bool _metadata_pending = false;
+
+		// Sending side of a resource streamed from storage, the encrypted
+		// stream is spooled to the cache and read back as parts are requested
+		std::string _spool_path;
+		FileStream _spool = {Type::NONE};
+		uint32_t _spooled_parts = 0;
+		// Decrypts the stream as sent, for encrypting it again when the
+		// resource is resumed on another link
+		Cryptography::TokenDecryptor::Ptr _stream_decryptor;
+
+		// Receiving side of a resource streamed to storage. The decrypted
+		// stream is spooled to the cache, and written out to the sink only
+		// once its hash has been checked.
+		FileStream _sink = {Type::NONE};
+		std::string _sink_spool_path;
+		FileStream _sink_spool = {Type::NONE};
+		Cryptography::TokenDecryptor::Ptr _decryptor;
+		uint32_t _written_parts = 0;
+		// Random hash bytes still to strip from the start of the stream
+		size_t _prefix_left = Type::Resource::RANDOM_HASH_SIZE;
+
+		// Receiving side of a resource whose transfer state is kept in the
+		// cache, so that it can resume on a new link after an interruption.
+		// The state names the sink spool, which keeps what was decrypted.
+		bool _persist = false;
+		// Size of the parts the sender cut the stream into, once known
+		uint32_t _part_size = 0;
+		// Sink spool kept from an interrupted transfer, until the sink is set
+		std::string _resume_path;
+		// Stream bytes to pass over before the ciphertext block decryption
+		// resumes after, then that block as it is collected
+		size_t _resume_skip = 0;
+		Bytes _resume_chain;
+		// Decrypted bytes already spooled past the block decryption resumes at
+		size_t _resume_overlap = 0;
+		bool _resumed = false;
 		Type::Resource::status _status = Type::Resource::NONE;
 		size_t _size = 0;
 		size_t _total_size = 0;
+		size_t _uncompressed_size = 0;
+		// Size of the data as compressed, once known
+		size_t _compressed_size = 0;
+		uint16_t _sdu = Type::Resource::SDU;
+		bool _initiator = false;
+		bool _encrypted = true;
+		bool _compressed = false;
+		bool _split = false;
+		bool _is_request = false;
+		bool _is_response = false;
+		int _segment_index = 1;
+		int _total_segments = 1;
+
+		uint32_t _total_parts = 0;
+		uint32_t _sent_parts = 0;
+		uint32_t _received_count = 0;
+		uint32_t _outstanding_parts = 0;
+		uint32_t _hashmap_height = 0;
+		int32_t _consecutive_completed_height = -1;
+		uint32_t _receiver_min_consecutive_height = 0;
+		bool _waiting_for_hmu = false;
+		bool _assembly_lock = false;
+		std::set<Bytes> _req_hashlist;
+
+		uint8_t _window = Type::Resource::WINDOW;
+		uint8_t _window_max = Type::Resource::WINDOW_MAX_SLOW;
+		uint8_t _window_min = Type::Resource::WINDOW_MIN;
+		uint8_t _window_flexibility = Type::Resource::WINDOW_FLEXIBILITY;
+		uint8_t _fast_rate_rounds = 0;
+		uint8_t _very_slow_rate_rounds = 0;
+
+		uint8_t _max_retries = Type::Resource::MAX_RETRIES;
+		uint8_t _max_adv_retries = Type::Resource::MAX_ADV_RETRIES;
+		uint8_t _retries_left = Type::Resource::MAX_RETRIES;
+		uint8_t _timeout_factor = 0;
+		uint8_t _part_timeout_factor = Type::Resource::PART_TIMEOUT_FACTOR;
+		uint8_t _sender_grace_time = Type::Resource::SENDER_GRACE_TIME;
+		double _timeout = 0.0;
+
+		// Timings, 0.0 where the reference implementation has None
+		double _rtt = 0.0;
+		double _eifr = 0.0;
+		double _previous_eifr = 0.0;
+		double _last_activity = 0.0;
+		double _started_transferring = 0.0;
+		double _adv_sent = 0.0;
+		double _last_part_sent = 0.0;
+		double _req_sent = 0.0;
+		double _req_resp = 0.0;
+		size_t _req_sent_bytes = 0;
+		size_t _rtt_rxd_bytes = 0;
+		size_t _rtt_rxd_bytes_at_part_req = 0;
+		double _req_resp_rtt_rate = 0.0;
+		double _req_data_rtt_rate = 0.0;
+
+		double _watchdog_deadline = 0.0;
+		uint32_t _watchdog_id = 0;
 		Resource::Callbacks _callbacks;
 
 	friend class Resource;
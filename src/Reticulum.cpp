@@ -1,6 +1,7 @@
 #include "Reticulum.h"
 
 #include "Transport.h"
+#include "Resource.h"
 #include "Log.h"
 
 //#include <TransistorNoiseSource.h>
@@ -309,26 +310,13 @@ void Reticulum::clean_caches() {
 	TRACE("Cleaning resource and packet caches...");
 	double now = OS::time();
 
-#if defined(RNS_USE_FS) && defined(RNS_PERSIST_PATHS)
-/*
+#if defined(RNS_USE_FS)
 	// Clean resource caches
-	for (auto& filename : OS::list_directory(resourcepath) {
-		try {
-			if (filename.length() == (Type::Identity::HASHLENGTH//8)*2) {
-				char filepath[FILEPATH_MAXSIZE];
-				snprintf(filepath, FILEPATH_MAXSIZE, "%s/%s", _resourcepath, filename.c_str());
-				//p mtime = os.path.getmtime(filepath)
-				//p age = now - mtime
-				//p if (age > Types::Reticulum.RESOURCE_CACHE) {
-				//p 	OS::remove_file(filepath);
-				//p }
-			}
-		}
-		catch (std::exception& e) {
-			ERROR("Error while cleaning resources cache, the contained exception was: %s", e.what());
-		}
-	}
+	Resource::clean_cache();
+#endif
 
+#if defined(RNS_USE_FS) && defined(RNS_PERSIST_PATHS)
+/*
 	// Clean packet caches
 	for (auto& filename : OS::list_directory(_cachepath.c_str())) {
 		try {
@@ -436,8 +424,8 @@ bool Reticulum::drop_path(const Bytes& destination) {
 	return Transport::expire_path(destination);
 }
 
-uint16_t Reticulum::drop_all_via(const Bytes& transport_hash) {
-	uint16_t dropped_count = 0;
+uint32_t Reticulum::drop_all_via(const Bytes& transport_hash) {
+	uint32_t dropped_count = 0;
 	//for (auto& destination_hash : Transport::get_destination_table()) {
 	for (const auto& [destination_hash, destination_entry] : Transport::get_destination_table()) {
 		if (destination_entry._received_from == transport_hash) {
@@ -84,7 +84,7 @@ namespace RNS {
 		const std::map<Bytes, Transport::DestinationEntry>& get_path_table() const;
 		const std::map<Bytes, Transport::RateEntry>& get_rate_table() const;
 		bool drop_path(const Bytes& destination);
-		uint16_t drop_all_via(const Bytes& transport_hash);
+		uint32_t drop_all_via(const Bytes& transport_hash);
 		void drop_announce_queues();
 		const std::string get_next_hop_if_name(const Bytes& destination) const;
 		double get_first_hop_timeout(const Bytes& destination) const;
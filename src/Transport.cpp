@@ -1,4 +1,5 @@
 #include "Transport.h"
+#include "TransportInstance.h"
 
 #include "Reticulum.h"
 #include "Destination.h"
@@ -11,6 +12,7 @@
 #include "Utilities/Persistence.h"
 
 #include <algorithm>
+#include <tuple>
 #include <unistd.h>
 #include <time.h>
 
@@ -18,110 +20,21 @@ using namespace RNS;
 using namespace RNS::Type::Transport;
 using namespace RNS::Utilities;
 
-#if defined(INTERFACES_SET)
-///*static*/ std::set<std::reference_wrapper<const Interface>, std::less<const Interface>> Transport::_interfaces;
-/*static*/ std::set<std::reference_wrapper<Interface>, std::less<Interface>> Transport::_interfaces;
-#elif defined(INTERFACES_LIST)
-/*static*/ std::list<std::reference_wrapper<Interface>> Transport::_interfaces;
-#elif defined(INTERFACES_MAP)
-/*static*/ std::map<Bytes, Interface&> Transport::_interfaces;
-#endif
-#if defined(DESTINATIONS_SET)
-/*static*/ std::set<Destination> Transport::_destinations;
-#elif defined(DESTINATIONS_MAP)
-/*static*/ std::map<Bytes, Destination> Transport::_destinations;
-#endif
-/*static*/ std::set<Link> Transport::_pending_links;
-/*static*/ std::set<Link> Transport::_active_links;
-/*static*/ std::set<Bytes> Transport::_packet_hashlist;
-/*static*/ std::list<PacketReceipt> Transport::_receipts;
-
-/*static*/ std::map<Bytes, Transport::AnnounceEntry> Transport::_announce_table;
-/*static*/ std::map<Bytes, Transport::DestinationEntry> Transport::_destination_table;
-/*static*/ std::map<Bytes, Transport::ReverseEntry> Transport::_reverse_table;
-/*static*/ std::map<Bytes, Transport::LinkEntry> Transport::_link_table;
-/*static*/ std::map<Bytes, Transport::AnnounceEntry> Transport::_held_announces;
-/*static*/ std::set<HAnnounceHandler> Transport::_announce_handlers;
-/*static*/ std::map<Bytes, Transport::TunnelEntry> Transport::_tunnels;
-/*static*/ std::map<Bytes, Transport::RateEntry> Transport::_announce_rate_table;
-/*static*/ std::map<Bytes, double> Transport::_path_requests;
-
-/*static*/ std::map<Bytes, Transport::PathRequestEntry> Transport::_discovery_path_requests;
-/*static*/ std::set<Bytes> Transport::_discovery_pr_tags;
-
-/*static*/ std::set<Destination> Transport::_control_destinations;
-/*static*/ std::set<Bytes> Transport::_control_hashes;
-
-///*static*/ std::set<Interface> Transport::_local_client_interfaces;
-/*static*/ std::set<std::reference_wrapper<const Interface>, std::less<const Interface>> Transport::_local_client_interfaces;
-
-/*static*/ std::map<Bytes, const Interface&> Transport::_pending_local_path_requests;
-
-// CBA
-/*static*/ std::map<Bytes, Transport::PacketEntry> Transport::_packet_table;
-
-/*static*/ uint16_t Transport::_LOCAL_CLIENT_CACHE_MAXSIZE = 512;
-
-/*static*/ double Transport::_start_time				= 0.0;
-/*static*/ bool Transport::_jobs_locked					= false;
-/*static*/ bool Transport::_jobs_running				= false;
-/*static*/ float Transport::_job_interval				= 0.250;
-/*static*/ double Transport::_jobs_last_run				= 0.0;
-/*static*/ double Transport::_links_last_checked		= 0.0;
-/*static*/ float Transport::_links_check_interval		= 1.0;
-/*static*/ double Transport::_receipts_last_checked		= 0.0;
-/*static*/ float Transport::_receipts_check_interval	= 1.0;
-/*static*/ double Transport::_announces_last_checked	= 0.0;
-/*static*/ float Transport::_announces_check_interval	= 1.0;
-/*static*/ double Transport::_tables_last_culled		= 0.0;
-// CBA MCU
-/*static*/ //float Transport::_tables_cull_interval		= 5.0;
-/*static*/ float Transport::_tables_cull_interval		= 60.0;
-/*static*/ bool Transport::_saving_path_table			= false;
-// CBA ACCUMULATES
-// CBA MCU
-/*static*/ //uint16_t Transport::_hashlist_maxsize		= 1000000;
-/*static*/ //uint16_t Transport::_hashlist_maxsize		= 100;
-/*static*/ uint16_t Transport::_hashlist_maxsize		= 100;
-// CBA ACCUMULATES
-// CBA MCU
-/*static*/ //uint16_t Transport::_max_pr_tags			= 32000;
-/*static*/ uint16_t Transport::_max_pr_tags				= 32;
-
-// CBA
-// CBA ACCUMULATES
-/*static*/ uint16_t Transport::_path_table_maxsize		= 100;
-// CBA ACCUMULATES
-/*static*/ uint16_t Transport::_path_table_maxpersist	= 100;
-/*static*/ double Transport::_last_saved				= 0.0;
-/*static*/ float Transport::_save_interval				= 3600.0;
-/*static*/ uint32_t Transport::_destination_table_crc	= 0;
-
-/*static*/ Reticulum Transport::_owner({Type::NONE});
-/*static*/ Identity Transport::_identity({Type::NONE});
-
-// CBA
-/*static*/ Transport::Callbacks Transport::_callbacks;
-
-// CBA Stats
-/*static*/ uint32_t Transport::_packets_sent = 0;
-/*static*/ uint32_t Transport::_packets_received = 0;
-/*static*/ uint32_t Transport::_destinations_added = 0;
-/*static*/ size_t Transport::_last_memory = 0;
-/*static*/ size_t Transport::_last_flash = 0;
+/*static*/ TransportInstance Transport::_default_instance;
+/*static*/ TransportInstance* Transport::_instance = &Transport::_default_instance;
 
 /*static*/ void Transport::start(const Reticulum& reticulum_instance) {
 	INFO("Transport starting...");
-	_jobs_running = true;
-	_owner = reticulum_instance;
+	_instance->_jobs_running = true;
+	_instance->_owner = reticulum_instance;
 
 	// Initialize time-based variables *after* time offset update
-	_jobs_last_run = OS::time();
-	_links_last_checked = OS::time();
-	_receipts_last_checked = OS::time();
-	_announces_last_checked = OS::time();
-	_tables_last_culled = OS::time();
-	_last_saved = OS::time();
+	_instance->_jobs_last_run = OS::time();
+	_instance->_links_last_checked = OS::time();
+	_instance->_receipts_last_checked = OS::time();
+	_instance->_announces_last_checked = OS::time();
+	_instance->_tables_last_culled = OS::time();
+	_instance->_last_saved = OS::time();
 
 	// ensure required directories exist
 	if (!OS::directory_exists(Reticulum::_cachepath)) {
@@ -129,19 +42,19 @@ using namespace RNS::Utilities;
 		OS::create_directory(Reticulum::_cachepath);
 	}
 
-	if (!_identity) {
+	if (!_instance->_identity) {
 		char transport_identity_path[Type::Reticulum::FILEPATH_MAXSIZE];
 		snprintf(transport_identity_path, Type::Reticulum::FILEPATH_MAXSIZE, "%s/transport_identity", Reticulum::_storagepath);
 		DEBUG("Checking for transport identity...");
 		try {
 			if (OS::file_exists(transport_identity_path)) {
-				_identity = Identity::from_file(transport_identity_path);
+				_instance->_identity = Identity::from_file(transport_identity_path);
 			}
 
-			if (!_identity) {
+			if (!_instance->_identity) {
 				VERBOSE("No valid Transport Identity in storage, creating...");
-				_identity = Identity();
-				_identity.to_file(transport_identity_path);
+				_instance->_identity = Identity();
+				_instance->_identity.to_file(transport_identity_path);
 			}
 			else {
 				VERBOSE("Loaded Transport Identity from storage");
@@ -173,9 +86,9 @@ using namespace RNS::Utilities;
 	Destination path_request_destination({Type::NONE}, Type::Destination::IN, Type::Destination::PLAIN, APP_NAME, "path.request");
 	path_request_destination.set_packet_callback(path_request_handler);
 	// CBA ACCUMULATES
-	_control_destinations.insert(path_request_destination);
+	_instance->_control_destinations.insert(path_request_destination);
 	// CBA ACCUMULATES
-	_control_hashes.insert(path_request_destination.hash());
+	_instance->_control_hashes.insert(path_request_destination.hash());
 	DEBUG("Created transport-specific path request destination " + path_request_destination.hash().toHex());
 
 	// Create transport-specific destination for tunnel synthesize
@@ -184,12 +97,12 @@ using namespace RNS::Utilities;
 	// CBA BUG?
     //p Transport.control_destinations.append(Transport.tunnel_synthesize_handler)
 	// CBA ACCUMULATES
-	_control_destinations.insert(tunnel_synthesize_destination);
+	_instance->_control_destinations.insert(tunnel_synthesize_destination);
 	// CBA ACCUMULATES
-	_control_hashes.insert(tunnel_synthesize_destination.hash());
+	_instance->_control_hashes.insert(tunnel_synthesize_destination.hash());
 	DEBUG("Created transport-specific tunnel synthesize destination " + tunnel_synthesize_destination.hash().toHex());
 
-	_jobs_running = false;
+	_instance->_jobs_running = false;
 
 	// CBA Threading
 	//p thread = threading.Thread(target=Transport.jobloop, daemon=True)
@@ -208,7 +121,7 @@ using namespace RNS::Utilities;
 
 		// Create transport-specific destination for probe requests
 		if (Reticulum::probe_destination_enabled()) {
-			Destination probe_destination(_identity, Type::Destination::IN, Type::Destination::SINGLE, APP_NAME, "probe");
+			Destination probe_destination(_instance->_identity, Type::Destination::IN, Type::Destination::SINGLE, APP_NAME, "probe");
 			probe_destination.accepts_links(false);
 			probe_destination.set_proof_strategy(Type::Destination::PROVE_ALL);
 			DEBUG("Created probe responder destination " + probe_destination.hash().toHex());
@@ -216,8 +129,8 @@ using namespace RNS::Utilities;
 			NOTICE("Transport Instance will respond to probe requests on " + probe_destination.toString());
 		}
 
-		VERBOSE("Transport instance " + _identity.toString() + " started");
-		_start_time = OS::time();
+		VERBOSE("Transport instance " + _instance->_identity.toString() + " started");
+		_instance->_start_time = OS::time();
 	}
 
 // TODO
@@ -236,9 +149,12 @@ using namespace RNS::Utilities;
 }
 
 /*static*/ void Transport::loop() {
-	if (OS::time() > (_jobs_last_run + _job_interval)) {
+	if (!_instance->_deadlines.empty() && (*_instance->_deadlines.begin()).first <= OS::time()) {
+		run_deadlines();
+	}
+	if (OS::time() > (_instance->_jobs_last_run + _instance->_job_interval)) {
 		jobs();
-		_jobs_last_run = OS::time();
+		_instance->_jobs_last_run = OS::time();
 	}
 }
 
@@ -248,14 +164,14 @@ using namespace RNS::Utilities;
 	std::vector<Packet> outgoing;
 	std::set<Bytes> path_requests;
 	int count;
-	_jobs_running = true;
+	_instance->_jobs_running = true;
 
 	try {
-		if (!_jobs_locked) {
+		if (!_instance->_jobs_locked) {
 
 			// Process active and pending link lists
-			if (OS::time() > (_links_last_checked + _links_check_interval)) {
-				std::set<Link> pending_links(_pending_links);
+			if (OS::time() > (_instance->_links_last_checked + _instance->_links_check_interval)) {
+				std::set<Link> pending_links(_instance->_pending_links);
 				for (auto& link : pending_links) {
 					if (link.status() == Type::Link::CLOSED) {
 						// If we are not a Transport Instance, finding a pending link
@@ -267,10 +183,10 @@ using namespace RNS::Utilities;
 							// If we are connected to a shared instance, it will take
 							// care of sending out a new path request. If not, we will
 							// send one directly.
-							if (!_owner.is_connected_to_shared_instance()) {
+							if (!_instance->_owner.is_connected_to_shared_instance()) {
 								double last_path_request = 0;
-								auto iter = _path_requests.find(link.destination().hash());
-								if (iter != _path_requests.end()) {
+								auto iter = _instance->_path_requests.find(link.destination().hash());
+								if (iter != _instance->_path_requests.end()) {
 									last_path_request = (*iter).second;
 								}
 
@@ -285,31 +201,31 @@ using namespace RNS::Utilities;
 							}
 						}
 
-						_pending_links.erase(link);
+						_instance->_pending_links.erase(link);
 					}
 				}
-				std::set<Link> active_links(_active_links);
+				std::set<Link> active_links(_instance->_active_links);
 				for (auto& link : active_links) {
 					if (link.status() == Type::Link::CLOSED) {
-						_active_links.erase(link);
+						_instance->_active_links.erase(link);
 					}
 				}
 
-				_links_last_checked = OS::time();
+				_instance->_links_last_checked = OS::time();
 			}
 
 			// Process receipts list for timed-out packets
-			if (OS::time() > (_receipts_last_checked + _receipts_check_interval)) {
-				while (_receipts.size() > Type::Transport::MAX_RECEIPTS) {
+			if (OS::time() > (_instance->_receipts_last_checked + _instance->_receipts_check_interval)) {
+				while (_instance->_receipts.size() > Type::Transport::MAX_RECEIPTS) {
 					//p culled_receipt = Transport.receipts.pop(0)
-					PacketReceipt culled_receipt = _receipts.front();
-					_receipts.pop_front();
+					PacketReceipt culled_receipt = _instance->_receipts.front();
+					_instance->_receipts.pop_front();
 					culled_receipt.set_timeout(-1);
 					culled_receipt.check_timeout();
 				}
 
 				std::list<PacketReceipt> cull_receipts;
-				for (auto& receipt : _receipts) {
+				for (auto& receipt : _instance->_receipts) {
 					receipt.check_timeout();
 					if (receipt.status() != Type::PacketReceipt::SENT) {
 						//p if receipt in Transport.receipts:
@@ -318,17 +234,17 @@ using namespace RNS::Utilities;
 					}
 				}
 				// CBA since modifying of collection while iterating is forbidden
-				for (auto& receipt : _receipts) {
+				for (auto& receipt : _instance->_receipts) {
 					cull_receipts.remove(receipt);
 				}
 
-				_receipts_last_checked = OS::time();
+				_instance->_receipts_last_checked = OS::time();
 			}
 
 			// Process announces needing retransmission
-			if (OS::time() > (_announces_last_checked + _announces_check_interval)) {
+			if (OS::time() > (_instance->_announces_last_checked + _instance->_announces_check_interval)) {
 				//p for destination_hash in Transport.announce_table:
-				for (auto& [destination_hash, announce_entry] : _announce_table) {
+				for (auto& [destination_hash, announce_entry] : _instance->_announce_table) {
 				//for (auto& pair : _announce_table) {
 				//	const auto& destination_hash = pair.first;
 				//	auto& announce_entry = pair.second;
@@ -337,7 +253,7 @@ using namespace RNS::Utilities;
 					if (announce_entry._retries > Type::Transport::PATHFINDER_R) {
 						TRACE("Completed announce processing for " + destination_hash.toHex() + ", retry limit reached");
 						// CBA OK to modify collection here since we're immediately exiting iteration
-						_announce_table.erase(destination_hash);
+						_instance->_announce_table.erase(destination_hash);
 						break;
 					}
 					else {
@@ -374,7 +290,7 @@ using namespace RNS::Utilities;
 								announce_context,
 								Type::Transport::TRANSPORT,
 								Type::Packet::HEADER_2,
-								Transport::_identity.hash()
+								_instance->_identity.hash()
 							);
 
 							new_packet.hops(announce_entry._hops);
@@ -394,41 +310,72 @@ using namespace RNS::Utilities;
 							// is temporarily held, and then reinserted when the path
 							// request has been served to the peer.
 							//p if destination_hash in Transport.held_announces:
-							auto iter =_held_announces.find(destination_hash);
-							if (iter != _held_announces.end()) {
+							auto iter =_instance->_held_announces.find(destination_hash);
+							if (iter != _instance->_held_announces.end()) {
 								//p held_entry = Transport.held_announces.pop(destination_hash)
 								auto held_entry = (*iter).second;
-								_held_announces.erase(iter);
+								_instance->_held_announces.erase(iter);
 								//p Transport.announce_table[destination_hash] = held_entry
 								//_announce_table[destination_hash] = held_entry;
 								//_announce_table.insert_or_assign({destination_hash, held_entry});
-								_announce_table.erase(destination_hash);
+								_instance->_announce_table.erase(destination_hash);
 								// CBA ACCUMULATES
-								_announce_table.insert({destination_hash, held_entry});
+								_instance->_announce_table.insert({destination_hash, held_entry});
 								DEBUG("Reinserting held announce into table");
 							}
 						}
 					}
 				}
 
-				_announces_last_checked = OS::time();
+				_instance->_announces_last_checked = OS::time();
+			}
+
+			// Process interface announce queues whose announce cap has elapsed
+#if defined(INTERFACES_SET)
+			for (const Interface& interface : _instance->_interfaces) {
+#elif defined(INTERFACES_LIST)
+			for (Interface& interface : _instance->_interfaces) {
+#elif defined(INTERFACES_MAP)
+			for (auto& [hash, interface] : _instance->_interfaces) {
+#endif
+				if (interface.announce_queue().size() > 0 && OS::time() >= interface.announce_allowed_at()) {
+#if defined(INTERFACES_SET)
+					const_cast<Interface&>(interface).process_announce_queue();
+#else
+					interface.process_announce_queue();
+#endif
+				}
 			}
 
 			// Cull the packet hashlist if it has reached its max size
-			if (_packet_hashlist.size() > _hashlist_maxsize) {
-				std::set<Bytes>::iterator iter = _packet_hashlist.begin();
-				std::advance(iter, _packet_hashlist.size() - _hashlist_maxsize);
-				_packet_hashlist.erase(_packet_hashlist.begin(), iter);
+			if (_instance->_packet_hashlist.size() > _instance->_hashlist_maxsize) {
+				std::set<Bytes>::iterator iter = _instance->_packet_hashlist.begin();
+				std::advance(iter, _instance->_packet_hashlist.size() - _instance->_hashlist_maxsize);
+				_instance->_packet_hashlist.erase(_instance->_packet_hashlist.begin(), iter);
+			}
+
+			// Cull the path request tags list if it has reached its max size,
+			// dropping the oldest tags first
+			while (_instance->_discovery_pr_tags.size() > _instance->_max_pr_tags && _instance->_discovery_pr_tags_age.size() > 0) {
+				_instance->_discovery_pr_tags.erase(_instance->_discovery_pr_tags_age.front());
+				_instance->_discovery_pr_tags_age.pop_front();
 			}
 
-			// Cull the path request tags list if it has reached its max size
-			if (_discovery_pr_tags.size() > _max_pr_tags) {
-				std::set<Bytes>::iterator iter = _discovery_pr_tags.begin();
-				std::advance(iter, _discovery_pr_tags.size() - _max_pr_tags);
-				_discovery_pr_tags.erase(_discovery_pr_tags.begin(), iter);
+			// Conclude in-flight path requests that went unanswered
+			if (_instance->_path_requests_in_flight.size() > 0) {
+				std::vector<Bytes> timed_out_path_requests;
+				for (const auto& [destination_hash, in_flight_entry] : _instance->_path_requests_in_flight) {
+					if (OS::time() > in_flight_entry._timeout) {
+						timed_out_path_requests.push_back(destination_hash);
+					}
+				}
+				for (const Bytes& destination_hash : timed_out_path_requests) {
+					DEBUG("Path request for " + destination_hash.toHex() + " timed out");
+					path_request_concluded(destination_hash, false);
+				}
 			}
 
-			if (OS::time() > (_tables_last_culled + _tables_cull_interval)) {
+			if (OS::time() > (_instance->_tables_last_culled + _instance->_tables_cull_interval)) {
 
 				// CBA Disabled following since we're calling immediately after adding to path table now
 				// Cull the path table if it has reached its max size
@@ -436,7 +383,7 @@ using namespace RNS::Utilities;
 
 				// Cull the reverse table according to timeout
 				std::vector<Bytes> stale_reverse_entries;
-				for (const auto& [packet_hash, reverse_entry] : _reverse_table) {
+				for (const auto& [packet_hash, reverse_entry] : _instance->_reverse_table) {
 					if (OS::time() > (reverse_entry._timestamp + REVERSE_TIMEOUT)) {
 						stale_reverse_entries.push_back(packet_hash);
 					}
@@ -444,7 +391,7 @@ using namespace RNS::Utilities;
 
 				// Cull the link table according to timeout
 				std::vector<Bytes> stale_links;
-				for (const auto& [link_id, link_entry] : _link_table) {
+				for (const auto& [link_id, link_entry] : _instance->_link_table) {
 					if (link_entry._validated) {
 						if (OS::time() > (link_entry._timestamp + LINK_TIMEOUT)) {
 							stale_links.push_back(link_id);
@@ -455,8 +402,8 @@ using namespace RNS::Utilities;
 							stale_links.push_back(link_id);
 
 							double last_path_request = 0.0;
-							const auto& iter = _path_requests.find(link_entry._destination_hash);
-							if (iter != _path_requests.end()) {
+							const auto& iter = _instance->_path_requests.find(link_entry._destination_hash);
+							if (iter != _instance->_path_requests.end()) {
 								last_path_request = (*iter).second;
 							}
 
@@ -517,7 +464,7 @@ using namespace RNS::Utilities;
 
 				// Cull the path table
 				std::vector<Bytes> stale_paths;
-				for (const auto& [destination_hash, destination_entry] : _destination_table) {
+				for (const auto& [destination_hash, destination_entry] : _instance->_destination_table) {
 					const Interface& attached_interface = destination_entry.receiving_interface();
 					double destination_expiry;
 					if (attached_interface && attached_interface.mode() == Type::Interface::MODE_ACCESS_POINT) {
@@ -534,7 +481,7 @@ using namespace RNS::Utilities;
 						stale_paths.push_back(destination_hash);
 						DEBUG("Path to " + destination_hash.toHex() + " timed out and was removed");
 					}
-					else if (_interfaces.count(attached_interface.get_hash()) == 0) {
+					else if (_instance->_interfaces.count(attached_interface.get_hash()) == 0) {
 						stale_paths.push_back(destination_hash);
 						DEBUG("Path to " + destination_hash.toHex() + " was removed since the attached interface no longer exists");
 					}
@@ -542,7 +489,7 @@ using namespace RNS::Utilities;
 
 				// Cull the pending discovery path requests table
 				std::vector<Bytes> stale_discovery_path_requests;
-				for (const auto& [destination_hash, path_entry] : _discovery_path_requests) {
+				for (const auto& [destination_hash, path_entry] : _instance->_discovery_path_requests) {
 					if (OS::time() > path_entry._timeout) {
 						stale_discovery_path_requests.push_back(destination_hash);
 						DEBUG("Waiting path request for " + destination_hash.toString() + " timed out and was removed");
@@ -552,7 +499,7 @@ using namespace RNS::Utilities;
 				// Cull the tunnel table
 				count = 0;
 				std::vector<Bytes> stale_tunnels;
-				for (const auto& [tunnel_id, tunnel_entry] : _tunnels) {
+				for (const auto& [tunnel_id, tunnel_entry] : _instance->_tunnels) {
 					if (OS::time() > tunnel_entry._expires) {
 						stale_tunnels.push_back(tunnel_id);
 						TRACE("Tunnel " + tunnel_id.toHex() + " timed out and was removed");
@@ -587,7 +534,7 @@ using namespace RNS::Utilities;
 				dump_stats();
 //#endif
 
-				_tables_last_culled = OS::time();
+				_instance->_tables_last_culled = OS::time();
 			}
 
 			// CBA Periodically persist data
@@ -606,7 +553,7 @@ using namespace RNS::Utilities;
 		ERRORF("The contained exception was: %s", e.what());
 	}
 
-	_jobs_running = false;
+	_instance->_jobs_running = false;
 
 	// CBA send announce retransmission packets
 	for (auto& packet : outgoing) {
@@ -622,9 +569,9 @@ using namespace RNS::Utilities;
 /*static*/ void Transport::transmit(Interface& interface, const Bytes& raw) {
 	TRACE("Transport::transmit()");
 	// CBA
-	if (_callbacks._transmit_packet) {
+	if (_instance->_callbacks._transmit_packet) {
 		try {
-			_callbacks._transmit_packet(raw, interface);
+			_instance->_callbacks._transmit_packet(raw, interface);
 		}
 		catch (std::exception& e) {
 			DEBUG("Error while executing transmit packet callback. The contained exception was: " + std::string(e.what()));
@@ -682,7 +629,7 @@ using namespace RNS::Utilities;
 
 /*static*/ bool Transport::outbound(Packet& packet) {
 	TRACE("Transport::outbound()");
-	++_packets_sent;
+	++_instance->_packets_sent;
 
 	if (!packet.destination()) {
 		//throw std::invalid_argument("Can not send packet with no destination.");
@@ -692,22 +639,22 @@ using namespace RNS::Utilities;
 
 	TRACE("Transport::outbound: destination=" + packet.destination_hash().toHex() + " hops=" + std::to_string(packet.hops()));
 
-	while (_jobs_running) {
+	while (_instance->_jobs_running) {
 		TRACE("Transport::outbound: sleeping...");
 		OS::sleep(0.0005);
 	}
 
-	_jobs_locked = true;
+	_instance->_jobs_locked = true;
 
 	bool sent = false;
 	double outbound_time = OS::time();
 
 	// Check if we have a known path for the destination in the path table
     //if packet.packet_type != RNS.Packet.ANNOUNCE and packet.destination.type != RNS.Destination.PLAIN and packet.destination.type != RNS.Destination.GROUP and packet.destination_hash in Transport.destination_table:
-	if (packet.packet_type() != Type::Packet::ANNOUNCE && packet.destination().type() != Type::Destination::PLAIN && packet.destination().type() != Type::Destination::GROUP && _destination_table.find(packet.destination_hash()) != _destination_table.end()) {
+	if (packet.packet_type() != Type::Packet::ANNOUNCE && packet.destination().type() != Type::Destination::PLAIN && packet.destination().type() != Type::Destination::GROUP && _instance->_destination_table.find(packet.destination_hash()) != _instance->_destination_table.end()) {
 		TRACE("Transport::outbound: Path to destination is known");
         //outbound_interface = Transport.destination_table[packet.destination_hash][5]
-		DestinationEntry destination_entry = (*_destination_table.find(packet.destination_hash())).second;
+		DestinationEntry destination_entry = (*_instance->_destination_table.find(packet.destination_hash())).second;
 		Interface outbound_interface = destination_entry.receiving_interface();
 
 		// If there's more than one hop to the destination, and we know
@@ -748,7 +695,7 @@ using namespace RNS::Utilities;
 		// are "behind" a shared instance, we need to get that instance
 		// to transport it onto the network.
         //elif Transport.destination_table[packet.destination_hash][2] == 1 and Transport.owner.is_connected_to_shared_instance:
-		else if (destination_entry._hops == 1 && _owner.is_connected_to_shared_instance()) {
+		else if (destination_entry._hops == 1 && _instance->_owner.is_connected_to_shared_instance()) {
 			TRACE("Transport::outbound: Sending packet for directly connected interface to shared instance...");
 			if (packet.header_type() == Type::Packet::HEADER_1) {
 				// Insert packet into transport
@@ -787,262 +734,115 @@ using namespace RNS::Utilities;
 	// interface, or belongs to a link.
 	else {
 		TRACE("Transport::outbound: Path to destination is unknown");
-		bool stored_hash = false;
+
+		if (packet.destination().type() == Type::Destination::LINK) {
+			if (!packet.destination_link()) throw std::invalid_argument("Packet is not associated with a Link");
+		}
+
+		// CBA Everything that only depends on the packet is evaluated once here,
+		// leaving a cheap per-interface eligibility pass before fanout.
+		bool is_announce = (packet.packet_type() == Type::Packet::ANNOUNCE);
+		bool link_closed = (packet.destination().type() == Type::Destination::LINK && packet.destination_link().status() == Type::Link::CLOSED);
+		if (link_closed) {
+			TRACE("Transport::outbound: Packet destination is link-closed, not transmitting");
+		}
+		// Interface modes on which this packet may not be broadcast
+		uint8_t blocked_modes = 0;
+		if (is_announce && !packet.attached_interface()) {
+			TRACE("Transport::outbound: Packet has no attached interface");
+			blocked_modes = announce_blocked_modes(packet);
+		}
+		// Currently, annouces originating locally are always
+		// allowed, and do not conform to bandwidth caps.
+		// TODO: Rethink whether this is actually optimal.
+		bool announce_capped = (is_announce && !packet.attached_interface() && packet.hops() > 0);
+
+		// Eligibility pass
+		std::vector<Interface*> eligible;
+		eligible.reserve(_instance->_interfaces.size());
 #if defined(INTERFACES_SET)
-		for (const Interface& interface : _interfaces) {
+		for (const Interface& interface : _instance->_interfaces) {
 #elif defined(INTERFACES_LIST)
-		for (Interface& interface : _interfaces) {
+		for (Interface& interface : _instance->_interfaces) {
 #elif defined(INTERFACES_MAP)
-		for (auto& [hash, interface] : _interfaces) {
-#endif
-			TRACE("Transport::outbound: Checking interface " + interface.toString());
-			if (interface.OUT()) {
-				bool should_transmit = true;
-
-				if (packet.destination().type() == Type::Destination::LINK) {
-					if (!packet.destination_link()) throw std::invalid_argument("Packet is not associated with a Link");
-					if (packet.destination_link().status() == Type::Link::CLOSED) {
-						TRACE("Transport::outbound: Pscket destination is link-closed, not transmitting");
-						should_transmit = false;
-					}
-					// CBA Bug? Destination has no member attached_interface
-					//z if (interface != packet.destination().attached_interface()) {
-					//z 	should_transmit = false;
-					//z }
-				}
-				
-				if (packet.attached_interface() && interface != packet.attached_interface()) {
-					TRACE("Transport::outbound: Packet has wrong attached interface, not transmitting");
-					should_transmit = false;
-				}
-
-				if (packet.packet_type() == Type::Packet::ANNOUNCE) {
-					if (!packet.attached_interface()) {
-						TRACE("Transport::outbound: Packet has no attached interface");
-						if (interface.mode() == Type::Interface::MODE_ACCESS_POINT) {
-							TRACE("Blocking announce broadcast on " + interface.toString() + " due to AP mode");
-							should_transmit = false;
-						}
-						else if (interface.mode() == Type::Interface::MODE_ROAMING) {
-							//local_destination = next((d for d in Transport.destinations if d.hash == packet.destination_hash), None)
-							//Destination local_destination({Type::NONE});
-#if defined(DESTINATIONS_SET)
-							bool found_local = false;
-							for (auto& destination : _destinations) {
-								if (destination.hash() == packet.destination_hash()) {
-									//local_destination = destination;
-									found_local = true;
-									break;
-								}
-							}
-                            //if local_destination != None:
-							//if (local_destination) {
-							if (found_local) {
-#elif defined(DESTINATIONS_MAP)
-							auto iter = _destinations.find(packet.destination_hash());
-							//if (iter != _destinations.end()) {
-							//	local_destination = (*iter).second;
-							//}
-							if (iter != _destinations.end()) {
-#endif
-								TRACE("Allowing announce broadcast on roaming-mode interface from instance-local destination");
-							}
-							else {
-								const Interface& from_interface = next_hop_interface(packet.destination_hash());
-								//if from_interface == None or not hasattr(from_interface, "mode"):
-								if (!from_interface || from_interface.mode() == Type::Interface::MODE_NONE) {
-									should_transmit = false;
-									if (!from_interface) {
-										TRACE("Blocking announce broadcast on " + interface.toString() + " since next hop interface doesn't exist");
-									}
-									else if (from_interface.mode() == Type::Interface::MODE_NONE) {
-										TRACE("Blocking announce broadcast on " + interface.toString() + " since next hop interface has no mode configured");
-									}
-								}
-								else {
-									if (from_interface.mode() == Type::Interface::MODE_ROAMING) {
-										TRACE("Blocking announce broadcast on " + interface.toString() + " due to roaming-mode next-hop interface");
-										should_transmit = false;
-									}
-									else if (from_interface.mode() == Type::Interface::MODE_BOUNDARY) {
-										TRACE("Blocking announce broadcast on " + interface.toString() + " due to boundary-mode next-hop interface");
-										should_transmit = false;
-									}
-								}
-							}
-						}
-						else if (interface.mode() == Type::Interface::MODE_BOUNDARY) {
-							//local_destination = next((d for d in Transport.destinations if d.hash == packet.destination_hash), None)
-							// next and filter pattern?
-							// next(iterable, default)
-							// list comprehension: [x for x in xyz if x in a]
-							// CBA TODO confirm that above pattern just selects the first matching destination
-#if defined(DESTINATIONS_SET)
-							//Destination local_destination({Type::Destination::NONE});
-							bool found_local = false;
-							for (auto& destination : _destinations) {
-								if (destination.hash() == packet.destination_hash()) {
-									//local_destination = destination;
-									found_local = true;
-									break;
-								}
-							}
-                            //if local_destination != None:
-							//if (local_destination) {
-							if (found_local) {
-#elif defined(DESTINATIONS_MAP)
-							auto iter = _destinations.find(packet.destination_hash());
-							if (iter != _destinations.end()) {
+		for (auto& [hash, interface] : _instance->_interfaces) {
 #endif
-								TRACE("Allowing announce broadcast on boundary-mode interface from instance-local destination");
-							}
-							else {
-								const Interface& from_interface = next_hop_interface(packet.destination_hash());
-								if (!from_interface || from_interface.mode() == Type::Interface::MODE_NONE) {
-									should_transmit = false;
-									if (!from_interface) {
-										TRACE("Blocking announce broadcast on " + interface.toString() + " since next hop interface doesn't exist");
-									}
-									else if (from_interface.mode() == Type::Interface::MODE_NONE) {
-										TRACE("Blocking announce broadcast on "  + interface.toString() + " since next hop interface has no mode configured");
-									}
-								}
-								else {
-									if (from_interface.mode() == Type::Interface::MODE_ROAMING) {
-										TRACE("Blocking announce broadcast on " + interface.toString() + " due to roaming-mode next-hop interface");
-										should_transmit = false;
-									}
-								}
-							}
-						}
-						else {
-							// Currently, annouces originating locally are always
-							// allowed, and do not conform to bandwidth caps.
-							// TODO: Rethink whether this is actually optimal.
-							if (packet.hops() > 0) {
-
-// TODO
-/*p
-								if not hasattr(interface, "announce_cap"):
-									interface.announce_cap = RNS.Reticulum.ANNOUNCE_CAP
+			if (!interface.OUT() || link_closed) {
+				continue;
+			}
 
-								if not hasattr(interface, "announce_allowed_at"):
-									interface.announce_allowed_at = 0
+			if (packet.attached_interface() && interface != packet.attached_interface()) {
+				TRACE("Transport::outbound: Packet has wrong attached interface, not transmitting on " + interface.toString());
+				continue;
+			}
 
-								if not hasattr(interface, "announce_queue"):
-										interface.announce_queue = []
-*/
+			if (blocked_modes & interface.mode()) {
+				TRACE("Blocking announce broadcast on " + interface.toString() + " due to interface mode");
+				continue;
+			}
 
-								bool queued_announces = (interface.announce_queue().size() > 0);
-								if (!queued_announces && outbound_time > interface.announce_allowed_at()) {
-									uint16_t wait_time = 0;
-									if (interface.bitrate() > 0 && interface.announce_cap() > 0) {
-										uint16_t tx_time = (packet.raw().size() * 8) / interface.bitrate();
-										wait_time = (tx_time / interface.announce_cap());
-									}
+			// CBA Roaming and boundary interfaces are exempt from the announce cap
+			if (announce_capped && !(interface.mode() & (Type::Interface::MODE_ROAMING | Type::Interface::MODE_BOUNDARY))) {
+				if (interface.announce_queue().size() == 0 && outbound_time > interface.announce_allowed_at()) {
+					double wait_time = interface.announce_wait_time(packet.raw().size());
 #if defined(INTERFACES_SET)
-									const_cast<Interface&>(interface).announce_allowed_at(outbound_time + wait_time);
+					const_cast<Interface&>(interface).announce_allowed_at(outbound_time + wait_time);
 #else
-									interface.announce_allowed_at(outbound_time + wait_time);
+					interface.announce_allowed_at(outbound_time + wait_time);
 #endif
-								}
-								else {
-									should_transmit = false;
-									if (interface.announce_queue().size() < Type::Reticulum::MAX_QUEUED_ANNOUNCES) {
-										bool should_queue = true;
-										for (auto& entry : interface.announce_queue()) {
-											if (entry._destination == packet.destination_hash()) {
-												uint64_t emission_timestamp = announce_emitted(packet);
-												should_queue = false;
-												if (emission_timestamp > entry._emitted) {
-													entry._time = outbound_time;
-													entry._hops = packet.hops();
-													entry._emitted = emission_timestamp;
-													entry._raw = packet.raw();
-												}
-												break;
-											}
-										}
-										if (should_queue) {
-											RNS::AnnounceEntry entry(
-												packet.destination_hash(),
-												outbound_time,
-												packet.hops(),
-												announce_emitted(packet),
-												packet.raw()
-											);
-
-											queued_announces = (interface.announce_queue().size() > 0);
+				}
+				else {
+					// CBA Interface keeps only the newest emission per destination
+					// and enforces MAX_QUEUED_ANNOUNCES
+					RNS::AnnounceEntry entry(
+						packet.destination_hash(),
+						outbound_time,
+						packet.hops(),
+						announce_emitted(packet),
+						packet.raw()
+					);
 #if defined(INTERFACES_SET)
-											const_cast<Interface&>(interface).add_announce(entry);
+					const_cast<Interface&>(interface).add_announce(entry);
 #else
-											// CBA ACCUMULATES
-											interface.add_announce(entry);
+					// CBA ACCUMULATES
+					interface.add_announce(entry);
 #endif
 
-											if (!queued_announces) {
-												double wait_time = std::max(interface.announce_allowed_at() - OS::time(), (double)0);
-
-												// CBA TODO THREAD?
-												//z timer = threading.Timer(wait_time, interface.process_announce_queue)
-												//z timer.start()
-
-												if (wait_time < 1000) {
-													TRACE("Added announce to queue (height " + std::to_string(interface.announce_queue().size()) + ") on " + interface.toString() + " for processing in " + std::to_string((int)wait_time) + " ms");
-												}
-												else {
-													TRACE("Added announce to queue (height " + std::to_string(interface.announce_queue().size()) + ") on " + interface.toString() + " for processing in " + std::to_string(OS::round(wait_time/1000,1)) + " s");
-												}
-											}
-											else {
-												double wait_time = std::max(interface.announce_allowed_at() - OS::time(), (double)0);
-												if (wait_time < 1000) {
-													TRACE("Added announce to queue (height " + std::to_string(interface.announce_queue().size()) + ") on " + interface.toString() + " for processing in " + std::to_string((int)wait_time) + " ms");
-												}
-												else {
-													TRACE("Added announce to queue (height " + std::to_string(interface.announce_queue().size()) + ") on " + interface.toString() + " for processing in " + std::to_string(OS::round(wait_time/1000,1)) + " s");
-												}
-											}
-										}
-									}
-									else {
-										//p pass
-									}
-								}
-							}
-							else {
-								//p pass
-							}
-						}
-					}
+					// CBA Queue is drained from jobs() once announce_allowed_at has passed
+					double wait_time = std::max(interface.announce_allowed_at() - OS::time(), (double)0);
+					TRACE("Added announce to queue (height " + std::to_string(interface.announce_queue().size()) + ") on " + interface.toString() + " for processing in " + std::to_string(OS::round(wait_time,1)) + " s");
+					continue;
 				}
-						
-				if (should_transmit) {
-					TRACE("Transport::outbound: Packet transmission allowed");
-					if (!stored_hash) {
-						// CBA ACCUMULATES
-						_packet_hashlist.insert(packet.packet_hash());
-						stored_hash = true;
-					}
-
-					// TODO: Re-evaluate potential for blocking
-					// def send_packet():
-					//     Transport.transmit(interface, packet.raw)
-					// thread = threading.Thread(target=send_packet)
-					// thread.daemon = True
-					// thread.start()
+			}
 
 #if defined(INTERFACES_SET)
-					transmit(const_cast<Interface&>(interface), packet.raw());
+			eligible.push_back(&const_cast<Interface&>(interface));
 #else
-					transmit(interface, packet.raw());
+			eligible.push_back(&interface);
 #endif
-					sent = true;
-				}
-				else {
-					TRACE("Transport::outbound: Packet transmission refused");
-				}
+		}
+
+		// Fanout pass
+		if (eligible.size() > 0) {
+			TRACE("Transport::outbound: Packet transmission allowed on " + std::to_string(eligible.size()) + " interfaces");
+			// CBA ACCUMULATES
+			_instance->_packet_hashlist.insert(packet.packet_hash());
+
+			// TODO: Re-evaluate potential for blocking
+			// def send_packet():
+			//     Transport.transmit(interface, packet.raw)
+			// thread = threading.Thread(target=send_packet)
+			// thread.daemon = True
+			// thread.start()
+
+			// The raw packet is refcounted, every interface transmits the same buffer
+			for (Interface* interface : eligible) {
+				transmit(*interface, packet.raw());
 			}
+			sent = true;
+		}
+		else {
+			TRACE("Transport::outbound: Packet transmission refused");
 		}
 	}
 
@@ -1064,13 +864,13 @@ using namespace RNS::Utilities;
 			PacketReceipt receipt(packet);
 			packet.receipt(receipt);
 			// CBA ACCUMULATES
-			_receipts.push_back(receipt);
+			_instance->_receipts.push_back(receipt);
 		}
 		
 		cache_packet(packet);
 	}
 
-	_jobs_locked = false;
+	_instance->_jobs_locked = false;
 	return sent;
 }
 
@@ -1129,7 +929,7 @@ using namespace RNS::Utilities;
 		}
 	}
 
-	if (_packet_hashlist.find(packet.packet_hash()) == _packet_hashlist.end()) {
+	if (_instance->_packet_hashlist.find(packet.packet_hash()) == _instance->_packet_hashlist.end()) {
 		TRACE("Transport::packet_filter: packet not previously seen");
 		return true;
 	}
@@ -1152,11 +952,11 @@ using namespace RNS::Utilities;
 
 /*static*/ void Transport::inbound(const Bytes& raw, const Interface& interface /*= {Type::NONE}*/) {
 	TRACE("Transport::inbound()");
-	++_packets_received;
+	++_instance->_packets_received;
 	// CBA
-	if (_callbacks._receive_packet) {
+	if (_instance->_callbacks._receive_packet) {
 		try {
-			_callbacks._receive_packet(raw, interface);
+			_instance->_callbacks._receive_packet(raw, interface);
 		}
 		catch (std::exception& e) {
 			DEBUG("Error while executing receive packet callback. The contained exception was: " + std::string(e.what()));
@@ -1230,17 +1030,17 @@ using namespace RNS::Utilities;
 	}
 */
 
-	while (_jobs_running) {
+	while (_instance->_jobs_running) {
 		TRACE("Transport::inbound: sleeping...");
 		OS::sleep(0.0005);
 	}
 
-	if (!_identity) {
+	if (!_instance->_identity) {
 		WARNING("Transport::inbound: No identity!");
 		return;
 	}
 
-	_jobs_locked = true;
+	_instance->_jobs_locked = true;
 
 	Packet packet(RNS::Destination(RNS::Type::NONE), raw);
 	if (!packet.unpack()) {
@@ -1279,7 +1079,7 @@ using namespace RNS::Utilities;
 	}
 */
 
-	if (_local_client_interfaces.size() > 0) {
+	if (_instance->_local_client_interfaces.size() > 0) {
 		if (is_local_client_interface(interface)) {
 			packet.hops(packet.hops() - 1);
 		}
@@ -1291,9 +1091,9 @@ using namespace RNS::Utilities;
 	//if (packet_filter(packet)) {
 	// CBA
 	bool accept = true;
-	if (_callbacks._filter_packet) {
+	if (_instance->_callbacks._filter_packet) {
 		try {
-			accept = _callbacks._filter_packet(packet);
+			accept = _instance->_callbacks._filter_packet(packet);
 		}
 		catch (std::exception& e) {
 			DEBUG("Error while executing filter packet callback. The contained exception was: " + std::string(e.what()));
@@ -1305,13 +1105,13 @@ using namespace RNS::Utilities;
 	if (accept) {
 		TRACE("Transport::inbound: Packet accepted by filter");
 		// CBA ACCUMULATES
-		_packet_hashlist.insert(packet.packet_hash());
+		_instance->_packet_hashlist.insert(packet.packet_hash());
 		cache_packet(packet);
 		
 		// Check special conditions for local clients connected
 		// through a shared Reticulum instance
 		//p from_local_client         = (packet.receiving_interface in Transport.local_client_interfaces)
-		bool from_local_client         = (_local_client_interfaces.find(packet.receiving_interface()) != _local_client_interfaces.end());
+		bool from_local_client         = (_instance->_local_client_interfaces.find(packet.receiving_interface()) != _instance->_local_client_interfaces.end());
 		//p for_local_client          = (packet.packet_type != RNS.Packet.ANNOUNCE) and (packet.destination_hash in Transport.destination_table and Transport.destination_table[packet.destination_hash][2] == 0)
 		//p for_local_client_link     = (packet.packet_type != RNS.Packet.ANNOUNCE) and (packet.destination_hash in Transport.link_table and Transport.link_table[packet.destination_hash][4] in Transport.local_client_interfaces)
 		//p for_local_client_link    |= (packet.packet_type != RNS.Packet.ANNOUNCE) and (packet.destination_hash in Transport.link_table and Transport.link_table[packet.destination_hash][2] in Transport.local_client_interfaces)
@@ -1320,22 +1120,22 @@ using namespace RNS::Utilities;
 		bool for_local_client = false;
 		bool for_local_client_link = false;
 		if (packet.packet_type() != Type::Packet::ANNOUNCE) {
-			auto destination_iter = _destination_table.find(packet.destination_hash());
-			if (destination_iter != _destination_table.end()) {
+			auto destination_iter = _instance->_destination_table.find(packet.destination_hash());
+			if (destination_iter != _instance->_destination_table.end()) {
 				DestinationEntry destination_entry = (*destination_iter).second;
 			 	if (destination_entry._hops == 0) {
 					// Destined for a local destination
 					for_local_client = true;
 				}
 			}
-			auto link_iter = _link_table.find(packet.destination_hash());
-			if (link_iter != _link_table.end()) {
+			auto link_iter = _instance->_link_table.find(packet.destination_hash());
+			if (link_iter != _instance->_link_table.end()) {
 				LinkEntry link_entry = (*link_iter).second;
-			 	if (_local_client_interfaces.find(link_entry._receiving_interface) != _local_client_interfaces.end()) {
+			 	if (_instance->_local_client_interfaces.find(link_entry._receiving_interface) != _instance->_local_client_interfaces.end()) {
 					// Destined for a local link
 					for_local_client_link = true;
 				}
-			 	if (_local_client_interfaces.find(link_entry._outbound_interface) != _local_client_interfaces.end()) {
+			 	if (_instance->_local_client_interfaces.find(link_entry._outbound_interface) != _instance->_local_client_interfaces.end()) {
 					// Destined for a local link
 					for_local_client_link = true;
 				}
@@ -1345,10 +1145,10 @@ using namespace RNS::Utilities;
 		// Determine if packet is proof for local destination???
 		//p proof_for_local_client    = (packet.destination_hash in Transport.reverse_table) and (Transport.reverse_table[packet.destination_hash][0] in Transport.local_client_interfaces)
 		bool proof_for_local_client = false;
-		auto reverse_iter = _reverse_table.find(packet.destination_hash());
-		if (reverse_iter != _reverse_table.end()) {
+		auto reverse_iter = _instance->_reverse_table.find(packet.destination_hash());
+		if (reverse_iter != _instance->_reverse_table.end()) {
 			ReverseEntry reverse_entry = (*reverse_iter).second;
-			if (_local_client_interfaces.find(reverse_entry._receiving_interface) != _local_client_interfaces.end()) {
+			if (_instance->_local_client_interfaces.find(reverse_entry._receiving_interface) != _instance->_local_client_interfaces.end()) {
 				// Proof for local destination???
 				proof_for_local_client = true;
 			}
@@ -1359,17 +1159,17 @@ using namespace RNS::Utilities;
 		// never injected into transport.
 
 		// If packet is not destined for a local transport-specific destination
-		if (_control_hashes.find(packet.destination_hash()) == _control_hashes.end()) {
+		if (_instance->_control_hashes.find(packet.destination_hash()) == _instance->_control_hashes.end()) {
 			// If packet is destination type PLAIN and transport type BROADCAST
 			if (packet.destination_type() == Type::Destination::PLAIN && packet.transport_type() == Type::Transport::BROADCAST) {
 				// Send to all interfaces except the one the packet was recieved on
 				if (from_local_client) {
 #if defined(INTERFACES_SET)
-					for (const Interface& interface : _interfaces) {
+					for (const Interface& interface : _instance->_interfaces) {
 #elif defined(INTERFACES_LIST)
-					for (Interface& interface : _interfaces) {
+					for (Interface& interface : _instance->_interfaces) {
 #elif defined(INTERFACES_MAP)
-					for (auto& [hash, interface] : _interfaces) {
+					for (auto& [hash, interface] : _instance->_interfaces) {
 #endif
 						if (interface != packet.receiving_interface()) {
 							TRACE("Transport::inbound: Broadcasting packet on " + interface.toString());
@@ -1384,7 +1184,7 @@ using namespace RNS::Utilities;
 				// If the packet was not from a local client, send
 				// it directly to all local clients
 				else {
-					for (const Interface& interface : _local_client_interfaces) {
+					for (const Interface& interface : _instance->_local_client_interfaces) {
 						TRACE("Transport::inbound: Broadcasting packet on " + interface.toString());
 						transmit(const_cast<Interface&>(interface), packet.raw());
 					}
@@ -1411,7 +1211,7 @@ using namespace RNS::Utilities;
 			// implementation can handle the packet.
 			if (!packet.transport_id() && for_local_client) {
 				TRACE("Transport::inbound: Regenerating transport id");
-				packet.transport_id(_identity.hash());
+				packet.transport_id(_instance->_identity.hash());
 			}
 
 			// If this is a cache request, and we can fullfill
@@ -1429,10 +1229,10 @@ using namespace RNS::Utilities;
 			// accordingly if we are.
 			if (packet.transport_id() && packet.packet_type() != Type::Packet::ANNOUNCE) {
 				TRACE("Transport::inbound: Packet is in transport...");
-				if (packet.transport_id() == _identity.hash()) {
+				if (packet.transport_id() == _instance->_identity.hash()) {
 					TRACE("Transport::inbound: We are designated next-hop");
-					auto destination_iter = _destination_table.find(packet.destination_hash());
-					if (destination_iter != _destination_table.end()) {
+					auto destination_iter = _instance->_destination_table.find(packet.destination_hash());
+					if (destination_iter != _instance->_destination_table.end()) {
 						TRACE("Transport::inbound: Found next-hop path to destination");
 						DestinationEntry destination_entry = (*destination_iter).second;
 						Bytes next_hop = destination_entry._received_from;
@@ -1477,6 +1277,30 @@ using namespace RNS::Utilities;
 
 						if (packet.packet_type() == Type::Packet::LINKREQUEST) {
 							TRACE("Transport::inbound: Packet is next-hop LINKREQUEST");
+							// Keep the signalled link MTU at the minimum along the path
+							//p path_mtu = RNS.Link.mtu_from_lr_packet(packet)
+							uint16_t path_mtu = Link::mtu_from_lr_packet(packet);
+							if (path_mtu) {
+								if (outbound_interface.HW_MTU() == 0) {
+									DEBUG("No next-hop HW MTU, disabling link MTU upgrade");
+									new_raw = new_raw.left(new_raw.size() - Type::Link::LINK_MTU_SIZE);
+								}
+								else if (!outbound_interface.AUTOCONFIGURE_MTU() && !outbound_interface.FIXED_MTU()) {
+									DEBUG("Outbound interface doesn't support MTU autoconfiguration, disabling link MTU upgrade");
+									new_raw = new_raw.left(new_raw.size() - Type::Link::LINK_MTU_SIZE);
+								}
+								else if (outbound_interface.HW_MTU() < path_mtu) {
+									try {
+										Bytes clamped_mtu = Link::signalling_bytes(outbound_interface.HW_MTU(), Link::mode_from_lr_packet(packet));
+										DEBUGF("Clamping link MTU to %d", outbound_interface.HW_MTU());
+										new_raw = new_raw.left(new_raw.size() - Type::Link::LINK_MTU_SIZE) + clamped_mtu;
+									}
+									catch (std::exception& e) {
+										DEBUGF("Could not clamp link MTU, disabling link MTU upgrade. The contained exception was: %s", e.what());
+										new_raw = new_raw.left(new_raw.size() - Type::Link::LINK_MTU_SIZE);
+									}
+								}
+							}
 							double now = OS::time();
 							double proof_timeout = now + Type::Link::ESTABLISHMENT_TIMEOUT_PER_HOP * std::max((uint8_t)1, remaining_hops);
 							LinkEntry link_entry(
@@ -1491,7 +1315,7 @@ using namespace RNS::Utilities;
 								proof_timeout
 							);
 							// CBA ACCUMULATES
-							_link_table.insert({packet.getTruncatedHash(), link_entry});
+							_instance->_link_table.insert({packet.getTruncatedHash(), link_entry});
 						}
 						else {
 							TRACE("Transport::inbound: Packet is next-hop other type");
@@ -1501,7 +1325,7 @@ using namespace RNS::Utilities;
 								OS::time()
 							);
 							// CBA ACCUMULATES
-							_reverse_table.insert({packet.getTruncatedHash(), reverse_entry});
+							_instance->_reverse_table.insert({packet.getTruncatedHash(), reverse_entry});
 						}
 						TRACE("Transport::outbound: Sending packet to next hop...");
 #if defined(INTERFACES_SET)
@@ -1530,8 +1354,8 @@ using namespace RNS::Utilities;
 			// to entries in the link tables
 			if (packet.packet_type() != Type::Packet::ANNOUNCE && packet.packet_type() != Type::Packet::LINKREQUEST && packet.context() != Type::Packet::LRPROOF) {
 				TRACE("Transport::inbound: Checking if packet is meant for link transport...");
-				auto link_iter = _link_table.find(packet.destination_hash());
-				if (link_iter != _link_table.end()) {
+				auto link_iter = _instance->_link_table.find(packet.destination_hash());
+				if (link_iter != _instance->_link_table.end()) {
 					TRACE("Transport::inbound: Found link entry, handling link transport");
 					LinkEntry link_entry = (*link_iter).second;
 					// If receiving and outbound interface is
@@ -1601,7 +1425,7 @@ using namespace RNS::Utilities;
 #if defined(DESTINATIONS_SET)
 			//Destination local_destination({Type::NONE});
 			bool found_local = false;
-			for (auto& destination : _destinations) {
+			for (auto& destination : _instance->_destinations) {
 				if (destination.hash() == packet.destination_hash()) {
 					//local_destination = destination;
 					found_local = true;
@@ -1612,8 +1436,8 @@ using namespace RNS::Utilities;
 			//if (!local_destination && Identity::validate_announce(packet)) {
 			if (!found_local && Identity::validate_announce(packet)) {
 #elif defined(DESTINATIONS_MAP)
-			auto iter = _destinations.find(packet.destination_hash());
-			if (iter == _destinations.end() && Identity::validate_announce(packet)) {
+			auto iter = _instance->_destinations.find(packet.destination_hash());
+			if (iter == _instance->_destinations.end() && Identity::validate_announce(packet)) {
 #endif
 				TRACE("Transport::inbound: Packet is announce for non-local destination, processing...");
 				if (packet.transport_id()) {
@@ -1622,16 +1446,16 @@ using namespace RNS::Utilities;
 					// Check if this is a next retransmission from
 					// another node. If it is, we're removing the
 					// announce in question from our pending table
-					if (Reticulum::transport_enabled() && _announce_table.count(packet.destination_hash()) > 0) {
+					if (Reticulum::transport_enabled() && _instance->_announce_table.count(packet.destination_hash()) > 0) {
 						//AnnounceEntry& announce_entry = _announce_table[packet.destination_hash()];
-						AnnounceEntry& announce_entry = (*_announce_table.find(packet.destination_hash())).second;
+						AnnounceEntry& announce_entry = (*_instance->_announce_table.find(packet.destination_hash())).second;
 						
 						if ((packet.hops() - 1) == announce_entry._hops) {
 							DEBUG("Heard a local rebroadcast of announce for " + packet.destination_hash().toHex());
 							announce_entry._local_rebroadcasts += 1;
 							if (announce_entry._local_rebroadcasts >= LOCAL_REBROADCASTS_MAX) {
 								DEBUG("Max local rebroadcasts of announce for " + packet.destination_hash().toHex() + " reached, dropping announce from our table");
-								_announce_table.erase(packet.destination_hash());
+								_instance->_announce_table.erase(packet.destination_hash());
 							}
 						}
 
@@ -1639,7 +1463,7 @@ using namespace RNS::Utilities;
 							double now = OS::time();
 							if (now < announce_entry._timestamp) {
 								DEBUG("Rebroadcasted announce for " + packet.destination_hash().toHex() + " has been passed on to another node, no further tries needed");
-								_announce_table.erase(packet.destination_hash());
+								_instance->_announce_table.erase(packet.destination_hash());
 							}
 						}
 					}
@@ -1658,7 +1482,7 @@ using namespace RNS::Utilities;
 				//if (not any(packet.destination_hash == d.hash for d in Transport.destinations) and packet.hops < Transport.PATHFINDER_M+1):
 #if defined(DESTINATIONS_SET)
 				bool found_local = false;
-				for (auto& destination : _destinations) {
+				for (auto& destination : _instance->_destinations) {
 					if (destination.hash() == packet.destination_hash()) {
 						found_local = true;
 						break;
@@ -1666,8 +1490,8 @@ using namespace RNS::Utilities;
 				}
 				if (!found_local && packet.hops() < (PATHFINDER_M+1)) {
 #elif defined(DESTINATIONS_MAP)
-				auto iter = _destinations.find(packet.destination_hash());
-				if (iter == _destinations.end() && packet.hops() < (PATHFINDER_M+1)) {
+				auto iter = _instance->_destinations.find(packet.destination_hash());
+				if (iter == _instance->_destinations.end() && packet.hops() < (PATHFINDER_M+1)) {
 #endif
 					uint64_t announce_emitted = Transport::announce_emitted(packet);
 
@@ -1676,8 +1500,8 @@ using namespace RNS::Utilities;
 					//p random_blobs = []
 					std::set<Bytes> empty_random_blobs;
 					std::set<Bytes>& random_blobs = empty_random_blobs;
-					auto iter = _destination_table.find(packet.destination_hash());
-					if (iter != _destination_table.end()) {
+					auto iter = _instance->_destination_table.find(packet.destination_hash());
+					if (iter != _instance->_destination_table.end()) {
 						DestinationEntry destination_entry = (*iter).second;
 						//p random_blobs = Transport.destination_table[packet.destination_hash][4]
 						random_blobs = destination_entry._random_blobs;
@@ -1836,7 +1660,7 @@ using namespace RNS::Utilities;
 									attached_interface
 								);
 								// CBA ACCUMULATES
-								_announce_table.insert({packet.destination_hash(), announce_entry});
+								_instance->_announce_table.insert({packet.destination_hash(), announce_entry});
 							}
 						}
 						// TODO: Check from_local_client once and store result
@@ -1845,8 +1669,8 @@ using namespace RNS::Utilities;
 							// check if any external interfaces have pending
 							// path requests.
 							//p if packet.destination_hash in Transport.pending_local_path_requests:
-							auto iter = _pending_local_path_requests.find(packet.destination_hash());
-							if (iter != _pending_local_path_requests.end()) {
+							auto iter = _instance->_pending_local_path_requests.find(packet.destination_hash());
+							if (iter != _instance->_pending_local_path_requests.end()) {
 								//p desiring_interface = Transport.pending_local_path_requests.pop(packet.destination_hash)
 								//const Interface& desiring_interface = (*iter).second;
 								retransmit_timeout = now;
@@ -1864,13 +1688,13 @@ using namespace RNS::Utilities;
 									attached_interface
 								);
 								// CBA ACCUMULATES
-								_announce_table.insert({packet.destination_hash(), announce_entry});
+								_instance->_announce_table.insert({packet.destination_hash(), announce_entry});
 							}
 						}
 
 						// If we have any local clients connected, we re-
 						// transmit the announce to them immediately
-						if (_local_client_interfaces.size() > 0) {
+						if (_instance->_local_client_interfaces.size() > 0) {
 							Identity announce_identity(Identity::recall(packet.destination_hash()));
 							//Destination announce_destination(announce_identity, Type::Destination::OUT, Type::Destination::SINGLE, "unknown", "unknown");
 							//announce_destination.hash(packet.destination_hash());
@@ -1881,7 +1705,7 @@ using namespace RNS::Utilities;
 
 							// TODO: Shouldn't the context be PATH_RESPONSE in the first case here?
 							if (Transport::from_local_client(packet) && packet.context() == Type::Packet::PATH_RESPONSE) {
-								for (const Interface& local_interface : _local_client_interfaces) {
+								for (const Interface& local_interface : _instance->_local_client_interfaces) {
 									if (packet.receiving_interface() != local_interface) {
 										Packet new_announce(
 											announce_destination,
@@ -1891,7 +1715,7 @@ using namespace RNS::Utilities;
 											announce_context,
 											Type::Transport::TRANSPORT,
 											Type::Packet::HEADER_2,
-											_identity.hash()
+											_instance->_identity.hash()
 										);
 
 										new_announce.hops(packet.hops());
@@ -1900,7 +1724,7 @@ using namespace RNS::Utilities;
 								}
 							}
 							else {
-								for (const Interface& local_interface : _local_client_interfaces) {
+								for (const Interface& local_interface : _instance->_local_client_interfaces) {
 									if (packet.receiving_interface() != local_interface) {
 										Packet new_announce(
 											announce_destination,
@@ -1910,7 +1734,7 @@ using namespace RNS::Utilities;
 											announce_context,
 											Type::Transport::TRANSPORT,
 											Type::Packet::HEADER_2,
-											_identity.hash()
+											_instance->_identity.hash()
 										);
 
 										new_announce.hops(packet.hops());
@@ -1923,8 +1747,8 @@ using namespace RNS::Utilities;
 						// If we have any waiting discovery path requests
 						// for this destination, we retransmit to that
 						// interface immediately
-						auto iter = _discovery_path_requests.find(packet.destination_hash());
-						if (iter != _discovery_path_requests.end()) {
+						auto iter = _instance->_discovery_path_requests.find(packet.destination_hash());
+						if (iter != _instance->_discovery_path_requests.end()) {
 							PathRequestEntry& pr_entry = (*iter).second;
 							attached_interface = pr_entry._requesting_interface;
 
@@ -1945,7 +1769,7 @@ using namespace RNS::Utilities;
 								Type::Packet::PATH_RESPONSE,
 								Type::Transport::TRANSPORT,
 								Type::Packet::HEADER_2,
-								_identity.hash()
+								_instance->_identity.hash()
 							);
 
 							new_announce.hops(packet.hops());
@@ -1975,11 +1799,16 @@ using namespace RNS::Utilities;
 							packet.get_hash()
 						);
 						// CBA ACCUMULATES
-						if (_destination_table.insert({packet.destination_hash(), destination_table_entry}).second) {
-							++_destinations_added;
+						if (_instance->_destination_table.insert({packet.destination_hash(), destination_table_entry}).second) {
+							++_instance->_destinations_added;
 							cull_path_table();
 						}
 
+						// Notify anyone waiting on a path request for this destination
+						if (_instance->_path_requests_in_flight.count(packet.destination_hash()) > 0) {
+							path_request_concluded(packet.destination_hash(), true);
+						}
+
 						DEBUG("Destination " + packet.destination_hash().toHex() + " is now " + std::to_string(announce_hops) + " hops away via " + received_from.toHex() + " on " + packet.receiving_interface().toString());
 						//TRACE("Transport::inbound: Destination " + packet.destination_hash().toHex() + " has data: " + packet.data().toHex());
 						//TRACE("Transport::inbound: Destination " + packet.destination_hash().toHex() + " has text: " + packet.data().toString());
@@ -2002,7 +1831,7 @@ using namespace RNS::Utilities;
 						// wanting to know when an announce arrives
 						if (packet.context() != Type::Packet::PATH_RESPONSE) {
 							TRACE("Transport::inbound: Not path response, sending to announce handler...");
-							for (auto& handler : _announce_handlers) {
+							for (auto& handler : _instance->_announce_handlers) {
 								TRACE("Transport::inbound: Checking filter of announce handler...");
 								try {
 									// Check that the announced destination matches
@@ -2049,14 +1878,14 @@ using namespace RNS::Utilities;
 		// Handling for link requests to local destinations
 		else if (packet.packet_type() == Type::Packet::LINKREQUEST) {
 			TRACE("Transport::inbound: Packet is LINKREQUEST");
-			if (!packet.transport_id() || packet.transport_id() == _identity.hash()) {
+			if (!packet.transport_id() || packet.transport_id() == _instance->_identity.hash()) {
 				TRACE("Transport::inbound: Checking if LINKREQUEST is for local destination");
 #if defined(DESTINATIONS_SET)
-				for (auto& destination : _destinations) {
+				for (auto& destination : _instance->_destinations) {
 					if (destination.hash() == packet.destination_hash() && destination.type() == packet.destination_type()) {
 #elif defined(DESTINATIONS_MAP)
-				auto iter = _destinations.find(packet.destination_hash());
-				if (iter != _destinations.end()) {
+				auto iter = _instance->_destinations.find(packet.destination_hash());
+				if (iter != _instance->_destinations.end()) {
 					auto& destination = (*iter).second;
 					if (destination.type() == packet.destination_type()) {
 #endif
@@ -2080,7 +1909,7 @@ using namespace RNS::Utilities;
 			if (packet.destination_type() == Type::Destination::LINK) {
 				// Data is destined for a link
 				TRACE("Transport::inbound: Packet is DATA for a LINK");
-				std::set<Link> active_links(_active_links);
+				std::set<Link> active_links(_instance->_active_links);
 				for (auto& link : active_links) {
 					if (link.link_id() == packet.destination_hash()) {
 						TRACE("Transport::inbound: Packet is DATA for an active LINK");
@@ -2092,11 +1921,11 @@ using namespace RNS::Utilities;
 			else {
 				// Data is basic (not destined for a link)
 #if defined(DESTINATIONS_SET)
-				for (auto& destination : _destinations) {
+				for (auto& destination : _instance->_destinations) {
 					if (destination.hash() == packet.destination_hash() && destination.type() == packet.destination_type()) {
 #elif defined(DESTINATIONS_MAP)
-				auto iter = _destinations.find(packet.destination_hash());
-				if (iter != _destinations.end()) {
+				auto iter = _instance->_destinations.find(packet.destination_hash());
+				if (iter != _instance->_destinations.end()) {
 					// Data is for a local destination
 					DEBUG("Packet destination " + packet.destination_hash().toHex() + " found, destination is local");
 					auto& destination = (*iter).second;
@@ -2143,17 +1972,21 @@ using namespace RNS::Utilities;
 				TRACE("Transport::inbound: Packet is LINK PROOF");
 				// This is a link request proof, check if it
 				// needs to be transported
-				if ((Reticulum::transport_enabled() || for_local_client_link || from_local_client) && _link_table.find(packet.destination_hash()) != _link_table.end()) {
+				if ((Reticulum::transport_enabled() || for_local_client_link || from_local_client) && _instance->_link_table.find(packet.destination_hash()) != _instance->_link_table.end()) {
 					TRACE("Handling link request proof...");
-					LinkEntry link_entry = (*_link_table.find(packet.destination_hash())).second;
+					LinkEntry& link_entry = (*_instance->_link_table.find(packet.destination_hash())).second;
 					if (packet.receiving_interface() == link_entry._outbound_interface) {
 						try {
-							if (packet.data().size() == (Type::Identity::SIGLENGTH/8 + Type::Link::ECPUBSIZE/2)) {
+							if (packet.data().size() == (Type::Identity::SIGLENGTH/8 + Type::Link::ECPUBSIZE/2) || packet.data().size() == (Type::Identity::SIGLENGTH/8 + Type::Link::ECPUBSIZE/2 + Type::Link::LINK_MTU_SIZE)) {
+								Bytes signalling_bytes;
+								if (packet.data().size() == (Type::Identity::SIGLENGTH/8 + Type::Link::ECPUBSIZE/2 + Type::Link::LINK_MTU_SIZE)) {
+									signalling_bytes = Link::signalling_bytes(Link::mtu_from_lp_packet(packet), Link::mode_from_lp_packet(packet));
+								}
 								Bytes peer_pub_bytes = packet.data().mid(Type::Identity::SIGLENGTH/8, Type::Link::ECPUBSIZE/2);
 								Identity peer_identity = Identity::recall(link_entry._destination_hash);
 								Bytes peer_sig_pub_bytes = peer_identity.get_public_key().mid(Type::Link::ECPUBSIZE/2, Type::Link::ECPUBSIZE/2);
 
-								Bytes signed_data = packet.destination_hash() + peer_pub_bytes + peer_sig_pub_bytes;
+								Bytes signed_data = packet.destination_hash() + peer_pub_bytes + peer_sig_pub_bytes + signalling_bytes;
 								Bytes signature = packet.data().left(Type::Identity::SIGLENGTH/8);
 
 								if (peer_identity.validate(signature, signed_data)) {
@@ -2189,7 +2022,7 @@ using namespace RNS::Utilities;
 					TRACEF("Handling proof for link request %s", packet.destination_hash().toHex().c_str());
 					// CBA Must make a copy of _pending_links before traversing since it gets modified
 					//for (auto link : _pending_links) {
-					std::set<Link> pending_links(_pending_links);
+					std::set<Link> pending_links(_instance->_pending_links);
 					for (auto& link : pending_links) {
 						TRACEF("Checking for link request handling by pending link %s", link.link_id().toHex().c_str());
 						if (link.link_id() == packet.destination_hash()) {
@@ -2201,7 +2034,7 @@ using namespace RNS::Utilities;
 			}
 			else if (packet.context() == Type::Packet::RESOURCE_PRF) {
 				TRACE("Transport::inbound: Packet is RESOURCE PROOF");
-				std::set<Link> active_links(_active_links);
+				std::set<Link> active_links(_instance->_active_links);
 				for (auto& link : active_links) {
 					if (link.link_id() == packet.destination_hash()) {
 						const_cast<Link&>(link).receive(packet);
@@ -2211,7 +2044,7 @@ using namespace RNS::Utilities;
 			else {
 				TRACE("Transport::inbound: Packet is regular PROOF");
 				if (packet.destination_type() == Type::Destination::LINK) {
-					std::set<Link> active_links(_active_links);
+					std::set<Link> active_links(_instance->_active_links);
 					for (auto& link : active_links) {
 						if (link.link_id() == packet.destination_hash()) {
 							packet.link(link);
@@ -2225,8 +2058,8 @@ using namespace RNS::Utilities;
 				}
 
 				// Check if this proof needs to be transported
-				if ((Reticulum::transport_enabled() || from_local_client || proof_for_local_client) && _reverse_table.find(packet.destination_hash()) != _reverse_table.end()) {
-					ReverseEntry reverse_entry = (*_reverse_table.find(packet.destination_hash())).second;
+				if ((Reticulum::transport_enabled() || from_local_client || proof_for_local_client) && _instance->_reverse_table.find(packet.destination_hash()) != _instance->_reverse_table.end()) {
+					ReverseEntry reverse_entry = (*_instance->_reverse_table.find(packet.destination_hash())).second;
 					if (packet.receiving_interface() == reverse_entry._outbound_interface) {
 						TRACE("Proof received on correct interface, transporting it via " + reverse_entry._receiving_interface.toString());
 						//p new_raw = packet.raw[0:1]
@@ -2249,7 +2082,7 @@ using namespace RNS::Utilities;
 				}
 
 				std::list<PacketReceipt> cull_receipts;
-				for (auto& receipt : _receipts) {
+				for (auto& receipt : _instance->_receipts) {
 					bool receipt_validated = false;
 					if (proof_hash) {
 						// Only test validation if hash matches
@@ -2274,14 +2107,14 @@ using namespace RNS::Utilities;
 					}
 				}
 				// CBA since modifying of collection while iterating is forbidden
-				for (auto& receipt : _receipts) {
+				for (auto& receipt : _instance->_receipts) {
 					cull_receipts.remove(receipt);
 				}
 			}
 		}
 	}
 
-	_jobs_locked = false;
+	_instance->_jobs_locked = false;
 }
 
 /*static*/ void Transport::synthesize_tunnel(const Interface& interface) {
@@ -2393,11 +2226,11 @@ using namespace RNS::Utilities;
 /*static*/ void Transport::register_interface(Interface& interface) {
 	TRACE("Transport: Registering interface " + interface.get_hash().toHex() + " " + interface.toString());
 #if defined(INTERFACES_SET)
-	_interfaces.insert(interface);
+	_instance->_interfaces.insert(interface);
 #elif defined(INTERFACES_LIST)
-	_interfaces.push_back(interface);
+	_instance->_interfaces.push_back(interface);
 #elif defined(INTERFACES_MAP)
-	_interfaces.insert({interface.get_hash(), interface});
+	_instance->_interfaces.insert({interface.get_hash(), interface});
 #endif
 	// CBA TODO set or add transport as listener on interface to receive incoming packets?
 }
@@ -2413,24 +2246,24 @@ using namespace RNS::Utilities;
 	//	}
 	//}
 	//auto iter = _interfaces.find(interface);
-	auto iter = _interfaces.find(const_cast<Interface&>(interface));
-	if (iter != _interfaces.end()) {
-		_interfaces.erase(iter);
+	auto iter = _instance->_interfaces.find(const_cast<Interface&>(interface));
+	if (iter != _instance->_interfaces.end()) {
+		_instance->_interfaces.erase(iter);
 		TRACE("Transport::deregister_interface: Found and removed interface " + (*iter).get().toString());
 	}
 #elif defined(INTERFACES_LIST)
-	for (auto iter = _interfaces.begin(); iter != _interfaces.end(); ++iter) {
+	for (auto iter = _instance->_interfaces.begin(); iter != _instance->_interfaces.end(); ++iter) {
 		if ((*iter).get() == interface) {
-			_interfaces.erase(iter);
+			_instance->_interfaces.erase(iter);
 			TRACE("Transport::deregister_interface: Found and removed interface " + (*iter).get().toString());
 			break;
 		}
 	}
 #elif defined(INTERFACES_MAP)
-	auto iter = _interfaces.find(interface.get_hash());
-	if (iter != _interfaces.end()) {
+	auto iter = _instance->_interfaces.find(interface.get_hash());
+	if (iter != _instance->_interfaces.end()) {
 		TRACE("Transport::deregister_interface: Found and removed interface " + (*iter).second.toString());
-		_interfaces.erase(iter);
+		_instance->_interfaces.erase(iter);
 	}
 #endif
 }
@@ -2441,7 +2274,7 @@ using namespace RNS::Utilities;
 	destination.mtu(Type::Reticulum::MTU);
 	if (destination.direction() == Type::Destination::IN) {
 #if defined(DESTINATIONS_SET)
-		for (auto& registered_destination : _destinations) {
+		for (auto& registered_destination : _instance->_destinations) {
 			if (destination.hash() == registered_destination.hash()) {
 				//p raise KeyError("Attempt to register an already registered destination.")
 				throw std::runtime_error("Attempt to register an already registered destination.");
@@ -2449,19 +2282,19 @@ using namespace RNS::Utilities;
 		}
 
 		// CBA ACCUMULATES
-		_destinations.insert(destination);
+		_instance->_destinations.insert(destination);
 #elif defined(DESTINATIONS_MAP)
-		auto iter = _destinations.find(destination.hash());
-		if (iter != _destinations.end()) {
+		auto iter = _instance->_destinations.find(destination.hash());
+		if (iter != _instance->_destinations.end()) {
 			//p raise KeyError("Attempt to register an already registered destination.")
 			throw std::runtime_error("Attempt to register an already registered destination.");
 		}
 
 		// CBA ACCUMULATES
-		_destinations.insert({destination.hash(), destination});
+		_instance->_destinations.insert({destination.hash(), destination});
 #endif
 
-		if (_owner && _owner.is_connected_to_shared_instance()) {
+		if (_instance->_owner && _instance->_owner.is_connected_to_shared_instance()) {
 			if (destination.type() == Type::Destination::SINGLE) {
 				TRACE("Transport:register_destination: Announcing destination " + destination.toString());
 				destination.announce({}, true);
@@ -2487,14 +2320,14 @@ using namespace RNS::Utilities;
 /*static*/ void Transport::deregister_destination(const Destination& destination) {
 	TRACE("Transport: Deregistering destination " + destination.toString());
 #if defined(DESTINATIONS_SET)
-	if (_destinations.find(destination) != _destinations.end()) {
-		_destinations.erase(destination);
+	if (_instance->_destinations.find(destination) != _instance->_destinations.end()) {
+		_instance->_destinations.erase(destination);
 		TRACE("Transport::deregister_destination: Found and removed destination " + destination.toString());
 	}
 #elif defined(DESTINATIONS_MAP)
-	auto iter = _destinations.find(destination.hash());
-	if (iter != _destinations.end()) {
-		_destinations.erase(iter);
+	auto iter = _instance->_destinations.find(destination.hash());
+	if (iter != _instance->_destinations.end()) {
+		_instance->_destinations.erase(iter);
 		TRACE("Transport::deregister_destination: Found and removed destination " + (*iter).second.toString());
 	}
 #endif
@@ -2504,23 +2337,23 @@ using namespace RNS::Utilities;
 	TRACE("Transport: Registering link " + link.toString());
 	if (link.initiator()) {
 		// CBA ACCUMULATES
-		_pending_links.insert(link);
+		_instance->_pending_links.insert(link);
 	}
 	else {
 		// CBA ACCUMULATES
-		_active_links.insert(link);
+		_instance->_active_links.insert(link);
 	}
 }
 
 /*static*/ void Transport::activate_link(Link& link) {
 	TRACE("Transport: Activating link " + link.toString());
-	if (_pending_links.find(link) != _pending_links.end()) {
+	if (_instance->_pending_links.find(link) != _instance->_pending_links.end()) {
 		if (link.status() != Type::Link::ACTIVE) {
 			throw std::runtime_error("Invalid link state for link activation: " + std::to_string(link.status()));
 		}
-		_pending_links.erase(link);
+		_instance->_pending_links.erase(link);
 		// CBA ACCUMULATES
-		_active_links.insert(link);
+		_instance->_active_links.insert(link);
 		link.status(Type::Link::ACTIVE);
 	}
 	else {
@@ -2528,6 +2361,53 @@ using namespace RNS::Utilities;
 	}
 }
 
+/*static*/ uint32_t Transport::schedule_deadline(double deadline, const std::function<void()>& job) {
+	// 0 is left for owners to mean nothing is scheduled
+	if (++_instance->_last_deadline_id == 0) {
+		++_instance->_last_deadline_id;
+	}
+	_instance->_deadlines.insert({deadline, DeadlineEntry(_instance->_last_deadline_id, job)});
+	return _instance->_last_deadline_id;
+}
+
+/*static*/ void Transport::cancel_deadline(double deadline, uint32_t id) {
+	auto range = _instance->_deadlines.equal_range(deadline);
+	for (auto iter = range.first; iter != range.second; ++iter) {
+		if ((*iter).second._id == id) {
+			_instance->_deadlines.erase(iter);
+			return;
+		}
+	}
+}
+
+/*static*/ void Transport::run_deadlines() {
+	// Take every due job off the schedule before running any of them, so
+	// that a job rescheduling itself for now waits for the next loop
+	double now = OS::time();
+	std::vector<std::function<void()>> due;
+	auto iter = _instance->_deadlines.begin();
+	while (iter != _instance->_deadlines.end() && (*iter).first <= now) {
+		due.push_back((*iter).second._job);
+		iter = _instance->_deadlines.erase(iter);
+	}
+	for (auto& job : due) {
+		try {
+			job();
+		}
+		catch (std::exception& e) {
+			ERRORF("Error while running scheduled job. The contained exception was: %s", e.what());
+		}
+	}
+}
+
+/*static*/ double Transport::next_wakeup() {
+	double wakeup = _instance->_jobs_last_run + _instance->_job_interval;
+	if (!_instance->_deadlines.empty()) {
+		wakeup = std::min(wakeup, (*_instance->_deadlines.begin()).first);
+	}
+	return wakeup;
+}
+
 /*
 Registers an announce handler.
 
@@ -2535,7 +2415,7 @@ Registers an announce handler.
 */
 /*static*/ void Transport::register_announce_handler(HAnnounceHandler handler) {
 	TRACE("Transport: Registering announce handler " + handler->aspect_filter());
-	_announce_handlers.insert(handler);
+	_instance->_announce_handlers.insert(handler);
 }
 
 /*
@@ -2545,30 +2425,30 @@ Deregisters an announce handler.
 */
 /*static*/ void Transport::deregister_announce_handler(HAnnounceHandler handler) {
 	TRACE("Transport: Deregistering announce handler " + handler->aspect_filter());
-	if (_announce_handlers.find(handler) != _announce_handlers.end()) {
-		_announce_handlers.erase(handler);
+	if (_instance->_announce_handlers.find(handler) != _instance->_announce_handlers.end()) {
+		_instance->_announce_handlers.erase(handler);
 		TRACE("Transport::deregister_announce_handler: Found and removed handler" + handler->aspect_filter());
 	}
 }
 
 /*static*/ Interface Transport::find_interface_from_hash(const Bytes& interface_hash) {
 #if defined(INTERFACES_SET)
-	for (const Interface& interface : _interfaces) {
+	for (const Interface& interface : _instance->_interfaces) {
 		if (interface.get_hash() == interface_hash) {
 			TRACE("Transport::find_interface_from_hash: Found interface " + interface.toString());
 			return interface;
 		}
 	}
 #elif defined(INTERFACES_LIST)
-	for (Interface& interface : _interfaces) {
+	for (Interface& interface : _instance->_interfaces) {
 		if (interface.get_hash() == interface_hash) {
 			TRACE("Transport::find_interface_from_hash: Found interface " + interface.toString());
 			return interface;
 		}
 	}
 #elif defined(INTERFACES_MAP)
-	auto iter = _interfaces.find(interface_hash);
-	if (iter != _interfaces.end()) {
+	auto iter = _instance->_interfaces.find(interface_hash);
+	if (iter != _instance->_interfaces.end()) {
 		TRACE("Transport::find_interface_from_hash: Found interface " + (*iter).second.toString());
 		return (*iter).second;
 	}
@@ -2710,8 +2590,20 @@ Deregisters an announce handler.
 	}
 }
 
+// As above, for packets travelling over a link
+/*static*/ void Transport::cache_request(const Bytes& packet_hash, const Link& link) {
+	const Packet& cached_packet = get_cached_packet(packet_hash);
+	if (cached_packet) {
+		inbound(cached_packet.raw(), cached_packet.receiving_interface());
+	}
+	else {
+		Packet request(link, packet_hash, Type::Packet::DATA, Type::Packet::CACHE_REQUEST);
+		request.send();
+	}
+}
+
 /*static*/ bool Transport::remove_path(const Bytes& destination_hash) {
-	if (_destination_table.erase(destination_hash) > 0) {
+	if (_instance->_destination_table.erase(destination_hash) > 0) {
 		// CBA also remove cached announce packet if exists
 	}
 	return false;
@@ -2722,7 +2614,7 @@ Deregisters an announce handler.
 :returns: *True* if a path to the destination is known, otherwise *False*.
 */
 /*static*/ bool Transport::has_path(const Bytes& destination_hash) {
-	if (_destination_table.find(destination_hash) != _destination_table.end()) {
+	if (_instance->_destination_table.find(destination_hash) != _instance->_destination_table.end()) {
 		return true;
 	}
 	else {
@@ -2735,8 +2627,8 @@ Deregisters an announce handler.
 :returns: The number of hops to the specified destination, or ``RNS.Transport.PATHFINDER_M`` if the number of hops is unknown.
 */
 /*static*/ uint8_t Transport::hops_to(const Bytes& destination_hash) {
-	auto iter = _destination_table.find(destination_hash);
-	if (iter != _destination_table.end()) {
+	auto iter = _instance->_destination_table.find(destination_hash);
+	if (iter != _instance->_destination_table.end()) {
 		DestinationEntry destination_entry = (*iter).second;
 		return destination_entry._hops;
 	}
@@ -2750,8 +2642,8 @@ Deregisters an announce handler.
 :returns: The destination hash as *bytes* for the next hop to the specified destination, or *None* if the next hop is unknown.
 */
 /*static*/ Bytes Transport::next_hop(const Bytes& destination_hash) {
-	auto iter = _destination_table.find(destination_hash);
-	if (iter != _destination_table.end()) {
+	auto iter = _instance->_destination_table.find(destination_hash);
+	if (iter != _instance->_destination_table.end()) {
 		DestinationEntry destination_entry = (*iter).second;
 		return destination_entry._received_from;
 	}
@@ -2765,8 +2657,8 @@ Deregisters an announce handler.
 :returns: The interface for the next hop to the specified destination, or *None* if the interface is unknown.
 */
 /*static*/ Interface Transport::next_hop_interface(const Bytes& destination_hash) {
-	auto iter = _destination_table.find(destination_hash);
-	if (iter != _destination_table.end()) {
+	auto iter = _instance->_destination_table.find(destination_hash);
+	if (iter != _instance->_destination_table.end()) {
 		DestinationEntry destination_entry = (*iter).second;
 		return destination_entry.receiving_interface();
 	}
@@ -2836,11 +2728,11 @@ Deregisters an announce handler.
 }
 
 /*static*/ bool Transport::expire_path(const Bytes& destination_hash) {
-	auto iter = _destination_table.find(destination_hash);
-	if (iter != _destination_table.end()) {
+	auto iter = _instance->_destination_table.find(destination_hash);
+	if (iter != _instance->_destination_table.end()) {
 		DestinationEntry destination_entry = (*iter).second;
 		destination_entry._timestamp = 0;
-		_tables_last_culled = 0;
+		_instance->_tables_last_culled = 0;
 		return true;
 	}
 	else {
@@ -2894,6 +2786,23 @@ will announce it.
 */
 ///*static*/ void Transport::request_path(const Bytes& destination_hash, const Interface& on_interface /*= {Type::NONE}*/, const Bytes& tag /*= {}*/, bool recursive /*= false*/) {
 /*static*/ void Transport::request_path(const Bytes& destination_hash, const Interface& on_interface, const Bytes& tag /*= {}*/, bool recursive /*= false*/) {
+	// CBA Locally originated (untagged) requests for a destination are coalesced
+	// while an earlier request covering the same interface is still in flight
+	Bytes on_interface_hash;
+	if (on_interface) {
+		on_interface_hash = on_interface.get_hash();
+	}
+	if (!tag) {
+		auto iter = _instance->_path_requests_in_flight.find(destination_hash);
+		if (iter != _instance->_path_requests_in_flight.end() && OS::time() <= (*iter).second._timeout) {
+			InFlightPathRequestEntry& in_flight_entry = (*iter).second;
+			if (in_flight_entry._broadcast || (on_interface && in_flight_entry._interface_hashes.count(on_interface_hash) > 0)) {
+				DEBUG("Coalescing path request for " + destination_hash.toHex() + " with request already in flight");
+				return;
+			}
+		}
+	}
+
 	Bytes request_tag;
 	if (!tag) {
 		request_tag = Identity::get_random_hash();
@@ -2904,7 +2813,7 @@ will announce it.
 
 	Bytes path_request_data;
 	if (Reticulum::transport_enabled()) {
-		path_request_data = destination_hash + _identity.hash() + request_tag;
+		path_request_data = destination_hash + _instance->_identity.hash() + request_tag;
 	}
 	else {
 		path_request_data = destination_hash + request_tag;
@@ -2939,24 +2848,84 @@ will announce it.
 			}
 			else {
 				//p tx_time   = ((len(path_request_data)+RNS.Reticulum.HEADER_MINSIZE)*8) / on_interface.bitrate
-				uint32_t wait_time = 0;
-				if ( on_interface.bitrate() > 0 && on_interface.announce_cap() > 0) {
-					uint32_t tx_time = ((path_request_data.size() + Type::Reticulum::HEADER_MINSIZE)*8) / on_interface.bitrate();
-					wait_time = (tx_time / on_interface.announce_cap());
-				}
+				double wait_time = on_interface.announce_wait_time(path_request_data.size() + Type::Reticulum::HEADER_MINSIZE);
 				const_cast<Interface&>(on_interface).announce_allowed_at(now + wait_time);
 			}
 		}
 	}
 
 	packet.send();
-	_path_requests[destination_hash] = OS::time();
+	double now = OS::time();
+	_instance->_path_requests[destination_hash] = now;
+
+	if (!tag) {
+		auto iter = _instance->_path_requests_in_flight.find(destination_hash);
+		if (iter == _instance->_path_requests_in_flight.end()) {
+			// CBA ACCUMULATES
+			iter = _instance->_path_requests_in_flight.insert({destination_hash, {now, now + Type::Transport::PATH_REQUEST_TIMEOUT}}).first;
+		}
+		InFlightPathRequestEntry& in_flight_entry = (*iter).second;
+		if (now > in_flight_entry._timeout) {
+			// Re-arm a lapsed entry without losing its waiters
+			in_flight_entry._requested_at = now;
+			in_flight_entry._timeout = now + Type::Transport::PATH_REQUEST_TIMEOUT;
+			in_flight_entry._broadcast = false;
+			in_flight_entry._interface_hashes.clear();
+		}
+		if (on_interface) {
+			in_flight_entry._interface_hashes.insert(on_interface_hash);
+		}
+		else {
+			in_flight_entry._broadcast = true;
+		}
+	}
 }
 
 /*static*/ void Transport::request_path(const Bytes& destination_hash) {
 	return request_path(destination_hash, {Type::NONE});
 }
 
+/*
+Requests a path to the destination and calls the callback once the path
+arrives, or with path_found false once the request times out. Concurrent
+callers share a single path request on the wire.
+*/
+/*static*/ void Transport::request_path(const Bytes& destination_hash, Callbacks::path_response callback) {
+	if (has_path(destination_hash)) {
+		if (callback != nullptr) {
+			callback(destination_hash, true);
+		}
+		return;
+	}
+
+	request_path(destination_hash, {Type::NONE});
+
+	if (callback != nullptr) {
+		auto iter = _instance->_path_requests_in_flight.find(destination_hash);
+		if (iter != _instance->_path_requests_in_flight.end()) {
+			(*iter).second._waiters.push_back(callback);
+		}
+	}
+}
+
+/*static*/ void Transport::path_request_concluded(const Bytes& destination_hash, bool path_found) {
+	auto iter = _instance->_path_requests_in_flight.find(destination_hash);
+	if (iter == _instance->_path_requests_in_flight.end()) {
+		return;
+	}
+	// Detach waiters first so callbacks are free to issue new requests
+	std::vector<Callbacks::path_response> waiters(std::move((*iter).second._waiters));
+	_instance->_path_requests_in_flight.erase(iter);
+	for (auto& callback : waiters) {
+		try {
+			callback(destination_hash, path_found);
+		}
+		catch (std::exception& e) {
+			ERROR("Error while executing path response callback. The contained exception was: " + std::string(e.what()));
+		}
+	}
+}
+
 /*static*/ void Transport::path_request_handler(const Bytes& data, const Packet& packet) {
 	TRACE("Transport::path_request_handler");
 	try {
@@ -2993,9 +2962,10 @@ will announce it.
 				Bytes unique_tag = destination_hash + tag_bytes;
 				//TRACE("Transport::path_request_handler: unique_tag: " + unique_tag.toHex());
 
-				if (_discovery_pr_tags.find(unique_tag) == _discovery_pr_tags.end()) {
+				if (_instance->_discovery_pr_tags.find(unique_tag) == _instance->_discovery_pr_tags.end()) {
 					// CBA ACCUMULATES
-					_discovery_pr_tags.insert(unique_tag);
+					_instance->_discovery_pr_tags.insert(unique_tag);
+					_instance->_discovery_pr_tags_age.push_back(unique_tag);
 
 					path_request(
 						destination_hash,
@@ -3036,15 +3006,15 @@ will announce it.
 	DEBUG("Path request for destination " + destination_hash.toHex() + interface_str);
 
 	bool destination_exists_on_local_client = false;
-	if (_local_client_interfaces.size() > 0) {
-		auto iter = _destination_table.find(destination_hash);
-		if (iter != _destination_table.end()) {
+	if (_instance->_local_client_interfaces.size() > 0) {
+		auto iter = _instance->_destination_table.find(destination_hash);
+		if (iter != _instance->_destination_table.end()) {
 			TRACE("Transport::path_request_handler: entry found for destination " + destination_hash.toHex());
 			DestinationEntry& destination_entry = (*iter).second;
 			if (is_local_client_interface(destination_entry.receiving_interface())) {
 				destination_exists_on_local_client = true;
 				// CBA ACCUMULATES
-				_pending_local_path_requests.insert({destination_hash, attached_interface});
+				_instance->_pending_local_path_requests.insert({destination_hash, attached_interface});
 			}
 		}
 		else {
@@ -3052,11 +3022,11 @@ will announce it.
 		}
 	}
 
-	auto destination_iter = _destination_table.find(destination_hash);
+	auto destination_iter = _instance->_destination_table.find(destination_hash);
 	//local_destination = next((d for d in Transport.destinations if d.hash == destination_hash), None)
 #if defined(DESTINATIONS_SET)
 	Destination local_destination({Type::NONE});
-	for (auto& destination : _destinations) {
+	for (auto& destination : _instance->_destinations) {
 		if (destination.hash() == destination_hash) {
 			local_destination = destination;
 			break;
@@ -3065,15 +3035,15 @@ will announce it.
     //if local_destination != None:
 	if (local_destination) {
 #elif defined(DESTINATIONS_MAP)
-	auto iter = _destinations.find(destination_hash);
-	if (iter != _destinations.end()) {
+	auto iter = _instance->_destinations.find(destination_hash);
+	if (iter != _instance->_destinations.end()) {
 		auto& local_destination = (*iter).second;
 #endif
 		local_destination.announce({Bytes::NONE}, true, attached_interface, tag);
 		DEBUG("Answering path request for destination " + destination_hash.toHex() + interface_str + ", destination is local to this system");
 	}
     //p elif (RNS.Reticulum.transport_enabled() or is_from_local_client) and (destination_hash in Transport.destination_table):
-	else if ((Reticulum::transport_enabled() || is_from_local_client) && destination_iter != _destination_table.end()) {
+	else if ((Reticulum::transport_enabled() || is_from_local_client) && destination_iter != _instance->_destination_table.end()) {
 		TRACE("Transport::path_request_handler: entry found for destination " + destination_hash.toHex());
 		DestinationEntry& destination_entry = (*destination_iter).second;
 		const Packet& announce_packet = destination_entry.announce_packet();
@@ -3118,11 +3088,11 @@ will announce it.
 				// rebroadcast locally. In such a case the actual announce
 				// is temporarily held, and then reinserted when the path
 				// request has been served to the peer.
-				auto announce_iter = _announce_table.find(announce_packet.destination_hash());
-				if (announce_iter != _announce_table.end()) {
+				auto announce_iter = _instance->_announce_table.find(announce_packet.destination_hash());
+				if (announce_iter != _instance->_announce_table.end()) {
 					AnnounceEntry& held_entry = (*announce_iter).second;
 					// CBA ACCUMULATES
-					_held_announces.insert({announce_packet.destination_hash(), held_entry});
+					_instance->_held_announces.insert({announce_packet.destination_hash(), held_entry});
 				}
 
 /*
@@ -3155,7 +3125,7 @@ will announce it.
 					attached_interface
 				);
 				// CBA ACCUMULATES
-				_announce_table.insert({announce_packet.destination_hash(), announce_entry});
+				_instance->_announce_table.insert({announce_packet.destination_hash(), announce_entry});
 			}
 		}
 	}
@@ -3165,11 +3135,11 @@ will announce it.
 		DEBUG("Forwarding path request from local client for destination " + destination_hash.toHex() + interface_str + " to all other interfaces");
 		Bytes request_tag = Identity::get_random_hash();
 #if defined(INTERFACES_SET)
-		for (const Interface& interface : _interfaces) {
+		for (const Interface& interface : _instance->_interfaces) {
 #elif defined(INTERFACES_LIST)
-		for (Interface& interface : _interfaces) {
+		for (Interface& interface : _instance->_interfaces) {
 #elif defined(INTERFACES_MAP)
-		for (auto& [hash, interface] : _interfaces) {
+		for (auto& [hash, interface] : _instance->_interfaces) {
 #endif
 			if (interface != attached_interface) {
 				request_path(destination_hash, interface, request_tag);
@@ -3178,7 +3148,7 @@ will announce it.
 	}
 	else if (should_search_for_unknown) {
 		TRACE("Transport::path_request_handler: searching for unknown path to " + destination_hash.toHex());
-		if (_discovery_path_requests.find(destination_hash) != _discovery_path_requests.end()) {
+		if (_instance->_discovery_path_requests.find(destination_hash) != _instance->_discovery_path_requests.end()) {
 			DEBUG("There is already a waiting path request for destination " + destination_hash.toHex() + " on behalf of path request" + interface_str);
 		}
 		else {
@@ -3188,18 +3158,18 @@ will announce it.
 			//p pr_entry = { "destination_hash": destination_hash, "timeout": time.time()+Transport.PATH_REQUEST_TIMEOUT, "requesting_interface": attached_interface }
 			//p _discovery_path_requests[destination_hash] = pr_entry;
 			// CBA ACCUMULATES
-			_discovery_path_requests.insert({destination_hash, {
+			_instance->_discovery_path_requests.insert({destination_hash, {
 				destination_hash,
 				OS::time() + Type::Transport::PATH_REQUEST_TIMEOUT,
 				attached_interface
 			}});
 
 #if defined(INTERFACES_SET)
-			for (const Interface& interface : _interfaces) {
+			for (const Interface& interface : _instance->_interfaces) {
 #elif defined(INTERFACES_LIST)
-			for (Interface& interface : _interfaces) {
+			for (Interface& interface : _instance->_interfaces) {
 #elif defined(INTERFACES_MAP)
-			for (auto& [hash, interface] : _interfaces) {
+			for (auto& [hash, interface] : _instance->_interfaces) {
 #endif
 				// CBA EXPERIMENTAL forwarding path requests even on requestor interface in order to support
 				//  path-finding over LoRa mesh
@@ -3216,11 +3186,11 @@ will announce it.
 			}
 		}
 	}
-	else if (!is_from_local_client && _local_client_interfaces.size() > 0) {
+	else if (!is_from_local_client && _instance->_local_client_interfaces.size() > 0) {
 		// Forward the path request on all local
 		// client interfaces
 		DEBUG("Forwarding path request for destination " + destination_hash.toHex() + interface_str + " to local clients");
-		for (const Interface& interface : _local_client_interfaces) {
+		for (const Interface& interface : _instance->_local_client_interfaces) {
 			request_path(destination_hash, interface);
 		}
 	}
@@ -3319,20 +3289,27 @@ will announce it.
 }
 
 /*static*/ void Transport::drop_announce_queues() {
-// TODO
-/*p
-	for interface in Transport.interfaces:
-		if hasattr(interface, "announce_queue") and interface.announce_queue != None:
-			na = len(interface.announce_queue)
-			if na > 0:
-				if na == 1:
-					na_str = "1 announce"
-				else:
-					na_str = str(na)+" announces"
-
-				interface.announce_queue = []
-				RNS.log("Dropped "+na_str+" on "+str(interface), RNS.LOG_VERBOSE)
-*/
+#if defined(INTERFACES_SET)
+	for (const Interface& interface : _instance->_interfaces) {
+		size_t na = const_cast<Interface&>(interface).drop_announce_queue();
+#elif defined(INTERFACES_LIST)
+	for (Interface& interface : _instance->_interfaces) {
+		size_t na = interface.drop_announce_queue();
+#elif defined(INTERFACES_MAP)
+	for (auto& [hash, interface] : _instance->_interfaces) {
+		size_t na = interface.drop_announce_queue();
+#endif
+		if (na > 0) {
+			std::string na_str;
+			if (na == 1) {
+				na_str = "1 announce";
+			}
+			else {
+				na_str = std::to_string(na) + " announces";
+			}
+			VERBOSE("Dropped " + na_str + " on " + interface.toString());
+		}
+	}
 }
 
 /*static*/ uint64_t Transport::announce_emitted(const Packet& packet) {
@@ -3345,6 +3322,52 @@ will announce it.
 	return 0;
 }
 
+// Returns the mask of interface modes on which an announce with no attached
+// interface must not be broadcast. The outcome only depends on the packet, so
+// it is evaluated once per packet rather than once per interface.
+/*static*/ uint8_t Transport::announce_blocked_modes(const Packet& packet) {
+	// Access point interfaces never carry broadcast announces
+	uint8_t blocked_modes = Type::Interface::MODE_ACCESS_POINT;
+
+	//local_destination = next((d for d in Transport.destinations if d.hash == packet.destination_hash), None)
+#if defined(DESTINATIONS_SET)
+	bool found_local = false;
+	for (auto& destination : _instance->_destinations) {
+		if (destination.hash() == packet.destination_hash()) {
+			found_local = true;
+			break;
+		}
+	}
+#elif defined(DESTINATIONS_MAP)
+	bool found_local = (_instance->_destinations.find(packet.destination_hash()) != _instance->_destinations.end());
+#endif
+	if (found_local) {
+		TRACE("Allowing announce broadcast on roaming-mode and boundary-mode interfaces from instance-local destination");
+		return blocked_modes;
+	}
+
+	const Interface from_interface = next_hop_interface(packet.destination_hash());
+	//if from_interface == None or not hasattr(from_interface, "mode"):
+	if (!from_interface || from_interface.mode() == Type::Interface::MODE_NONE) {
+		if (!from_interface) {
+			TRACE("Blocking announce broadcast on roaming-mode and boundary-mode interfaces since next hop interface doesn't exist");
+		}
+		else {
+			TRACE("Blocking announce broadcast on roaming-mode and boundary-mode interfaces since next hop interface has no mode configured");
+		}
+		blocked_modes |= Type::Interface::MODE_ROAMING | Type::Interface::MODE_BOUNDARY;
+	}
+	else if (from_interface.mode() == Type::Interface::MODE_ROAMING) {
+		TRACE("Blocking announce broadcast on roaming-mode and boundary-mode interfaces due to roaming-mode next-hop interface");
+		blocked_modes |= Type::Interface::MODE_ROAMING | Type::Interface::MODE_BOUNDARY;
+	}
+	else if (from_interface.mode() == Type::Interface::MODE_BOUNDARY) {
+		TRACE("Blocking announce broadcast on roaming-mode interfaces due to boundary-mode next-hop interface");
+		blocked_modes |= Type::Interface::MODE_ROAMING;
+	}
+	return blocked_modes;
+}
+
 /*static*/ void Transport::write_packet_hashlist() {
 #if defined(RNS_USE_FS) && defined(RNS_PERSIST_PATHS)
 // TODO
@@ -3396,7 +3419,7 @@ will announce it.
 #if defined(RNS_USE_FS) && defined(RNS_PERSIST_PATHS)
 	char destination_table_path[Type::Reticulum::FILEPATH_MAXSIZE];
 	snprintf(destination_table_path, Type::Reticulum::FILEPATH_MAXSIZE, "%s/destination_table", Reticulum::_storagepath);
-	if (!_owner.is_connected_to_shared_instance() && OS::file_exists(destination_table_path)) {
+	if (!_instance->_owner.is_connected_to_shared_instance() && OS::file_exists(destination_table_path)) {
 /*p
 		serialised_destinations = []
 		try:
@@ -3453,16 +3476,16 @@ TRACEF("Transport::start: buffer size %d bytes", Persistence::_buffer.size());
 				TRACEF("Transport::start: doc size: %d bytes", Persistence::_buffer.size());
 				if (!error) {
 					// Calculate crc for dirty-checking before write
-					_destination_table_crc = Crc::crc32(0, Persistence::_buffer.data(), Persistence::_buffer.size());
-					_destination_table = Persistence::_document.as<std::map<Bytes, DestinationEntry>>();
+					_instance->_destination_table_crc = Crc::crc32(0, Persistence::_buffer.data(), Persistence::_buffer.size());
+					_instance->_destination_table = Persistence::_document.as<std::map<Bytes, DestinationEntry>>();
 #else	// CUSTOM
 				// Calculate crc for dirty-checking before write
-				if (Persistence::deserialize(_destination_table, destination_table_path, _destination_table_crc) > 0) {
+				if (Persistence::deserialize(_instance->_destination_table, destination_table_path, _instance->_destination_table_crc) > 0) {
 #endif	// CUSTOM
 
-					TRACEF("Transport::start: successfully deserialized path table with %d entries", _destination_table.size());
+					TRACEF("Transport::start: successfully deserialized path table with %d entries", _instance->_destination_table.size());
 					std::vector<Bytes> invalid_paths;
-					for (auto& [destination_hash, destination_entry] : _destination_table) {
+					for (auto& [destination_hash, destination_entry] : _instance->_destination_table) {
 #ifndef NDEBUG
 						TRACEF("Transport::start: entry: %s = %s", destination_hash.toHex().c_str(), destination_entry.debugString().c_str());
 #endif
@@ -3480,7 +3503,7 @@ TRACEF("Transport::start: buffer size %d bytes", Persistence::_buffer.size());
 						}
 					}
 					for (const auto& destination_hash : invalid_paths) {
-						_destination_table.erase(destination_hash);
+						_instance->_destination_table.erase(destination_hash);
 					}
 					return true;
 				}
@@ -3495,7 +3518,7 @@ TRACEF("Transport::start: buffer size %d bytes", Persistence::_buffer.size());
 #else	// CUSTOM
 #endif	// CUSTOM
 
-			VERBOSEF("Loaded %d valid path table entries from storage", _destination_table.size());
+			VERBOSEF("Loaded %d valid path table entries from storage", _instance->_destination_table.size());
 
 		}
 		catch (std::exception& e) {
@@ -3509,17 +3532,17 @@ TRACEF("Transport::start: buffer size %d bytes", Persistence::_buffer.size());
 /*static*/ bool Transport::write_path_table() {
 	DEBUG("Transport::write_path_table");
 
-	if (Transport::_owner.is_connected_to_shared_instance()) {
+	if (_instance->_owner.is_connected_to_shared_instance()) {
 		return true;
 	}
 
 	bool success = false;
 #if defined(RNS_USE_FS) && defined(RNS_PERSIST_PATHS)
-	if (_saving_path_table) {
+	if (_instance->_saving_path_table) {
 		double wait_interval = 0.2;
 		double wait_timeout = 5;
 		double wait_start = OS::time();
-		while (_saving_path_table) {
+		while (_instance->_saving_path_table) {
 			OS::sleep(wait_interval);
 			if (OS::time() > (wait_start + wait_timeout)) {
 				ERROR("Could not save path table to storage, waiting for previous save operation timed out.");
@@ -3529,9 +3552,9 @@ TRACEF("Transport::start: buffer size %d bytes", Persistence::_buffer.size());
 	}
 
 	try {
-		_saving_path_table = true;
+		_instance->_saving_path_table = true;
 		double save_start = OS::time();
-		DEBUGF("Saving %d path table entries to storage...", _destination_table.size());
+		DEBUGF("Saving %d path table entries to storage...", _instance->_destination_table.size());
 
 /*p
 		serialised_destinations = []
@@ -3576,7 +3599,7 @@ TRACEF("Transport::start: buffer size %d bytes", Persistence::_buffer.size());
 
 #if CUSTOM
 		{
-			Persistence::_document.set(_destination_table);
+			Persistence::_document.set(_instance->_destination_table);
 			TRACEF("Transport::write_path_table: doc size %d bytes", Persistence::_document.memoryUsage());
 
 			//size_t size = 8192;
@@ -3606,12 +3629,12 @@ TRACE("Transport::write_path_table: buffer size " + std::to_string(Persistence::
 #endif
 			// Check crc to see if data has changed before writing
 			uint32_t crc = Crc::crc32(0, Persistence::_buffer.data(), Persistence::_buffer.size());
-			if (_destination_table_crc > 0 && crc == _destination_table_crc) {
+			if (_instance->_destination_table_crc > 0 && crc == _instance->_destination_table_crc) {
 				TRACE("Transport::write_path_table: no change detected, skipping write");
 			}
 			else if (RNS::Utilities::OS::write_file(destination_table_path, Persistence::_buffer) == Persistence::_buffer.size()) {
-				TRACEF("Transport::write_path_table: wrote %d entries, %d bytes", _destination_table.size(), Persistence::_buffer.size());
-				_destination_table_crc = crc;
+				TRACEF("Transport::write_path_table: wrote %d entries, %d bytes", _instance->_destination_table.size(), Persistence::_buffer.size());
+				_instance->_destination_table_crc = crc;
 				success = true;
 
 #ifndef NDEBUG
@@ -3630,16 +3653,16 @@ TRACE("Transport::write_path_table: buffer size " + std::to_string(Persistence::
 			TRACE("Transport::write_path_table: failed to serialize");
 		}
 #else	// CUSTOM
-		uint32_t crc = Persistence::crc(_destination_table);
-		if (_destination_table_crc > 0 && crc == _destination_table_crc) {
+		uint32_t crc = Persistence::crc(_instance->_destination_table);
+		if (_instance->_destination_table_crc > 0 && crc == _instance->_destination_table_crc) {
 			TRACE("Transport::write_path_table: no change detected, skipping write");
 		}
 		else {
 			TRACE("Transport::write_path_table: change detected, writing...");
 			char destination_table_path[Type::Reticulum::FILEPATH_MAXSIZE];
 			snprintf(destination_table_path, Type::Reticulum::FILEPATH_MAXSIZE, "%s/destination_table", Reticulum::_storagepath);
-			if (Persistence::serialize(_destination_table, destination_table_path, _destination_table_crc) > 0) {
-				TRACEF("Transport::write_path_table: wrote %d entries, %d bytes", _destination_table.size(), Persistence::_buffer.size());
+			if (Persistence::serialize(_instance->_destination_table, destination_table_path, _instance->_destination_table_crc) > 0) {
+				TRACEF("Transport::write_path_table: wrote %d entries, %d bytes", _instance->_destination_table.size(), Persistence::_buffer.size());
 				success = true;
 			}
 		}
@@ -3649,11 +3672,11 @@ TRACE("Transport::write_path_table: buffer size " + std::to_string(Persistence::
 			double save_time = OS::time() - save_start;
 			if (save_time < 1.0) {
 				//DEBUG("Saved " + std::to_string(_destination_table.size()) + " path table entries in " + std::to_string(OS::round(save_time * 1000, 1)) + " ms");
-				DEBUGF("Saved %d path table entries in %d ms", _destination_table.size(), (int)(save_time*1000));
+				DEBUGF("Saved %d path table entries in %d ms", _instance->_destination_table.size(), (int)(save_time*1000));
 			}
 			else {
 				//DEBUG("Saved " + std::to_string(_destination_table.size()) + " path table entries in " + std::to_string(OS::round(save_time, 1)) + " s");
-				DEBUGF("Saved %d path table entries in %d s", _destination_table.size(), save_time);
+				DEBUGF("Saved %d path table entries in %d s", _instance->_destination_table.size(), save_time);
 			}
 		}
 	}
@@ -3662,7 +3685,7 @@ TRACE("Transport::write_path_table: buffer size " + std::to_string(Persistence::
 	}
 #endif
 
-	_saving_path_table = false;
+	_instance->_saving_path_table = false;
 
 	return success;
 }
@@ -3818,9 +3841,13 @@ TRACE("Transport::write_path_table: buffer size " + std::to_string(Persistence::
 	// CBA Remove cached packets no longer in path list
 	std::list<std::string> files = OS::list_directory(Reticulum::_cachepath);
     for (auto& file : files) {
+		// Resource transfer state is cleaned by Resource::clean_cache()
+		if (file.compare("resources") == 0) {
+			continue;
+		}
 		TRACE("Transport::clean_caches: Checking for use of cached packet " + file);
 		bool found = false;
-		for (auto& [destination_hash, destination_entry] : _destination_table) {
+		for (auto& [destination_hash, destination_entry] : _instance->_destination_table) {
 			if (file.compare(destination_entry._announce_packet.toHex()) == 0) {
 				found = true;
 				break;
@@ -3843,11 +3870,11 @@ TRACE("Transport::write_path_table: buffer size " + std::to_string(Persistence::
 	size_t memory = OS::heap_available();
 	size_t flash = OS::storage_available();
 
-	if (_last_memory == 0) {
-		_last_memory = memory;
+	if (_instance->_last_memory == 0) {
+		_instance->_last_memory = memory;
 	}
-	if (_last_flash == 0) {
-		_last_flash = flash;
+	if (_instance->_last_flash == 0) {
+		_instance->_last_flash = flash;
 	}
 
 	// memory
@@ -3857,7 +3884,7 @@ TRACE("Transport::write_path_table: buffer size " + std::to_string(Persistence::
 	// _reverse_table
 	// _announce_table
 	// _held_announces
-	HEADF(LOG_VERBOSE, "mem: %u (%u%%) [%d] flash: %u (%u%%) [%d] paths: %u dsts: %u revr: %u annc: %u held: %u", memory, (int)((double)memory / (double)OS::heap_size() * 100.0), memory - _last_memory, flash, (int)((double)flash / (double)OS::storage_size() * 100.0), flash - _last_flash, _destination_table.size(), _destinations.size(), _reverse_table.size(), _announce_table.size(), _held_announces.size());
+	HEADF(LOG_VERBOSE, "mem: %u (%u%%) [%d] flash: %u (%u%%) [%d] paths: %u dsts: %u revr: %u annc: %u held: %u", memory, (int)((double)memory / (double)OS::heap_size() * 100.0), memory - _instance->_last_memory, flash, (int)((double)flash / (double)OS::storage_size() * 100.0), flash - _instance->_last_flash, _instance->_destination_table.size(), _instance->_destinations.size(), _instance->_reverse_table.size(), _instance->_announce_table.size(), _instance->_held_announces.size());
 
 	// _path_requests
 	// _discovery_path_requests
@@ -3865,7 +3892,7 @@ TRACE("Transport::write_path_table: buffer size " + std::to_string(Persistence::
 	// _discovery_pr_tags
 	// _control_destinations
 	// _control_hashes
-	VERBOSEF("preqs: %u dpreqs: %u ppreqs: %u dprt: %u cdsts: %u chshs: %u", _path_requests.size(), _discovery_path_requests.size(), _pending_local_path_requests.size(), _discovery_pr_tags.size(), _control_destinations.size(), _control_hashes.size());
+	VERBOSEF("preqs: %u dpreqs: %u ppreqs: %u dprt: %u ifpreqs: %u cdsts: %u chshs: %u", _instance->_path_requests.size(), _instance->_discovery_path_requests.size(), _instance->_pending_local_path_requests.size(), _instance->_discovery_pr_tags.size(), _instance->_path_requests_in_flight.size(), _instance->_control_destinations.size(), _instance->_control_hashes.size());
 
 	// _packet_hashlist
 	// _receipts
@@ -3874,24 +3901,24 @@ TRACE("Transport::write_path_table: buffer size " + std::to_string(Persistence::
 	// _active_links
 	// _tunnels
 	uint32_t destination_path_responses = 0;
-	for (auto& [destination_hash, destination] : _destinations) {
+	for (auto& [destination_hash, destination] : _instance->_destinations) {
 		destination_path_responses += destination.path_responses().size();
 	}
 	uint32_t interface_announces = 0;
-	for (auto& [interface_hash, interface] : _interfaces) {
+	for (auto& [interface_hash, interface] : _instance->_interfaces) {
 		interface_announces += interface.announce_queue().size();
 	}
-	VERBOSEF("phl: %u rcp: %u lt: %u pl: %u al: %u tun: %u", _packet_hashlist.size(), _receipts.size(), _link_table.size(), _pending_links.size(), _active_links.size(), _tunnels.size());
-	VERBOSEF("pin: %u pout: %u padd: %u dpr: %u ikd: %u ia: %u\r\n", _packets_received, _packets_sent, _destinations_added, destination_path_responses, Identity::_known_destinations.size(), interface_announces);
+	VERBOSEF("phl: %u rcp: %u lt: %u pl: %u al: %u tun: %u", _instance->_packet_hashlist.size(), _instance->_receipts.size(), _instance->_link_table.size(), _instance->_pending_links.size(), _instance->_active_links.size(), _instance->_tunnels.size());
+	VERBOSEF("pin: %u pout: %u padd: %u dpr: %u ikd: %u ia: %u\r\n", _instance->_packets_received, _instance->_packets_sent, _instance->_destinations_added, destination_path_responses, _instance->_known_destinations.size(), interface_announces);
 
-	_last_memory = memory;
-	_last_flash = flash;
+	_instance->_last_memory = memory;
+	_instance->_last_flash = flash;
 
 }
 
 /*static*/ void Transport::exit_handler() {
 	TRACE("Transport::exit_handler()");
-	if (!_owner.is_connected_to_shared_instance()) {
+	if (!_instance->_owner.is_connected_to_shared_instance()) {
 		persist_data();
 	}
 }
@@ -3899,15 +3926,15 @@ TRACE("Transport::write_path_table: buffer size " + std::to_string(Persistence::
 /*static*/ Destination Transport::find_destination_from_hash(const Bytes& destination_hash) {
 	TRACE("Transport::find_destination_from_hash: Searching for destination " + destination_hash.toHex());
 #if defined(DESTINATIONS_SET)
-	for (const Destination& destination : _destinations) {
+	for (const Destination& destination : _instance->_destinations) {
 		if (destination.get_hash() == destination_hash) {
 			TRACE("Transport::find_destination_from_hash: Found destination " + destination.toString());
 			return destination;
 		}
 	}
 #elif defined(DESTINATIONS_MAP)
-	auto iter = _destinations.find(destination_hash);
-	if (iter != _destinations.end()) {
+	auto iter = _instance->_destinations.find(destination_hash);
+	if (iter != _instance->_destinations.end()) {
 		TRACE("Transport::find_destination_from_hash: Found destination " + (*iter).second.toString());
 		return (*iter).second;
 	}
@@ -3916,9 +3943,126 @@ TRACE("Transport::write_path_table: buffer size " + std::to_string(Persistence::
 	return {Type::NONE};
 }
 
+/*static*/ const std::map<Bytes, Interface&> Transport::get_interfaces() {
+	return _instance->_interfaces;
+}
+
+/*static*/ void Transport::set_receive_packet_callback(Callbacks::receive_packet callback) {
+	_instance->_callbacks._receive_packet = callback;
+}
+
+/*static*/ void Transport::set_transmit_packet_callback(Callbacks::transmit_packet callback) {
+	_instance->_callbacks._transmit_packet = callback;
+}
+
+/*static*/ void Transport::set_filter_packet_callback(Callbacks::filter_packet callback) {
+	_instance->_callbacks._filter_packet = callback;
+}
+
+/*static*/ const Reticulum& Transport::reticulum() {
+	return _instance->_owner;
+}
+
+/*static*/ const Identity& Transport::identity() {
+	return _instance->_identity;
+}
+
+/*static*/ void Transport::identity(Identity& identity) {
+	_instance->_identity = identity;
+}
+
+/*static*/ const std::map<Bytes, Transport::DestinationEntry>& Transport::get_destination_table() {
+	return _instance->_destination_table;
+}
+
+/*static*/ const std::map<Bytes, Transport::RateEntry>& Transport::get_announce_rate_table() {
+	return _instance->_announce_rate_table;
+}
+
+/*static*/ const std::map<Bytes, Transport::LinkEntry>& Transport::get_link_table() {
+	return _instance->_link_table;
+}
+
+/*static*/ const TransportLimits& Transport::limits() {
+	return _instance->_limits;
+}
+
+/*static*/ uint32_t Transport::path_table_maxsize() {
+	return _instance->_path_table_maxsize;
+}
+
+/*static*/ void Transport::path_table_maxsize(uint32_t path_table_maxsize) {
+	TransportLimits limits = _instance->_limits;
+	limits._path_table_maxsize = path_table_maxsize;
+	Transport::limits(limits);
+}
+
+/*static*/ uint32_t Transport::path_table_maxpersist() {
+	return _instance->_path_table_maxpersist;
+}
+
+/*static*/ void Transport::path_table_maxpersist(uint32_t path_table_maxpersist) {
+	TransportLimits limits = _instance->_limits;
+	limits._path_table_maxpersist = path_table_maxpersist;
+	Transport::limits(limits);
+}
+
+// Approximate heap footprint of one std::map node holding key and value
+template <typename Key, typename Value>
+static constexpr size_t map_node_size() {
+	return sizeof(std::pair<const Key, Value>) + 4 * sizeof(void*);
+}
+
+// Approximate heap footprint of the shared buffer behind a Bytes of length bytes
+static constexpr size_t bytes_buffer_size(size_t length) {
+	return sizeof(std::vector<uint8_t>) + 4 * sizeof(void*) + length;
+}
+
+// Caps a capacity to the number of entries of entry_size that fit in budget
+static uint32_t budgeted_capacity(uint32_t capacity, size_t budget, size_t entry_size) {
+	if (budget == 0) {
+		return capacity;
+	}
+	size_t entries = std::max(budget / entry_size, (size_t)1);
+	return (uint32_t)std::min((size_t)capacity, entries);
+}
+
+/*static*/ void Transport::limits(const TransportLimits& limits) {
+	_instance->_limits = limits;
+
+	// Path table entry with its hash key, next hop, interface and packet hashes and a single random blob
+	const size_t path_entry_size = map_node_size<Bytes, DestinationEntry>()
+		+ 2 * bytes_buffer_size(Type::Reticulum::TRUNCATED_HASHLENGTH/8)
+		+ 2 * bytes_buffer_size(Type::Identity::HASHLENGTH/8)
+		+ sizeof(Bytes) + 4 * sizeof(void*) + bytes_buffer_size(10);
+	// Packet hashlist entry with its full packet hash
+	const size_t hashlist_entry_size = sizeof(Bytes) + 4 * sizeof(void*) + bytes_buffer_size(Type::Identity::HASHLENGTH/8);
+	// Known destination entry with its hash key, packet hash, public key, nominal app data,
+	// and the decoded keys and identity hash cached on first recall
+	const size_t known_destination_entry_size = map_node_size<Bytes, decltype(TransportInstance::_known_destinations)::mapped_type>()
+		+ bytes_buffer_size(Type::Reticulum::TRUNCATED_HASHLENGTH/8)
+		+ bytes_buffer_size(Type::Identity::HASHLENGTH/8)
+		+ bytes_buffer_size(Type::Identity::KEYSIZE/8)
+		+ bytes_buffer_size(32)
+		+ sizeof(Cryptography::X25519PublicKey) + sizeof(Cryptography::Ed25519PublicKey) + 2 * 4 * sizeof(void*)
+		+ bytes_buffer_size(Type::Reticulum::TRUNCATED_HASHLENGTH/8);
+
+	_instance->_path_table_maxsize = budgeted_capacity(limits._path_table_maxsize, limits._path_table_maxbytes, path_entry_size);
+	_instance->_path_table_maxpersist = std::min(limits._path_table_maxpersist, _instance->_path_table_maxsize);
+	_instance->_hashlist_maxsize = budgeted_capacity(limits._hashlist_maxsize, limits._hashlist_maxbytes, hashlist_entry_size);
+	_instance->_max_pr_tags = limits._max_pr_tags;
+	_instance->_known_destinations_maxsize = budgeted_capacity(limits._known_destinations_maxsize, limits._known_destinations_maxbytes, known_destination_entry_size);
+
+	VERBOSEF("Transport limits: paths %u (persist %u), hashlist %u, pr tags %u, known destinations %u", _instance->_path_table_maxsize, _instance->_path_table_maxpersist, _instance->_hashlist_maxsize, _instance->_max_pr_tags, _instance->_known_destinations_maxsize);
+
+	// Bring tables within the new limits right away
+	cull_path_table();
+	Identity::cull_known_destinations();
+}
+
 /*static*/ void Transport::cull_path_table() {
 	TRACE("Transport::cull_path_table()");
-	if (_destination_table.size() > _path_table_maxsize) {
+	if (_instance->_destination_table.size() > _instance->_path_table_maxsize) {
 		// TODO prune by age, or better yet by last use
 /*
 		std::map<Bytes, DestinationEntry>::iterator iter = _destination_table.begin();
@@ -3956,10 +4100,11 @@ TRACE("Transport::write_path_table: buffer size " + std::to_string(Persistence::
 		}
 		DEBUG("Removed " + std::to_string(count) + " path(s) from path table");
 */
-		uint16_t count = 0;
+		uint32_t count = 0;
 		std::vector<std::pair<Bytes,DestinationEntry>> sorted_pairs;
+		sorted_pairs.reserve(_instance->_destination_table.size());
 		// Copy key/value pairs from map into vector
-		std::for_each(_destination_table.begin(), _destination_table.end(), [&](const std::pair<const Bytes, DestinationEntry>& ref) {
+		std::for_each(_instance->_destination_table.begin(), _instance->_destination_table.end(), [&](const std::pair<const Bytes, DestinationEntry>& ref) {
 			sorted_pairs.push_back(ref);
 		});
 		// Sort vector using specified comparator
@@ -3970,7 +4115,7 @@ TRACE("Transport::write_path_table: buffer size " + std::to_string(Persistence::
 		for (auto& [destination_hash, destination_entry] : sorted_pairs) {
 			TRACE("Transport::cull_path_table: Removing destination " + destination_hash.toHex() + " from path table");
 			// Remove destination from path table
-			if (_destination_table.erase(destination_hash) < 1) {
+			if (_instance->_destination_table.erase(destination_hash) < 1) {
 				WARNING("Failed to remove destination " + destination_hash.toHex() + " from path table");
 			}
 			// Remove announce packet from packet table
@@ -3986,7 +4131,7 @@ TRACE("Transport::write_path_table: buffer size " + std::to_string(Persistence::
 			}
 #endif
 			++count;
-			if (_destination_table.size() <= _path_table_maxsize) {
+			if (_instance->_destination_table.size() <= _instance->_path_table_maxsize) {
 				break;
 			}
 		}
@@ -3994,10 +4139,10 @@ TRACE("Transport::write_path_table: buffer size " + std::to_string(Persistence::
 	}
 }
 	
-/*static*/ uint16_t Transport::remove_reverse_entries(const std::vector<Bytes>& hashes) {
-	uint16_t count = 0;
+/*static*/ uint32_t Transport::remove_reverse_entries(const std::vector<Bytes>& hashes) {
+	uint32_t count = 0;
 	for (const auto& truncated_packet_hash : hashes) {
-		_reverse_table.erase(truncated_packet_hash);
+		_instance->_reverse_table.erase(truncated_packet_hash);
 		++count;
 	}
 	if (count > 0) {
@@ -4006,10 +4151,10 @@ TRACE("Transport::write_path_table: buffer size " + std::to_string(Persistence::
 	return count;
 }
 
-/*static*/ uint16_t Transport::remove_links(const std::vector<Bytes>& hashes) {
-	uint16_t count = 0;
+/*static*/ uint32_t Transport::remove_links(const std::vector<Bytes>& hashes) {
+	uint32_t count = 0;
 	for (const auto& link_id : hashes) {
-		_link_table.erase(link_id);
+		_instance->_link_table.erase(link_id);
 		++count;
 	}
 	if (count > 0) {
@@ -4018,8 +4163,8 @@ TRACE("Transport::write_path_table: buffer size " + std::to_string(Persistence::
 	return count;
 }
 
-/*static*/ uint16_t Transport::remove_paths(const std::vector<Bytes>& hashes) {
-	uint16_t count = 0;
+/*static*/ uint32_t Transport::remove_paths(const std::vector<Bytes>& hashes) {
+	uint32_t count = 0;
 	for (const auto& destination_hash : hashes) {
 		//_destination_table.erase(destination_hash);
 		remove_path(destination_hash);
@@ -4031,10 +4176,10 @@ TRACE("Transport::write_path_table: buffer size " + std::to_string(Persistence::
 	return count;
 }
 
-/*static*/ uint16_t Transport::remove_discovery_path_requests(const std::vector<Bytes>& hashes) {
-	uint16_t count = 0;
+/*static*/ uint32_t Transport::remove_discovery_path_requests(const std::vector<Bytes>& hashes) {
+	uint32_t count = 0;
 	for (const auto& destination_hash : hashes) {
-		_discovery_path_requests.erase(destination_hash);
+		_instance->_discovery_path_requests.erase(destination_hash);
 		++count;
 	}
 	if (count > 0) {
@@ -4043,10 +4188,10 @@ TRACE("Transport::write_path_table: buffer size " + std::to_string(Persistence::
 	return count;
 }
 
-/*static*/ uint16_t Transport::remove_tunnels(const std::vector<Bytes>& hashes) {
-	uint16_t count = 0;
+/*static*/ uint32_t Transport::remove_tunnels(const std::vector<Bytes>& hashes) {
+	uint32_t count = 0;
 	for (const auto& tunnel_id : hashes) {
-		_tunnels.erase(tunnel_id);
+		_instance->_tunnels.erase(tunnel_id);
 		++count;
 	}
 	if (count > 0) {
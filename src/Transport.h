@@ -24,9 +24,12 @@ namespace RNS {
 
 	class Reticulum;
 	class Identity;
+	class TransportInstance;
 	class Destination;
 	class Interface;
 	class Link;
+	class Resource;
+	class Channel;
 	class Packet;
 	class PacketReceipt;
 
@@ -49,6 +52,53 @@ namespace RNS {
 	};
 	using HAnnounceHandler = std::shared_ptr<AnnounceHandler>;
 
+	// Runtime sizing of the transport and identity tables. Native builds
+	// default to the sizing of the reference implementation, other builds to
+	// a sizing for MCU targets. Either can be applied, or values of their own,
+	// through Transport::limits(). A byte budget of zero means no budget,
+	// otherwise it further caps the table at the number of entries that fit
+	// the budget.
+	class TransportLimits {
+	public:
+		// Sizing of the reference implementation, for hosts with ample memory
+		static inline TransportLimits desktop() {
+			TransportLimits limits;
+			limits._path_table_maxsize = 1000000;
+			limits._path_table_maxpersist = 1000000;
+			limits._hashlist_maxsize = 1000000;
+			limits._max_pr_tags = 32000;
+			limits._known_destinations_maxsize = 1000000;
+			return limits;
+		}
+		// Sizing for MCU targets
+		static inline TransportLimits mcu() {
+			TransportLimits limits;
+			limits._path_table_maxsize = 100;
+			limits._path_table_maxpersist = 100;
+			limits._hashlist_maxsize = 100;
+			limits._max_pr_tags = 32;
+			limits._known_destinations_maxsize = 100;
+			return limits;
+		}
+	public:
+#if defined(NATIVE)
+		uint32_t _path_table_maxsize = 1000000;
+		uint32_t _path_table_maxpersist = 1000000;
+		uint32_t _hashlist_maxsize = 1000000;
+		uint32_t _max_pr_tags = 32000;
+		uint32_t _known_destinations_maxsize = 1000000;
+#else
+		uint32_t _path_table_maxsize = 100;
+		uint32_t _path_table_maxpersist = 100;
+		uint32_t _hashlist_maxsize = 100;
+		uint32_t _max_pr_tags = 32;
+		uint32_t _known_destinations_maxsize = 100;
+#endif
+		size_t _path_table_maxbytes = 0;
+		size_t _hashlist_maxbytes = 0;
+		size_t _known_destinations_maxbytes = 0;
+	};
+
     /*
     Through static methods of this class you can interact with the
     Transport system of Reticulum.
@@ -61,6 +111,7 @@ namespace RNS {
 			using receive_packet = void(*)(const Bytes& raw, const Interface& interface);
 			using transmit_packet = void(*)(const Bytes& raw, const Interface& interface);
 			using filter_packet = bool(*)(const Packet& packet);
+			using path_response = void(*)(const Bytes& destination_hash, bool path_found);
 		public:
 			receive_packet _receive_packet = nullptr;
 			transmit_packet _transmit_packet = nullptr;
@@ -241,6 +292,25 @@ namespace RNS {
 			const Interface _requesting_interface = {Type::NONE};
 		};
 
+		// Locally originated path request awaiting a response. Further requests
+		// for the same destination are coalesced into this entry until it times out.
+		class InFlightPathRequestEntry {
+		public:
+			InFlightPathRequestEntry(double requested_at, double timeout) :
+				_requested_at(requested_at),
+				_timeout(timeout)
+			{
+			}
+		public:
+			double _requested_at = 0;
+			double _timeout = 0;
+			// Whether the request went out on all interfaces
+			bool _broadcast = false;
+			// Interfaces the request went out on when not broadcast
+			std::set<Bytes> _interface_hashes;
+			std::vector<Callbacks::path_response> _waiters;
+		};
+
 /*
 		// CBA TODO Analyze safety of using Inrerface references here
 		class SerialisedEntry {
@@ -297,6 +367,19 @@ namespace RNS {
 			std::vector<double> _timestamps;
 		};
 
+		// A job on the deadline schedule, the id lets its owner cancel it
+		class DeadlineEntry {
+		public:
+			DeadlineEntry(uint32_t id, const std::function<void()>& job) :
+				_id(id),
+				_job(job)
+			{
+			}
+		public:
+			uint32_t _id = 0;
+			std::function<void()> _job;
+		};
+
 	public:
 		static void start(const Reticulum& reticulum_instance);
 		static void loop();
@@ -312,11 +395,20 @@ namespace RNS {
 		static void handle_tunnel(const Bytes& tunnel_id, const Interface& interface);
 		static void register_interface(Interface& interface);
 		static void deregister_interface(const Interface& interface);
-		inline static const std::map<Bytes, Interface&> get_interfaces() { return _interfaces; }
+		static const std::map<Bytes, Interface&> get_interfaces();
 		static void register_destination(Destination& destination);
 		static void deregister_destination(const Destination& destination);
 		static void register_link(Link& link);
 		static void activate_link(Link& link);
+		// Timed work, such as link, resource and channel watchdogs and
+		// deferred flushes, runs as jobs on one deadline schedule per
+		// instance. Jobs cost nothing until due. schedule_deadline() returns
+		// an id for cancel_deadline(), which ignores jobs already run.
+		static uint32_t schedule_deadline(double deadline, const std::function<void()>& job);
+		static void cancel_deadline(double deadline, uint32_t id);
+		static void run_deadlines();
+		// Time at which loop() next has work to do, for callers that sleep between calls
+		static double next_wakeup();
 		static void register_announce_handler(HAnnounceHandler handler);
 		static void deregister_announce_handler(HAnnounceHandler handler);
 		static Interface find_interface_from_hash(const Bytes& interface_hash);
@@ -326,6 +418,7 @@ namespace RNS {
 		static bool clear_cached_packet(const Bytes& packet_hash);
 		static bool cache_request_packet(const Packet& packet);
 		static void cache_request(const Bytes& packet_hash, const Destination& destination);
+		static void cache_request(const Bytes& packet_hash, const Link& link);
 		static bool remove_path(const Bytes& destination_hash);
 		static bool has_path(const Bytes& destination_hash);
 		static uint8_t hops_to(const Bytes& destination_hash);
@@ -341,6 +434,8 @@ namespace RNS {
 		//static void request_path(const Bytes& destination_hash, const Interface& on_interface = {Type::NONE}, const Bytes& tag = {}, bool recursive = false);
 		static void request_path(const Bytes& destination_hash, const Interface& on_interface, const Bytes& tag = {}, bool recursive = false);
 		static void request_path(const Bytes& destination_hash);
+		static void request_path(const Bytes& destination_hash, Callbacks::path_response callback);
+		static void path_request_concluded(const Bytes& destination_hash, bool path_found);
 		static void path_request_handler(const Bytes& data, const Packet& packet);
 		static void path_request(const Bytes& destination_hash, bool is_from_local_client, const Interface& attached_interface, const Bytes& requestor_transport_id = {}, const Bytes& tag = {});
 		static bool from_local_client(const Packet& packet);
@@ -351,6 +446,7 @@ namespace RNS {
 		static void shared_connection_reappeared();
 		static void drop_announce_queues();
 		static uint64_t announce_emitted(const Packet& packet);
+		static uint8_t announce_blocked_modes(const Packet& packet);
 		static void write_packet_hashlist();
 		static bool read_path_table();
 		static bool write_path_table();
@@ -361,11 +457,11 @@ namespace RNS {
 		static void dump_stats();
 		static void exit_handler();
 
-		static uint16_t remove_reverse_entries(const std::vector<Bytes>& hashes);
-		static uint16_t remove_links(const std::vector<Bytes>& hashes);
-		static uint16_t remove_paths(const std::vector<Bytes>& hashes);
-		static uint16_t remove_discovery_path_requests(const std::vector<Bytes>& hashes);
-		static uint16_t remove_tunnels(const std::vector<Bytes>& hashes);
+		static uint32_t remove_reverse_entries(const std::vector<Bytes>& hashes);
+		static uint32_t remove_links(const std::vector<Bytes>& hashes);
+		static uint32_t remove_paths(const std::vector<Bytes>& hashes);
+		static uint32_t remove_discovery_path_requests(const std::vector<Bytes>& hashes);
+		static uint32_t remove_tunnels(const std::vector<Bytes>& hashes);
 
 		static Destination find_destination_from_hash(const Bytes& destination_hash);
 
@@ -373,119 +469,34 @@ namespace RNS {
 		static void cull_path_table();
 
 		// getters/setters
-		static inline void set_receive_packet_callback(Callbacks::receive_packet callback) { _callbacks._receive_packet = callback; }
-		static inline void set_transmit_packet_callback(Callbacks::transmit_packet callback) { _callbacks._transmit_packet = callback; }
-		static inline void set_filter_packet_callback(Callbacks::filter_packet callback) { _callbacks._filter_packet = callback; }
-		static inline const Reticulum& reticulum() { return _owner; }
-		static inline const Identity& identity() { return _identity; }
-		inline static uint16_t path_table_maxsize() { return _path_table_maxsize; }
-		inline static void path_table_maxsize(uint16_t path_table_maxsize) { _path_table_maxsize = path_table_maxsize; }
-		inline static uint16_t probe_destination_enabled() { return _path_table_maxpersist; }
-		inline static void path_table_maxpersist(uint16_t path_table_maxpersist) { _path_table_maxpersist = path_table_maxpersist; }
+		static void set_receive_packet_callback(Callbacks::receive_packet callback);
+		static void set_transmit_packet_callback(Callbacks::transmit_packet callback);
+		static void set_filter_packet_callback(Callbacks::filter_packet callback);
+		static const Reticulum& reticulum();
+		static const Identity& identity();
+		static const TransportLimits& limits();
+		static void limits(const TransportLimits& limits);
+		static uint32_t path_table_maxsize();
+		static void path_table_maxsize(uint32_t path_table_maxsize);
+		static uint32_t path_table_maxpersist();
+		static void path_table_maxpersist(uint32_t path_table_maxpersist);
 		// CBA TEST
-		static inline void identity(Identity& identity) { _identity = identity; }
+		static void identity(Identity& identity);
 
-		inline static const std::map<Bytes, DestinationEntry>& get_destination_table() { return _destination_table; }
-		inline static const std::map<Bytes, RateEntry>& get_announce_rate_table() { return _announce_rate_table; }
-		inline static const std::map<Bytes, LinkEntry>& get_link_table() { return _link_table; }
+		static const std::map<Bytes, DestinationEntry>& get_destination_table();
+		static const std::map<Bytes, RateEntry>& get_announce_rate_table();
+		static const std::map<Bytes, LinkEntry>& get_link_table();
 
-	private:
-		// CBA MUST use references to interfaces here in order for virtul overrides for send/receive to work
-#if defined(INTERFACES_SET)
-		// set sorted, can use find
-		//static std::set<std::reference_wrapper<const Interface>, std::less<const Interface>> _interfaces;           // All active interfaces
-		static std::set<std::reference_wrapper<Interface>, std::less<Interface>> _interfaces;           // All active interfaces
-#elif defined(INTERFACES_LIST)
-		// list is unsorted, can't use find
-		static std::list<std::reference_wrapper<Interface>> _interfaces;           // All active interfaces
-#elif defined(INTERFACES_MAP)
-		// map is sorted, can use find
-		static std::map<Bytes, Interface&> _interfaces;           // All active interfaces
-#endif
-#if defined(DESTINATIONS_SET)
-		static std::set<Destination> _destinations;           // All active destinations
-#elif defined(DESTINATIONS_MAP)
-		static std::map<Bytes, Destination> _destinations;           // All active destinations
-#endif
-		// CBA TODO: Reconsider using std::set for enforcing uniqueness. Maybe consider std::map keyed on hash instead
-		static std::set<Link> _pending_links;           // Links that are being established
-		static std::set<Link> _active_links;           // Links that are active
-		static std::set<Bytes> _packet_hashlist;           // A list of packet hashes for duplicate detection
-		static std::list<PacketReceipt> _receipts;           // Receipts of all outgoing packets for proof processing
-
-		// TODO: "destination_table" should really be renamed to "path_table"
-		// Notes on memory usage: 1 megabyte of memory can store approximately
-		// 55.100 path table entries or approximately 22.300 link table entries.
-
-		static std::map<Bytes, AnnounceEntry> _announce_table;           // A table for storing announces currently waiting to be retransmitted
-		static std::map<Bytes, DestinationEntry> _destination_table;           // A lookup table containing the next hop to a given destination
-		static std::map<Bytes, ReverseEntry> _reverse_table;           // A lookup table for storing packet hashes used to return proofs and replies
-		static std::map<Bytes, LinkEntry> _link_table;           // A lookup table containing hops for links
-		static std::map<Bytes, AnnounceEntry> _held_announces;           // A table containing temporarily held announce-table entries
-		static std::set<HAnnounceHandler> _announce_handlers;           // A table storing externally registered announce handlers
-		static std::map<Bytes, TunnelEntry> _tunnels;           // A table storing tunnels to other transport instances
-		static std::map<Bytes, RateEntry> _announce_rate_table;           // A table for keeping track of announce rates
-		static std::map<Bytes, double> _path_requests;           // A table for storing path request timestamps
-
-		static std::map<Bytes, PathRequestEntry> _discovery_path_requests;       // A table for keeping track of path requests on behalf of other nodes
-		static std::set<Bytes> _discovery_pr_tags;       // A table for keeping track of tagged path requests
-
-		// Transport control destinations are used
-		// for control purposes like path requests
-		static std::set<Destination> _control_destinations;
-		static std::set<Bytes> _control_hashes;
-
-		// Interfaces for communicating with
-		// local clients connected to a shared
-		// Reticulum instance
-		//static std::set<Interface> _local_client_interfaces;
-		static std::set<std::reference_wrapper<const Interface>, std::less<const Interface>> _local_client_interfaces;
-
-		static std::map<Bytes, const Interface&> _pending_local_path_requests;
+		// The node the static API operates on, the default instance unless
+		// another has been selected. Switching instances is not synchronised
+		// and must not happen while the current node is being driven.
+		inline static TransportInstance& instance() { return *_instance; }
+		inline static void instance(TransportInstance& instance) { _instance = &instance; }
+		inline static TransportInstance& default_instance() { return _default_instance; }
 
-		// CBA
-		static std::map<Bytes, PacketEntry> _packet_table;           // A lookup table containing announce packets for known paths
-
-		//z _local_client_rssi_cache    = []
-		//z _local_client_snr_cache     = []
-		static uint16_t _LOCAL_CLIENT_CACHE_MAXSIZE;
-
-		static double _start_time;
-		static bool _jobs_locked;
-		static bool _jobs_running;
-		static float _job_interval;
-		static double _jobs_last_run;
-		static double _links_last_checked;
-		static float _links_check_interval;
-		static double _receipts_last_checked;
-		static float _receipts_check_interval;
-		static double _announces_last_checked;
-		static float _announces_check_interval;
-		static double _tables_last_culled;
-		static float _tables_cull_interval;
-		static bool _saving_path_table;
-		static uint16_t _hashlist_maxsize;
-		static uint16_t _max_pr_tags;
-
-		// CBA
-		static uint16_t _path_table_maxsize;
-		static uint16_t _path_table_maxpersist;
-		static double _last_saved;
-		static float _save_interval;
-		static uint32_t _destination_table_crc;
-
-		static Reticulum _owner;
-		static Identity _identity;
-
-		// CBA
-		static Callbacks _callbacks;
-
-		// CBA Stats
-		static uint32_t _packets_sent;
-		static uint32_t _packets_received;
-		static uint32_t _destinations_added;
-		static size_t _last_memory;
-		static size_t _last_flash;
+	private:
+		static TransportInstance _default_instance;
+		static TransportInstance* _instance;
 	};
 
 	template <typename M, typename S> 
@@ -0,0 +1,158 @@
+#pragma once
+
+#include "Transport.h"
+#include "Reticulum.h"
+#include "Identity.h"
+#include "Destination.h"
+#include "Link.h"
+#include "Resource.h"
+#include "Channel.h"
+#include "Buffer.h"
+#include "Packet.h"
+#include "Interface.h"
+#include "Bytes.h"
+#include "Type.h"
+
+#include <map>
+#include <list>
+#include <set>
+#include <functional>
+#include <stdint.h>
+
+namespace RNS {
+
+    /*
+    State of one Transport node. The static Transport API operates on the
+    active instance, which is a process-wide default unless another one is
+    selected through Transport::instance(). Several instances can be held
+    in one process to simulate a network of nodes, with the caller
+    switching the active instance before driving each node.
+    */
+	class TransportInstance {
+
+	public:
+		TransportInstance() {}
+		virtual ~TransportInstance() {}
+
+	private:
+		TransportInstance(const TransportInstance&) = delete;
+		TransportInstance& operator=(const TransportInstance&) = delete;
+
+	public:
+		// CBA MUST use references to interfaces here in order for virtul overrides for send/receive to work
+#if defined(INTERFACES_SET)
+		// set sorted, can use find
+		//std::set<std::reference_wrapper<const Interface>, std::less<const Interface>> _interfaces;           // All active interfaces
+		std::set<std::reference_wrapper<Interface>, std::less<Interface>> _interfaces;           // All active interfaces
+#elif defined(INTERFACES_LIST)
+		// list is unsorted, can't use find
+		std::list<std::reference_wrapper<Interface>> _interfaces;           // All active interfaces
+#elif defined(INTERFACES_MAP)
+		// map is sorted, can use find
+		std::map<Bytes, Interface&> _interfaces;           // All active interfaces
+#endif
+#if defined(DESTINATIONS_SET)
+		std::set<Destination> _destinations;           // All active destinations
+#elif defined(DESTINATIONS_MAP)
+		std::map<Bytes, Destination> _destinations;           // All active destinations
+#endif
+		// CBA TODO: Reconsider using std::set for enforcing uniqueness. Maybe consider std::map keyed on hash instead
+		std::set<Link> _pending_links;           // Links that are being established
+		std::set<Link> _active_links;           // Links that are active
+		std::multimap<double, Transport::DeadlineEntry> _deadlines;           // Jobs keyed on the time they are due
+		uint32_t _last_deadline_id = 0;
+		std::set<Bytes> _packet_hashlist;           // A list of packet hashes for duplicate detection
+		std::list<PacketReceipt> _receipts;           // Receipts of all outgoing packets for proof processing
+
+		// TODO: "destination_table" should really be renamed to "path_table"
+		// Notes on memory usage: 1 megabyte of memory can store approximately
+		// 55.100 path table entries or approximately 22.300 link table entries.
+
+		std::map<Bytes, Transport::AnnounceEntry> _announce_table;           // A table for storing announces currently waiting to be retransmitted
+		std::map<Bytes, Transport::DestinationEntry> _destination_table;           // A lookup table containing the next hop to a given destination
+		std::map<Bytes, Transport::ReverseEntry> _reverse_table;           // A lookup table for storing packet hashes used to return proofs and replies
+		std::map<Bytes, Transport::LinkEntry> _link_table;           // A lookup table containing hops for links
+		std::map<Bytes, Transport::AnnounceEntry> _held_announces;           // A table containing temporarily held announce-table entries
+		std::set<HAnnounceHandler> _announce_handlers;           // A table storing externally registered announce handlers
+		std::map<Bytes, Transport::TunnelEntry> _tunnels;           // A table storing tunnels to other transport instances
+		std::map<Bytes, Transport::RateEntry> _announce_rate_table;           // A table for keeping track of announce rates
+		std::map<Bytes, double> _path_requests;           // A table for storing path request timestamps
+
+		std::map<Bytes, Transport::PathRequestEntry> _discovery_path_requests;       // A table for keeping track of path requests on behalf of other nodes
+		std::set<Bytes> _discovery_pr_tags;       // A table for keeping track of tagged path requests
+		std::list<Bytes> _discovery_pr_tags_age;       // Tagged path requests in order of arrival, oldest first
+		std::map<Bytes, Transport::InFlightPathRequestEntry> _path_requests_in_flight;       // A table of locally originated path requests awaiting a response
+
+		// Transport control destinations are used
+		// for control purposes like path requests
+		std::set<Destination> _control_destinations;
+		std::set<Bytes> _control_hashes;
+
+		// Interfaces for communicating with
+		// local clients connected to a shared
+		// Reticulum instance
+		//std::set<Interface> _local_client_interfaces;
+		std::set<std::reference_wrapper<const Interface>, std::less<const Interface>> _local_client_interfaces;
+
+		std::map<Bytes, const Interface&> _pending_local_path_requests;
+
+		// CBA
+		std::map<Bytes, Transport::PacketEntry> _packet_table;           // A lookup table containing announce packets for known paths
+
+		//z _local_client_rssi_cache    = []
+		//z _local_client_snr_cache     = []
+		uint16_t _LOCAL_CLIENT_CACHE_MAXSIZE = 512;
+
+		double _start_time				= 0.0;
+		bool _jobs_locked				= false;
+		bool _jobs_running				= false;
+		float _job_interval				= 0.250;
+		double _jobs_last_run			= 0.0;
+		double _links_last_checked		= 0.0;
+		float _links_check_interval		= 1.0;
+		double _receipts_last_checked	= 0.0;
+		float _receipts_check_interval	= 1.0;
+		double _announces_last_checked	= 0.0;
+		float _announces_check_interval	= 1.0;
+		double _tables_last_culled		= 0.0;
+		// CBA MCU
+		//float _tables_cull_interval	= 5.0;
+		float _tables_cull_interval		= 60.0;
+		bool _saving_path_table			= false;
+		TransportLimits _limits;
+		// Effective capacities derived from _limits
+		// CBA ACCUMULATES
+		uint32_t _hashlist_maxsize		= _limits._hashlist_maxsize;
+		// CBA ACCUMULATES
+		uint32_t _max_pr_tags			= _limits._max_pr_tags;
+
+		// CBA
+		// CBA ACCUMULATES
+		uint32_t _path_table_maxsize	= _limits._path_table_maxsize;
+		// CBA ACCUMULATES
+		uint32_t _path_table_maxpersist	= _limits._path_table_maxpersist;
+		double _last_saved				= 0.0;
+		float _save_interval			= 3600.0;
+		uint32_t _destination_table_crc	= 0;
+
+		Reticulum _owner {Type::NONE};
+		Identity _identity {Type::NONE};
+
+		// CBA
+		Transport::Callbacks _callbacks;
+
+		// Identities recalled by this node, see Identity::remember()
+		std::map<Bytes, Identity::IdentityEntry> _known_destinations;
+		bool _saving_known_destinations = false;
+		// CBA ACCUMULATES
+		uint32_t _known_destinations_maxsize = _limits._known_destinations_maxsize;
+
+		// CBA Stats
+		uint32_t _packets_sent = 0;
+		uint32_t _packets_received = 0;
+		uint32_t _destinations_added = 0;
+		size_t _last_memory = 0;
+		size_t _last_flash = 0;
+	};
+
+}
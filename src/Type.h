@@ -336,6 +336,7 @@ namespace RNS { namespace Type {
 			COMMAND        = 0x0C,   // Packet is a command
 			COMMAND_STATUS = 0x0D,   // Packet is a status of an executed command
 			CHANNEL        = 0x0E,   // Packet contains link channel data
+			COALESCED      = 0x0F,   // Packet contains several link data messages, only sent to peers signalling support, not in the reference implementation
 			KEEPALIVE      = 0xFA,   // Packet is a keepalive packet
 			LINKIDENTIFY   = 0xFB,   // Packet is a link peer identification proof
 			LINKCLOSE      = 0xFC,   // Packet is a link close message
@@ -459,6 +460,9 @@ namespace RNS { namespace Type {
 
 		// The maximum window size for transfers on fast links
 		static const uint8_t WINDOW_MAX_FAST      = 75;
+
+		// The maximum window size for transfers on very slow links
+		static const uint8_t WINDOW_MAX_VERY_SLOW = 4;
 		
 		// For calculating maps and guard segments, this
 		// must be set to the global maximum window.
@@ -474,6 +478,15 @@ namespace RNS { namespace Type {
 		// bytes per second, hence the "/ 8").
 		static const uint16_t RATE_FAST            = (50*1000) / 8;
 
+		// If the RTT rate is lower than this value,
+		// the window size will be capped at 4 parts.
+		// The default is 2 Kbps.
+		static const uint16_t RATE_VERY_SLOW       = (2*1000) / 8;
+
+		// If the very slow rate is sustained for this many
+		// request rounds, the very slow window size is used.
+		static const uint8_t VERY_SLOW_RATE_THRESHOLD = 2;
+
 		// The minimum allowed flexibility of the window size.
 		// The difference between window_max and window_min
 		// will never be smaller than this value.
@@ -500,19 +513,28 @@ namespace RNS { namespace Type {
 		// Capped at 16777215 (0xFFFFFF) per segment to
 		// fit in 3 bytes in resource advertisements.
 		static const uint32_t MAX_EFFICIENT_SIZE      = 16 * 1024 * 1024 - 1;
+
+		// The maximum size of packed metadata. It travels
+		// in the first segment after its size in 3 bytes.
+		static const uint32_t METADATA_MAX_SIZE       = MAX_EFFICIENT_SIZE - 3;
 		static const uint8_t RESPONSE_MAX_GRACE_TIME = 10;
 		
 		// The maximum size to auto-compress with
 		// bz2 before sending.
 		static const uint32_t AUTO_COMPRESS_MAX_SIZE = MAX_EFFICIENT_SIZE;
 
+		// Plaintext read from a source stream per step while spooling it
+		static const uint16_t SPOOL_CHUNK_SIZE = 1024;
+
 		static const uint8_t PART_TIMEOUT_FACTOR           = 4;
 		static const uint8_t PART_TIMEOUT_FACTOR_AFTER_RTT = 2;
+		static const uint8_t PROOF_TIMEOUT_FACTOR          = 3;
 		static const uint8_t MAX_RETRIES                   = 8;
 		static const uint8_t MAX_ADV_RETRIES               = 4;
 		static const uint8_t SENDER_GRACE_TIME             = 10;
 		static const float RETRY_GRACE_TIME              = 0.25;
 		static const float PER_RETRY_DELAY               = 0.5;
+		static const float PROCESSING_GRACE              = 1.0;
 
 		static const uint8_t WATCHDOG_MAX_SLEEP            = 1;
 
@@ -544,6 +566,76 @@ namespace RNS { namespace Type {
 	}
 
 	namespace Channel {
+
+		// The initial window size at channel setup
+		static const uint8_t WINDOW                  = 2;
+
+		// Absolute minimum window size
+		static const uint8_t WINDOW_MIN              = 2;
+		static const uint8_t WINDOW_MIN_LIMIT_SLOW   = 2;
+		static const uint8_t WINDOW_MIN_LIMIT_MEDIUM = 5;
+		static const uint8_t WINDOW_MIN_LIMIT_FAST   = 16;
+
+		// The maximum window size for transfers on slow links
+		static const uint8_t WINDOW_MAX_SLOW         = 5;
+
+		// The maximum window size for transfers on mid-speed links
+		static const uint8_t WINDOW_MAX_MEDIUM       = 12;
+
+		// The maximum window size for transfers on fast links
+		static const uint8_t WINDOW_MAX_FAST         = 48;
+
+		// For calculating maps and guard segments, this
+		// must be set to the global maximum window.
+		static const uint8_t WINDOW_MAX              = WINDOW_MAX_FAST;
+
+		// If the fast rate is sustained for this many request
+		// rounds, the fast link window size will be allowed.
+		static const uint8_t FAST_RATE_THRESHOLD     = 10;
+
+		// Round-trip times in seconds separating fast, medium and slow links
+		static const float RTT_FAST                  = 0.18;
+		static const float RTT_MEDIUM                = 0.75;
+		static const float RTT_SLOW                  = 1.45;
+
+		// The minimum allowed flexibility of the window size.
+		// The difference between window_max and window_min
+		// will never be smaller than this value.
+		static const uint8_t WINDOW_FLEXIBILITY      = 4;
+
+		static const uint16_t SEQ_MAX                = 0xFFFF;
+		static const uint32_t SEQ_MODULUS            = SEQ_MAX + 1;
+
+		// Transmissions of an envelope before the link is torn down
+		static const uint8_t MAX_TRIES               = 5;
+
+		// Time in seconds a Buffer writer holds written data for more
+		static const float WRITER_FLUSH_TIMEOUT      = 0.1;
+
+		// Message type, sequence and length, two bytes each
+		static const uint8_t ENVELOPE_HEADER_SIZE    = 6;
+
+		// Message types from here up are reserved for system messages
+		static const uint16_t SYSTEM_MSGTYPE_MIN     = 0xF000;
+		// System message carrying stream data for Buffer
+		static const uint16_t SMT_STREAM_DATA        = 0xFF00;
+
+		enum MessageState {
+			MSGSTATE_NEW       = 0,
+			MSGSTATE_SENT      = 1,
+			MSGSTATE_DELIVERED = 2,
+			MSGSTATE_FAILED    = 3
+		};
+
+		enum MessageError {
+			ME_NO_MSG_TYPE      = 0,
+			ME_INVALID_MSG_TYPE = 1,
+			ME_NOT_REGISTERED   = 2,
+			ME_LINK_NOT_READY   = 3,
+			ME_ALREADY_SENT     = 4,
+			ME_TOO_BIG          = 5
+		};
+
 	}
 
 } }
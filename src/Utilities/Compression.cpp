@@ -0,0 +1,248 @@
+#include "Compression.h"
+
+#include <stdexcept>
+#include <string.h>
+
+using namespace RNS;
+using namespace RNS::Utilities;
+
+namespace {
+
+	const uint16_t HASH_SIZE = 256;
+	// Window behind the next position plus room to read ahead
+	const uint16_t BUFFER_SIZE = 2 * Lzss::WINDOW_SIZE;
+
+	inline uint8_t hash3(const uint8_t* data) {
+		return (uint8_t)(((uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16)) * 2654435761u >> 24);
+	}
+
+	class LzssCompressor : public Compressor {
+
+	public:
+		LzssCompressor() {
+			memset(_head, 0, sizeof(_head));
+			memset(_prev, 0, sizeof(_prev));
+		}
+
+	public:
+		virtual const Bytes update(const Bytes& data) {
+			Bytes output;
+			const uint8_t* input = data.data();
+			size_t size = data.size();
+			while (size > 0) {
+				if (_fill == BUFFER_SIZE) {
+					slide();
+				}
+				size_t count = BUFFER_SIZE - _fill;
+				if (size < count) {
+					count = size;
+				}
+				memcpy(_buffer + _fill, input, count);
+				_fill += count;
+				input += count;
+				size -= count;
+				encode(output, false);
+			}
+			return output;
+		}
+
+		virtual const Bytes finalize() {
+			Bytes output;
+			encode(output, true);
+			if (_items > 0) {
+				flush(output);
+			}
+			return output;
+		}
+
+	private:
+		inline const uint8_t* at(uint32_t position) const {
+			return _buffer + (position - _base);
+		}
+
+		// Drops what has fallen out of the window
+		void slide() {
+			uint32_t keep_from = (_pos > Lzss::WINDOW_SIZE) ? _pos - Lzss::WINDOW_SIZE : _base;
+			if (keep_from <= _base) {
+				return;
+			}
+			uint32_t shift = keep_from - _base;
+			memmove(_buffer, _buffer + shift, _fill - shift);
+			_fill -= shift;
+			_base = keep_from;
+		}
+
+		// Encodes buffered input, short of the longest match unless final
+		void encode(Bytes& output, bool final) {
+			uint32_t end = _base + _fill;
+			while (_pos < end && (final || end - _pos >= Lzss::MAX_MATCH)) {
+				uint32_t available = end - _pos;
+				uint32_t best_length = 0;
+				uint32_t best_distance = 0;
+				if (available >= Lzss::MIN_MATCH) {
+					const uint8_t* current = at(_pos);
+					uint32_t max_length = (available < Lzss::MAX_MATCH) ? available : (uint32_t)Lzss::MAX_MATCH;
+					uint32_t candidate = _head[hash3(current)];
+					uint8_t chain = Lzss::MAX_CHAIN;
+					// Positions are stored plus one, zero ends the chain
+					while (candidate > 0 && chain-- > 0) {
+						uint32_t position = candidate - 1;
+						if (position >= _pos || _pos - position > Lzss::WINDOW_SIZE || position < _base) {
+							break;
+						}
+						const uint8_t* match = at(position);
+						uint32_t length = 0;
+						while (length < max_length && match[length] == current[length]) {
+							length++;
+						}
+						if (length > best_length) {
+							best_length = length;
+							best_distance = _pos - position;
+							if (length == max_length) {
+								break;
+							}
+						}
+						uint32_t next = _prev[position % Lzss::WINDOW_SIZE];
+						if (next == 0 || next - 1 >= position) {
+							break;
+						}
+						candidate = next;
+					}
+				}
+
+				uint32_t advance;
+				if (best_length >= Lzss::MIN_MATCH) {
+					uint16_t code = (uint16_t)(((best_distance - 1) << 6) | (best_length - Lzss::MIN_MATCH));
+					_group[0] |= (1 << _items);
+					_group[_group_size++] = (uint8_t)(code >> 8);
+					_group[_group_size++] = (uint8_t)code;
+					advance = best_length;
+				}
+				else {
+					_group[_group_size++] = *at(_pos);
+					advance = 1;
+				}
+				if (++_items == 8) {
+					flush(output);
+				}
+
+				while (advance-- > 0) {
+					if (end - _pos >= Lzss::MIN_MATCH) {
+						uint8_t hash = hash3(at(_pos));
+						_prev[_pos % Lzss::WINDOW_SIZE] = _head[hash];
+						_head[hash] = _pos + 1;
+					}
+					_pos++;
+				}
+			}
+		}
+
+		void flush(Bytes& output) {
+			output.append(_group, _group_size);
+			_group[0] = 0;
+			_group_size = 1;
+			_items = 0;
+		}
+
+	private:
+		uint8_t _buffer[BUFFER_SIZE];
+		// Stream position of the start of the buffer, and of the next byte to encode
+		uint32_t _base = 0;
+		uint32_t _pos = 0;
+		uint32_t _fill = 0;
+		uint32_t _head[HASH_SIZE];
+		uint32_t _prev[Lzss::WINDOW_SIZE];
+		// Flag byte and items of the group being built
+		uint8_t _group[1 + 8 * 2] = {0};
+		uint8_t _group_size = 1;
+		uint8_t _items = 0;
+	};
+
+	class LzssDecompressor : public Decompressor {
+
+	public:
+		LzssDecompressor(size_t max_size) : _max_size(max_size) {}
+
+	public:
+		virtual const Bytes update(const Bytes& data) {
+			Bytes output;
+			for (size_t i = 0; i < data.size(); i++) {
+				uint8_t byte = data.data()[i];
+				if (_items == 8) {
+					_flags = byte;
+					_items = 0;
+					continue;
+				}
+				if (_flags & (1 << _items)) {
+					if (!_have_high) {
+						_high = byte;
+						_have_high = true;
+						continue;
+					}
+					_have_high = false;
+					uint16_t code = ((uint16_t)_high << 8) | byte;
+					uint16_t distance = (code >> 6) + 1;
+					uint8_t length = (code & 0x3f) + Lzss::MIN_MATCH;
+					if (distance > _size) {
+						throw std::invalid_argument("Invalid match distance in compressed data");
+					}
+					while (length-- > 0) {
+						put(output, _window[(_window_pos - distance) & (Lzss::WINDOW_SIZE - 1)]);
+					}
+				}
+				else {
+					put(output, byte);
+				}
+				_items++;
+			}
+			output.append(_chunk, _chunk_size);
+			_chunk_size = 0;
+			return output;
+		}
+
+		virtual const Bytes finalize() {
+			if (_have_high) {
+				throw std::invalid_argument("Truncated compressed data");
+			}
+			return {Bytes::NONE};
+		}
+
+	private:
+		inline void put(Bytes& output, uint8_t byte) {
+			if (_size >= _max_size) {
+				throw std::invalid_argument("Compressed data exceeds its expected size");
+			}
+			_window[_window_pos] = byte;
+			_window_pos = (_window_pos + 1) & (Lzss::WINDOW_SIZE - 1);
+			_size++;
+			_chunk[_chunk_size++] = byte;
+			if (_chunk_size == sizeof(_chunk)) {
+				output.append(_chunk, _chunk_size);
+				_chunk_size = 0;
+			}
+		}
+
+	private:
+		uint8_t _window[Lzss::WINDOW_SIZE];
+		uint16_t _window_pos = 0;
+		size_t _size = 0;
+		size_t _max_size;
+		uint8_t _flags = 0;
+		// Items of the current group decoded, 8 when a flag byte is due
+		uint8_t _items = 8;
+		uint8_t _high = 0;
+		bool _have_high = false;
+		// Output collected before appending
+		uint8_t _chunk[64];
+		uint8_t _chunk_size = 0;
+	};
+
+}
+
+std::unique_ptr<Compressor> Lzss::compressor() const {
+	return std::unique_ptr<Compressor>(new LzssCompressor());
+}
+
+std::unique_ptr<Decompressor> Lzss::decompressor(size_t max_size) const {
+	return std::unique_ptr<Decompressor>(new LzssDecompressor(max_size));
+}
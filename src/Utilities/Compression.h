@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Bytes.h"
+
+#include <memory>
+#include <stdint.h>
+
+/*
+Streaming compression for resource payloads.
+
+A Codec makes compressors and decompressors that take data in pieces of any
+size, so a payload can be compressed as it is read from storage and
+decompressed as its parts arrive. The built-in Lzss codec is small enough for
+MCUs. The compressed flag of a resource does not name the codec, so both ends
+of a link must use the same one. The reference implementation uses bz2, which
+an application can supply as a Codec of its own.
+*/
+
+namespace RNS { namespace Utilities {
+
+	class Compressor {
+	public:
+		virtual ~Compressor() {}
+		// Returns the compressed output that follows from data
+		virtual const Bytes update(const Bytes& data) = 0;
+		// Returns the rest of the compressed output
+		virtual const Bytes finalize() = 0;
+	};
+
+	class Decompressor {
+	public:
+		virtual ~Decompressor() {}
+		// Returns the data decompressed so far, throws on invalid input
+		virtual const Bytes update(const Bytes& data) = 0;
+		// Returns the rest of the data, throws if the input ended early
+		virtual const Bytes finalize() = 0;
+	};
+
+	class Codec {
+	public:
+		using Ptr = std::shared_ptr<Codec>;
+	public:
+		virtual ~Codec() {}
+		virtual const char* name() const = 0;
+		virtual std::unique_ptr<Compressor> compressor() const = 0;
+		// The decompressor throws once the output would exceed max_size
+		virtual std::unique_ptr<Decompressor> decompressor(size_t max_size) const = 0;
+	};
+
+	/*
+	LZSS with a 1 KB window. Output is in groups of a flag byte and up to
+	eight items, a flag bit set for a match and clear for a literal byte.
+	A match is two bytes, a 10 bit distance less one and a 6 bit length
+	less three. The compressor keeps about 7 KB of state and the
+	decompressor 1 KB.
+	*/
+	class Lzss : public Codec {
+
+	public:
+		static const uint16_t WINDOW_SIZE = 1024;
+		static const uint8_t MIN_MATCH = 3;
+		static const uint8_t MAX_MATCH = 66;
+		// Match candidates tried per position
+		static const uint8_t MAX_CHAIN = 16;
+
+	public:
+		virtual const char* name() const { return "lzss"; }
+		virtual std::unique_ptr<Compressor> compressor() const;
+		virtual std::unique_ptr<Decompressor> decompressor(size_t max_size) const;
+
+	};
+
+} }
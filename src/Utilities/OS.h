@@ -45,7 +45,7 @@ namespace RNS { namespace Utilities {
 		}
 #else
         // return current time in milliseconds since 00:00:00, January 1, 1970 (Unix Epoch)
-		static inline uint64_t ltime() { timeval time; ::gettimeofday(&time, NULL); return (uint64_t)(time.tv_sec * 1000) + (uint64_t)(time.tv_usec / 1000); }
+		static inline uint64_t ltime() { timeval time; ::gettimeofday(&time, NULL); return (uint64_t)(time.tv_sec * 1000) + (uint64_t)(time.tv_usec / 1000) + _time_offset; }
 #endif
 
 #ifdef ARDUINO
@@ -53,7 +53,8 @@ namespace RNS { namespace Utilities {
 		static inline double time() { return (double)(ltime() / 1000.0); }
 #else
         // return current time in float seconds since 00:00:00, January 1, 1970 (Unix Epoch)
-		static inline double time() { timeval time; ::gettimeofday(&time, NULL); return (double)time.tv_sec + ((double)time.tv_usec / 1000000); }
+		// CBA The time offset lets tests move the clock ahead
+		static inline double time() { timeval time; ::gettimeofday(&time, NULL); return (double)time.tv_sec + ((double)time.tv_usec / 1000000) + ((double)_time_offset / 1000); }
 #endif
 
         // sleep for specified milliseconds
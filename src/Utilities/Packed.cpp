@@ -0,0 +1,244 @@
+#include "Packed.h"
+
+#include <stdexcept>
+#include <string.h>
+
+using namespace RNS;
+using namespace RNS::Utilities;
+
+/*static*/ size_t Packed::bin_size(size_t size) {
+	if (size <= 0xff) {
+		return 2 + size;
+	}
+	if (size <= 0xffff) {
+		return 3 + size;
+	}
+	return 5 + size;
+}
+
+/*static*/ void Packed::pack_uint(Bytes& packed, uint64_t value) {
+	if (value < 0x80) {
+		packed.append((uint8_t)value);
+		return;
+	}
+	uint8_t count;
+	if (value <= 0xff) {
+		packed.append((uint8_t)0xcc);
+		count = 1;
+	}
+	else if (value <= 0xffff) {
+		packed.append((uint8_t)0xcd);
+		count = 2;
+	}
+	else if (value <= 0xffffffff) {
+		packed.append((uint8_t)0xce);
+		count = 4;
+	}
+	else {
+		packed.append((uint8_t)0xcf);
+		count = 8;
+	}
+	while (count > 0) {
+		count--;
+		packed.append((uint8_t)(value >> (count * 8)));
+	}
+}
+
+/*static*/ void Packed::pack_double(Bytes& packed, double value) {
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	packed.append((uint8_t)0xcb);
+	for (int shift = 56; shift >= 0; shift -= 8) {
+		packed.append((uint8_t)(bits >> shift));
+	}
+}
+
+/*static*/ void Packed::pack_bin(Bytes& packed, const Bytes& value) {
+	size_t size = value.size();
+	if (size <= 0xff) {
+		packed.append((uint8_t)0xc4);
+		packed.append((uint8_t)size);
+	}
+	else if (size <= 0xffff) {
+		packed.append((uint8_t)0xc5);
+		packed.append((uint8_t)(size >> 8));
+		packed.append((uint8_t)size);
+	}
+	else {
+		packed.append((uint8_t)0xc6);
+		packed.append((uint8_t)(size >> 24));
+		packed.append((uint8_t)(size >> 16));
+		packed.append((uint8_t)(size >> 8));
+		packed.append((uint8_t)size);
+	}
+	packed.append(value);
+}
+
+/*static*/ void Packed::pack_optional_bin(Bytes& packed, const Bytes& value) {
+	if (value) {
+		pack_bin(packed, value);
+	}
+	else {
+		pack_nil(packed);
+	}
+}
+
+/*static*/ void Packed::pack_key(Bytes& packed, char key) {
+	packed.append((uint8_t)0xa1);
+	packed.append((uint8_t)key);
+}
+
+
+size_t PackedReader::read_array_size() {
+	uint8_t type = next();
+	if ((type & 0xf0) == 0x90) {
+		return type & 0x0f;
+	}
+	if (type == 0xdc) {
+		return read_be(2);
+	}
+	if (type == 0xdd) {
+		return read_be(4);
+	}
+	throw std::invalid_argument("Packed value is not an array");
+}
+
+size_t PackedReader::read_map_size() {
+	uint8_t type = next();
+	if ((type & 0xf0) == 0x80) {
+		return type & 0x0f;
+	}
+	if (type == 0xde) {
+		return read_be(2);
+	}
+	if (type == 0xdf) {
+		return read_be(4);
+	}
+	throw std::invalid_argument("Packed value is not a map");
+}
+
+uint64_t PackedReader::read_uint() {
+	uint8_t type = next();
+	if (type < 0x80) {
+		return type;
+	}
+	switch (type) {
+	case 0xcc: return read_be(1);
+	case 0xcd: return read_be(2);
+	case 0xce: return read_be(4);
+	case 0xcf: return read_be(8);
+	default:
+		throw std::invalid_argument("Packed value is not an unsigned integer");
+	}
+}
+
+double PackedReader::read_number() {
+	uint8_t type = next();
+	if (type < 0x80) {
+		return type;
+	}
+	if (type >= 0xe0) {
+		return (int8_t)type;
+	}
+	switch (type) {
+	case 0xca:
+	{
+		uint32_t bits = (uint32_t)read_be(4);
+		float value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+	case 0xcb:
+	{
+		uint64_t bits = read_be(8);
+		double value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+	case 0xcc: return (double)read_be(1);
+	case 0xcd: return (double)read_be(2);
+	case 0xce: return (double)read_be(4);
+	case 0xcf: return (double)read_be(8);
+	case 0xd0: return (double)(int8_t)read_be(1);
+	case 0xd1: return (double)(int16_t)read_be(2);
+	case 0xd2: return (double)(int32_t)read_be(4);
+	case 0xd3: return (double)(int64_t)read_be(8);
+	default:
+		throw std::invalid_argument("Packed value is not a number");
+	}
+}
+
+const Bytes PackedReader::read_bin(bool allow_nil /*= false*/) {
+	uint8_t type = next();
+	if (type == 0xc0 && allow_nil) {
+		return {Bytes::NONE};
+	}
+	size_t length;
+	if ((type & 0xe0) == 0xa0) {
+		length = type & 0x1f;
+	}
+	else if (type == 0xc4 || type == 0xd9) {
+		length = read_be(1);
+	}
+	else if (type == 0xc5 || type == 0xda) {
+		length = read_be(2);
+	}
+	else if (type == 0xc6 || type == 0xdb) {
+		length = read_be(4);
+	}
+	else {
+		throw std::invalid_argument("Packed value is not binary");
+	}
+	return take(length);
+}
+
+void PackedReader::skip() {
+	uint8_t type = next();
+	if (type < 0x80 || type >= 0xe0 || type == 0xc0 || type == 0xc2 || type == 0xc3) {
+		return;
+	}
+	if ((type & 0xe0) == 0xa0) {
+		advance(type & 0x1f);
+		return;
+	}
+	switch (type) {
+	case 0xcc: case 0xd0: read_be(1); return;
+	case 0xcd: case 0xd1: read_be(2); return;
+	case 0xce: case 0xd2: case 0xca: read_be(4); return;
+	case 0xcf: case 0xd3: case 0xcb: read_be(8); return;
+	case 0xc4: case 0xd9: advance(read_be(1)); return;
+	case 0xc5: case 0xda: advance(read_be(2)); return;
+	case 0xc6: case 0xdb: advance(read_be(4)); return;
+	default:
+		throw std::invalid_argument("Packed value cannot be skipped");
+	}
+}
+
+uint8_t PackedReader::next() {
+	if (_pos >= _data.size()) {
+		throw std::invalid_argument("Truncated packed value");
+	}
+	return _data.data()[_pos++];
+}
+
+uint64_t PackedReader::read_be(uint8_t count) {
+	uint64_t value = 0;
+	while (count-- > 0) {
+		value = (value << 8) | next();
+	}
+	return value;
+}
+
+void PackedReader::advance(size_t length) {
+	if (length > _data.size() - _pos) {
+		throw std::invalid_argument("Truncated packed value");
+	}
+	_pos += length;
+}
+
+const Bytes PackedReader::take(size_t length) {
+	size_t start = _pos;
+	advance(length);
+	// An empty value is not NONE, which mid() gives for a zero length
+	return (length > 0) ? _data.mid(start, length) : Bytes(_data.data() + start, 0);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Bytes.h"
+
+#include <stdint.h>
+
+/*
+Direct msgpack encoding for the fixed-shape values exchanged with the
+reference implementation, such as link requests and responses and resource
+advertisements. Those are packed by umsgpack there, and may hold nil where
+the typed MsgPack containers cannot express it, so they are encoded and
+decoded here without intermediate containers.
+*/
+
+namespace RNS { namespace Utilities {
+
+	class Packed {
+
+	public:
+		// Packed size of a bin value of the given length
+		static size_t bin_size(size_t size);
+
+		static void pack_nil(Bytes& packed) { packed.append((uint8_t)0xc0); }
+		static void pack_uint(Bytes& packed, uint64_t value);
+		static void pack_double(Bytes& packed, double value);
+		static void pack_bin(Bytes& packed, const Bytes& value);
+		// Nil for empty values, as None is sent for them by the reference implementation
+		static void pack_optional_bin(Bytes& packed, const Bytes& value);
+		// A fixstr of one character, as used for map keys
+		static void pack_key(Bytes& packed, char key);
+
+	};
+
+	// Reads packed values in order from a buffer, throwing on unexpected types
+	// and truncated input
+	class PackedReader {
+
+	public:
+		PackedReader(const Bytes& data) : _data(data) {}
+
+	public:
+		size_t read_array_size();
+		size_t read_map_size();
+		uint64_t read_uint();
+		// Any number, as some peers send timestamps as integers
+		double read_number();
+		// Binary or string value, or NONE for nil where allowed
+		const Bytes read_bin(bool allow_nil = false);
+		// Skips a scalar value
+		void skip();
+
+		size_t position() const { return _pos; }
+		bool at_end() const { return _pos == _data.size(); }
+
+	private:
+		uint8_t next();
+		uint64_t read_be(uint8_t count);
+		void advance(size_t length);
+		const Bytes take(size_t length);
+
+	private:
+		const Bytes _data;
+		size_t _pos = 0;
+
+	};
+
+} }
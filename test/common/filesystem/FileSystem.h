@@ -22,6 +22,7 @@ using namespace Adafruit_LittleFS_Namespace;
 #include <sys/stat.h>
 #include <sys/ioctl.h>
 #include <unistd.h>
+#include <dirent.h>
 #endif
 
 class FileSystem : public RNS::FileSystemImpl {
@@ -399,7 +400,8 @@ public:
 		}
 	#else
 		// Native
-		return false;
+		struct stat st = {0};
+		return (stat(directory_path, &st) == 0 && S_ISDIR(st.st_mode));
 	#endif
 	}
 
@@ -483,6 +485,20 @@ public:
 		return files;
 	#else
 		// Native
+		DIR* dir = opendir(directory_path);
+		if (dir == nullptr) {
+			ERROR("list_directory: failed to open directory " + std::string(directory_path));
+			return files;
+		}
+		struct dirent* entry;
+		while ((entry = readdir(dir)) != nullptr) {
+			std::string path = std::string(directory_path) + "/" + entry->d_name;
+			struct stat st = {0};
+			if (stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+				files.push_back(entry->d_name);
+			}
+		}
+		closedir(dir);
 		return files;
 	#endif
 	}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <Transport.h>
+#include <TransportInstance.h>
+#include <Identity.h>
+#include <Destination.h>
+#include <Link.h>
+#include <Packet.h>
+#include <Interface.h>
+#include <Bytes.h>
+#include <Type.h>
+#include <Utilities/OS.h>
+
+#include <vector>
+#include <stdint.h>
+
+/*
+Nodes exchanging packets in process, each with a transport instance of its
+own, for the suites that run links, channels and resources end to end.
+*/
+
+// Keeps what is sent out for the test to hand over or inspect
+class CaptureInterface : public RNS::InterfaceImpl {
+public:
+	CaptureInterface(const char* name = "CaptureInterface", bool out = true, uint16_t hw_mtu = 0) : RNS::InterfaceImpl(name) {
+		_IN = true;
+		_OUT = out;
+		_HW_MTU = hw_mtu;
+		_AUTOCONFIGURE_MTU = (hw_mtu > 0);
+	}
+	virtual ~CaptureInterface() {}
+	virtual void send_outgoing(const RNS::Bytes& data) {
+		_sent.push_back(data);
+		InterfaceImpl::handle_outgoing(data);
+	}
+	void autoconfigure_mtu(bool autoconfigure) {
+		_AUTOCONFIGURE_MTU = autoconfigure;
+	}
+	void announce_limits(uint32_t bitrate, float announce_cap) {
+		_bitrate = bitrate;
+		_announce_cap = announce_cap;
+	}
+public:
+	std::vector<RNS::Bytes> _sent;
+};
+
+// One end of a link, with a transport instance of its own
+class Node {
+public:
+	Node(const char* name) : _impl(new CaptureInterface(name)), _interface(_impl) {
+		enter();
+		RNS::Transport::identity(_identity);
+		RNS::Transport::register_interface(_interface);
+	}
+	void enter() {
+		RNS::Transport::instance(_transport);
+	}
+public:
+	RNS::TransportInstance _transport;
+	RNS::Identity _identity;
+	CaptureInterface* _impl;
+	RNS::Interface _interface;
+};
+
+// Hands what one node sent to the other, except packets with the given
+// context, and returns the number of packets handed over
+inline size_t deliver(Node& from, Node& to, int drop_context = -1) {
+	std::vector<RNS::Bytes> sent;
+	sent.swap(from._impl->_sent);
+	to.enter();
+	size_t delivered = 0;
+	for (const RNS::Bytes& raw : sent) {
+		RNS::Packet packet(RNS::Destination(RNS::Type::NONE), raw);
+		if (drop_context >= 0 && packet.unpack() && packet.context() == drop_context) {
+			continue;
+		}
+		RNS::Transport::inbound(raw, to._interface);
+		delivered++;
+	}
+	return delivered;
+}
+
+// Delivers both ways until neither node has anything left to send, which
+// leaves the initiator's transport instance current
+inline void exchange(Node& initiator, Node& responder) {
+	while (deliver(initiator, responder) + deliver(responder, initiator) > 0) {
+	}
+}
+
+// Moves the clock ahead, as time passes on a slow link
+inline void advance_time(double seconds) {
+	RNS::Utilities::OS::setTimeOffset(RNS::Utilities::OS::getTimeOffset() + (uint64_t)(seconds * 1000));
+}
+
+// Sets up a link from the initiator to the destination set up on the
+// responder for the identity
+inline RNS::Link connect(Node& initiator, Node& responder, const RNS::Identity& identity) {
+	initiator.enter();
+	RNS::Destination remote(identity, RNS::Type::Destination::OUT, RNS::Type::Destination::SINGLE, "test", "link");
+	RNS::Link link(remote);
+	exchange(initiator, responder);
+	return link;
+}
+
+// Sets up a destination for the identity on the responder, with the
+// callback for links established to it, and a link to it from the initiator
+inline RNS::Link establish(Node& initiator, Node& responder, const RNS::Identity& identity, RNS::Destination::Callbacks::link_established established) {
+	responder.enter();
+	RNS::Destination owner(identity, RNS::Type::Destination::IN, RNS::Type::Destination::SINGLE, "test", "link");
+	owner.set_link_established_callback(established);
+	return connect(initiator, responder, identity);
+}
+
+// Time of the job scheduled last, as links, channels, resources and
+// writers share the deadline schedule of a node
+inline double last_deadline(const RNS::TransportInstance& node) {
+	auto last = node._deadlines.begin();
+	for (auto iter = node._deadlines.begin(); iter != node._deadlines.end(); ++iter) {
+		if ((*iter).second._id > (*last).second._id) {
+			last = iter;
+		}
+	}
+	return (*last).first;
+}
+
+inline bool is_scheduled(const RNS::TransportInstance& node, double deadline) {
+	return node._deadlines.find(deadline) != node._deadlines.end();
+}
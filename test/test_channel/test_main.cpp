@@ -0,0 +1,599 @@
+#include <unity.h>
+
+#include "Channel.h"
+#include "Buffer.h"
+#include "Transport.h"
+#include "TransportInstance.h"
+#include "Identity.h"
+#include "Destination.h"
+#include "Link.h"
+#include "Packet.h"
+#include "Interface.h"
+#include "Utilities/OS.h"
+#include "Bytes.h"
+#include "Type.h"
+
+#include "../common/nodes/Nodes.h"
+
+#include <vector>
+
+using namespace RNS;
+
+class TextMessage : public RNS::MessageBase {
+public:
+	static const uint16_t MSGTYPE = 0x0101;
+public:
+	virtual uint16_t msgtype() const { return MSGTYPE; }
+	virtual const RNS::Bytes pack() const { return _text; }
+	virtual void unpack(const RNS::Bytes& raw) { _text = raw; }
+public:
+	RNS::Bytes _text;
+};
+
+void testEnvelopePack() {
+	// struct.pack(">HHH", 0x0101, 0x1234, 5) + b"hello" as in the reference implementation
+	RNS::Envelope envelope(TextMessage::MSGTYPE, 0x1234, "hello");
+	RNS::Bytes expected;
+	expected.appendHex("0101123400056865");
+	expected.appendHex("6c6c6f");
+	TEST_ASSERT_TRUE(envelope.pack() == expected);
+	TEST_ASSERT_EQUAL_size_t(RNS::Type::Channel::ENVELOPE_HEADER_SIZE + 5, envelope.pack().size());
+}
+
+void testEnvelopeUnpack() {
+	RNS::Envelope envelope(0xabcd, 0xfffe, "payload");
+	RNS::Envelope unpacked(0, 0, {RNS::Bytes::NONE});
+	TEST_ASSERT_TRUE(RNS::Envelope::unpack(envelope.pack(), unpacked));
+	TEST_ASSERT_EQUAL_UINT16(0xabcd, unpacked._msgtype);
+	TEST_ASSERT_EQUAL_UINT16(0xfffe, unpacked._sequence);
+	TEST_ASSERT_TRUE(unpacked._data == "payload");
+
+	// An empty message is valid
+	RNS::Envelope empty(0x0001, 0, {RNS::Bytes::NONE});
+	TEST_ASSERT_TRUE(RNS::Envelope::unpack(empty.pack(), unpacked));
+	TEST_ASSERT_EQUAL_size_t(0, unpacked._data.size());
+}
+
+void testEnvelopeInvalid() {
+	RNS::Envelope envelope(0x0101, 7, "hello");
+	const RNS::Bytes packed(envelope.pack());
+	RNS::Envelope unpacked(0, 0, {RNS::Bytes::NONE});
+	// Short of the header, or of the length the header gives
+	for (size_t size = 0; size < packed.size(); size++) {
+		TEST_ASSERT_FALSE(RNS::Envelope::unpack(packed.left(size), unpacked));
+	}
+}
+
+void testMessageFactory() {
+	RNS::MessageBase::Ptr message = RNS::Channel::create_message<TextMessage>();
+	TEST_ASSERT_EQUAL_UINT16(TextMessage::MSGTYPE, message->msgtype());
+	message->unpack("text");
+	TEST_ASSERT_TRUE(message->pack() == "text");
+
+	RNS::ChannelException exception(RNS::Type::Channel::ME_TOO_BIG, "too big");
+	TEST_ASSERT_EQUAL_INT(RNS::Type::Channel::ME_TOO_BIG, exception.type());
+}
+
+void testStreamDataMessage() {
+	// struct.pack(">H", 0x8000 | 5) + b"end", an end of stream on stream 5
+	RNS::StreamDataMessage message(5, "end", true);
+	RNS::Bytes expected;
+	expected.appendHex("8005656e64");
+	TEST_ASSERT_TRUE(message.pack() == expected);
+
+	RNS::StreamDataMessage unpacked;
+	unpacked.unpack(expected);
+	TEST_ASSERT_EQUAL_UINT16(5, unpacked._stream_id);
+	TEST_ASSERT_TRUE(unpacked._eof);
+	TEST_ASSERT_FALSE(unpacked._compressed);
+	TEST_ASSERT_TRUE(unpacked._data == "end");
+
+	// The largest stream id, no data
+	RNS::StreamDataMessage last(RNS::StreamDataMessage::STREAM_ID_MAX, {RNS::Bytes::NONE});
+	unpacked.unpack(last.pack());
+	TEST_ASSERT_EQUAL_size_t(2, last.pack().size());
+	TEST_ASSERT_EQUAL_UINT16(RNS::StreamDataMessage::STREAM_ID_MAX, unpacked._stream_id);
+	TEST_ASSERT_FALSE(unpacked._eof);
+	TEST_ASSERT_EQUAL_size_t(0, unpacked._data.size());
+
+	bool thrown = false;
+	try {
+		RNS::StreamDataMessage invalid(RNS::StreamDataMessage::STREAM_ID_MAX + 1, "x");
+	}
+	catch (std::invalid_argument& e) {
+		thrown = true;
+	}
+	TEST_ASSERT_TRUE(thrown);
+}
+
+static std::vector<Bytes> received_texts;
+
+bool on_text(const MessageBase& message) {
+	if (message.msgtype() != TextMessage::MSGTYPE) {
+		return false;
+	}
+	received_texts.push_back(((const TextMessage&)message)._text);
+	return true;
+}
+
+const Bytes text_envelope(uint16_t sequence, const char* text) {
+	return Envelope(TextMessage::MSGTYPE, sequence, text).pack();
+}
+
+// Channel on an incoming link that has not completed its handshake, fed
+// envelopes directly
+Channel receiving_channel(const Link& link) {
+	Channel channel(link);
+	channel.register_message_type<TextMessage>();
+	channel.add_message_handler(on_text);
+	return channel;
+}
+
+void testReceiveReordering() {
+	TransportInstance node;
+	Transport::instance(node);
+	Identity identity;
+	Destination owner(identity, Type::Destination::IN, Type::Destination::SINGLE, "test", "channel");
+	Channel channel(receiving_channel(Link({Type::NONE}, nullptr, nullptr, owner)));
+
+	// Later messages are held until the one due arrives
+	channel._receive(text_envelope(2, "two"));
+	channel._receive(text_envelope(1, "one"));
+	TEST_ASSERT_EQUAL_size_t(0, received_texts.size());
+	channel._receive(text_envelope(0, "zero"));
+	TEST_ASSERT_EQUAL_size_t(3, received_texts.size());
+	TEST_ASSERT_TRUE(received_texts[0] == "zero");
+	TEST_ASSERT_TRUE(received_texts[1] == "one");
+	TEST_ASSERT_TRUE(received_texts[2] == "two");
+
+	// A message of an unknown type is dropped without stalling the sequence
+	channel._receive(Envelope(0x0202, 3, "unknown").pack());
+	channel._receive(text_envelope(4, "four"));
+	TEST_ASSERT_EQUAL_size_t(4, received_texts.size());
+	TEST_ASSERT_TRUE(received_texts[3] == "four");
+}
+
+void testReceiveDuplicate() {
+	TransportInstance node;
+	Transport::instance(node);
+	Identity identity;
+	Destination owner(identity, Type::Destination::IN, Type::Destination::SINGLE, "test", "channel");
+	Channel channel(receiving_channel(Link({Type::NONE}, nullptr, nullptr, owner)));
+
+	// A held message received again is held once
+	channel._receive(text_envelope(1, "one"));
+	channel._receive(text_envelope(1, "one"));
+	channel._receive(text_envelope(0, "zero"));
+	TEST_ASSERT_EQUAL_size_t(2, received_texts.size());
+
+	// Retransmissions of delivered messages are dropped
+	channel._receive(text_envelope(0, "zero"));
+	channel._receive(text_envelope(1, "one"));
+	TEST_ASSERT_EQUAL_size_t(2, received_texts.size());
+	channel._receive(text_envelope(2, "two"));
+	TEST_ASSERT_EQUAL_size_t(3, received_texts.size());
+	TEST_ASSERT_TRUE(received_texts[2] == "two");
+}
+
+void testReceiveOutOfWindow() {
+	TransportInstance node;
+	Transport::instance(node);
+	Identity identity;
+	Destination owner(identity, Type::Destination::IN, Type::Destination::SINGLE, "test", "channel");
+	Channel channel(receiving_channel(Link({Type::NONE}, nullptr, nullptr, owner)));
+
+	// Nothing is held a full window or more past the message due
+	channel._receive(text_envelope(Type::Channel::WINDOW_MAX, "beyond"));
+	channel._receive(text_envelope(Type::Channel::WINDOW_MAX - 1, "last"));
+	for (uint16_t sequence = 0; sequence < Type::Channel::WINDOW_MAX - 1; sequence++) {
+		channel._receive(text_envelope(sequence, "within"));
+	}
+	TEST_ASSERT_EQUAL_size_t(Type::Channel::WINDOW_MAX, received_texts.size());
+	TEST_ASSERT_TRUE(received_texts.back() == "last");
+
+	// Sequences wrap around
+	for (uint32_t sequence = Type::Channel::WINDOW_MAX; sequence < Type::Channel::SEQ_MODULUS; sequence++) {
+		channel._receive(text_envelope((uint16_t)sequence, "within"));
+	}
+	channel._receive(text_envelope(0, "wrapped"));
+	TEST_ASSERT_EQUAL_size_t(Type::Channel::SEQ_MODULUS + 1, received_texts.size());
+	TEST_ASSERT_TRUE(received_texts.back() == "wrapped");
+
+	// Invalid envelopes are dropped
+	channel._receive(text_envelope(1, "short").left(Type::Channel::ENVELOPE_HEADER_SIZE + 2));
+	channel._receive(text_envelope(2, "after"));
+	TEST_ASSERT_EQUAL_size_t(Type::Channel::SEQ_MODULUS + 1, received_texts.size());
+}
+
+void testWatchdogScheduling() {
+	TransportInstance node;
+	Transport::instance(node);
+	Identity identity;
+	Destination owner(identity, Type::Destination::IN, Type::Destination::SINGLE, "test", "channel");
+	Channel channel(receiving_channel(Link({Type::NONE}, nullptr, nullptr, owner)));
+	node._jobs_last_run = Utilities::OS::time();
+
+	// Rescheduling moves the one deadline
+	double now = Utilities::OS::time();
+	channel.schedule_watchdog(now + 0.5);
+	TEST_ASSERT_EQUAL_size_t(1, node._deadlines.size());
+	channel.schedule_watchdog(now + 0.2);
+	TEST_ASSERT_EQUAL_size_t(1, node._deadlines.size());
+	TEST_ASSERT_TRUE(Transport::next_wakeup() == now + 0.2);
+	channel.schedule_watchdog(0.0);
+	TEST_ASSERT_EQUAL_size_t(0, node._deadlines.size());
+
+	// A due deadline is taken off the schedule when run, and with nothing
+	// in flight is not set again
+	channel.schedule_watchdog(now);
+	Transport::run_deadlines();
+	TEST_ASSERT_EQUAL_size_t(0, node._deadlines.size());
+
+	// Shutting the channel down cancels its deadline
+	channel.schedule_watchdog(now + 0.5);
+	channel._shutdown();
+	TEST_ASSERT_EQUAL_size_t(0, node._deadlines.size());
+}
+
+// The responder's end of the last link established
+static Link established_link({Type::NONE});
+
+void on_link_established(Link& link) {
+	established_link = link;
+	Channel channel(link.get_channel());
+	channel.register_message_type<TextMessage>();
+	channel.add_message_handler(on_text);
+}
+
+// Sets up a link from the initiator to a destination on the responder, and
+// returns the channel on the initiator's end
+Channel establish_channel(Node& initiator, Node& responder, Link& link) {
+	link = establish(initiator, responder, responder._identity, on_link_established);
+	TEST_ASSERT_EQUAL_INT(Type::Link::ACTIVE, link.status());
+	Channel channel(link.get_channel());
+	channel.register_message_type<TextMessage>();
+	return channel;
+}
+
+// Sends a window of messages and has them proven
+void send_round(Node& initiator, Node& responder, Channel& channel) {
+	initiator.enter();
+	while (channel.is_ready_to_send()) {
+		TextMessage message;
+		message._text = "round";
+		channel.send(message);
+	}
+	exchange(initiator, responder);
+	initiator.enter();
+}
+
+void testWindowGrowth() {
+	Node responder("responder");
+	Node initiator("initiator");
+	Link link({Type::NONE});
+	Channel channel(establish_channel(initiator, responder, link));
+	TEST_ASSERT_EQUAL_UINT8(Type::Channel::WINDOW, channel.window());
+
+	// Each message proven widens the window, up to the maximum for slow links
+	send_round(initiator, responder, channel);
+	TEST_ASSERT_EQUAL_size_t(Type::Channel::WINDOW, received_texts.size());
+	TEST_ASSERT_TRUE(channel.is_ready_to_send());
+	TEST_ASSERT_EQUAL_size_t(0, channel.outstanding());
+	TEST_ASSERT_EQUAL_UINT8(2 * Type::Channel::WINDOW, channel.window());
+	send_round(initiator, responder, channel);
+	TEST_ASSERT_TRUE(channel.is_ready_to_send());
+	TEST_ASSERT_EQUAL_UINT8(Type::Channel::WINDOW_MAX_SLOW, channel.window());
+	TEST_ASSERT_EQUAL_UINT8(Type::Channel::WINDOW_MAX_SLOW, channel.window_max());
+
+	// Enough fast rounds open up the window for fast links
+	while (channel.window_max() == Type::Channel::WINDOW_MAX_SLOW) {
+		send_round(initiator, responder, channel);
+		TEST_ASSERT_TRUE(channel.is_ready_to_send());
+	}
+	TEST_ASSERT_EQUAL_UINT8(Type::Channel::WINDOW_MAX_FAST, channel.window_max());
+	TEST_ASSERT_EQUAL_UINT8(Type::Channel::WINDOW_MIN_LIMIT_FAST, channel.window_min());
+	TEST_ASSERT_TRUE(channel.window() > Type::Channel::WINDOW_MAX_SLOW);
+}
+
+void testTimeoutNarrowsWindow() {
+	Node responder("responder");
+	Node initiator("initiator");
+	Link link({Type::NONE});
+	Channel channel(establish_channel(initiator, responder, link));
+	send_round(initiator, responder, channel);
+	send_round(initiator, responder, channel);
+	TEST_ASSERT_TRUE(channel.is_ready_to_send());
+	const uint8_t window = channel.window();
+	TEST_ASSERT_TRUE(window > channel.window_min());
+
+	// A lost message is sent again once its timeout has passed, and the
+	// window narrows
+	TextMessage message;
+	message._text = "lost";
+	channel.send(message);
+	TEST_ASSERT_EQUAL_size_t(1, initiator._impl->_sent.size());
+	TEST_ASSERT_FALSE(initiator._transport._deadlines.empty());
+	initiator._impl->_sent.clear();
+	Transport::run_deadlines();
+	TEST_ASSERT_EQUAL_size_t(0, initiator._impl->_sent.size());
+	advance_time(1.0);
+	Transport::run_deadlines();
+	TEST_ASSERT_EQUAL_size_t(1, initiator._impl->_sent.size());
+	TEST_ASSERT_EQUAL_UINT8(window - 1, channel.window());
+	TEST_ASSERT_EQUAL_size_t(1, channel.outstanding());
+	TEST_ASSERT_FALSE(initiator._transport._deadlines.empty());
+
+	// The retransmission is delivered and proven
+	size_t received = received_texts.size();
+	exchange(initiator, responder);
+	initiator.enter();
+	TEST_ASSERT_EQUAL_size_t(received + 1, received_texts.size());
+	TEST_ASSERT_TRUE(received_texts.back() == "lost");
+	TEST_ASSERT_TRUE(channel.is_ready_to_send());
+	TEST_ASSERT_EQUAL_size_t(0, channel.outstanding());
+}
+
+void testTimeoutTearsDown() {
+	Node responder("responder");
+	Node initiator("initiator");
+	Link link({Type::NONE});
+	Channel channel(establish_channel(initiator, responder, link));
+	initiator.enter();
+
+	// A message never proven is tried up to the limit, then the link is torn down
+	TextMessage message;
+	message._text = "lost";
+	channel.send(message);
+	for (uint8_t tries = 1; tries < Type::Channel::MAX_TRIES; tries++) {
+		initiator._impl->_sent.clear();
+		advance_time(60.0);
+		Transport::run_deadlines();
+		TEST_ASSERT_EQUAL_size_t(1, initiator._impl->_sent.size());
+		TEST_ASSERT_EQUAL_INT(Type::Link::ACTIVE, link.status());
+	}
+	TEST_ASSERT_EQUAL_UINT8(Type::Channel::WINDOW_MIN, channel.window());
+	advance_time(60.0);
+	Transport::run_deadlines();
+	TEST_ASSERT_EQUAL_INT(Type::Link::CLOSED, link.status());
+	TEST_ASSERT_EQUAL_size_t(0, channel.outstanding());
+	TEST_ASSERT_EQUAL_size_t(0, initiator._transport._deadlines.size());
+}
+
+
+const Bytes stream_envelope(uint16_t sequence, const Bytes& data, bool eof = false) {
+	return Envelope(StreamDataMessage::MSGTYPE, sequence, StreamDataMessage(1, data, eof).pack()).pack();
+}
+
+static size_t ready_bytes = 0;
+
+void on_ready(size_t ready) {
+	ready_bytes = ready;
+}
+
+void testReaderChunks() {
+	TransportInstance node;
+	Transport::instance(node);
+	Identity identity;
+	Destination owner(identity, Type::Destination::IN, Type::Destination::SINGLE, "test", "channel");
+	Channel channel(Link({Type::NONE}, nullptr, nullptr, owner));
+	RawChannelReader::Ptr reader = Buffer::create_reader(1, channel, on_ready);
+
+	// Each message is kept as a chunk, messages for other streams are left alone
+	channel._receive(stream_envelope(0, "abc"));
+	TEST_ASSERT_EQUAL_size_t(3, ready_bytes);
+	channel._receive(Envelope(StreamDataMessage::MSGTYPE, 1, StreamDataMessage(2, "other").pack()).pack());
+	channel._receive(stream_envelope(2, "defg"));
+	channel._receive(stream_envelope(3, "hi"));
+	TEST_ASSERT_EQUAL_size_t(9, ready_bytes);
+	TEST_ASSERT_EQUAL_INT(9, reader->available());
+
+	// Reads run on across chunk boundaries
+	TEST_ASSERT_EQUAL_INT('a', reader->peek());
+	TEST_ASSERT_EQUAL_INT('a', reader->read());
+	char buffer[8];
+	TEST_ASSERT_EQUAL_size_t(3, reader->readBytes(buffer, 3));
+	TEST_ASSERT_EQUAL_MEMORY("bcd", buffer, 3);
+	TEST_ASSERT_TRUE(reader->read_bytes(4) == "efgh");
+	TEST_ASSERT_EQUAL_INT(1, reader->available());
+	TEST_ASSERT_EQUAL_INT('i', reader->read());
+	TEST_ASSERT_EQUAL_INT(-1, reader->read());
+	TEST_ASSERT_EQUAL_INT(-1, reader->peek());
+	TEST_ASSERT_FALSE(reader->read_bytes());
+
+	// Whole chunks are handed out as received, no more than the chunk at the front
+	channel._receive(stream_envelope(4, "jklm"));
+	channel._receive(stream_envelope(5, "nop"));
+	TEST_ASSERT_TRUE(reader->read_bytes() == "jklm");
+	TEST_ASSERT_TRUE(reader->read_bytes(2) == "no");
+	TEST_ASSERT_TRUE(reader->read_bytes() == "p");
+
+	// The end of the stream is reached once all before it is read
+	TEST_ASSERT_FALSE(reader->eof());
+	channel._receive(stream_envelope(6, "qr", true));
+	TEST_ASSERT_FALSE(reader->eof());
+	TEST_ASSERT_EQUAL_size_t(2, reader->readBytes(buffer, sizeof(buffer)));
+	TEST_ASSERT_EQUAL_MEMORY("qr", buffer, 2);
+	TEST_ASSERT_TRUE(reader->eof());
+
+	// Nothing is received once closed
+	reader->close();
+	channel._receive(stream_envelope(7, "st"));
+	TEST_ASSERT_EQUAL_INT(0, reader->available());
+
+	// The channel does not keep a released reader alive
+	std::weak_ptr<RawChannelReader> released(Buffer::create_reader(1, channel, on_ready));
+	TEST_ASSERT_TRUE(released.expired());
+	ready_bytes = 0;
+	channel._receive(stream_envelope(8, "uv"));
+	TEST_ASSERT_EQUAL_size_t(0, ready_bytes);
+}
+
+void testWriterChunks() {
+	Node responder("responder");
+	Node initiator("initiator");
+	Link link({Type::NONE});
+	Channel channel(establish_channel(initiator, responder, link));
+	responder.enter();
+	RawChannelReader::Ptr reader = Buffer::create_reader(1, established_link.get_channel());
+	initiator.enter();
+	RawChannelWriter::Ptr writer = Buffer::create_writer(1, channel);
+	const size_t chunk_size = channel.mdu() - 2;
+
+	// Large writes are split into chunks of the most a message holds, as far
+	// as the window has room and one chunk more
+	Bytes data;
+	for (size_t i = 0; i < 4 * chunk_size; i++) {
+		data << (uint8_t)i;
+	}
+	TEST_ASSERT_EQUAL_size_t(3 * chunk_size, writer->write(data.data(), data.size()));
+	TEST_ASSERT_EQUAL_size_t(Type::Channel::WINDOW, initiator._impl->_sent.size());
+	TEST_ASSERT_EQUAL_size_t(chunk_size, writer->pending());
+	TEST_ASSERT_EQUAL_INT(0, writer->availableForWrite());
+	exchange(initiator, responder);
+	initiator.enter();
+	TEST_ASSERT_EQUAL_size_t(Type::Channel::WINDOW * chunk_size, (size_t)reader->available());
+	TEST_ASSERT_TRUE(reader->read_bytes() == data.left(chunk_size));
+	TEST_ASSERT_TRUE(reader->read_bytes() == data.mid(chunk_size, chunk_size));
+
+	// Room in the window lets the held chunk and the rest go
+	TEST_ASSERT_EQUAL_size_t(chunk_size, writer->write(data.data() + 3 * chunk_size, chunk_size));
+	TEST_ASSERT_EQUAL_size_t(0, writer->pending());
+	writer->close();
+	TEST_ASSERT_EQUAL_size_t(0, writer->pending());
+	TEST_ASSERT_EQUAL_size_t(0, writer->write((const uint8_t*)"x", 1));
+	exchange(initiator, responder);
+	TEST_ASSERT_TRUE(reader->read_bytes() == data.mid(2 * chunk_size, chunk_size));
+	TEST_ASSERT_TRUE(reader->read_bytes() == data.mid(3 * chunk_size));
+	TEST_ASSERT_TRUE(reader->eof());
+}
+
+void testWriterFlushDeadline() {
+	Node responder("responder");
+	Node initiator("initiator");
+	Link link({Type::NONE});
+	Channel channel(establish_channel(initiator, responder, link));
+	responder.enter();
+	RawChannelReader::Ptr reader = Buffer::create_reader(1, established_link.get_channel());
+	initiator.enter();
+	RawChannelWriter::Ptr writer = Buffer::create_writer(1, channel);
+	initiator._transport._jobs_last_run = Utilities::OS::time();
+
+	// A small write is held until its deadline on the Transport schedule
+	TEST_ASSERT_EQUAL_size_t(5, writer->write((const uint8_t*)"small", 5));
+	TEST_ASSERT_EQUAL_size_t(0, initiator._impl->_sent.size());
+	double deadline = last_deadline(initiator._transport);
+	TEST_ASSERT_TRUE(Transport::next_wakeup() <= deadline);
+	TEST_ASSERT_TRUE(deadline <= Utilities::OS::time() + Type::Channel::WRITER_FLUSH_TIMEOUT);
+	TEST_ASSERT_EQUAL_size_t(5, writer->write((const uint8_t*)" more", 5));
+	TEST_ASSERT_TRUE(last_deadline(initiator._transport) == deadline);
+	Transport::run_deadlines();
+	TEST_ASSERT_EQUAL_size_t(0, initiator._impl->_sent.size());
+	advance_time(Type::Channel::WRITER_FLUSH_TIMEOUT);
+	Transport::run_deadlines();
+	TEST_ASSERT_EQUAL_size_t(1, initiator._impl->_sent.size());
+	TEST_ASSERT_EQUAL_size_t(0, writer->pending());
+	TEST_ASSERT_FALSE(is_scheduled(initiator._transport, deadline));
+	exchange(initiator, responder);
+	TEST_ASSERT_TRUE(reader->read_bytes() == "small more");
+
+	// Sending what is held cancels the deadline
+	initiator.enter();
+	writer->write((const uint8_t*)"x", 1);
+	deadline = last_deadline(initiator._transport);
+	TEST_ASSERT_TRUE(deadline > Utilities::OS::time());
+	writer->flush();
+	TEST_ASSERT_FALSE(is_scheduled(initiator._transport, deadline));
+	exchange(initiator, responder);
+	TEST_ASSERT_TRUE(reader->read_bytes() == "x");
+	initiator.enter();
+
+	// What the window has no room for is tried again after another timeout
+	writer->set_flush_threshold(1);
+	writer->write((const uint8_t*)"a", 1);
+	writer->write((const uint8_t*)"b", 1);
+	TEST_ASSERT_EQUAL_size_t(0, writer->pending());
+	while (channel.is_ready_to_send()) {
+		TextMessage message;
+		message._text = "filler";
+		channel.send(message);
+	}
+	writer->write((const uint8_t*)"c", 1);
+	TEST_ASSERT_EQUAL_size_t(1, writer->pending());
+	advance_time(Type::Channel::WRITER_FLUSH_TIMEOUT);
+	Transport::run_deadlines();
+	TEST_ASSERT_EQUAL_size_t(1, writer->pending());
+	exchange(initiator, responder);
+	initiator.enter();
+	advance_time(Type::Channel::WRITER_FLUSH_TIMEOUT);
+	Transport::run_deadlines();
+	TEST_ASSERT_EQUAL_size_t(0, writer->pending());
+
+	// A timeout of 0 holds data until flushed
+	writer->set_flush_threshold(SIZE_MAX);
+	writer->set_flush_timeout(0.0);
+	size_t scheduled = initiator._transport._deadlines.size();
+	writer->write((const uint8_t*)"d", 1);
+	TEST_ASSERT_EQUAL_size_t(scheduled, initiator._transport._deadlines.size());
+	TEST_ASSERT_EQUAL_size_t(1, writer->pending());
+	writer->flush();
+	TEST_ASSERT_EQUAL_size_t(0, writer->pending());
+	exchange(initiator, responder);
+	char buffer[8];
+	TEST_ASSERT_EQUAL_size_t(4, reader->readBytes(buffer, sizeof(buffer)));
+	TEST_ASSERT_EQUAL_MEMORY("abcd", buffer, 4);
+}
+
+void setUp(void) {
+	// set stuff up here before each test
+}
+
+void tearDown(void) {
+	// clean stuff up here after each test
+	received_texts.clear();
+	ready_bytes = 0;
+	established_link = {Type::NONE};
+	Utilities::OS::setTimeOffset(0);
+	Transport::instance(Transport::default_instance());
+}
+
+int runUnityTests(void) {
+	UNITY_BEGIN();
+	RUN_TEST(testEnvelopePack);
+	RUN_TEST(testEnvelopeUnpack);
+	RUN_TEST(testEnvelopeInvalid);
+	RUN_TEST(testMessageFactory);
+	RUN_TEST(testStreamDataMessage);
+	RUN_TEST(testReceiveReordering);
+	RUN_TEST(testReceiveDuplicate);
+	RUN_TEST(testReceiveOutOfWindow);
+	RUN_TEST(testWatchdogScheduling);
+	RUN_TEST(testWindowGrowth);
+	RUN_TEST(testTimeoutNarrowsWindow);
+	RUN_TEST(testTimeoutTearsDown);
+	RUN_TEST(testReaderChunks);
+	RUN_TEST(testWriterChunks);
+	RUN_TEST(testWriterFlushDeadline);
+	return UNITY_END();
+}
+
+// For native dev-platform or for some embedded frameworks
+int main(void) {
+	return runUnityTests();
+}
+
+#ifdef ARDUINO
+// For Arduino framework
+void setup() {
+	// Wait ~2 seconds before the Unity test runner
+	// establishes connection with a board Serial interface
+	delay(2000);
+
+	runUnityTests();
+}
+void loop() {}
+#endif
+
+// For ESP-IDF framework
+void app_main() {
+	runUnityTests();
+}
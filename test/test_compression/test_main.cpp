@@ -0,0 +1,139 @@
+#include <unity.h>
+
+#include "Utilities/Compression.h"
+#include "Bytes.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+static RNS::Bytes roundtrip(const RNS::Bytes& data, size_t piece) {
+	RNS::Utilities::Lzss codec;
+	std::unique_ptr<RNS::Utilities::Compressor> compressor = codec.compressor();
+	RNS::Bytes compressed;
+	for (size_t offset = 0; offset < data.size(); offset += piece) {
+		compressed << compressor->update(data.mid(offset, piece));
+	}
+	compressed << compressor->finalize();
+
+	std::unique_ptr<RNS::Utilities::Decompressor> decompressor = codec.decompressor(data.size());
+	RNS::Bytes decompressed;
+	for (size_t offset = 0; offset < compressed.size(); offset += piece) {
+		decompressed << decompressor->update(compressed.mid(offset, piece));
+	}
+	decompressed << decompressor->finalize();
+	TEST_ASSERT_EQUAL_size_t(data.size(), decompressed.size());
+	if (data.size() > 0) {
+		TEST_ASSERT_TRUE(data == decompressed);
+	}
+	return compressed;
+}
+
+void testLzssText() {
+	RNS::Bytes text;
+	while (text.size() < 5000) {
+		text.append("Reticulum resources are compressed before they are encrypted. ");
+	}
+	// Sizes around the window, in pieces of any size
+	for (size_t size = 0; size < text.size(); size = size * 2 + 1) {
+		for (size_t piece = 1; piece < 4000; piece *= 7) {
+			roundtrip(text.left(size), piece);
+		}
+	}
+	TEST_ASSERT_TRUE(roundtrip(text, 100).size() < text.size() / 4);
+}
+
+void testLzssIncompressible() {
+	RNS::Bytes data;
+	uint8_t* buffer = data.writable(3000);
+	srand(1);
+	for (size_t i = 0; i < 3000; i++) {
+		buffer[i] = (uint8_t)rand();
+	}
+	// Expands by at most one flag byte per eight literals
+	RNS::Bytes compressed = roundtrip(data, 500);
+	TEST_ASSERT_TRUE(compressed.size() <= data.size() + (data.size() + 7) / 8);
+}
+
+void testLzssInvalid() {
+	RNS::Utilities::Lzss codec;
+	RNS::Bytes zeros;
+	memset(zeros.writable(2000), 0, 2000);
+	std::unique_ptr<RNS::Utilities::Compressor> compressor = codec.compressor();
+	RNS::Bytes compressed(compressor->update(zeros));
+	compressed << compressor->finalize();
+
+	// Output beyond the expected size is refused
+	bool rejected = false;
+	try {
+		codec.decompressor(1000)->update(compressed);
+	}
+	catch (std::exception& e) {
+		rejected = true;
+	}
+	TEST_ASSERT_TRUE(rejected);
+
+	// A match reaching back before the start of the data
+	RNS::Bytes invalid;
+	invalid.append((uint8_t)0x01);
+	invalid.append((uint8_t)0xff);
+	invalid.append((uint8_t)0xff);
+	rejected = false;
+	try {
+		codec.decompressor(1000)->update(invalid);
+	}
+	catch (std::exception& e) {
+		rejected = true;
+	}
+	TEST_ASSERT_TRUE(rejected);
+
+	// Input ending inside a match, the zeros are a literal and then a match
+	rejected = false;
+	try {
+		std::unique_ptr<RNS::Utilities::Decompressor> decompressor = codec.decompressor(1000);
+		decompressor->update(compressed.left(3));
+		decompressor->finalize();
+	}
+	catch (std::exception& e) {
+		rejected = true;
+	}
+	TEST_ASSERT_TRUE(rejected);
+}
+
+
+void setUp(void) {
+	// set stuff up here before each test
+}
+
+void tearDown(void) {
+	// clean stuff up here after each test
+}
+
+int runUnityTests(void) {
+	UNITY_BEGIN();
+	RUN_TEST(testLzssText);
+	RUN_TEST(testLzssIncompressible);
+	RUN_TEST(testLzssInvalid);
+	return UNITY_END();
+}
+
+// For native dev-platform or for some embedded frameworks
+int main(void) {
+	return runUnityTests();
+}
+
+#ifdef ARDUINO
+// For Arduino framework
+void setup() {
+	// Wait ~2 seconds before the Unity test runner
+	// establishes connection with a board Serial interface
+	delay(2000);
+
+	runUnityTests();
+}
+void loop() {}
+#endif
+
+// For ESP-IDF framework
+void app_main() {
+	runUnityTests();
+}
@@ -2,14 +2,28 @@
 
 #include "Bytes.h"
 #include "Utilities/Crc.h"
+#include "Cryptography/Provider.h"
+#include "Cryptography/Hashes.h"
+#include "Cryptography/HKDF.h"
 #include "Cryptography/HMAC.h"
+#include "Cryptography/AES.h"
+#include "Cryptography/Token.h"
 #include "Cryptography/PKCS7.h"
+#include "Cryptography/Ed25519.h"
+#include "Cryptography/X25519.h"
+#include "Cryptography/Random.h"
+#include "Utilities/OS.h"
+
+#include <Curve25519.h>
+#include <Ed25519.h>
 
 #include <string.h>
+#include <vector>
 #include <unistd.h>
 #include <time.h>
 #include <stdint.h>
 #include <sys/time.h>
+#include <sys/wait.h>
 #include <stdio.h>
 
 // Imported from Crypto.cpp
@@ -191,6 +205,396 @@ void testByteCrc32() {
 	TEST_ASSERT_EQUAL_UINT32(0xEE2F4613, crc);
 }
 
+void testProviderVectors() {
+	// FIPS 180-2 "abc"
+	{
+		RNS::Bytes expected;
+		expected.assignHex("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+		TEST_ASSERT_TRUE(expected == RNS::Cryptography::sha256("abc"));
+	}
+
+	// RFC 5869 test case 1
+	{
+		RNS::Bytes ikm;
+		ikm.assignHex("0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b");
+		RNS::Bytes salt;
+		salt.assignHex("000102030405060708090a0b0c");
+		RNS::Bytes info;
+		info.assignHex("f0f1f2f3f4f5f6f7f8f9");
+		RNS::Bytes expected;
+		expected.assignHex("3cb25f25faacd57a90434f64d0362f2a2d2d0a90cf1a5a4c5db02d56ecc4c5bf34007208d5b887185865");
+		TEST_ASSERT_TRUE(expected == RNS::Cryptography::hkdf(42, ikm, salt, info));
+	}
+
+	// NIST SP 800-38A F.2.1, first block
+	{
+		RNS::Bytes key;
+		key.assignHex("2b7e151628aed2a6abf7158809cf4f3c");
+		RNS::Bytes iv;
+		iv.assignHex("000102030405060708090a0b0c0d0e0f");
+		RNS::Bytes plaintext;
+		plaintext.assignHex("6bc1bee22e409f96e93d7e117393172a");
+		RNS::Bytes expected;
+		expected.assignHex("7649abac8119b246cee98e9b12e9197d");
+		RNS::Bytes ciphertext = RNS::Cryptography::AES_128_CBC::encrypt(plaintext, key, iv);
+		TEST_ASSERT_TRUE(expected == ciphertext);
+		TEST_ASSERT_TRUE(plaintext == RNS::Cryptography::AES_128_CBC::decrypt(ciphertext, key, iv));
+	}
+
+	// RFC 8032 section 7.1 test 1
+	{
+		RNS::Bytes seed;
+		seed.assignHex("9d61b19deffd5a60ba844af492ec2cc44449c5697b326919703bac031cae7f60");
+		RNS::Bytes expected_public;
+		expected_public.assignHex("d75a980182b10ab7d54bfed3c964073a0ee172f3daa62325af021a68f707511a");
+		RNS::Bytes expected_signature;
+		expected_signature.assignHex("e5564300c360ac729086e2cc806e828a84877f1eb8e5d974d873e065224901555fb8821590a33bacc61e39701cf9b46bd25bf5f0595bbe24655141438e7a100b");
+		RNS::Cryptography::Ed25519PrivateKey::Ptr private_key = RNS::Cryptography::Ed25519PrivateKey::from_private_bytes(seed);
+		TEST_ASSERT_TRUE(expected_public == private_key->public_key()->public_bytes());
+		RNS::Bytes signature = private_key->sign({RNS::Bytes::NONE});
+		TEST_ASSERT_TRUE(expected_signature == signature);
+		TEST_ASSERT_TRUE(private_key->public_key()->verify(signature, {RNS::Bytes::NONE}));
+		TEST_ASSERT_FALSE(private_key->public_key()->verify(signature, "x"));
+	}
+
+	// RFC 7748 section 6.1, private key given clamped
+	{
+		RNS::Bytes private_key;
+		private_key.assignHex("70076d0a7318a57d3c16c17251b26645df4c2f87ebc0992ab177fba51db92c6a");
+		RNS::Bytes expected_public;
+		expected_public.assignHex("8520f0098930a754748b7ddcb43ef75a0dbf3a0d26381af4eba4a98eaa9b4e6a");
+		RNS::Bytes peer_public;
+		peer_public.assignHex("de9edb7d7b7dc1b4d35b61c2ece435373f8343c85b78674dadfc7e146f882b4f");
+		RNS::Bytes expected_shared;
+		expected_shared.assignHex("4a5d9d5ba4ce2de1728e3bf480350f25e07e21c947d19e3376f09b3c1e161742");
+		RNS::Cryptography::X25519PrivateKey::Ptr key = RNS::Cryptography::X25519PrivateKey::from_private_bytes(private_key);
+		TEST_ASSERT_TRUE(expected_public == key->public_key()->public_bytes());
+		TEST_ASSERT_TRUE(expected_shared == key->exchange(peer_public));
+	}
+}
+
+void testAESCBC() {
+	// NIST SP 800-38A F.2.5
+	RNS::Bytes key;
+	key.assignHex("603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4");
+	RNS::Bytes iv;
+	iv.assignHex("000102030405060708090a0b0c0d0e0f");
+	RNS::Bytes plaintext;
+	plaintext.assignHex("6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e5130c81c46a35ce411e5fbc1191a0a52eff69f2445df4f9b17ad2b417be66c3710");
+	RNS::Bytes expected;
+	expected.assignHex("f58c4c04d6e5f1ba779eabfb5f7bfbd69cfc4e967edb808d679f777bc6702c7d39f23369a9d9bacfa530e26304231461b2eb05e2c39be9fcda6c19078c6a9d1b");
+	TEST_ASSERT_TRUE(expected == RNS::Cryptography::AES_256_CBC::encrypt(plaintext, key, iv));
+	TEST_ASSERT_TRUE(plaintext == RNS::Cryptography::AES_256_CBC::decrypt(expected, key, iv));
+
+	// Lengths around the multi-block decryption width, also in place
+	for (size_t blocks = 1; blocks <= 34; blocks++) {
+		RNS::Bytes data = RNS::Cryptography::random(blocks * 16);
+		RNS::Bytes ciphertext = RNS::Cryptography::AES_256_CBC::encrypt(data, key, iv);
+		TEST_ASSERT_TRUE(data == RNS::Cryptography::AES_256_CBC::decrypt(ciphertext, key, iv));
+		RNS::Cryptography::AES_256_CBC::inplace_decrypt(ciphertext, key, iv);
+		TEST_ASSERT_TRUE(data == ciphertext);
+	}
+}
+
+void testSHA256Batch() {
+	// Sizes around the one and two block padding boundaries, more than one batch
+	std::vector<RNS::Bytes> messages;
+	for (size_t size = 0; size < 140; size += 5) {
+		messages.push_back(RNS::Cryptography::random(size));
+	}
+	messages.push_back("abc");
+	std::vector<RNS::Bytes> hashes = RNS::Cryptography::sha256_batch(messages);
+	TEST_ASSERT_EQUAL_size_t(messages.size(), hashes.size());
+	for (size_t i = 0; i < messages.size(); i++) {
+		TEST_ASSERT_TRUE(RNS::Cryptography::sha256(messages[i]) == hashes[i]);
+	}
+	RNS::Bytes expected;
+	expected.assignHex("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+	TEST_ASSERT_TRUE(expected == hashes.back());
+	TEST_ASSERT_EQUAL_size_t(0, RNS::Cryptography::sha256_batch({}).size());
+}
+
+void testHmacReuse() {
+	// RFC 4231 test case 6, key longer than the block size
+	uint8_t key[131];
+	memset(key, 0xaa, sizeof(key));
+	const char* message = "Test Using Larger Than Block-Size Key - Hash Key First";
+	RNS::Bytes expected;
+	expected.assignHex("60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54");
+	std::unique_ptr<RNS::Cryptography::Provider::Hmac> hmac = RNS::Cryptography::Provider::hmac_sha256(key, sizeof(key));
+	// The same MAC each time the keyed state is reset, whole or in pieces
+	for (int i = 0; i < 3; i++) {
+		uint8_t mac[32];
+		hmac->reset();
+		hmac->update((const uint8_t*)message, i);
+		hmac->update((const uint8_t*)message + i, strlen(message) - i);
+		hmac->finalize(mac);
+		TEST_ASSERT_TRUE(expected == RNS::Bytes(mac, sizeof(mac)));
+	}
+}
+
+void testRandomPool() {
+	// Small requests are served from the pool, including across refills
+	std::vector<RNS::Bytes> values;
+	for (int i = 0; i < 200; i++) {
+		RNS::Bytes value = RNS::Cryptography::random(16);
+		TEST_ASSERT_EQUAL_size_t(16, value.size());
+		for (const RNS::Bytes& other : values) {
+			TEST_ASSERT_FALSE(value == other);
+		}
+		values.push_back(value);
+	}
+	// Odd sizes, and sizes large enough to bypass the pool
+	for (size_t size = 1; size < 3000; size = size * 3 + 1) {
+		TEST_ASSERT_EQUAL_size_t(size, RNS::Cryptography::random(size).size());
+	}
+#if defined(NATIVE)
+	// A forked child does not hand out what is left in the parent's pool
+	RNS::Cryptography::random(16);
+	int fds[2];
+	TEST_ASSERT_EQUAL_INT(0, pipe(fds));
+	pid_t child = fork();
+	if (child == 0) {
+		RNS::Bytes value = RNS::Cryptography::random(16);
+		ssize_t written = write(fds[1], value.data(), value.size());
+		_exit(written == 16 ? 0 : 1);
+	}
+	RNS::Bytes parent_value = RNS::Cryptography::random(16);
+	uint8_t child_value[16];
+	TEST_ASSERT_EQUAL_INT(16, read(fds[0], child_value, sizeof(child_value)));
+	int status = 0;
+	waitpid(child, &status, 0);
+	close(fds[0]);
+	close(fds[1]);
+	TEST_ASSERT_FALSE(parent_value == RNS::Bytes(child_value, sizeof(child_value)));
+#endif
+}
+
+void testToken() {
+	RNS::Bytes key;
+	key.assignHex("000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f");
+	RNS::Cryptography::Token token(key);
+
+	// empty plaintext still gives a full block of padding
+	TEST_ASSERT_EQUAL_size_t(64, token.encrypt({RNS::Bytes::NONE}).size());
+	TEST_ASSERT_EQUAL_size_t(0, token.decrypt(token.encrypt({RNS::Bytes::NONE})).size());
+
+	for (size_t size = 1; size <= 48; size++) {
+		RNS::Bytes plaintext = RNS::Cryptography::random(size);
+		RNS::Bytes encrypted = token.encrypt(plaintext);
+		TEST_ASSERT_EQUAL_size_t(RNS::Cryptography::Token::token_size(size), encrypted.size());
+
+		// iv, AES-256-CBC ciphertext and HMAC-SHA256 over both as built by hand
+		RNS::Bytes iv = encrypted.left(16);
+		RNS::Bytes ciphertext = encrypted.mid(16, encrypted.size() - 48);
+		RNS::Bytes expected_hmac = RNS::Cryptography::HMAC(key.left(32), encrypted.left(encrypted.size() - 32)).digest();
+		TEST_ASSERT_TRUE(expected_hmac == encrypted.right(32));
+		RNS::Bytes padded = RNS::Cryptography::AES_256_CBC::decrypt(ciphertext, key.mid(32), iv);
+		TEST_ASSERT_TRUE(plaintext == RNS::Cryptography::PKCS7::unpad(padded));
+
+		TEST_ASSERT_TRUE(plaintext == token.decrypt(encrypted));
+
+		// raw interface into caller buffers
+		uint8_t buffer[16 + 64 + 32];
+		size_t length = token.encrypt(buffer, plaintext.data(), plaintext.size());
+		TEST_ASSERT_EQUAL_size_t(encrypted.size(), length);
+		uint8_t decrypted[64];
+		TEST_ASSERT_EQUAL_size_t(size, token.decrypt(decrypted, buffer, length));
+		TEST_ASSERT_EQUAL_INT(0, memcmp(plaintext.data(), decrypted, size));
+	}
+
+	// tampering and truncation are rejected
+	RNS::Bytes encrypted = token.encrypt("hello");
+	RNS::Bytes tampered(encrypted.data(), encrypted.size());
+	tampered.writable(tampered.size())[20] ^= 0x01;
+	TEST_ASSERT_FALSE(token.verify_hmac(tampered));
+	bool rejected = false;
+	try {
+		token.decrypt(tampered);
+	}
+	catch (std::exception& e) {
+		rejected = true;
+	}
+	TEST_ASSERT_TRUE(rejected);
+	rejected = false;
+	try {
+		token.decrypt(encrypted.left(40));
+	}
+	catch (std::exception& e) {
+		rejected = true;
+	}
+	TEST_ASSERT_TRUE(rejected);
+}
+
+void testTokenStream() {
+	RNS::Bytes key;
+	key.assignHex("000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f");
+	RNS::Cryptography::Token::Ptr token(new RNS::Cryptography::Token(key));
+
+	// Any split into pieces gives one token that decrypts whole or in pieces
+	for (size_t size = 0; size <= 100; size += 11) {
+		RNS::Bytes plaintext = RNS::Cryptography::random(size);
+		for (size_t piece = 1; piece <= 40; piece += 13) {
+			RNS::Cryptography::TokenEncryptor encryptor(token);
+			RNS::Bytes encrypted;
+			for (size_t offset = 0; offset < size; offset += piece) {
+				encrypted << encryptor.update(plaintext.mid(offset, piece));
+			}
+			encrypted << encryptor.finalize();
+			TEST_ASSERT_EQUAL_size_t(RNS::Cryptography::Token::token_size(size), encrypted.size());
+			TEST_ASSERT_EQUAL_size_t(size, token->decrypt(encrypted).size());
+			if (size > 0) {
+				TEST_ASSERT_TRUE(plaintext == token->decrypt(encrypted));
+			}
+
+			RNS::Cryptography::TokenDecryptor decryptor(token);
+			RNS::Bytes decrypted;
+			for (size_t offset = 0; offset < encrypted.size(); offset += piece) {
+				decrypted << decryptor.update(encrypted.mid(offset, piece));
+			}
+			decrypted << decryptor.finalize();
+			TEST_ASSERT_EQUAL_size_t(size, decrypted.size());
+			if (size > 0) {
+				TEST_ASSERT_TRUE(plaintext == decrypted);
+			}
+		}
+	}
+
+	// Decryption resumes after any ciphertext block, given that block
+	RNS::Bytes plaintext = RNS::Cryptography::random(100);
+	RNS::Bytes stream = token->encrypt(plaintext);
+	for (size_t block = 0; block * 16 < plaintext.size() - 4; block++) {
+		RNS::Cryptography::TokenDecryptor resumed(token, stream.mid(block * 16, 16));
+		RNS::Bytes decrypted(resumed.update(stream.mid((block + 1) * 16)));
+		decrypted << resumed.finalize();
+		TEST_ASSERT_TRUE(plaintext.mid(block * 16) == decrypted);
+	}
+
+	// Tampering is only detected at the end of the stream
+	RNS::Bytes encrypted = token->encrypt(RNS::Cryptography::random(64));
+	RNS::Bytes tampered(encrypted.data(), encrypted.size());
+	tampered.writable(tampered.size())[30] ^= 0x01;
+	RNS::Cryptography::TokenDecryptor decryptor(token);
+	decryptor.update(tampered);
+	bool rejected = false;
+	try {
+		decryptor.finalize();
+	}
+	catch (std::exception& e) {
+		rejected = true;
+	}
+	TEST_ASSERT_TRUE(rejected);
+}
+
+void testSHA256Stream() {
+	RNS::Bytes message = RNS::Cryptography::random(200);
+	std::unique_ptr<RNS::Cryptography::Provider::Sha256> hash = RNS::Cryptography::Provider::sha256_stream();
+	hash->update(message.data(), 70);
+	// A clone finishes the common prefix independently
+	std::unique_ptr<RNS::Cryptography::Provider::Sha256> prefix = hash->clone();
+	hash->update(message.data() + 70, message.size() - 70);
+	uint8_t digest[32];
+	hash->finalize(digest);
+	TEST_ASSERT_TRUE(RNS::Cryptography::sha256(message) == RNS::Bytes(digest, sizeof(digest)));
+	prefix->finalize(digest);
+	TEST_ASSERT_TRUE(RNS::Cryptography::sha256(message.left(70)) == RNS::Bytes(digest, sizeof(digest)));
+}
+
+void testEd25519Expanded() {
+	RNS::Cryptography::Ed25519PrivateKey::Ptr private_key = RNS::Cryptography::Ed25519PrivateKey::generate();
+	TEST_ASSERT_TRUE(private_key->public_key() == private_key->public_key());
+
+#if defined(RNS_CURVE25519_GROUP)
+	// Keys and signatures from the expanded key match the Crypto library working from the seed
+	for (int i = 0; i < 16; i++) {
+		RNS::Bytes seed = RNS::Cryptography::random(32);
+		RNS::Bytes message = RNS::Cryptography::random(i * 13);
+		uint8_t expanded[64];
+		RNS::Cryptography::ed25519_expand(expanded, seed.data());
+
+		RNS::Bytes public_key;
+		RNS::Bytes expected_public;
+		RNS::Cryptography::ed25519_base(public_key.writable(32), expanded);
+		Ed25519::derivePublicKey(expected_public.writable(32), seed.data());
+		TEST_ASSERT_TRUE(expected_public == public_key);
+
+		RNS::Bytes signature;
+		RNS::Bytes expected_signature;
+		RNS::Cryptography::ed25519_sign_expanded(signature.writable(64), expanded, public_key.data(), message.data(), message.size());
+		Ed25519::sign(expected_signature.writable(64), seed.data(), public_key.data(), message.data(), message.size());
+		TEST_ASSERT_TRUE(expected_signature == signature);
+	}
+#endif
+}
+
+void testEd25519Verify() {
+#if defined(RNS_CURVE25519_GROUP)
+	// Signatures from the Crypto library verify against the decoded key, altered ones do not
+	for (int i = 0; i < 16; i++) {
+		RNS::Bytes seed = RNS::Cryptography::random(32);
+		RNS::Bytes message = RNS::Cryptography::random(i * 13 + 1);
+		RNS::Bytes public_key;
+		RNS::Bytes signature;
+		Ed25519::derivePublicKey(public_key.writable(32), seed.data());
+		Ed25519::sign(signature.writable(64), seed.data(), public_key.data(), message.data(), message.size());
+
+		RNS::Cryptography::Ed25519VerifyKey key;
+		TEST_ASSERT_TRUE(key.decode(public_key.data()));
+		TEST_ASSERT_TRUE(key.verify(signature.data(), message.data(), message.size()));
+
+		uint8_t altered[64];
+		memcpy(altered, signature.data(), 64);
+		altered[i * 4] ^= 0x01;
+		TEST_ASSERT_FALSE(key.verify(altered, message.data(), message.size()));
+		RNS::Bytes other_message(message);
+		other_message.writable(other_message.size())[0] ^= 0x01;
+		TEST_ASSERT_FALSE(key.verify(signature.data(), other_message.data(), other_message.size()));
+
+		// S + L verifies under the group law but is not canonical
+		static const uint8_t order[32] = {
+			0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58, 0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+			0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10
+		};
+		memcpy(altered, signature.data(), 64);
+		int carry = 0;
+		for (int j = 0; j < 32; j++) {
+			carry += altered[32 + j] + order[j];
+			altered[32 + j] = (uint8_t)carry;
+			carry >>= 8;
+		}
+		TEST_ASSERT_FALSE(key.verify(altered, message.data(), message.size()));
+	}
+
+	// y = 2 is not on the curve
+	uint8_t invalid[32] = {0x02};
+	RNS::Cryptography::Ed25519VerifyKey key;
+	TEST_ASSERT_FALSE(key.decode(invalid));
+#endif
+}
+
+void testX25519FixedBase() {
+#if defined(RNS_X25519_FIXED_BASE)
+	// RFC 7748 section 6.1, private key given clamped as Curve25519::dh1() produces it
+	RNS::Bytes private_key;
+	private_key.assignHex("70076d0a7318a57d3c16c17251b26645df4c2f87ebc0992ab177fba51db92c6a");
+	RNS::Bytes expected;
+	expected.assignHex("8520f0098930a754748b7ddcb43ef75a0dbf3a0d26381af4eba4a98eaa9b4e6a");
+	RNS::Bytes public_key;
+	RNS::Cryptography::x25519_base(public_key.writable(32), private_key.data());
+	TEST_ASSERT_TRUE(expected == public_key);
+
+	// Unclamped keys give the same result as the Montgomery ladder
+	for (int i = 0; i < 16; i++) {
+		RNS::Bytes key = RNS::Cryptography::random(32);
+		RNS::Bytes fixed_base;
+		RNS::Bytes ladder;
+		RNS::Cryptography::x25519_base(fixed_base.writable(32), key.data());
+		Curve25519::eval(ladder.writable(32), key.data(), 0);
+		TEST_ASSERT_TRUE(ladder == fixed_base);
+	}
+#endif
+}
+
 
 void setUp(void) {
     // set stuff up here before each test
@@ -208,6 +612,17 @@ int runUnityTests(void) {
 	RUN_TEST(testCrc32);
 	RUN_TEST(testIncrementalCrc32);
 	RUN_TEST(testByteCrc32);
+	RUN_TEST(testProviderVectors);
+	RUN_TEST(testAESCBC);
+	RUN_TEST(testSHA256Batch);
+	RUN_TEST(testHmacReuse);
+	RUN_TEST(testRandomPool);
+	RUN_TEST(testToken);
+	RUN_TEST(testTokenStream);
+	RUN_TEST(testSHA256Stream);
+	RUN_TEST(testEd25519Expanded);
+	RUN_TEST(testEd25519Verify);
+	RUN_TEST(testX25519FixedBase);
     return UNITY_END();
 }
 
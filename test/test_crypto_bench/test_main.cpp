@@ -0,0 +1,242 @@
+#include <unity.h>
+
+#include "Bytes.h"
+#include "Identity.h"
+#include "Destination.h"
+#include "Packet.h"
+#include "Cryptography/Provider.h"
+#include "Cryptography/Hashes.h"
+#include "Cryptography/HKDF.h"
+#include "Cryptography/HMAC.h"
+#include "Cryptography/AES.h"
+#include "Cryptography/Token.h"
+#include "Cryptography/Ed25519.h"
+#include "Cryptography/X25519.h"
+#include "Cryptography/Random.h"
+#include "Utilities/OS.h"
+
+#include <Curve25519.h>
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+Crypto micro-benchmarks. Each case prints one line of the form
+
+	BENCH {"backend":"Crypto","name":"sha256","size":64,"iterations":65536,"ns_per_op":812.4,"ops_per_sec":1230921.0}
+
+so results can be collected with grep and compared between runs, or between
+backends by running under both the native and native_openssl environments:
+
+	pio test -f test_crypto_bench -e native | grep ^BENCH
+	pio test -f test_crypto_bench -e native_openssl | grep ^BENCH
+
+Size is the payload size in bytes, or 0 where it does not apply.
+*/
+
+// Minimum measured time per case, in seconds
+#ifndef RNS_BENCH_SECONDS
+#define RNS_BENCH_SECONDS 0.2
+#endif
+
+// Keeps results observable so that the measured calls are not optimised away
+static volatile uint8_t sink;
+
+static void consume(const RNS::Bytes& result) {
+	if (result.size() > 0) {
+		sink ^= result.data()[0];
+	}
+}
+
+// Runs op in batches, doubling the batch until it takes at least
+// RNS_BENCH_SECONDS, and reports the cost of the last batch
+template <typename Op>
+static void bench(const char* name, size_t size, Op op) {
+	// first call builds any lazily initialised tables
+	op();
+	uint32_t iterations = 1;
+	double elapsed = 0.0;
+	while (true) {
+		double start = RNS::Utilities::OS::time();
+		for (uint32_t i = 0; i < iterations; i++) {
+			op();
+		}
+		elapsed = RNS::Utilities::OS::time() - start;
+		if (elapsed >= RNS_BENCH_SECONDS || iterations >= (1u << 30)) {
+			break;
+		}
+		iterations *= 2;
+	}
+	double ns_per_op = elapsed * 1e9 / iterations;
+	double ops_per_sec = (elapsed > 0.0) ? (iterations / elapsed) : 0.0;
+	printf("BENCH {\"backend\":\"%s\",\"name\":\"%s\",\"size\":%u,\"iterations\":%u,\"ns_per_op\":%.1f,\"ops_per_sec\":%.1f}\n",
+		RNS::Cryptography::Provider::name(), name, (unsigned)size, (unsigned)iterations, ns_per_op, ops_per_sec);
+	TEST_ASSERT_TRUE(elapsed > 0.0);
+}
+
+// Payload sizes from a bare packet proof up to a full link MDU and beyond
+static const size_t payload_sizes[] = {16, 64, 256, 1024, 8192};
+
+void benchHashes() {
+	for (size_t size : payload_sizes) {
+		RNS::Bytes data = RNS::Cryptography::random(size);
+		bench("sha256", size, [&]() { consume(RNS::Cryptography::sha256(data)); });
+	}
+	for (size_t size : payload_sizes) {
+		RNS::Bytes data = RNS::Cryptography::random(size);
+		bench("sha512", size, [&]() { consume(RNS::Cryptography::sha512(data)); });
+	}
+}
+
+void benchHkdf() {
+	// Link key derivation, 64 bytes from a 32 byte shared key
+	RNS::Bytes shared_key = RNS::Cryptography::random(32);
+	RNS::Bytes salt = RNS::Cryptography::random(16);
+	bench("hkdf", 64, [&]() { consume(RNS::Cryptography::hkdf(64, shared_key, salt)); });
+}
+
+void benchHmac() {
+	RNS::Bytes key = RNS::Cryptography::random(32);
+	for (size_t size : payload_sizes) {
+		RNS::Bytes data = RNS::Cryptography::random(size);
+		// keyed once, as Token does
+		std::unique_ptr<RNS::Cryptography::Provider::Hmac> hmac = RNS::Cryptography::Provider::hmac_sha256(key.data(), key.size());
+		uint8_t mac[32];
+		bench("hmac_sha256", size, [&]() {
+			hmac->reset();
+			hmac->update(data.data(), data.size());
+			hmac->finalize(mac);
+			sink ^= mac[0];
+		});
+	}
+	// Including the key schedule, as the HMAC class does per instance
+	RNS::Bytes data = RNS::Cryptography::random(64);
+	bench("hmac_sha256_keyed", 64, [&]() { consume(RNS::Cryptography::HMAC::generate(key, data)->digest()); });
+}
+
+void benchAes() {
+	RNS::Bytes iv = RNS::Cryptography::random(16);
+	for (size_t key_size : {16, 32}) {
+		RNS::Bytes key = RNS::Cryptography::random(key_size);
+		std::unique_ptr<RNS::Cryptography::Provider::AesCbc> cipher = RNS::Cryptography::Provider::aes_cbc(key.data(), key.size());
+		for (size_t size : payload_sizes) {
+			RNS::Bytes data = RNS::Cryptography::random(size);
+			RNS::Bytes output;
+			uint8_t* buffer = output.writable(size);
+			bench((key_size == 16) ? "aes128_cbc_encrypt" : "aes256_cbc_encrypt", size, [&]() {
+				cipher->encrypt(buffer, data.data(), size, iv.data());
+				sink ^= buffer[0];
+			});
+			bench((key_size == 16) ? "aes128_cbc_decrypt" : "aes256_cbc_decrypt", size, [&]() {
+				cipher->decrypt(buffer, data.data(), size, iv.data());
+				sink ^= buffer[0];
+			});
+		}
+	}
+}
+
+void benchToken() {
+	RNS::Cryptography::Token token(RNS::Cryptography::Token::generate_key());
+	for (size_t size : payload_sizes) {
+		RNS::Bytes plaintext = RNS::Cryptography::random(size);
+		RNS::Bytes encrypted = token.encrypt(plaintext);
+		bench("token_encrypt", size, [&]() { consume(token.encrypt(plaintext)); });
+		bench("token_decrypt", size, [&]() { consume(token.decrypt(encrypted)); });
+	}
+}
+
+void benchEd25519() {
+	RNS::Cryptography::Ed25519PrivateKey::Ptr private_key = RNS::Cryptography::Ed25519PrivateKey::generate();
+	RNS::Cryptography::Ed25519PublicKey::Ptr public_key = private_key->public_key();
+	RNS::Bytes message = RNS::Cryptography::random(32);
+	RNS::Bytes signature = private_key->sign(message);
+	bench("ed25519_sign", message.size(), [&]() { consume(private_key->sign(message)); });
+	bench("ed25519_verify", message.size(), [&]() { sink ^= (uint8_t)public_key->verify(signature, message); });
+	TEST_ASSERT_TRUE(public_key->verify(signature, message));
+}
+
+void benchX25519() {
+	RNS::Cryptography::X25519PrivateKey::Ptr private_key = RNS::Cryptography::X25519PrivateKey::generate();
+	RNS::Cryptography::X25519PublicKey::Ptr peer_public_key = RNS::Cryptography::X25519PrivateKey::generate()->public_key();
+	bench("x25519_keygen", 0, [&]() { consume(RNS::Cryptography::X25519PrivateKey::generate()->public_key()->public_bytes()); });
+#if defined(RNS_X25519_FIXED_BASE)
+	// Public key derivation alone, fixed-base table against the Montgomery ladder
+	RNS::Bytes key = RNS::Cryptography::random(32);
+	RNS::Bytes public_key;
+	uint8_t* derived = public_key.writable(32);
+	bench("x25519_base", 0, [&]() { RNS::Cryptography::x25519_base(derived, key.data()); sink ^= derived[0]; });
+	bench("x25519_ladder", 0, [&]() { Curve25519::eval(derived, key.data(), 0); sink ^= derived[0]; });
+#endif
+	bench("x25519_exchange", 0, [&]() { consume(private_key->exchange(peer_public_key->public_bytes())); });
+}
+
+void benchIdentity() {
+	RNS::Identity identity;
+	RNS::Identity public_identity(false);
+	public_identity.load_public_key(identity.get_public_key());
+	for (size_t size : {16, 256}) {
+		RNS::Bytes plaintext = RNS::Cryptography::random(size);
+		RNS::Bytes ciphertext = public_identity.encrypt(plaintext);
+		bench("identity_encrypt", size, [&]() { consume(public_identity.encrypt(plaintext)); });
+		bench("identity_decrypt", size, [&]() { consume(identity.decrypt(ciphertext)); });
+		TEST_ASSERT_TRUE(plaintext == identity.decrypt(ciphertext));
+	}
+}
+
+void benchValidateAnnounce() {
+	RNS::Identity identity;
+	RNS::Destination destination(identity, RNS::Type::Destination::IN, RNS::Type::Destination::SINGLE, "bench", "announce");
+	RNS::Packet announce = destination.announce(RNS::bytesFromString("app data"), false, {RNS::Type::NONE}, {}, false);
+	announce.pack();
+	// As received from an interface
+	RNS::Packet packet(RNS::Destination(RNS::Type::NONE), announce.raw());
+	TEST_ASSERT_TRUE(packet.unpack());
+	TEST_ASSERT_TRUE(RNS::Identity::validate_announce(packet));
+	// Repeat announces of a known destination, the common case on a busy network
+	bench("identity_validate_announce", packet.data().size(), [&]() { sink ^= (uint8_t)RNS::Identity::validate_announce(packet); });
+}
+
+
+void setUp(void) {
+	// set stuff up here before each test
+}
+
+void tearDown(void) {
+	// clean stuff up here after each test
+}
+
+int runUnityTests(void) {
+	UNITY_BEGIN();
+	RUN_TEST(benchHashes);
+	RUN_TEST(benchHkdf);
+	RUN_TEST(benchHmac);
+	RUN_TEST(benchAes);
+	RUN_TEST(benchToken);
+	RUN_TEST(benchEd25519);
+	RUN_TEST(benchX25519);
+	RUN_TEST(benchIdentity);
+	RUN_TEST(benchValidateAnnounce);
+	return UNITY_END();
+}
+
+// For native dev-platform or for some embedded frameworks
+int main(void) {
+	return runUnityTests();
+}
+
+#ifdef ARDUINO
+// For Arduino framework
+void setup() {
+	// Wait ~2 seconds before the Unity test runner
+	// establishes connection with a board Serial interface
+	delay(2000);
+
+	runUnityTests();
+}
+void loop() {}
+#endif
+
+// For ESP-IDF framework
+void app_main() {
+	runUnityTests();
+}
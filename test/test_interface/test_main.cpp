@@ -0,0 +1,145 @@
+#include <unity.h>
+
+#include "Interface.h"
+#include "Bytes.h"
+#include "Type.h"
+#include "Utilities/OS.h"
+
+#include "../common/nodes/Nodes.h"
+
+#include <vector>
+#include <stdint.h>
+
+using namespace RNS;
+
+void testAnnounceQueueOrder() {
+	CaptureInterface* impl = new CaptureInterface();
+	RNS::Interface interface(impl);
+
+	double now = RNS::Utilities::OS::time();
+	interface.add_announce(RNS::AnnounceEntry("dest_a", now - 10, 3, 1, "raw_a"));
+	interface.add_announce(RNS::AnnounceEntry("dest_b", now - 5, 1, 1, "raw_b"));
+	interface.add_announce(RNS::AnnounceEntry("dest_c", now - 20, 1, 1, "raw_c"));
+	interface.add_announce(RNS::AnnounceEntry("dest_d", now - 30, 2, 1, "raw_d"));
+	TEST_ASSERT_EQUAL_size_t(4, interface.announce_queue().size());
+
+	// Fewest hops first, oldest first on equal hops
+	for (int i = 0; i < 4; i++) {
+		interface.process_announce_queue();
+	}
+	TEST_ASSERT_EQUAL_size_t(0, interface.announce_queue().size());
+	TEST_ASSERT_EQUAL_size_t(4, impl->_sent.size());
+	TEST_ASSERT_EQUAL_STRING("raw_c", impl->_sent[0].toString().c_str());
+	TEST_ASSERT_EQUAL_STRING("raw_b", impl->_sent[1].toString().c_str());
+	TEST_ASSERT_EQUAL_STRING("raw_d", impl->_sent[2].toString().c_str());
+	TEST_ASSERT_EQUAL_STRING("raw_a", impl->_sent[3].toString().c_str());
+}
+
+void testAnnounceQueueDedup() {
+	CaptureInterface* impl = new CaptureInterface();
+	RNS::Interface interface(impl);
+
+	double now = RNS::Utilities::OS::time();
+	interface.add_announce(RNS::AnnounceEntry("dest_a", now, 4, 100, "raw_old"));
+	interface.add_announce(RNS::AnnounceEntry("dest_b", now, 2, 100, "raw_b"));
+	// Older emission of a queued destination is ignored
+	interface.add_announce(RNS::AnnounceEntry("dest_a", now, 1, 50, "raw_older"));
+	TEST_ASSERT_EQUAL_size_t(2, interface.announce_queue().size());
+	// Newer emission replaces the queued entry and is re-prioritised
+	interface.add_announce(RNS::AnnounceEntry("dest_a", now, 1, 200, "raw_new"));
+	TEST_ASSERT_EQUAL_size_t(2, interface.announce_queue().size());
+
+	interface.process_announce_queue();
+	TEST_ASSERT_EQUAL_size_t(1, impl->_sent.size());
+	TEST_ASSERT_EQUAL_STRING("raw_new", impl->_sent[0].toString().c_str());
+}
+
+void testAnnounceQueueExpiry() {
+	CaptureInterface* impl = new CaptureInterface();
+	RNS::Interface interface(impl);
+
+	double now = RNS::Utilities::OS::time();
+	interface.add_announce(RNS::AnnounceEntry("dest_a", now - RNS::Type::Reticulum::QUEUED_ANNOUNCE_LIFE - 1, 1, 1, "raw_stale"));
+	interface.add_announce(RNS::AnnounceEntry("dest_b", now, 5, 1, "raw_b"));
+
+	// Stale entry is discarded and the next valid one sent in the same pass
+	interface.process_announce_queue();
+	TEST_ASSERT_EQUAL_size_t(0, interface.announce_queue().size());
+	TEST_ASSERT_EQUAL_size_t(1, impl->_sent.size());
+	TEST_ASSERT_EQUAL_STRING("raw_b", impl->_sent[0].toString().c_str());
+}
+
+void testAnnounceQueuePacing() {
+	// 1000 bps with a 2% cap, 100 bytes takes 0.8s of airtime and so 40s of budget
+	CaptureInterface* impl = new CaptureInterface();
+	impl->announce_limits(1000, 0.02);
+	RNS::Interface interface(impl);
+	TEST_ASSERT_DOUBLE_WITHIN(0.001, 40.0, interface.announce_wait_time(100));
+
+	double now = RNS::Utilities::OS::time();
+	RNS::Bytes raw;
+	raw.writable(100);
+	interface.add_announce(RNS::AnnounceEntry("dest_a", now, 1, 1, raw));
+	interface.process_announce_queue();
+	TEST_ASSERT_DOUBLE_WITHIN(1.0, now + 40.0, interface.announce_allowed_at());
+
+	// Uncapped interface never waits
+	CaptureInterface* uncapped_impl = new CaptureInterface();
+	uncapped_impl->announce_limits(0, 0.02);
+	RNS::Interface uncapped(uncapped_impl);
+	TEST_ASSERT_DOUBLE_WITHIN(0.001, 0.0, uncapped.announce_wait_time(100));
+}
+
+void testDropAnnounceQueue() {
+	CaptureInterface* impl = new CaptureInterface();
+	RNS::Interface interface(impl);
+
+	double now = RNS::Utilities::OS::time();
+	interface.add_announce(RNS::AnnounceEntry("dest_a", now, 1, 1, "raw_a"));
+	interface.add_announce(RNS::AnnounceEntry("dest_b", now, 1, 1, "raw_b"));
+	TEST_ASSERT_EQUAL_size_t(2, interface.drop_announce_queue());
+	TEST_ASSERT_EQUAL_size_t(0, interface.announce_queue().size());
+	interface.process_announce_queue();
+	TEST_ASSERT_EQUAL_size_t(0, impl->_sent.size());
+}
+
+
+void setUp(void) {
+    // set stuff up here before each test
+}
+
+void tearDown(void) {
+    // clean stuff up here after each test
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+	RUN_TEST(testAnnounceQueueOrder);
+	RUN_TEST(testAnnounceQueueDedup);
+	RUN_TEST(testAnnounceQueueExpiry);
+	RUN_TEST(testAnnounceQueuePacing);
+	RUN_TEST(testDropAnnounceQueue);
+    return UNITY_END();
+}
+
+// For native dev-platform or for some embedded frameworks
+int main(void) {
+    return runUnityTests();
+}
+
+#ifdef ARDUINO
+// For Arduino framework
+void setup() {
+    // Wait ~2 seconds before the Unity test runner
+    // establishes connection with a board Serial interface
+    delay(2000);
+
+    runUnityTests();
+}
+void loop() {}
+#endif
+
+// For ESP-IDF framework
+void app_main() {
+    runUnityTests();
+}
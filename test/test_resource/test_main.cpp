@@ -0,0 +1,598 @@
+#include <unity.h>
+
+#include "Resource.h"
+#include "Transport.h"
+#include "TransportInstance.h"
+#include "Identity.h"
+#include "Destination.h"
+#include "Link.h"
+#include "Packet.h"
+#include "Interface.h"
+#include "Reticulum.h"
+#include "Utilities/OS.h"
+#include "Utilities/Compression.h"
+#include "Bytes.h"
+#include "Type.h"
+
+#include "../common/filesystem/FileSystem.h"
+#include "../common/nodes/Nodes.h"
+
+#include <vector>
+
+using namespace RNS;
+
+static Link responder_link = {Type::NONE};
+static std::vector<Resource> started_resources;
+static std::vector<Resource> concluded_resources;
+
+void on_link_established(Link& link) {
+	responder_link = link;
+	link.set_resource_strategy(Type::Link::ACCEPT_ALL);
+	link.set_resource_started_callback([](const Resource& resource) {
+		started_resources.push_back(resource);
+	});
+	link.set_resource_concluded_callback([](const Resource& resource) {
+		concluded_resources.push_back(resource);
+	});
+}
+
+// Files for streamed resources, with the resources cache in the working directory
+void use_filesystem() {
+	RNS::FileSystem filesystem = new ::FileSystem();
+	((::FileSystem*)filesystem.get())->init();
+	Utilities::OS::register_filesystem(filesystem);
+	strncpy(Reticulum::_cachepath, "test_resource_cache", Type::Reticulum::FILEPATH_MAXSIZE);
+	Utilities::OS::create_directory(Reticulum::_cachepath);
+	// Starting without files left from earlier runs
+	for (auto& filename : Utilities::OS::list_directory("test_resource_cache/resources")) {
+		Utilities::OS::remove_file(("test_resource_cache/resources/" + filename).c_str());
+	}
+}
+
+Bytes test_data(size_t size) {
+	Bytes data;
+	uint8_t* buffer = data.writable(size);
+	for (size_t i = 0; i < size; i++) {
+		buffer[i] = (uint8_t)(i * 7 + (i >> 8));
+	}
+	return data;
+}
+
+// Advertisement for a plain encrypted resource of three parts, as packed by
+// umsgpack in the reference implementation, with a nil request id
+static const char advertisement_hex[] =
+	"8ba174cd04b0a164cd044ca16e03"
+	"a168c420202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f"
+	"a172c404a0a1a2a3"
+	"a16fc420202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f"
+	"a16901a16c01a171c0a16601"
+	"a16dc40c505152535455565758595a5b";
+
+void testAdvertisementUnpack() {
+	RNS::Bytes packed;
+	packed.appendHex(advertisement_hex);
+
+	RNS::ResourceAdvertisement adv = RNS::ResourceAdvertisement::unpack(packed);
+	TEST_ASSERT_EQUAL_size_t(1200, adv.transfer_size());
+	TEST_ASSERT_EQUAL_size_t(1100, adv.data_size());
+	TEST_ASSERT_EQUAL_UINT32(3, adv.parts());
+	TEST_ASSERT_EQUAL_size_t(32, adv.hash().size());
+	TEST_ASSERT_EQUAL_UINT8(0x20, adv.hash()[0]);
+	TEST_ASSERT_TRUE(adv.original_hash() == adv.hash());
+	TEST_ASSERT_EQUAL_size_t(RNS::Type::Resource::RANDOM_HASH_SIZE, adv.random_hash().size());
+	TEST_ASSERT_EQUAL_size_t(3 * RNS::Type::Resource::MAPHASH_LEN, adv.hashmap().size());
+	TEST_ASSERT_FALSE(adv.request_id());
+	TEST_ASSERT_EQUAL_INT(1, adv.segment_index());
+	TEST_ASSERT_EQUAL_INT(1, adv.total_segments());
+	TEST_ASSERT_TRUE(adv.encrypted());
+	TEST_ASSERT_FALSE(adv.compressed());
+	TEST_ASSERT_FALSE(adv.split());
+	TEST_ASSERT_FALSE(adv.is_request());
+	TEST_ASSERT_FALSE(adv.is_response());
+}
+
+void testAdvertisementRoundtrip() {
+	RNS::Bytes packed;
+	packed.appendHex(advertisement_hex);
+
+	// Packing reproduces the reference encoding byte for byte
+	RNS::ResourceAdvertisement adv = RNS::ResourceAdvertisement::unpack(packed);
+	TEST_ASSERT_TRUE(adv.pack() == packed);
+}
+
+void testAdvertisementRequestFlags() {
+	RNS::Bytes packed;
+	packed.appendHex(advertisement_hex);
+
+	// Same advertisement carrying a 16 byte request id, flagged as a response
+	RNS::Bytes request_id;
+	request_id.appendHex("000102030405060708090a0b0c0d0e0f");
+	// The "q" key sits at offset 100, followed by nil and the flags entry
+	const size_t q = 100;
+	TEST_ASSERT_EQUAL_UINT8('q', packed[q + 1]);
+	RNS::Bytes response;
+	response << packed.left(q + 2);
+	response.append((uint8_t)0xc4);
+	response.append((uint8_t)request_id.size());
+	response << request_id;
+	response.append((const uint8_t*)"\xa1" "f" "\x11", 3);
+	response << packed.mid(q + 6);
+
+	RNS::ResourceAdvertisement adv = RNS::ResourceAdvertisement::unpack(response);
+	TEST_ASSERT_TRUE(adv.request_id() == request_id);
+	TEST_ASSERT_EQUAL_UINT8(0x11, adv.flags());
+	TEST_ASSERT_TRUE(adv.encrypted());
+	TEST_ASSERT_FALSE(adv.is_request());
+	TEST_ASSERT_TRUE(adv.is_response());
+	TEST_ASSERT_TRUE(adv.pack() == response);
+}
+
+void testAdvertisementInvalid() {
+	RNS::Bytes packed;
+	packed.appendHex(advertisement_hex);
+
+	// Truncated anywhere, the advertisement must be rejected rather than misread
+	for (size_t size = 0; size < packed.size(); size += 7) {
+		bool rejected = false;
+		try {
+			RNS::ResourceAdvertisement::unpack(packed.left(size));
+		}
+		catch (std::exception& e) {
+			rejected = true;
+		}
+		TEST_ASSERT_TRUE(rejected);
+	}
+}
+
+void testTransferRound() {
+	Node responder("responder");
+	Node initiator("initiator");
+	Identity identity;
+	Link link = establish(initiator, responder, identity, on_link_established);
+	TEST_ASSERT_EQUAL_INT(Type::Link::ACTIVE, link.status());
+	TEST_ASSERT_TRUE(responder_link);
+	TEST_ASSERT_EQUAL_INT(Type::Link::ACTIVE, responder_link.status());
+
+	// Ten parts, more than the first window of four
+	const uint16_t sdu = link.mtu() - Type::Reticulum::HEADER_MAXSIZE - Type::Reticulum::IFAC_MIN_SIZE;
+	Bytes data(test_data(9 * sdu + 100));
+	initiator.enter();
+	Resource resource(data, link, true, false);
+	TEST_ASSERT_EQUAL_INT(Type::Resource::ADVERTISED, resource.status());
+	TEST_ASSERT_EQUAL_UINT32(10, resource.get_parts());
+
+	// The advertisement is answered with a request for the first window
+	TEST_ASSERT_EQUAL_size_t(1, deliver(initiator, responder));
+	TEST_ASSERT_EQUAL_size_t(1, responder._impl->_sent.size());
+	Packet request(Destination(Type::NONE), responder._impl->_sent.back());
+	TEST_ASSERT_TRUE(request.unpack());
+	TEST_ASSERT_EQUAL_INT(Type::Packet::RESOURCE_REQ, request.context());
+
+	// Which is answered with one part per requested hash
+	TEST_ASSERT_EQUAL_size_t(1, deliver(responder, initiator));
+	TEST_ASSERT_EQUAL_INT(Type::Resource::TRANSFERRING, resource.status());
+	TEST_ASSERT_EQUAL_size_t(Type::Resource::WINDOW, initiator._impl->_sent.size());
+	for (const Bytes& raw : initiator._impl->_sent) {
+		Packet part(Destination(Type::NONE), raw);
+		TEST_ASSERT_TRUE(part.unpack());
+		TEST_ASSERT_EQUAL_INT(Type::Packet::RESOURCE, part.context());
+		TEST_ASSERT_EQUAL_size_t(sdu, part.data().size());
+	}
+
+	exchange(initiator, responder);
+	TEST_ASSERT_EQUAL_INT(Type::Resource::COMPLETE, resource.status());
+	TEST_ASSERT_EQUAL_size_t(1, concluded_resources.size());
+	TEST_ASSERT_EQUAL_INT(Type::Resource::COMPLETE, concluded_resources[0].status());
+	TEST_ASSERT_TRUE(concluded_resources[0].data() == data);
+}
+
+void testWindowGrowth() {
+	Node responder("responder");
+	Node initiator("initiator");
+	Identity identity;
+	Link link = establish(initiator, responder, identity, on_link_established);
+
+	// Every round delivered in full grows the window by one part, and rounds
+	// at the fast rate lift its limit from the slow to the fast maximum
+	const uint16_t sdu = link.mtu() - Type::Reticulum::HEADER_MAXSIZE - Type::Reticulum::IFAC_MIN_SIZE;
+	initiator.enter();
+	Resource resource(test_data(200 * sdu), link, true, false);
+	deliver(initiator, responder);
+	TEST_ASSERT_EQUAL_size_t(1, started_resources.size());
+	Resource incoming = started_resources[0];
+	uint8_t window = incoming.window();
+	TEST_ASSERT_EQUAL_UINT8(Type::Resource::WINDOW, window);
+	for (int round = 0; round < Type::Resource::WINDOW_MAX_SLOW; round++) {
+		deliver(responder, initiator);
+		deliver(initiator, responder);
+		TEST_ASSERT_EQUAL_UINT8(window + 1, incoming.window());
+		window = incoming.window();
+	}
+	TEST_ASSERT_TRUE(incoming.window() > Type::Resource::WINDOW_MAX_SLOW);
+
+	exchange(initiator, responder);
+	TEST_ASSERT_EQUAL_INT(Type::Resource::COMPLETE, resource.status());
+}
+
+void testWindowShrinkOnTimeout() {
+	Node responder("responder");
+	Node initiator("initiator");
+	Identity identity;
+	Link link = establish(initiator, responder, identity, on_link_established);
+
+	const uint16_t sdu = link.mtu() - Type::Reticulum::HEADER_MAXSIZE - Type::Reticulum::IFAC_MIN_SIZE;
+	initiator.enter();
+	Resource resource(test_data(200 * sdu), link, true, false);
+	deliver(initiator, responder);
+	TEST_ASSERT_EQUAL_size_t(1, started_resources.size());
+	Resource incoming = started_resources[0];
+	for (int round = 0; round < 2; round++) {
+		deliver(responder, initiator);
+		deliver(initiator, responder);
+	}
+	const uint8_t window = incoming.window();
+	TEST_ASSERT_EQUAL_UINT8(Type::Resource::WINDOW + 2, window);
+
+	// A round lost in full times out on the receiver, which narrows the
+	// window by one part and asks again
+	deliver(responder, initiator);
+	TEST_ASSERT_EQUAL_size_t(0, deliver(initiator, responder, Type::Packet::RESOURCE));
+	responder.enter();
+	Transport::run_deadlines();
+	TEST_ASSERT_EQUAL_UINT8(window, incoming.window());
+	TEST_ASSERT_EQUAL_size_t(0, responder._impl->_sent.size());
+	advance_time(60.0);
+	Transport::run_deadlines();
+	TEST_ASSERT_EQUAL_UINT8(window - 1, incoming.window());
+	TEST_ASSERT_EQUAL_size_t(1, responder._impl->_sent.size());
+	Packet request(Destination(Type::NONE), responder._impl->_sent.back());
+	TEST_ASSERT_TRUE(request.unpack());
+	TEST_ASSERT_EQUAL_INT(Type::Packet::RESOURCE_REQ, request.context());
+
+	exchange(initiator, responder);
+	TEST_ASSERT_EQUAL_INT(Type::Resource::COMPLETE, resource.status());
+	TEST_ASSERT_EQUAL_INT(Type::Resource::COMPLETE, incoming.status());
+}
+
+void testVerySlowRate() {
+	Node responder("responder");
+	Node initiator("initiator");
+	Identity identity;
+	Link link = establish(initiator, responder, identity, on_link_established);
+
+	const uint16_t sdu = link.mtu() - Type::Reticulum::HEADER_MAXSIZE - Type::Reticulum::IFAC_MIN_SIZE;
+	initiator.enter();
+	Resource resource(test_data(200 * sdu), link, true, false);
+	deliver(initiator, responder);
+	TEST_ASSERT_EQUAL_size_t(1, started_resources.size());
+	Resource incoming = started_resources[0];
+
+	// Rounds taking ten seconds each stay below the very slow rate, and after
+	// the threshold of such rounds the window no longer grows
+	uint8_t window = incoming.window();
+	for (int round = 0; round < Type::Resource::VERY_SLOW_RATE_THRESHOLD; round++) {
+		deliver(responder, initiator);
+		advance_time(10.0);
+		deliver(initiator, responder);
+		TEST_ASSERT_EQUAL_UINT8(window + 1, incoming.window());
+		window = incoming.window();
+	}
+	TEST_ASSERT_TRUE(incoming.eifr() < Type::Resource::RATE_VERY_SLOW * 8);
+	deliver(responder, initiator);
+	advance_time(10.0);
+	deliver(initiator, responder);
+	TEST_ASSERT_EQUAL_UINT8(window, incoming.window());
+
+	exchange(initiator, responder);
+	TEST_ASSERT_EQUAL_INT(Type::Resource::COMPLETE, resource.status());
+}
+
+void testMetadata() {
+	Node responder("responder");
+	Node initiator("initiator");
+	Identity identity;
+	Link link = establish(initiator, responder, identity, on_link_established);
+
+	// Metadata travels ahead of the data and is split off again on assembly
+	const Bytes metadata("\x81\xa4name\xa8test.bin");
+	Bytes data(test_data(3000));
+	initiator.enter();
+	Resource resource(data, link, true, false, nullptr, nullptr, 0.0, 1, {Type::NONE}, {Type::NONE}, false, metadata);
+	TEST_ASSERT_TRUE(resource.has_metadata());
+	exchange(initiator, responder);
+	TEST_ASSERT_EQUAL_INT(Type::Resource::COMPLETE, resource.status());
+	TEST_ASSERT_EQUAL_size_t(1, concluded_resources.size());
+	TEST_ASSERT_TRUE(concluded_resources[0].has_metadata());
+	TEST_ASSERT_TRUE(concluded_resources[0].metadata() == metadata);
+	TEST_ASSERT_TRUE(concluded_resources[0].data() == data);
+}
+
+void testStreamedTransfer() {
+	use_filesystem();
+	Node responder("responder");
+	Node initiator("initiator");
+	Identity identity;
+	Link link = establish(initiator, responder, identity, on_link_established);
+
+	// Enough parts for several hashmap segments, and for the sender to drop
+	// map hashes from memory while mapping
+	const uint16_t sdu = link.mtu() - Type::Reticulum::HEADER_MAXSIZE - Type::Reticulum::IFAC_MIN_SIZE;
+	const uint32_t parts = 3 * Type::Resource::ResourceAdvertisement::COLLISION_GUARD_SIZE;
+	const size_t hashmap_span = 2 * Type::Resource::ResourceAdvertisement::COLLISION_GUARD_SIZE * Type::Resource::MAPHASH_LEN;
+	const Bytes data(test_data(parts * sdu - 100));
+	TEST_ASSERT_EQUAL_size_t(data.size(), Utilities::OS::write_file("test_resource_source", data));
+	initiator.enter();
+	FileStream source = Utilities::OS::open_file("test_resource_source", FileStream::MODE_READ);
+	Resource resource(source, link, true, false);
+	TEST_ASSERT_EQUAL_INT(Type::Resource::ADVERTISED, resource.status());
+	TEST_ASSERT_EQUAL_UINT32(parts, resource.get_parts());
+	TEST_ASSERT_TRUE(resource.hashmap().size() <= hashmap_span);
+
+	deliver(initiator, responder);
+	TEST_ASSERT_EQUAL_size_t(1, started_resources.size());
+	Resource incoming = started_resources[0];
+	responder.enter();
+	FileStream sink = Utilities::OS::open_file("test_resource_sink", FileStream::MODE_WRITE);
+	incoming.set_data_sink(sink);
+
+	// Nothing reaches the sink before the hash has been checked, and the
+	// sender reads in the hashmap as it goes
+	for (int round = 0; round < 20; round++) {
+		deliver(responder, initiator);
+		deliver(initiator, responder);
+	}
+	TEST_ASSERT_EQUAL_INT(Type::Resource::TRANSFERRING, incoming.status());
+	sink.flush();
+	TEST_ASSERT_EQUAL_size_t(0, sink.size());
+	TEST_ASSERT_TRUE(resource.hashmap().size() <= hashmap_span);
+
+	exchange(initiator, responder);
+	TEST_ASSERT_EQUAL_INT(Type::Resource::COMPLETE, resource.status());
+	TEST_ASSERT_EQUAL_INT(Type::Resource::COMPLETE, incoming.status());
+	Bytes received;
+	Utilities::OS::read_file("test_resource_sink", received);
+	TEST_ASSERT_EQUAL_size_t(data.size(), received.size());
+	TEST_ASSERT_TRUE(received == data);
+
+	Utilities::OS::remove_file("test_resource_source");
+	Utilities::OS::remove_file("test_resource_sink");
+}
+
+void testStreamedCompressedWithMetadata() {
+	use_filesystem();
+	Resource::set_codec(Utilities::Codec::Ptr(new Utilities::Lzss()));
+	Node responder("responder");
+	Node initiator("initiator");
+	Identity identity;
+	Link link = establish(initiator, responder, identity, on_link_established);
+
+	// Text compresses, and is read back through the decompressor twice, to
+	// check it and to write it out after the metadata
+	Bytes data;
+	for (int line = 0; line < 2000; line++) {
+		char text[64];
+		snprintf(text, sizeof(text), "line %d of a compressible resource\n", line);
+		data.append(text);
+	}
+	const Bytes metadata("\x81\xa4name\xa8test.txt");
+	TEST_ASSERT_EQUAL_size_t(data.size(), Utilities::OS::write_file("test_resource_source", data));
+	initiator.enter();
+	FileStream source = Utilities::OS::open_file("test_resource_source", FileStream::MODE_READ);
+	Resource resource(source, link, true, true, nullptr, nullptr, 0.0, 1, {Type::NONE}, {Type::NONE}, false, metadata);
+	TEST_ASSERT_TRUE(resource.is_compressed());
+
+	deliver(initiator, responder);
+	TEST_ASSERT_EQUAL_size_t(1, started_resources.size());
+	Resource incoming = started_resources[0];
+	responder.enter();
+	incoming.set_data_sink(Utilities::OS::open_file("test_resource_sink", FileStream::MODE_WRITE));
+	exchange(initiator, responder);
+	TEST_ASSERT_EQUAL_INT(Type::Resource::COMPLETE, resource.status());
+	TEST_ASSERT_EQUAL_INT(Type::Resource::COMPLETE, incoming.status());
+	TEST_ASSERT_TRUE(incoming.metadata() == metadata);
+	Bytes received;
+	Utilities::OS::read_file("test_resource_sink", received);
+	TEST_ASSERT_TRUE(received == data);
+
+	Utilities::OS::remove_file("test_resource_source");
+	Utilities::OS::remove_file("test_resource_sink");
+}
+
+// Number of resource parts among what a node has sent and not yet delivered
+size_t count_parts(Node& from) {
+	size_t parts = 0;
+	for (const Bytes& raw : from._impl->_sent) {
+		Packet packet(Destination(Type::NONE), raw);
+		if (packet.unpack() && packet.context() == Type::Packet::RESOURCE) {
+			parts++;
+		}
+	}
+	return parts;
+}
+
+// Streams data to a sink over link and closes the link once the receiver
+// has more than half of it, returning the incoming resource
+Resource interrupt_transfer(Node& initiator, Node& responder, Link& link, Resource& resource, const Bytes& data) {
+	TEST_ASSERT_EQUAL_size_t(data.size(), Utilities::OS::write_file("test_resource_source", data));
+	initiator.enter();
+	resource = Resource(Utilities::OS::open_file("test_resource_source", FileStream::MODE_READ), link, true, false);
+	deliver(initiator, responder);
+	TEST_ASSERT_EQUAL_size_t(1, started_resources.size());
+	Resource incoming = started_resources[0];
+	started_resources.clear();
+	responder.enter();
+	incoming.set_data_sink(Utilities::OS::open_file("test_resource_sink", FileStream::MODE_WRITE));
+	while (incoming.get_progress() < 0.5) {
+		deliver(responder, initiator);
+		deliver(initiator, responder);
+	}
+	initiator.enter();
+	link.teardown();
+	deliver(initiator, responder);
+	TEST_ASSERT_EQUAL_INT(Type::Resource::FAILED, resource.status());
+	TEST_ASSERT_EQUAL_INT(Type::Resource::FAILED, incoming.status());
+	return incoming;
+}
+
+// Files in the resources cache, by kind
+size_t count_cache_files(const char* suffix) {
+	char path[Type::Reticulum::FILEPATH_MAXSIZE];
+	snprintf(path, Type::Reticulum::FILEPATH_MAXSIZE, "%s/resources", Reticulum::_cachepath);
+	size_t count = 0;
+	for (auto& filename : Utilities::OS::list_directory(path)) {
+		size_t dot = filename.find('.');
+		if ((dot == std::string::npos && *suffix == 0) || (dot != std::string::npos && filename.compare(dot, std::string::npos, suffix) == 0)) {
+			count++;
+		}
+	}
+	return count;
+}
+
+void testResumeOnNewLink() {
+	use_filesystem();
+	Node responder("responder");
+	Node initiator("initiator");
+	Identity identity;
+	Link link = establish(initiator, responder, identity, on_link_established);
+
+	// The receiver picks up beyond the first hashmap segment
+	const uint16_t sdu = link.mtu() - Type::Reticulum::HEADER_MAXSIZE - Type::Reticulum::IFAC_MIN_SIZE;
+	const uint32_t parts = 3 * Type::Resource::ResourceAdvertisement::HASHMAP_MAX_LEN;
+	const Bytes data(test_data(parts * sdu - 100));
+	Resource resource({Type::NONE});
+	Resource interrupted(interrupt_transfer(initiator, responder, link, resource, data));
+	const float progress = interrupted.get_progress();
+	TEST_ASSERT_TRUE(progress * parts > Type::Resource::ResourceAdvertisement::HASHMAP_MAX_LEN);
+
+	// The state names the spool of decrypted data, which is kept
+	char state_path[Type::Reticulum::FILEPATH_MAXSIZE];
+	snprintf(state_path, Type::Reticulum::FILEPATH_MAXSIZE, "%s/resources/%s", Reticulum::_cachepath, interrupted.hash().toHex().c_str());
+	TEST_ASSERT_TRUE(Utilities::OS::file_exists(state_path));
+	TEST_ASSERT_EQUAL_size_t(1, count_cache_files(".sink"));
+	Bytes sink;
+	Utilities::OS::read_file("test_resource_sink", sink);
+	TEST_ASSERT_EQUAL_size_t(0, sink.size());
+
+	// Advertised again on a new link, under a new key and the same hash
+	Link new_link = connect(initiator, responder, identity);
+	TEST_ASSERT_EQUAL_INT(Type::Link::ACTIVE, new_link.status());
+	initiator.enter();
+	resource.resume(new_link);
+	TEST_ASSERT_TRUE(resource.hash() == interrupted.hash());
+	deliver(initiator, responder);
+	TEST_ASSERT_EQUAL_size_t(1, started_resources.size());
+	Resource incoming = started_resources[0];
+	responder.enter();
+	incoming.set_data_sink(Utilities::OS::open_file("test_resource_sink", FileStream::MODE_WRITE));
+	// Parts to the last whole block decrypted before are not requested again
+	TEST_ASSERT_TRUE(incoming.get_progress() > progress - 0.05);
+
+	size_t parts_sent = 0;
+	while (true) {
+		parts_sent += count_parts(initiator);
+		if (deliver(initiator, responder) + deliver(responder, initiator) == 0) {
+			break;
+		}
+	}
+	TEST_ASSERT_EQUAL_INT(Type::Resource::COMPLETE, resource.status());
+	TEST_ASSERT_EQUAL_INT(Type::Resource::COMPLETE, incoming.status());
+	TEST_ASSERT_TRUE(parts_sent < parts * (1.05 - progress));
+	Bytes received;
+	Utilities::OS::read_file("test_resource_sink", received);
+	TEST_ASSERT_EQUAL_size_t(data.size(), received.size());
+	TEST_ASSERT_TRUE(received == data);
+
+	// Nothing of the transfer is left in the cache on the receiving side
+	TEST_ASSERT_FALSE(Utilities::OS::file_exists(state_path));
+	TEST_ASSERT_EQUAL_size_t(0, count_cache_files(".sink"));
+
+	Utilities::OS::remove_file("test_resource_source");
+	Utilities::OS::remove_file("test_resource_sink");
+}
+
+void testStaleStateCleaned() {
+	use_filesystem();
+	Node responder("responder");
+	Node initiator("initiator");
+	Identity identity;
+	Link link = establish(initiator, responder, identity, on_link_established);
+
+	const uint16_t sdu = link.mtu() - Type::Reticulum::HEADER_MAXSIZE - Type::Reticulum::IFAC_MIN_SIZE;
+	const Bytes data(test_data(4 * Type::Resource::WINDOW * sdu));
+	Resource resource({Type::NONE});
+	Resource interrupted(interrupt_transfer(initiator, responder, link, resource, data));
+	TEST_ASSERT_EQUAL_size_t(1, count_cache_files(""));
+	TEST_ASSERT_EQUAL_size_t(1, count_cache_files(".sink"));
+	TEST_ASSERT_EQUAL_size_t(1, count_cache_files(".spool"));
+
+	// Files within their time are kept
+	Resource::clean_cache();
+	TEST_ASSERT_EQUAL_size_t(1, count_cache_files(""));
+	TEST_ASSERT_EQUAL_size_t(1, count_cache_files(".sink"));
+	TEST_ASSERT_EQUAL_size_t(1, count_cache_files(".spool"));
+
+	advance_time(Type::Reticulum::RESOURCE_CACHE + 60);
+	Resource::clean_cache();
+	TEST_ASSERT_EQUAL_size_t(0, count_cache_files(""));
+	TEST_ASSERT_EQUAL_size_t(0, count_cache_files(".sink"));
+	TEST_ASSERT_EQUAL_size_t(0, count_cache_files(".spool"));
+
+	Utilities::OS::remove_file("test_resource_source");
+	Utilities::OS::remove_file("test_resource_sink");
+}
+
+
+void setUp(void) {
+	// set stuff up here before each test
+}
+
+void tearDown(void) {
+	// clean stuff up here after each test
+	responder_link = {Type::NONE};
+	started_resources.clear();
+	concluded_resources.clear();
+	Utilities::OS::setTimeOffset(0);
+	Utilities::OS::deregister_filesystem();
+	Resource::set_codec(nullptr);
+	Transport::instance(Transport::default_instance());
+}
+
+int runUnityTests(void) {
+	UNITY_BEGIN();
+	RUN_TEST(testAdvertisementUnpack);
+	RUN_TEST(testAdvertisementRoundtrip);
+	RUN_TEST(testAdvertisementRequestFlags);
+	RUN_TEST(testAdvertisementInvalid);
+	RUN_TEST(testTransferRound);
+	RUN_TEST(testWindowGrowth);
+	RUN_TEST(testWindowShrinkOnTimeout);
+	RUN_TEST(testVerySlowRate);
+	RUN_TEST(testMetadata);
+	RUN_TEST(testStreamedTransfer);
+	RUN_TEST(testStreamedCompressedWithMetadata);
+	RUN_TEST(testResumeOnNewLink);
+	RUN_TEST(testStaleStateCleaned);
+	return UNITY_END();
+}
+
+// For native dev-platform or for some embedded frameworks
+int main(void) {
+	return runUnityTests();
+}
+
+#ifdef ARDUINO
+// For Arduino framework
+void setup() {
+	// Wait ~2 seconds before the Unity test runner
+	// establishes connection with a board Serial interface
+	delay(2000);
+
+	runUnityTests();
+}
+void loop() {}
+#endif
+
+// For ESP-IDF framework
+void app_main() {
+	runUnityTests();
+}
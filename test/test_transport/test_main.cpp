@@ -0,0 +1,786 @@
+#include <unity.h>
+
+#include "Transport.h"
+#include "TransportInstance.h"
+#include "Identity.h"
+#include "Destination.h"
+#include "Link.h"
+#include "Packet.h"
+#include "Interface.h"
+#include "Reticulum.h"
+#include "Cryptography/X25519.h"
+#include "Cryptography/Ed25519.h"
+#include "Utilities/OS.h"
+#include "Bytes.h"
+
+#include "../common/nodes/Nodes.h"
+
+#include <vector>
+
+using namespace RNS;
+
+void testDefaultInstance() {
+	TEST_ASSERT_EQUAL_PTR(&Transport::default_instance(), &Transport::instance());
+}
+
+void testInstanceLimits() {
+	TransportInstance node;
+	Transport::instance(node);
+	Transport::path_table_maxsize(42);
+	TEST_ASSERT_EQUAL_UINT32(42, Transport::path_table_maxsize());
+	TEST_ASSERT_EQUAL_UINT32(42, node._path_table_maxsize);
+
+	// Default instance keeps its own limits
+	Transport::instance(Transport::default_instance());
+	TEST_ASSERT_NOT_EQUAL(42, Transport::path_table_maxsize());
+}
+
+void testDefaultLimits() {
+	TransportInstance node;
+	Transport::instance(node);
+#if defined(NATIVE)
+	// Native hosts get the sizing of the reference implementation
+	TransportLimits expected = TransportLimits::desktop();
+#else
+	TransportLimits expected = TransportLimits::mcu();
+#endif
+	TEST_ASSERT_EQUAL_UINT32(expected._path_table_maxsize, Transport::limits()._path_table_maxsize);
+	TEST_ASSERT_EQUAL_UINT32(expected._path_table_maxsize, node._path_table_maxsize);
+	TEST_ASSERT_EQUAL_UINT32(expected._path_table_maxpersist, node._path_table_maxpersist);
+	TEST_ASSERT_EQUAL_UINT32(expected._hashlist_maxsize, node._hashlist_maxsize);
+	TEST_ASSERT_EQUAL_UINT32(expected._max_pr_tags, node._max_pr_tags);
+	TEST_ASSERT_EQUAL_UINT32(expected._known_destinations_maxsize, node._known_destinations_maxsize);
+	TEST_ASSERT_EQUAL_UINT32(expected._path_table_maxsize, Transport::path_table_maxsize());
+
+	// The MCU sizing can still be applied
+	Transport::limits(TransportLimits::mcu());
+	TEST_ASSERT_EQUAL_UINT32(100, node._path_table_maxsize);
+	TEST_ASSERT_EQUAL_UINT32(32, node._max_pr_tags);
+}
+
+void testLimitsByteBudget() {
+	TransportInstance node;
+	Transport::instance(node);
+
+	// Without byte budgets the entry counts apply as given
+	TransportLimits limits;
+	limits._path_table_maxsize = 50;
+	limits._path_table_maxpersist = 20;
+	limits._hashlist_maxsize = 60;
+	limits._known_destinations_maxsize = 70;
+	Transport::limits(limits);
+	TEST_ASSERT_EQUAL_UINT32(50, node._path_table_maxsize);
+	TEST_ASSERT_EQUAL_UINT32(20, node._path_table_maxpersist);
+	TEST_ASSERT_EQUAL_UINT32(60, node._hashlist_maxsize);
+	TEST_ASSERT_EQUAL_UINT32(70, node._known_destinations_maxsize);
+	TEST_ASSERT_EQUAL_UINT32(50, Transport::limits()._path_table_maxsize);
+
+	// A budget too small for one entry still leaves room for one
+	limits._path_table_maxbytes = 1;
+	limits._hashlist_maxbytes = 1;
+	limits._known_destinations_maxbytes = 1;
+	Transport::limits(limits);
+	TEST_ASSERT_EQUAL_UINT32(1, node._path_table_maxsize);
+	TEST_ASSERT_EQUAL_UINT32(1, node._path_table_maxpersist);
+	TEST_ASSERT_EQUAL_UINT32(1, node._hashlist_maxsize);
+	TEST_ASSERT_EQUAL_UINT32(1, node._known_destinations_maxsize);
+
+	// The known destination estimate covers at least the real map entry
+	limits._known_destinations_maxbytes = 10 * sizeof(decltype(node._known_destinations)::value_type);
+	Transport::limits(limits);
+	TEST_ASSERT_TRUE(node._known_destinations_maxsize >= 1);
+	TEST_ASSERT_TRUE(node._known_destinations_maxsize < 10);
+
+	// Lowering a limit culls the table right away
+	limits = TransportLimits();
+	Transport::limits(limits);
+	Bytes public_key;
+	public_key.writable(Type::Identity::KEYSIZE/8);
+	for (uint8_t n = 0; n < 5; ++n) {
+		Bytes destination_hash("0123456789abcde");
+		destination_hash.append(n);
+		Identity::remember("packet_hash", destination_hash, public_key);
+	}
+	TEST_ASSERT_EQUAL_size_t(5, node._known_destinations.size());
+	limits._known_destinations_maxsize = 2;
+	Transport::limits(limits);
+	TEST_ASSERT_EQUAL_size_t(2, node._known_destinations.size());
+}
+
+void testInstanceKnownDestinations() {
+	TransportInstance node_a;
+	TransportInstance node_b;
+	Bytes destination_hash("0123456789abcdef");
+	Bytes public_key;
+	public_key.writable(Type::Identity::KEYSIZE/8);
+
+	Transport::instance(node_a);
+	Identity::remember("packet_hash", destination_hash, public_key, "app_data");
+	TEST_ASSERT_EQUAL_STRING("app_data", Identity::recall_app_data(destination_hash).toString().c_str());
+	TEST_ASSERT_EQUAL_size_t(1, node_a._known_destinations.size());
+
+	// Identities remembered by one node are not known to another
+	Transport::instance(node_b);
+	TEST_ASSERT_FALSE(Identity::recall_app_data(destination_hash));
+	TEST_ASSERT_EQUAL_size_t(0, node_b._known_destinations.size());
+
+	Transport::instance(Transport::default_instance());
+	TEST_ASSERT_FALSE(Identity::recall_app_data(destination_hash));
+}
+
+void testRecallSharesDecodedKeys() {
+	TransportInstance node;
+	Transport::instance(node);
+	Identity identity;
+	Bytes destination_hash("fedcba9876543210");
+	Identity::remember("packet_hash", destination_hash, identity.get_public_key());
+
+	Identity first = Identity::recall(destination_hash);
+	TEST_ASSERT_TRUE(first);
+	TEST_ASSERT_TRUE(first.hash() == identity.hash());
+	TEST_ASSERT_TRUE(first.get_public_key() == identity.get_public_key());
+
+	// Later recalls reuse the keys decoded on first recall
+	Identity second = Identity::recall(destination_hash);
+	TEST_ASSERT_TRUE(second.hash() == identity.hash());
+	TEST_ASSERT_TRUE(first.sig_pub() == second.sig_pub());
+	TEST_ASSERT_TRUE(first.pub() == second.pub());
+
+	Bytes message("message");
+	TEST_ASSERT_TRUE(second.validate(identity.sign(message), message));
+}
+
+void testBroadcastFanout() {
+	TransportInstance node;
+	Transport::instance(node);
+	CaptureInterface* open_impl = new CaptureInterface("open");
+	CaptureInterface* access_point_impl = new CaptureInterface("access_point");
+	CaptureInterface* receive_only_impl = new CaptureInterface("receive_only", false);
+	Interface open_interface(open_impl);
+	Interface access_point_interface(access_point_impl);
+	access_point_interface.mode(Type::Interface::MODE_ACCESS_POINT);
+	Interface receive_only_interface(receive_only_impl);
+	Transport::register_interface(open_interface);
+	Transport::register_interface(access_point_interface);
+	Transport::register_interface(receive_only_interface);
+
+	// Data without a known path goes out on every outgoing interface as one shared buffer
+	Destination plain({Type::NONE}, Type::Destination::OUT, Type::Destination::PLAIN, "test", "fanout");
+	Packet packet(plain, "data");
+	packet.send();
+	TEST_ASSERT_EQUAL_size_t(1, open_impl->_sent.size());
+	TEST_ASSERT_EQUAL_size_t(1, access_point_impl->_sent.size());
+	TEST_ASSERT_EQUAL_size_t(0, receive_only_impl->_sent.size());
+	TEST_ASSERT_TRUE(open_impl->_sent[0] == packet.raw());
+	TEST_ASSERT_EQUAL_PTR(packet.raw().data(), open_impl->_sent[0].data());
+	TEST_ASSERT_EQUAL_PTR(packet.raw().data(), access_point_impl->_sent[0].data());
+
+	// Announces are not broadcast on access point interfaces
+	Identity identity;
+	Destination announcing(identity, Type::Destination::IN, Type::Destination::SINGLE, "test", "fanout");
+	announcing.announce();
+	TEST_ASSERT_EQUAL_size_t(2, open_impl->_sent.size());
+	TEST_ASSERT_EQUAL_size_t(1, access_point_impl->_sent.size());
+	TEST_ASSERT_EQUAL_size_t(0, receive_only_impl->_sent.size());
+
+	Transport::deregister_interface(open_interface);
+	Transport::deregister_interface(access_point_interface);
+	Transport::deregister_interface(receive_only_interface);
+}
+
+static std::vector<bool> path_responses;
+
+static void on_path_response_a(const Bytes& destination_hash, bool path_found) {
+	path_responses.push_back(path_found);
+}
+
+static void on_path_response_b(const Bytes& destination_hash, bool path_found) {
+	path_responses.push_back(path_found);
+}
+
+void testPathRequestCoalescing() {
+	TransportInstance node;
+	Transport::instance(node);
+	CaptureInterface* impl = new CaptureInterface("capture");
+	Interface interface(impl);
+	Transport::register_interface(interface);
+	path_responses.clear();
+
+	Bytes destination_hash("0123456789abcdef");
+	Transport::request_path(destination_hash, on_path_response_a);
+	Transport::request_path(destination_hash, on_path_response_b);
+	Transport::request_path(destination_hash);
+	// One request on the wire, both callers waiting on it
+	TEST_ASSERT_EQUAL_size_t(1, impl->_sent.size());
+	TEST_ASSERT_EQUAL_size_t(1, node._path_requests_in_flight.size());
+	TEST_ASSERT_EQUAL_size_t(2, node._path_requests_in_flight.find(destination_hash)->second._waiters.size());
+	TEST_ASSERT_EQUAL_size_t(0, path_responses.size());
+
+	// A request on a specific interface is covered by the broadcast one
+	Transport::request_path(destination_hash, interface);
+	TEST_ASSERT_EQUAL_size_t(1, impl->_sent.size());
+
+	Transport::deregister_interface(interface);
+}
+
+void testPathRequestAnswered() {
+	TransportInstance remote_node;
+	TransportInstance node;
+	CaptureInterface* impl = new CaptureInterface("capture");
+	Interface interface(impl);
+	path_responses.clear();
+
+	// The destination lives on another node, which answers with an announce
+	Transport::instance(remote_node);
+	Identity identity;
+	Destination remote(identity, Type::Destination::IN, Type::Destination::SINGLE, "test", "path");
+	Packet announce = remote.announce({Bytes::NONE}, true, {Type::NONE}, {Bytes::NONE}, false);
+	announce.pack();
+
+	Transport::instance(node);
+	Identity transport_identity;
+	Transport::identity(transport_identity);
+	Transport::register_interface(interface);
+	Transport::request_path(remote.hash(), on_path_response_a);
+	Transport::request_path(remote.hash(), on_path_response_b);
+	TEST_ASSERT_FALSE(Transport::has_path(remote.hash()));
+
+	Transport::inbound(announce.raw(), interface);
+	TEST_ASSERT_TRUE(Transport::has_path(remote.hash()));
+	// Every waiter is told, and the request is no longer in flight
+	TEST_ASSERT_EQUAL_size_t(2, path_responses.size());
+	TEST_ASSERT_TRUE(path_responses[0]);
+	TEST_ASSERT_TRUE(path_responses[1]);
+	TEST_ASSERT_EQUAL_size_t(0, node._path_requests_in_flight.size());
+
+	// With the path known, callers are answered right away
+	Transport::request_path(remote.hash(), on_path_response_a);
+	TEST_ASSERT_EQUAL_size_t(3, path_responses.size());
+	TEST_ASSERT_TRUE(path_responses[2]);
+
+	Transport::deregister_interface(interface);
+}
+
+void testPathRequestTimeout() {
+	TransportInstance node;
+	Transport::instance(node);
+	CaptureInterface* impl = new CaptureInterface("capture");
+	Interface interface(impl);
+	Transport::register_interface(interface);
+	path_responses.clear();
+
+	Bytes destination_hash("fedcba9876543210");
+	Transport::request_path(destination_hash, on_path_response_a);
+	Transport::request_path(destination_hash, on_path_response_b);
+	TEST_ASSERT_EQUAL_size_t(1, node._path_requests_in_flight.size());
+
+	// Not yet timed out
+	Transport::jobs();
+	TEST_ASSERT_EQUAL_size_t(0, path_responses.size());
+
+	node._path_requests_in_flight.find(destination_hash)->second._timeout = Utilities::OS::time() - 1.0;
+	Transport::jobs();
+	TEST_ASSERT_EQUAL_size_t(2, path_responses.size());
+	TEST_ASSERT_FALSE(path_responses[0]);
+	TEST_ASSERT_FALSE(path_responses[1]);
+	TEST_ASSERT_EQUAL_size_t(0, node._path_requests_in_flight.size());
+
+	// A new request goes on the wire again
+	Transport::request_path(destination_hash);
+	TEST_ASSERT_EQUAL_size_t(2, impl->_sent.size());
+
+	Transport::deregister_interface(interface);
+}
+
+void testLinkMtuSignalling() {
+	// 21 bits of MTU below 3 bits of link mode, big endian
+	Bytes signalling = Link::signalling_bytes(1064, Type::Link::MODE_AES256_CBC);
+	TEST_ASSERT_EQUAL_size_t(Type::Link::LINK_MTU_SIZE, signalling.size());
+	TEST_ASSERT_EQUAL_UINT8(Type::Link::MODE_AES256_CBC << 5, signalling[0] & Type::Link::MODE_BYTEMASK);
+	uint32_t mtu = ((signalling[0] << 16) | (signalling[1] << 8) | signalling[2]) & Type::Link::MTU_BYTEMASK;
+	TEST_ASSERT_EQUAL_UINT32(1064, mtu);
+}
+
+// Link request payload from a fresh initiator, signalling the given MTU
+static Bytes link_request_data(uint16_t mtu) {
+	Bytes data;
+	data << Cryptography::X25519PrivateKey::generate()->public_key()->public_bytes();
+	data << Cryptography::Ed25519PrivateKey::generate()->public_key()->public_bytes();
+	data << Link::signalling_bytes(mtu, Link::MODE_DEFAULT);
+	return data;
+}
+
+// Link request addressed to owner and relayed via transport_id, as Transport::outbound() frames it
+static Bytes link_request_in_transport(const Destination& owner, uint16_t mtu, const Bytes& transport_id) {
+	Packet request(owner, link_request_data(mtu), Type::Packet::LINKREQUEST);
+	request.pack();
+	Bytes raw;
+	raw << (uint8_t)((Type::Packet::HEADER_2 << 6) | (Type::Transport::TRANSPORT << 4) | (request.raw()[0] & 0b00001111));
+	raw << request.raw().mid(1, 1);
+	raw << transport_id;
+	raw << request.raw().mid(2);
+	return raw;
+}
+
+void testLinkRequestMtuClamp() {
+	TransportInstance node;
+	Transport::instance(node);
+	Identity transport_identity;
+	Transport::identity(transport_identity);
+	Identity identity;
+	Destination owner(identity, Type::Destination::IN, Type::Destination::SINGLE, "test", "mtu");
+	Interface autoconfigured(new CaptureInterface("autoconfigured", true, 1064));
+	Interface fixed(new CaptureInterface("fixed"));
+	Transport::register_interface(autoconfigured);
+	Transport::register_interface(fixed);
+
+	struct Case { const Interface& interface; uint16_t signalled; uint16_t expected; };
+	const Case cases[] = {
+		// Below the receiving interface, the signalled path minimum stands
+		{autoconfigured, 800, 800},
+		// Above it, clamped to the interface HW MTU
+		{autoconfigured, 2000, 1064},
+		// Interfaces without MTU autoconfiguration carry the default MTU
+		{fixed, 800, Type::Reticulum::MTU},
+	};
+	for (const Case& test_case : cases) {
+		Bytes data = link_request_data(test_case.signalled);
+		Packet request(owner, data, Type::Packet::LINKREQUEST);
+		request.pack();
+		request.receiving_interface(test_case.interface);
+		Link link = Link::validate_request(owner, data, request);
+		TEST_ASSERT_TRUE(link);
+		TEST_ASSERT_EQUAL_UINT16(test_case.expected, link.mtu());
+	}
+
+	// Without MTU signalling the link keeps the default MTU
+	Bytes data = link_request_data(800).left(Type::Link::ECPUBSIZE);
+	Packet request(owner, data, Type::Packet::LINKREQUEST);
+	request.pack();
+	request.receiving_interface(autoconfigured);
+	Link link = Link::validate_request(owner, data, request);
+	TEST_ASSERT_TRUE(link);
+	TEST_ASSERT_EQUAL_UINT16(Type::Reticulum::MTU, link.mtu());
+
+	Transport::deregister_interface(autoconfigured);
+	Transport::deregister_interface(fixed);
+}
+
+void testLinkMtuForwarding() {
+	TransportInstance remote_node;
+	TransportInstance node;
+	CaptureInterface* initiator_impl = new CaptureInterface("initiator", true, 1064);
+	CaptureInterface* responder_impl = new CaptureInterface("responder", true, 400);
+	Interface initiator_side(initiator_impl);
+	Interface responder_side(responder_impl);
+
+	// The responding destination is one hop away on the responder side
+	Transport::instance(remote_node);
+	Identity identity;
+	Destination owner(identity, Type::Destination::IN, Type::Destination::SINGLE, "test", "mtu");
+	Packet announce = owner.announce({Bytes::NONE}, true, {Type::NONE}, {Bytes::NONE}, false);
+	announce.pack();
+
+	Transport::instance(node);
+	Identity transport_identity;
+	Transport::identity(transport_identity);
+	bool transport_enabled = Reticulum::transport_enabled();
+	Reticulum::transport_enabled(true);
+	Transport::register_interface(initiator_side);
+	Transport::register_interface(responder_side);
+	Transport::inbound(announce.raw(), responder_side);
+	TEST_ASSERT_TRUE(Transport::has_path(owner.hash()));
+
+	// A link request signalling more than the next hop carries is clamped to it
+	size_t sent = responder_impl->_sent.size();
+	Transport::inbound(link_request_in_transport(owner, 1064, transport_identity.hash()), initiator_side);
+	TEST_ASSERT_EQUAL_size_t(sent + 1, responder_impl->_sent.size());
+	Packet forwarded(Destination(Type::NONE), responder_impl->_sent.back());
+	TEST_ASSERT_TRUE(forwarded.unpack());
+	TEST_ASSERT_EQUAL_INT(Type::Packet::LINKREQUEST, forwarded.packet_type());
+	TEST_ASSERT_EQUAL_UINT16(400, Link::mtu_from_lr_packet(forwarded));
+	TEST_ASSERT_EQUAL_size_t(1, node._link_table.size());
+
+	// The proof signalling the clamped MTU is carried back unchanged
+	Bytes link_id = node._link_table.begin()->first;
+	Bytes responder_pub = Cryptography::X25519PrivateKey::generate()->public_key()->public_bytes();
+	Bytes signalling = Link::signalling_bytes(400, Link::MODE_DEFAULT);
+	Bytes signature = identity.sign(link_id + responder_pub + identity.get_public_key().mid(Type::Link::ECPUBSIZE/2, Type::Link::ECPUBSIZE/2) + signalling);
+	Bytes proof;
+	proof << (uint8_t)((Type::Packet::HEADER_1 << 6) | (Type::Transport::BROADCAST << 4) | (Type::Destination::LINK << 2) | Type::Packet::PROOF);
+	proof << (uint8_t)0;
+	proof << link_id;
+	proof << (uint8_t)Type::Packet::LRPROOF;
+	proof << signature << responder_pub << signalling;
+	sent = initiator_impl->_sent.size();
+	Transport::inbound(proof, responder_side);
+	TEST_ASSERT_EQUAL_size_t(sent + 1, initiator_impl->_sent.size());
+	Packet forwarded_proof(Destination(Type::NONE), initiator_impl->_sent.back());
+	TEST_ASSERT_TRUE(forwarded_proof.unpack());
+	TEST_ASSERT_EQUAL_UINT16(400, Link::mtu_from_lp_packet(forwarded_proof));
+	TEST_ASSERT_TRUE(node._link_table.begin()->second._validated);
+
+	// Next hops without MTU autoconfiguration drop the signalling
+	responder_impl->autoconfigure_mtu(false);
+	Transport::inbound(link_request_in_transport(owner, 1064, transport_identity.hash()), initiator_side);
+	Packet stripped(Destination(Type::NONE), responder_impl->_sent.back());
+	TEST_ASSERT_TRUE(stripped.unpack());
+	TEST_ASSERT_EQUAL_size_t(Type::Link::ECPUBSIZE, stripped.data().size());
+
+	Reticulum::transport_enabled(transport_enabled);
+	Transport::deregister_interface(initiator_side);
+	Transport::deregister_interface(responder_side);
+}
+
+void testLinkWatchdogTimeout() {
+	TransportInstance node;
+	Transport::instance(node);
+	Identity identity;
+	Destination owner(identity, Type::Destination::IN, Type::Destination::SINGLE, "test", "watchdog");
+
+	// Incoming link that never completes its handshake
+	Link link({Type::NONE}, nullptr, nullptr, owner);
+	link.establishment_timeout(0.05);
+	link.request_time(Utilities::OS::time());
+	link.start_watchdog();
+	TEST_ASSERT_EQUAL_size_t(1, node._deadlines.size());
+
+	// First run moves the deadline out to the end of the establishment timeout
+	Transport::run_deadlines();
+	TEST_ASSERT_EQUAL_INT(Type::Link::PENDING, link.status());
+	TEST_ASSERT_EQUAL_size_t(1, node._deadlines.size());
+	node._jobs_last_run = Utilities::OS::time();
+	TEST_ASSERT_TRUE(Transport::next_wakeup() == link.request_time() + link.establishment_timeout());
+
+	while (Utilities::OS::time() < link.request_time() + link.establishment_timeout()) {
+		Utilities::OS::sleep((float)0.01);
+	}
+	Transport::run_deadlines();
+	TEST_ASSERT_EQUAL_INT(Type::Link::CLOSED, link.status());
+	TEST_ASSERT_EQUAL_INT(Type::Link::TIMEOUT, link.teardown_reason());
+	// Closed links leave the schedule
+	TEST_ASSERT_EQUAL_size_t(0, node._deadlines.size());
+}
+
+void testLinkWatchdogCancelledOnClose() {
+	TransportInstance node;
+	Transport::instance(node);
+	Identity identity;
+	Destination owner(identity, Type::Destination::IN, Type::Destination::SINGLE, "test", "watchdog");
+
+	Link link({Type::NONE}, nullptr, nullptr, owner);
+	link.establishment_timeout(60.0);
+	link.request_time(Utilities::OS::time());
+	link.start_watchdog();
+	Transport::run_deadlines();
+	TEST_ASSERT_EQUAL_size_t(1, node._deadlines.size());
+
+	link.teardown();
+	TEST_ASSERT_EQUAL_size_t(0, node._deadlines.size());
+}
+
+void testLinkCoalescedFraming() {
+	Bytes payload;
+	Bytes small("hello");
+	Bytes large;
+	for (int i = 0; i < 300; i++) {
+		large << (uint8_t)i;
+	}
+	Link::append_coalesced(payload, small);
+	Link::append_coalesced(payload, large);
+	Link::append_coalesced(payload, {Bytes::NONE});
+	// One length byte below 0x80, two above
+	TEST_ASSERT_EQUAL_size_t(1 + 5 + 2 + 300 + 1, payload.size());
+	TEST_ASSERT_EQUAL_UINT8(0x81, payload[6]);
+	TEST_ASSERT_EQUAL_UINT8(0x2c, payload[7]);
+
+	std::vector<Bytes> messages;
+	TEST_ASSERT_TRUE(Link::split_coalesced(payload, messages));
+	TEST_ASSERT_EQUAL_size_t(3, messages.size());
+	TEST_ASSERT_TRUE(messages[0] == small);
+	TEST_ASSERT_TRUE(messages[1] == large);
+	TEST_ASSERT_EQUAL_size_t(0, messages[2].size());
+
+	// Truncated within a length or a message
+	TEST_ASSERT_FALSE(Link::split_coalesced(payload.left(7), messages));
+	TEST_ASSERT_FALSE(Link::split_coalesced(payload.left(100), messages));
+}
+
+static std::vector<Bytes> link_messages;
+
+static void on_link_message(const Bytes& plaintext, const Packet& packet) {
+	link_messages.push_back(plaintext);
+}
+
+static void on_coalescing_link_established(Link& link) {
+	link.set_packet_callback(on_link_message);
+}
+
+// Sets up a link from the initiator to a destination on the responder, with
+// coalescing turned on and signalled both ways
+static Link establish_coalescing(Node& initiator, Node& responder, double latency_budget) {
+	Link link(establish(initiator, responder, responder._identity, on_coalescing_link_established));
+	TEST_ASSERT_EQUAL_INT(Type::Link::ACTIVE, link.status());
+	link.set_coalescing(latency_budget);
+	exchange(initiator, responder);
+	link_messages.clear();
+	return link;
+}
+
+static Type::Packet::context_types sent_context(const Bytes& raw) {
+	Packet packet(Destination(Type::NONE), raw);
+	TEST_ASSERT_TRUE(packet.unpack());
+	return packet.context();
+}
+
+void testLinkCoalescedSizeFlush() {
+	Node responder("responder");
+	Node initiator("initiator");
+	Link link(establish_coalescing(initiator, responder, 60.0));
+
+	// Messages are held until the next would not fit in one packet
+	Bytes message;
+	for (int i = 0; i < 100; i++) {
+		message << (uint8_t)i;
+	}
+	size_t held = link.get_mdu() / (message.size() + 1);
+	// The link shares the schedule with its watchdog
+	const size_t scheduled = initiator._transport._deadlines.size();
+	for (size_t i = 0; i < held; i++) {
+		link.send_coalesced(message);
+	}
+	TEST_ASSERT_EQUAL_size_t(0, initiator._impl->_sent.size());
+	TEST_ASSERT_EQUAL_size_t(scheduled + 1, initiator._transport._deadlines.size());
+	link.send_coalesced(message);
+	TEST_ASSERT_EQUAL_size_t(1, initiator._impl->_sent.size());
+	TEST_ASSERT_EQUAL_INT(Type::Packet::COALESCED, sent_context(initiator._impl->_sent.back()));
+	// The message that did not fit starts the next queue
+	TEST_ASSERT_EQUAL_size_t(scheduled + 1, initiator._transport._deadlines.size());
+
+	// Handed to the packet callback one by one
+	exchange(initiator, responder);
+	TEST_ASSERT_EQUAL_size_t(held, link_messages.size());
+	for (auto& received : link_messages) {
+		TEST_ASSERT_TRUE(received == message);
+	}
+
+	// Turning coalescing off sends what is queued, and later messages right away
+	initiator.enter();
+	link.set_coalescing(0.0);
+	TEST_ASSERT_EQUAL_size_t(scheduled, initiator._transport._deadlines.size());
+	link.send_coalesced("unqueued");
+	TEST_ASSERT_EQUAL_size_t(2, initiator._impl->_sent.size());
+	exchange(initiator, responder);
+	TEST_ASSERT_EQUAL_size_t(held + 2, link_messages.size());
+	TEST_ASSERT_TRUE(link_messages[held] == message);
+	TEST_ASSERT_TRUE(link_messages[held + 1] == "unqueued");
+}
+
+void testLinkCoalescedDeadline() {
+	Node responder("responder");
+	Node initiator("initiator");
+	Link link(establish_coalescing(initiator, responder, 0.05));
+
+	double queued = Utilities::OS::time();
+	const size_t scheduled = initiator._transport._deadlines.size();
+	link.send_coalesced("one");
+	link.send_coalesced("two");
+	TEST_ASSERT_EQUAL_size_t(0, initiator._impl->_sent.size());
+	TEST_ASSERT_EQUAL_size_t(scheduled + 1, initiator._transport._deadlines.size());
+	double deadline = last_deadline(initiator._transport);
+	TEST_ASSERT_TRUE(deadline >= queued + 0.05);
+	initiator._transport._jobs_last_run = Utilities::OS::time();
+	TEST_ASSERT_TRUE(Transport::next_wakeup() <= deadline);
+
+	// Nothing is sent before the deadline
+	Transport::run_deadlines();
+	TEST_ASSERT_EQUAL_size_t(0, initiator._impl->_sent.size());
+	while (Utilities::OS::time() < deadline) {
+		Utilities::OS::sleep((float)0.01);
+	}
+	Transport::run_deadlines();
+	TEST_ASSERT_EQUAL_size_t(1, initiator._impl->_sent.size());
+	TEST_ASSERT_EQUAL_INT(Type::Packet::COALESCED, sent_context(initiator._impl->_sent.back()));
+	TEST_ASSERT_FALSE(is_scheduled(initiator._transport, deadline));
+
+	exchange(initiator, responder);
+	TEST_ASSERT_EQUAL_size_t(2, link_messages.size());
+	TEST_ASSERT_TRUE(link_messages[0] == "one");
+	TEST_ASSERT_TRUE(link_messages[1] == "two");
+}
+
+void testLinkCoalescedLoneMessage() {
+	Node responder("responder");
+	Node initiator("initiator");
+	Link link(establish_coalescing(initiator, responder, 60.0));
+
+	// A lone message goes out as an ordinary packet
+	const size_t scheduled = initiator._transport._deadlines.size();
+	link.send_coalesced("alone");
+	link.flush_coalesced();
+	TEST_ASSERT_EQUAL_size_t(1, initiator._impl->_sent.size());
+	TEST_ASSERT_EQUAL_INT(Type::Packet::CONTEXT_NONE, sent_context(initiator._impl->_sent.back()));
+	TEST_ASSERT_EQUAL_size_t(scheduled, initiator._transport._deadlines.size());
+
+	// As does a message too large to queue, without waiting for the queue
+	initiator.enter();
+	Bytes large;
+	for (size_t i = 0; i < link.get_mdu(); i++) {
+		large << (uint8_t)i;
+	}
+	link.send_coalesced("queued");
+	link.send_coalesced(large);
+	TEST_ASSERT_EQUAL_size_t(3, initiator._impl->_sent.size());
+	TEST_ASSERT_EQUAL_INT(Type::Packet::CONTEXT_NONE, sent_context(initiator._impl->_sent[1]));
+	TEST_ASSERT_EQUAL_INT(Type::Packet::CONTEXT_NONE, sent_context(initiator._impl->_sent[2]));
+
+	exchange(initiator, responder);
+	TEST_ASSERT_EQUAL_size_t(3, link_messages.size());
+	TEST_ASSERT_TRUE(link_messages[0] == "alone");
+	TEST_ASSERT_TRUE(link_messages[1] == "queued");
+	TEST_ASSERT_TRUE(link_messages[2] == large);
+}
+
+void testLinkCoalescedNegotiation() {
+	Node responder("responder");
+	Node initiator("initiator");
+	Link link(establish(initiator, responder, responder._identity, on_coalescing_link_established));
+	link_messages.clear();
+
+	// Turning coalescing on signals support with a single empty message
+	link.set_coalescing(60.0);
+	TEST_ASSERT_EQUAL_size_t(1, initiator._impl->_sent.size());
+	TEST_ASSERT_EQUAL_INT(Type::Packet::COALESCED, sent_context(initiator._impl->_sent.back()));
+
+	// A reference peer drops the unknown context and never signals back, so
+	// messages go out in a packet each
+	TEST_ASSERT_EQUAL_size_t(0, deliver(initiator, responder, Type::Packet::COALESCED));
+	initiator.enter();
+	const size_t scheduled = initiator._transport._deadlines.size();
+	link.send_coalesced("one");
+	link.send_coalesced("two");
+	TEST_ASSERT_EQUAL_size_t(2, initiator._impl->_sent.size());
+	TEST_ASSERT_EQUAL_INT(Type::Packet::CONTEXT_NONE, sent_context(initiator._impl->_sent[0]));
+	TEST_ASSERT_EQUAL_INT(Type::Packet::CONTEXT_NONE, sent_context(initiator._impl->_sent[1]));
+	TEST_ASSERT_EQUAL_size_t(scheduled, initiator._transport._deadlines.size());
+
+	// The signal is sent once per link
+	link.set_coalescing(0.0);
+	link.set_coalescing(60.0);
+	TEST_ASSERT_EQUAL_size_t(2, initiator._impl->_sent.size());
+
+	exchange(initiator, responder);
+	TEST_ASSERT_EQUAL_size_t(2, link_messages.size());
+	TEST_ASSERT_TRUE(link_messages[0] == "one");
+	TEST_ASSERT_TRUE(link_messages[1] == "two");
+}
+
+void testLinkRequestEncoding() {
+	// umsgpack.packb([1.5, b"\x01\x02", b"x"]) as in the reference implementation
+	Bytes expected;
+	expected.appendHex("93cb3ff8000000000000c4020102c40178");
+	Bytes path_hash;
+	path_hash.appendHex("0102");
+	Bytes packed;
+	Link::pack_request(packed, 1.5, path_hash, "x");
+	TEST_ASSERT_TRUE(packed == expected);
+
+	ResourceRequest request;
+	Link::unpack_request(packed, request);
+	TEST_ASSERT_TRUE(request._requested_at == 1.5);
+	TEST_ASSERT_TRUE(request._path_hash == path_hash);
+	TEST_ASSERT_TRUE(request._request_data == "x");
+
+	// An integer timestamp, a string path hash and no data
+	Bytes other;
+	other.appendHex("9301a170c0");
+	Link::unpack_request(other, request);
+	TEST_ASSERT_TRUE(request._requested_at == 1.0);
+	TEST_ASSERT_TRUE(request._path_hash == "p");
+	TEST_ASSERT_FALSE(request._request_data);
+
+	// umsgpack.packb([b"\xaa", b"ok"])
+	expected.clear();
+	expected.appendHex("92c401aac4026f6b");
+	Bytes request_id;
+	request_id.appendHex("aa");
+	packed.clear();
+	Link::pack_response(packed, request_id, "ok");
+	TEST_ASSERT_TRUE(packed == expected);
+	Bytes unpacked_id;
+	Bytes response;
+	TEST_ASSERT_EQUAL_size_t(4, Link::unpack_response(packed, unpacked_id, response));
+	TEST_ASSERT_TRUE(unpacked_id == request_id);
+	TEST_ASSERT_TRUE(response == "ok");
+
+	// Truncated anywhere
+	for (size_t size = 0; size < packed.size(); size++) {
+		bool thrown = false;
+		try {
+			Link::unpack_response(packed.left(size), unpacked_id, response);
+		}
+		catch (std::invalid_argument& e) {
+			thrown = true;
+		}
+		TEST_ASSERT_TRUE(thrown);
+	}
+}
+
+
+void setUp(void) {
+    // set stuff up here before each test
+}
+
+void tearDown(void) {
+    // clean stuff up here after each test
+	link_messages.clear();
+	Transport::instance(Transport::default_instance());
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+	RUN_TEST(testDefaultInstance);
+	RUN_TEST(testInstanceLimits);
+	RUN_TEST(testDefaultLimits);
+	RUN_TEST(testLimitsByteBudget);
+	RUN_TEST(testInstanceKnownDestinations);
+	RUN_TEST(testRecallSharesDecodedKeys);
+	RUN_TEST(testBroadcastFanout);
+	RUN_TEST(testPathRequestCoalescing);
+	RUN_TEST(testPathRequestAnswered);
+	RUN_TEST(testPathRequestTimeout);
+	RUN_TEST(testLinkMtuSignalling);
+	RUN_TEST(testLinkRequestMtuClamp);
+	RUN_TEST(testLinkMtuForwarding);
+	RUN_TEST(testLinkWatchdogTimeout);
+	RUN_TEST(testLinkWatchdogCancelledOnClose);
+	RUN_TEST(testLinkCoalescedFraming);
+	RUN_TEST(testLinkCoalescedSizeFlush);
+	RUN_TEST(testLinkCoalescedDeadline);
+	RUN_TEST(testLinkCoalescedLoneMessage);
+	RUN_TEST(testLinkCoalescedNegotiation);
+	RUN_TEST(testLinkRequestEncoding);
+    return UNITY_END();
+}
+
+// For native dev-platform or for some embedded frameworks
+int main(void) {
+    return runUnityTests();
+}
+
+#ifdef ARDUINO
+// For Arduino framework
+void setup() {
+    // Wait ~2 seconds before the Unity test runner
+    // establishes connection with a board Serial interface
+    delay(2000);
+
+    runUnityTests();
+}
+void loop() {}
+#endif
+
+// For ESP-IDF framework
+void app_main() {
+    runUnityTests();
+}